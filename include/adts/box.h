@@ -2,9 +2,19 @@
 
 #include "n00b.h"
 
+extern n00b_obj_t n00b_box_cache_get(n00b_box_t, n00b_type_t *);
+
+// Boxes are immutable, so small ints get a shared box out of a cache;
+// don't write through a pointer you get from here.
 static inline n00b_obj_t
 n00b_box_obj(n00b_box_t value, n00b_type_t *type)
 {
+    n00b_obj_t result = n00b_box_cache_get(value, type);
+
+    if (result) {
+        return result;
+    }
+
     return n00b_new(n00b_type_box(type), value);
 }
 
@@ -51,6 +51,9 @@ extern void        *n00b_list_view(n00b_list_t *, uint64_t *);
 extern void         n00b_private_list_reverse(n00b_list_t *);
 extern void         n00b_list_reverse(n00b_list_t *);
 extern n00b_list_t *_n00b_to_list(n00b_type_t *, int, ...);
+extern void         n00b_list_cow_append(_Atomic(n00b_list_t *) *, void *);
+extern bool         n00b_list_cow_remove_item(_Atomic(n00b_list_t *) *,
+                                              void *);
 extern int          n00b_lexical_sort(const n00b_string_t **,
                                       const n00b_string_t **);
 
@@ -110,6 +113,15 @@ n00b_list_sort(n00b_list_t *list, void *f)
     n00b_unlock_list(list);
 }
 
+// Kernels for lists of ints and f64s; see list_values.nc.
+extern int64_t n00b_list_sum_ints(n00b_list_t *);
+extern double  n00b_list_sum_floats(n00b_list_t *);
+extern int64_t n00b_list_min_int(n00b_list_t *, bool *);
+extern int64_t n00b_list_max_int(n00b_list_t *, bool *);
+extern double  n00b_list_min_float(n00b_list_t *, bool *);
+extern double  n00b_list_max_float(n00b_list_t *, bool *);
+extern void    n00b_list_sort_ints(n00b_list_t *);
+
 #ifdef N00B_USE_INTERNAL_API
 extern void n00b_list_add_if_unique(n00b_list_t *list,
                                     void        *item,
@@ -0,0 +1,57 @@
+#pragma once
+#include "n00b.h"
+
+// Ropes hold a sequence of bytes as a tree of fragments, so that
+// appending and concatenating never copy. They're immutable; every
+// append or concatenation gives you a new rope that shares structure
+// with its inputs.
+//
+// Leaves point at the data they were built from, instead of copying
+// it, so don't modify a buffer once you've added it to a rope.
+typedef struct n00b_rope_t n00b_rope_t;
+
+struct n00b_rope_t {
+    // Interior nodes have both children; leaves have neither, and
+    // point at their data.
+    n00b_rope_t *left;
+    n00b_rope_t *right;
+    char        *data;
+    // For leaves, the buffer or string 'data' came from, which keeps
+    // it alive as long as the rope is.
+    void        *source;
+    int64_t      byte_len;
+    int32_t      depth;
+    int32_t      num_leaves;
+    // The contiguous version, once someone has needed it.
+    n00b_buf_t  *flat;
+};
+
+extern n00b_rope_t   *n00b_rope_concat(n00b_rope_t *, n00b_rope_t *);
+extern n00b_rope_t   *n00b_rope_append_buffer(n00b_rope_t *, n00b_buf_t *);
+extern n00b_rope_t   *n00b_rope_append_string(n00b_rope_t *,
+                                              n00b_string_t *);
+extern int64_t        n00b_rope_len(n00b_rope_t *);
+extern n00b_buf_t    *n00b_rope_to_buffer(n00b_rope_t *);
+extern n00b_string_t *n00b_rope_to_string(n00b_rope_t *);
+extern struct iovec  *n00b_rope_iovec(n00b_rope_t *, int *);
+extern int64_t        n00b_rope_write_fd(n00b_rope_t *, int);
+
+static inline n00b_rope_t *
+n00b_rope_empty(void)
+{
+    return n00b_new(n00b_type_rope());
+}
+
+static inline n00b_rope_t *
+n00b_rope_from_buffer(n00b_buf_t *b)
+{
+    return n00b_new(n00b_type_rope(),
+                    n00b_header_kargs("buffer", (int64_t)b));
+}
+
+static inline n00b_rope_t *
+n00b_rope_from_string(n00b_string_t *s)
+{
+    return n00b_new(n00b_type_rope(),
+                    n00b_header_kargs("string", (int64_t)s));
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include "n00b.h"
+
+// On-disk cache of fully generated programs. Entries are keyed by
+// the entry point, the module search path and the compiler version,
+// and carry a manifest of every module that went into the image
+// along with the SHA-256 of the source it was compiled from. A
+// lookup only succeeds if every one of those sources is unchanged.
+//
+// The cache lives in $N00B_CACHE_DIR if set, otherwise
+// $XDG_CACHE_HOME/n00b, falling back to ~/.cache/n00b. Setting
+// N00B_NO_CACHE in the environment turns it off entirely.
+
+// Bump when the file layout changes.
+#define N00B_COMPILE_CACHE_MAGIC 0x6e30306263616369ULL
+#define N00B_COMPILE_CACHE_EXT   "n00bc"
+
+extern bool           n00b_compile_cache_enabled(void);
+extern n00b_string_t *n00b_compile_cache_dir(void);
+extern n00b_vm_t     *n00b_compile_cache_lookup(n00b_string_t *);
+extern bool           n00b_compile_cache_store(n00b_string_t *, n00b_vm_t *);
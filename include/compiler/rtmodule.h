@@ -110,7 +110,9 @@ n00b_path_is_url(n00b_string_t *path)
 #define N00B_SET_INDEX "$set_index"
 #define N00B_SET_SLICE "$set_slice"
 
-void n00b_vm_remove_compile_time_data(n00b_vm_t *);
+void         n00b_vm_remove_compile_time_data(n00b_vm_t *);
+n00b_list_t *n00b_vm_stash_compile_time_data(n00b_vm_t *);
+void         n00b_vm_restore_compile_time_data(n00b_list_t *);
 
 n00b_string_t *n00b_repr_one_n00b_node(n00b_pnode_t *);
 static inline n00b_table_t *
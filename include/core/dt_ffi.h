@@ -80,6 +80,15 @@ typedef struct n00b_ffi_decl_t {
     int64_t                global_ffi_call_ix;
 } n00b_ffi_decl_t;
 
+// What the VM needs to make a call, worked out once when the VM
+// starts, instead of on every call. Not saved; see n00b_zrun_state_t.
+typedef struct {
+    n00b_zffi_cif *cif;
+    // Where in an 8-byte value slot each argument's bits live, for
+    // arguments narrower than the slot.
+    uint8_t       *val_offset;
+} n00b_ffi_plan_t;
+
 extern n00b_ffi_type ffi_type_void;
 extern n00b_ffi_type ffi_type_uint8;
 extern n00b_ffi_type ffi_type_sint8;
@@ -3,8 +3,10 @@
 #include "n00b.h"
 
 typedef struct {
-    char *kw;
-    void *value;
+    char    *kw;
+    // n00b_karg_hash() of 'kw'; this is what callees actually match on.
+    uint64_t hash;
+    void    *value;
 } n00b_one_karg_t;
 
 typedef struct {
@@ -165,6 +165,7 @@ typedef enum : int64_t {
     N00B_T_SESSION,
     N00B_T_SESSION_STATE,
     N00B_T_SESSION_TRIGGER,
+    N00B_T_ROPE,
     N00B_NUM_BUILTIN_DTS,
 } n00b_builtin_t;
 
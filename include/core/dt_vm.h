@@ -506,6 +506,11 @@ typedef struct {
 typedef struct {
     // The stuff in this struct isn't saved out; it needs to be
     // reinitialized on each startup.
+    //
+    // Call plans for foreign functions, indexed the same as
+    // obj->ffi_info.
+    n00b_ffi_plan_t *ffi_plans;
+    int32_t          num_ffi_plans;
 #ifdef N00B_DEV
     n00b_buf_t           *print_buf;
     struct n00b_stream_t *print_stream;
@@ -558,6 +563,21 @@ typedef struct {
     n00b_obj_t r2;
     n00b_obj_t r3;
 
+    // Nothing past this point gets scanned by the collector.
+
+    // Scratch space for FFI call arguments, so that calls don't need
+    // to allocate. Anything that's a pointer is also still on the
+    // stack for the duration of the call. Calls w/ more arguments
+    // than this fall back to allocating.
+    void      *ffi_args[N00B_FFI_MAX_ARGS];
+    n00b_box_t ffi_vals[N00B_FFI_MAX_ARGS];
+
+    // How many allocations FFI calls on this thread have needed, for
+    // boxing arguments or converting return values. Calls w/ concrete
+    // scalar types and at most N00B_FFI_MAX_ARGS arguments shouldn't
+    // need any; a cstring return always does.
+    uint64_t ffi_allocs;
+
     // pc is the current program counter, which is an index into current_module
     // instructions array.
     uint32_t pc;
@@ -41,7 +41,7 @@ typedef struct n00b_alloc_record_t {
     uint8_t n00b_debug : 1;
 #endif
 
-    uint64_t cached_hash[2];
+    uint64_t forward;
     alignas(N00B_FORCED_ALIGNMENT) uint64_t data[0];
 } n00b_alloc_record_t;
 
@@ -57,10 +57,9 @@ struct n00b_alloc_hdr {
     // /dev/urandom, to make sure that we do not start adding
     // references  in memory to it.
     uint64_t guard;
-    // This can eventually go down to just a 32-bit int.  For the
-    // moment, this pointer gets overwritten when we set n00b_moved;
-    // it certainly does get migrated first.
-
+    // Types are heap objects that the collector moves like anything
+    // else (see run_all_scans() in heap_collect.nc), so this stays a
+    // pointer.
     struct n00b_type_t *type;
 
 #if defined(N00B_ADD_ALLOC_LOC_INFO)
@@ -111,12 +110,15 @@ struct n00b_alloc_hdr {
     // the object.
     uint8_t n00b_debug : 1;
 #endif
-    // For the moment,this gets commandeered during collection.
-    // It's turned into 2 64-byte objects, by casting it to a
-    // n00b_alloc_record_t above.
+    // Only used during collection, where it holds the address the
+    // allocation is being copied to. It has to be separate from the
+    // rest of the header, since all of that is still needed after the
+    // allocation gets forwarded, and until it has been scanned.
     //
-    // The first item is used to store the forwarding pointer.
-    __uint128_t cached_hash;
+    // Along w/ the rest of the fields above, this packs into 32
+    // bytes, which the data alignment would round us up to anyway
+    // (without alloc location info).
+    void *forward;
 
     alignas(N00B_FORCED_ALIGNMENT) uint64_t data[];
 };
@@ -124,7 +126,7 @@ struct n00b_alloc_hdr {
 #define N00B_HDR_GUARD_OFFSET 0
 #define N00B_HDR_TYPE_OFFSET  offsetof(n00b_alloc_hdr, type)
 #define N00B_HDR_LEN_OFFSET   offsetof(n00b_alloc_hdr, alloc_len)
-#define N00B_HDR_HASH_OFFSET  offsetof(n00b_alloc_hdr, cached_hash)
+#define N00B_HDR_FWD_OFFSET   offsetof(n00b_alloc_hdr, forward)
 
 #if defined(N00B_ADD_ALLOC_LOC_INFO)
 #define N00B_HDR_FILE_OFFSET offsetof(n00b_alloc_hdr, alloc_file)
@@ -254,8 +256,28 @@ struct n00b_arena_t {
     void         *last_issued;
     n00b_arena_t *successor;
     size_t        user_length; // Just for convenience.
+    // The heap the arena currently belongs to. Arenas can change
+    // hands (e.g., the GC's to-space becomes the collected heap), so
+    // this must be kept up to date via n00b_arenas_set_owner().
+    n00b_heap_t  *heap;
 };
 
+// To classify an address, we don't walk heaps; we keep a map from
+// page number to the arena that owns the page. It's a two-level radix
+// table: the root has an entry for each 2^N00B_PAGEMAP_LEAF_BITS
+// pages, which points to a leaf that has an arena pointer per page.
+// Leaves are mmap()'d when first needed, and are only paged in where
+// they're written, so sparse address spaces cost little.
+//
+// The root is sized for the smallest page size we support (4k), and
+// the 48 bits of user address space every platform we run on gives
+// us. Anything above that can't be one of ours.
+#define N00B_PAGEMAP_ADDR_BITS 48
+#define N00B_PAGEMAP_LEAF_BITS 18
+#define N00B_PAGEMAP_LEAF_LEN  (1ULL << N00B_PAGEMAP_LEAF_BITS)
+#define N00B_PAGEMAP_ROOT_LEN \
+    (1ULL << (N00B_PAGEMAP_ADDR_BITS - 12 - N00B_PAGEMAP_LEAF_BITS))
+
 // The goal here is to make it easy to change the amount of space
 // associated with common data objects when we're treating them like
 // arrays.
@@ -304,6 +326,9 @@ extern n00b_heap_t *n00b_default_heap;
 // you call it, to ensure that sub-allocations use the same
 // allocator. When that happens, it will reset to NULL.
 
+extern _Atomic(n00b_arena_t **) n00b_pagemap_root[N00B_PAGEMAP_ROOT_LEN];
+extern uint64_t                 n00b_page_shift;
+
 extern n00b_heap_t    *n00b_addr_find_heap(void *, bool);
 extern bool            n00b_addr_in_heap(n00b_heap_t *, void *);
 extern n00b_heap_t    *_n00b_new_heap(uint64_t, char *, int);
@@ -339,6 +364,7 @@ extern void            n00b_gc_set_system_finalizer(n00b_system_finalizer_fn);
 extern void            n00b_heap_collect(n00b_heap_t *, int64_t);
 extern uint64_t        n00b_get_page_size(void);
 extern void            n00b_long_term_pin(n00b_heap_t *);
+extern void            n00b_gc_add_mapping(void *, void *, size_t);
 // in utils/deep_copy.c
 extern void           *n00b_heap_deep_copy(void *);
 
@@ -350,6 +376,29 @@ extern void           *n00b_heap_deep_copy(void *);
 #define n00b_heap_alloc_guarded(h, sz, f) \
     _n00b_heap_alloc(h, sz, true, f N00B_ALLOC_CALLPARAM)
 
+// Returns the arena whose pages contain 'addr', if any. The caller
+// still needs to check the address is in the arena's user range.
+static inline n00b_arena_t *
+n00b_pagemap_lookup(void *addr)
+{
+    uint64_t n = (uint64_t)addr;
+
+    if (n >> N00B_PAGEMAP_ADDR_BITS) {
+        return NULL;
+    }
+
+    n >>= n00b_page_shift;
+
+    n00b_arena_t **leaf = atomic_read(
+        &n00b_pagemap_root[n >> N00B_PAGEMAP_LEAF_BITS]);
+
+    if (!leaf) {
+        return NULL;
+    }
+
+    return leaf[n & (N00B_PAGEMAP_LEAF_LEN - 1)];
+}
+
 static inline bool
 n00b_in_heap(void *addr)
 {
@@ -562,11 +611,18 @@ n00b_round_up_to_given_power_of_2(uint64_t power, uint64_t n)
 #define N00B_ALLOC_OVERHEAD sizeof(n00b_header_t)
 
 extern void           n00b_add_arena(n00b_heap_t *, uint64_t);
+extern void           n00b_arenas_set_owner(n00b_arena_t *, n00b_heap_t *);
+extern void           n00b_pagemap_add_arena(n00b_arena_t *);
+extern void           n00b_pagemap_remove_arena(n00b_arena_t *);
+extern void           n00b_gc_sweep_mappings(n00b_heap_t *);
+extern void           n00b_gc_mark_mapping(void *);
 extern n00b_string_t *noob_debug_repr_heap(n00b_heap_t *);
 extern void           n00b_debug_log_heap(n00b_heap_t *);
 extern n00b_string_t *n00b_debug_repr_all_heaps(void);
 extern void           n00b_debug_all_heaps(void);
 extern n00b_heap_t   *__n00b_current_from_space;
+extern char          *n00b_mappings_lo;
+extern char          *n00b_mappings_hi;
 
 extern n00b_heap_t *n00b_all_heaps;
 extern n00b_heap_t *n00b_cur_heap_page;
@@ -655,6 +711,8 @@ n00b_delete_arena(n00b_arena_t *a)
     void  *alloc_start = n00b_arena_to_alloc_location(a);
     size_t len         = a->user_length + N00B_ARENA_OVERHEAD;
 
+    n00b_pagemap_remove_arena(a);
+
 #if defined(N00B_MADV_ZERO)
     madvise(alloc_start, len, MADV_ZERO);
     mprotect(alloc_start, len, PROT_NONE);
@@ -23,7 +23,45 @@ typedef struct {
     n00b_one_karg_t     args[N00B_MAX_KEYWORD_SIZE];
 } n00b_static_karg_t;
 
+// What ncpp passes for keyword arguments (see src/ncpp/x_keyword.c),
+// built as a compound literal on the caller's stack. The header isn't
+// a real allocation; it's there so that varargs functions can tell
+// the keywords apart from their other arguments (see n00b_is_kargs()).
+typedef struct {
+    n00b_alloc_record_t h;
+    n00b_karg_info_t    ka;
+} n00b_stack_karg_t;
+
+// 'arr' is a parenthesized n00b_one_karg_t[] compound literal, and
+// 'n' the number of items in it.
+#define n00b_stack_kargs(arr, n)                              \
+    (&((n00b_stack_karg_t){                                   \
+           .h  = {.empty_guard = n00b_gc_guard,               \
+                  .type        = n00b_type_kargs()},          \
+           .ka = {.num_provided = (n), .args = (arr)},        \
+       })                                                     \
+          .ka)
+
 extern n00b_karg_info_t *n00b_kargs_obj(char *, int64_t val, ...);
+extern bool              n00b_is_kargs(void *);
+
+// Keywords get matched on a 64-bit FNV-1a hash of their name, not on
+// the name itself. For anything that goes through ncpp, both the
+// caller's and the callee's hashes get computed at preprocessing time
+// (see src/ncpp/x_keyword.c), so the two implementations need to stay
+// in sync.
+static inline uint64_t
+n00b_karg_hash(char *s)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+
+    while (*s) {
+        h ^= (uint8_t)*s++;
+        h *= 0x100000001b3ULL;
+    }
+
+    return h;
+}
 
 // Everything below this point is part of the *old* keyword argument
 // system.  It's still here because there are two places where the
@@ -43,10 +81,11 @@ _n00b_kw_int64(n00b_karg_info_t *provided, char *name, int64_t *ptr)
         return false;
     }
 
-    int64_t n = provided->num_provided;
+    int64_t  n = provided->num_provided;
+    uint64_t h = n00b_karg_hash(name);
 
     for (int64_t i = 0; i < n; i++) {
-        if (!strcmp(name, provided->args[i].kw)) {
+        if (provided->args[i].hash == h) {
             *ptr = (int64_t)provided->args[i].value;
             return true;
         }
@@ -68,11 +107,12 @@ _n00b_kw_int32(n00b_karg_info_t *provided, char *name, int32_t *ptr)
         return false;
     }
 
-    int64_t n = provided->num_provided;
-    int64_t tmp;
+    int64_t  n = provided->num_provided;
+    uint64_t h = n00b_karg_hash(name);
+    int64_t  tmp;
 
     for (int64_t i = 0; i < n; i++) {
-        if (!strcmp(name, provided->args[i].kw)) {
+        if (provided->args[i].hash == h) {
             tmp = (int64_t)provided->args[i].value;
 
             *ptr = (int32_t)tmp;
@@ -90,11 +130,12 @@ _n00b_kw_bool(n00b_karg_info_t *provided, char *name, bool *ptr)
         return false;
     }
 
-    int64_t n = provided->num_provided;
-    int64_t tmp;
+    int64_t  n = provided->num_provided;
+    uint64_t h = n00b_karg_hash(name);
+    int64_t  tmp;
 
     for (int64_t i = 0; i < n; i++) {
-        if (!strcmp(name, provided->args[i].kw)) {
+        if (provided->args[i].hash == h) {
             tmp  = (int64_t)provided->args[i].value;
             *ptr = (bool)tmp;
             return true;
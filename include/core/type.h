@@ -279,6 +279,16 @@ n00b_type_is_bytering(n00b_type_t *t)
     return n00b_type_resolve(t)->base_index == N00B_T_BYTERING;
 }
 
+static inline bool
+n00b_type_is_rope(n00b_type_t *t)
+{
+    if (!n00b_ensure_type(t)) {
+        return false;
+    }
+
+    return n00b_type_resolve(t)->base_index == N00B_T_ROPE;
+}
+
 static inline bool
 n00b_type_is_keyword(n00b_type_t *t)
 {
@@ -695,6 +705,12 @@ n00b_type_bytering(void)
     return n00b_bi_types[N00B_T_BYTERING];
 }
 
+static inline n00b_type_t *
+n00b_type_rope(void)
+{
+    return n00b_bi_types[N00B_T_ROPE];
+}
+
 static inline n00b_type_t *
 n00b_type_text_element(void)
 {
@@ -5,7 +5,17 @@ typedef void *EVP_MD_CTX;
 typedef void *EVP_MD;
 typedef void *OSSL_PARAM;
 
+// State for the native SHA-256 implementation (src/crypto/sha256.nc).
 typedef struct {
-    EVP_MD_CTX  openssl_ctx;
-    n00b_buf_t *digest;
+    uint32_t h[8];
+    uint64_t total;
+    uint32_t buf_len;
+    uint8_t  buf[64];
+} n00b_sha256_ctx_t;
+
+typedef struct {
+    EVP_MD_CTX         openssl_ctx;
+    n00b_buf_t        *digest;
+    // When set, we're doing SHA-256 natively instead of via openssl.
+    n00b_sha256_ctx_t *native;
 } n00b_sha_t;
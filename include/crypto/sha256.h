@@ -0,0 +1,21 @@
+#pragma once
+#include "n00b.h"
+
+#define N00B_SHA256_LEN   32
+#define N00B_SHA256_BLOCK 64
+
+extern void         n00b_sha256_ctx_init(n00b_sha256_ctx_t *);
+extern void         n00b_sha256_ctx_update(n00b_sha256_ctx_t *,
+                                           const void *,
+                                           size_t);
+extern void         n00b_sha256_ctx_final(n00b_sha256_ctx_t *, uint8_t *);
+extern void         n00b_sha256_raw(const void *, size_t, uint8_t *);
+extern void         n00b_sha256_multi_raw(const uint8_t **,
+                                          const int64_t *,
+                                          uint8_t **,
+                                          int);
+extern n00b_buf_t  *n00b_sha256(n00b_buf_t *);
+extern n00b_list_t *n00b_sha256_multi(n00b_list_t *);
+extern bool         n00b_sha256_hw_accelerated(void);
+extern char        *n00b_sha256_backend_name(void);
+extern bool         n00b_sha256_set_backend(char *);
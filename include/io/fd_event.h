@@ -5,6 +5,16 @@
 #define N00B_SOCKET_LINGER_SEC     5
 #define N00B_DEFAULT_POLLSET_SLOTS 32
 
+// Each event loop indexes its fd streams directly by fd, through a
+// two-level table (see fd_cache.nc). Chunks get allocated as needed.
+// Descriptors past the end of the table (which needs a raised
+// RLIMIT_NOFILE) go to a dictionary instead.
+#define N00B_FD_TABLE_CHUNK_BITS 10
+#define N00B_FD_TABLE_CHUNK_LEN  (1 << N00B_FD_TABLE_CHUNK_BITS)
+#define N00B_FD_TABLE_CHUNKS     1024
+#define N00B_FD_TABLE_MAX \
+    (N00B_FD_TABLE_CHUNKS * N00B_FD_TABLE_CHUNK_LEN)
+
 typedef enum {
     N00B_FD_SUB_READ,
     N00B_FD_SUB_QUEUED_WRITE,
@@ -39,12 +49,16 @@ struct n00b_fd_stream_t {
     int                      fd;
     _Atomic(n00b_thread_t *) worker;
     n00b_event_loop_t       *evloop;
-    n00b_list_t             *read_subs;
-    n00b_list_t             *queued_subs;
-    n00b_list_t             *sent_subs;
-    n00b_list_t             *close_subs;
-    n00b_list_t             *err_subs;
+    // Subscriber lists are copy-on-write (see n00b_list_cow_append());
+    // posting walks a snapshot without locking, and subs_lock only
+    // serializes changes.
+    _Atomic(n00b_list_t *)   read_subs;
+    _Atomic(n00b_list_t *)   queued_subs;
+    _Atomic(n00b_list_t *)   sent_subs;
+    _Atomic(n00b_list_t *)   close_subs;
+    _Atomic(n00b_list_t *)   err_subs;
     n00b_list_t             *write_queue;
+    n00b_spin_lock_t         subs_lock;
     unsigned int             socket           : 1;
     unsigned int             read_closed      : 1;
     unsigned int             write_closed     : 1;
@@ -65,19 +79,32 @@ struct n00b_fd_stream_t {
     unsigned int             plain_file       : 1;
     unsigned int             tty              : 1;
     unsigned int             closing          : 1;
+    // Set once the kernel refuses to splice for this stream; we then
+    // forward through a stack buffer instead.
+    unsigned int             splice_fallback  : 1;
+    unsigned int             splice_staged    : 1;
 
     int              fd_mode;
     int              fd_flags;
     int              internal_ix;
     int64_t          total_read;
     int64_t          total_written;
+    // The generation of the fd table slot when this stream took it;
+    // n00b_fd_cache_remove() only clears the slot if it still matches.
+    uint64_t         cache_gen;
     n00b_ev_ready_cb notify;
     n00b_string_t   *name;
+
+    // If set, data read from this fd is forwarded to the target,
+    // kernel-side when possible; see n00b_fd_splice().
+    n00b_fd_stream_t *splice_target;
+    int               splice_pipe[2];
 };
 
 struct n00b_fd_sub_t {
     void            *thunk;
     bool             oneshot;
+    _Atomic bool     fired;
     n00b_fd_sub_kind kind;
     union {
         n00b_err_cb   err;
@@ -108,6 +135,16 @@ struct n00b_rdbuf_t {
     int           len;
 };
 
+// A slot in the fd table. The generation goes up every time the slot
+// gets a new stream, so that replacing a closed stream can't race with
+// someone else doing the same.
+typedef struct {
+    n00b_fd_stream_t *stream;
+    uint64_t          gen;
+} n00b_fd_slot_t;
+
+typedef _Atomic n00b_fd_slot_t n00b_fd_cell_t;
+
 typedef struct {
     struct pollfd     *pollset;
     n00b_fd_stream_t **monitored_fds;
@@ -133,14 +170,15 @@ struct n00b_event_loop_t {
     union {
         n00b_pevent_loop_t poll;
     } algo;
-    n00b_list_t             *timers;
-    n00b_event_impl_kind     kind;
-    n00b_list_t             *pending;
-    n00b_duration_t         *stop_time;
-    int64_t                  heap_key;
-    bool                     exit_loop;
-    _Atomic(n00b_thread_t *) owner;
-    _Atomic(n00b_list_t *)   conditions;
+    n00b_list_t              *timers;
+    n00b_event_impl_kind      kind;
+    n00b_list_t              *pending;
+    n00b_duration_t          *stop_time;
+    int64_t                   heap_key;
+    bool                      exit_loop;
+    _Atomic(n00b_thread_t *)  owner;
+    _Atomic(n00b_list_t *)    conditions;
+    _Atomic(n00b_fd_cell_t *) fd_table[N00B_FD_TABLE_CHUNKS];
 };
 
 extern n00b_event_loop_t *n00b_system_dispatcher;
@@ -173,6 +211,9 @@ extern bool               n00b_fd_unsubscribe(n00b_fd_stream_t *,
                                               n00b_fd_sub_t *);
 extern bool               n00b_fd_send(n00b_fd_stream_t *, char *, int);
 extern bool               n00b_fd_write(n00b_fd_stream_t *, char *, int);
+extern bool               n00b_fd_splice(n00b_fd_stream_t *,
+                                         n00b_fd_stream_t *);
+extern void               n00b_fd_unsplice(n00b_fd_stream_t *);
 extern n00b_buf_t        *n00b_fd_read(n00b_fd_stream_t *,
                                        int,
                                        int,
@@ -186,6 +227,7 @@ extern n00b_timer_t      *_n00b_add_timer(n00b_duration_t *,
                                           n00b_timer_cb,
                                           ...);
 extern void               n00b_remove_timer(n00b_timer_t *);
+extern void               n00b_run_after(int64_t, void *(*)(void *), void *);
 
 static inline bool
 n00b_fd_is_regular_file(n00b_fd_stream_t *s)
@@ -219,6 +261,7 @@ extern bool              n00b_condition_poll(n00b_condition_test_fn,
                                              int64_t to);
 extern n00b_fd_stream_t *n00b_fd_cache_lookup(int, n00b_event_loop_t *);
 extern n00b_fd_stream_t *n00b_fd_cache_add(n00b_fd_stream_t *);
+extern void              n00b_fd_cache_remove(n00b_fd_stream_t *);
 extern void              n00b_fd_post(n00b_fd_stream_t *,
                                       n00b_list_t *,
                                       void *);
@@ -230,6 +273,9 @@ extern void              n00b_fd_post_error(n00b_fd_stream_t *,
 extern void              n00b_fd_post_close(n00b_fd_stream_t *);
 extern bool              n00b_handle_one_read(n00b_fd_stream_t *);
 extern bool              n00b_handle_one_write(n00b_fd_stream_t *);
+extern int               n00b_fd_splice_one_read(n00b_fd_stream_t *);
+extern void              n00b_fd_splice_forward(n00b_fd_stream_t *,
+                                                n00b_buf_t *);
 extern void              n00b_end_system_io(void);
 
 extern n00b_dict_t    *n00b_fd_cache;
@@ -4,8 +4,18 @@
 typedef struct n00b_filter_t      n00b_filter_t;
 typedef struct n00b_filter_step_t n00b_filter_step_t;
 
+typedef struct n00b_filter_out_t n00b_filter_out_t;
+
 typedef n00b_list_t *(*n00b_stream_filter_fn)(void *, void *);
 
+// Push-style filter functions. Instead of returning a list of
+// outputs, they hand each output to n00b_filter_emit(), which runs it
+// straight through the rest of the pipeline. Filters that implement
+// these don't cost any per-message allocations beyond what their own
+// bodies do. Filters may implement either style, or both; if a push
+// function is present, it gets used.
+typedef void (*n00b_stream_push_fn)(void *, void *, n00b_filter_out_t *);
+
 typedef enum {
     // Filter whenever a read operation occurs. This occurs whenever
     // the read implementation function is invoked, which is either
@@ -32,6 +42,12 @@ typedef struct {
     n00b_stream_filter_fn read_fn;
     n00b_stream_filter_fn write_fn;
     n00b_stream_filter_fn flush_fn;
+    n00b_stream_push_fn   push_read_fn;
+    n00b_stream_push_fn   push_write_fn;
+    n00b_stream_push_fn   push_flush_fn;
+    // Gets a NULL when the stream closes, so that read filters that
+    // hold data back can push it out.
+    n00b_stream_push_fn   push_read_flush_fn;
     n00b_string_t        *name;
     n00b_type_t          *output_type;
     // If `polymorphic_w` is true, it indicates that filter WRITES to
@@ -48,8 +64,12 @@ typedef struct {
     // type). Subsequent layers of filtering may also be flexible both
     // in and out, but in that case they will be type checked with
     // every message, instead of just when setting up the pipeline.
-    unsigned int          polymorphic_r : 1;
-    unsigned int          polymorphic_w : 1;
+    unsigned int          polymorphic_r  : 1;
+    unsigned int          polymorphic_w  : 1;
+    // Set if the filter hands raw buffers along untouched. Streams
+    // whose filters all do that can be spliced together (see
+    // n00b_stream_splice()).
+    unsigned int          passes_buffers : 1;
 
     /* Type checking to be done.
         union {
@@ -62,6 +82,7 @@ typedef struct {
 
 struct n00b_filter_t {
     n00b_string_t    *name;
+    void             *stream; // really n00b_stream_t
     n00b_list_t      *read_cache;
     n00b_filter_impl *impl;
     n00b_filter_t    *next_read_step;
@@ -77,6 +98,28 @@ typedef struct {
     int               policy;
 } n00b_filter_spec_t;
 
+typedef void (*n00b_filter_sink_fn)(void *, void *);
+
+// State for one pass through a filter pipeline. Lives on the stack of
+// whoever's running the pipeline.
+typedef struct {
+    n00b_filter_sink_fn sink;
+    void               *sink_arg;
+    int64_t             delivered;
+    bool                reads;
+    bool                flushing;
+} n00b_filter_run_t;
+
+// Where a push-style filter sends its output; this is the rest of
+// the pipeline, starting at 'next'.
+struct n00b_filter_out_t {
+    n00b_filter_run_t *run;
+    n00b_filter_t     *next;
+};
+
+extern void n00b_filter_emit(n00b_filter_out_t *, void *);
+extern void n00b_filter_flush_stage(void *, bool);
+
 extern n00b_filter_spec_t *n00b_filter_apply_color(int);
 extern n00b_filter_spec_t *n00b_filter_apply_line_buffering(
     void);
@@ -92,5 +135,13 @@ extern void       *n00b_autounmarshal(n00b_buf_t *);
 // json filter
 extern n00b_filter_spec_t *n00b_filter_json(bool, bool, bool);
 
+// Streaming compression. Block size and flush time of 0 get the
+// defaults.
+extern n00b_filter_spec_t *n00b_filter_compress(bool, int64_t, int64_t);
+extern n00b_filter_spec_t *n00b_filter_decompress(bool);
+
+// Hashes everything passing through into the given hash object.
+extern n00b_filter_spec_t *n00b_filter_hash(n00b_sha_t *, bool);
+
 extern n00b_filter_spec_t *n00b_filter_parse_ansi(bool);
 extern n00b_filter_spec_t *n00b_filter_strip_ansi(bool);
@@ -29,6 +29,9 @@ typedef struct {
     bool                   started;
     bool                   closed;
     n00b_gc_root_info_t   *root_entry;
+    // If more than one, marshal with this many threads; see
+    // src/io/marshal_parallel.nc
+    int                    workers;
 } n00b_pickle_ctx;
 
 typedef struct n00b_alloc_record_t n00b_marshaled_hdr;
@@ -87,13 +90,83 @@ typedef union {
 // could with more memory munging).
 #define N00B_MARSHAL_RECORD_GUARD 0x13addbbeab3ddddaULL
 // #define N00B_MARSHAL_RECORD_GUARD 0xccccccccccccccccULL
-#define N00B_MARSHAL_MAGIC_BASE   0xc0cac01ab0ba1ceeULL
+// Version 1: allocations without the scan bit, and words after
+// N00B_NOSCAN, are copied verbatim and never translated.
+// Version 2: allocation headers lost the 128-bit hash field.
+#define N00B_MARSHAL_MAGIC_BASE   0xc0cac21ab0ba1ceeULL
 // For compat w/ original version, until it is excised.
 #define N00B_MARSHAL_MAGIC        N00B_MARSHAL_MAGIC_BASE
 
+#if defined(N00B_ALLOC_LOC_INF0)
+#define N00B_MARSHAL_OPT_1 0x01
+#else
+#define N00B_MARSHAL_OPT_1 0x00
+#endif
+
+#if defined(N00B_FULL_MEMCHECK)
+#define N00B_MARSHAL_OPT_2 0x02
+#else
+#define N00B_MARSHAL_OPT_2 0x00
+#endif
+
+#define N00B_MAGIC_FLIPS (N00B_MARSHAL_OPT_1 | N00B_MARSHAL_OPT_2)
+
+static inline uint64_t
+n00b_get_marshal_magic(void)
+{
+    return (N00B_MARSHAL_MAGIC_BASE & 0xffffffffffffff00)
+         | ((N00B_MAGIC_FLIPS) ^ N00B_MARSHAL_MAGIC_BASE);
+}
+
 extern n00b_buf_t         *n00b_automarshal(void *);
 extern void               *n00b_autounmarshal(n00b_buf_t *);
 extern n00b_filter_spec_t *n00b_filter_marshal(bool);
+extern n00b_filter_spec_t *n00b_filter_marshal_parallel(bool, int);
 n00b_filter_spec_t        *n00b_filter_unmarshal(bool);
+extern n00b_buf_t         *n00b_automarshal_parallel(void *, int);
 extern n00b_buf_t         *n00b_autopickle(void *);
 extern void               *n00b_autounpickle(n00b_buf_t *);
+
+// Mappable images. An image holds the same object graph
+// n00b_automarshal() would produce, but laid out so that it can be
+// mmap()'d and used in place. Pointers are stored as absolute
+// addresses relative to a preferred load address; if we can't map
+// there, a compact relocation table gets applied. See
+// src/io/marshal_image.nc.
+//
+// Bump the magic value when the layout changes.
+#define N00B_IMAGE_MAGIC 0x6e3030626d617033ULL
+// Data starts this far into the image, so that it is page aligned
+// for any page size we're likely to meet.
+#define N00B_IMAGE_ALIGN 0x10000
+
+typedef struct {
+    // Filled in when the image is mapped, so that the mapped data can
+    // be registered as a (pinned) heap.
+    n00b_arena_t arena;
+    uint64_t     magic;
+    uint64_t     version;
+    uint64_t     marshal_magic;
+    // The address we'd like the front of the image to be mapped at.
+    uint64_t     base;
+    uint64_t     data_offset;
+    uint64_t     data_len;
+    uint64_t     root_offset;
+    // Both tables are arrays of uint32_t word indexes, relative to
+    // the start of the data. Relocations are words that hold
+    // pointers back into the image, and records are the starts of
+    // allocation headers.
+    uint64_t     reloc_offset;
+    uint64_t     num_relocs;
+    uint64_t     record_offset;
+    uint64_t     num_records;
+} n00b_image_hdr_t;
+
+#ifdef N00B_USE_INTERNAL_API
+extern n00b_list_t *n00b_parallel_marshal(n00b_pickle_ctx *, void *);
+#endif
+
+extern n00b_buf_t *n00b_image_create(void *);
+extern n00b_buf_t *n00b_image_from_marshal(n00b_buf_t *);
+extern void       *n00b_image_map(int, int64_t);
+extern void       *n00b_image_load(n00b_string_t *);
@@ -8,8 +8,13 @@ typedef struct n00b_observable_t n00b_observable_t;
 typedef void (*n00b_subscribe_cb)(n00b_observable_t *, n00b_observer_t *);
 typedef void (*n00b_observer_cb)(void *, void *);
 
+// Subscriber lists are copy-on-write: 'observers' holds one list per
+// topic, and neither it nor any of those lists changes after it's
+// published. Posting just loads the current version and walks it,
+// without locking. Subscribing and unsubscribing build a new version
+// under 'lock', which only serializes writers.
 struct n00b_observable_t {
-    n00b_list_t      *observers;
+    _Atomic(n00b_list_t *) observers;
     n00b_list_t      *topics;
     n00b_subscribe_cb on_subscribe;
     n00b_subscribe_cb on_unsubscribe;
@@ -26,6 +31,9 @@ struct n00b_observer_t {
     n00b_observer_cb   callback;
     int64_t            topic_ix;
     bool               oneshot;
+    // Set by whichever post claims a oneshot subscription, so that
+    // concurrent posts deliver it only once.
+    _Atomic bool       fired;
 };
 
 #ifdef N00B_USE_INTERNAL_API
@@ -81,7 +89,7 @@ n00b_observable_set_unsubscribe_callback(n00b_observable_t *o,
 static inline void
 n00b_observable_remove_all_subscriptions(n00b_observable_t *o)
 {
-    o->observers = n00b_list(n00b_type_ref());
+    atomic_store(&o->observers, n00b_list(n00b_type_ref()));
 }
 #endif
 
@@ -3,8 +3,11 @@
 
 extern void _n00b_print(void *, ...);
 
-#define n00b_print(s, ...) _n00b_print(s __VA_OPT__(, __VA_ARGS__))
-#define n00b_eprint(...)   _n00b_print(n00b_stderr() __VA_OPT__(, __VA_ARGS__))
+// Arguments end either at keyword arguments, or at a NULL, which
+// these add.
+#define n00b_print(s, ...) _n00b_print(s __VA_OPT__(, __VA_ARGS__), NULL)
+#define n00b_eprint(...) \
+    _n00b_print(n00b_stderr() __VA_OPT__(, __VA_ARGS__), NULL)
 
 #define n00b_printf(fmt, ...)                                               \
     {                                                                       \
@@ -40,29 +40,38 @@ typedef struct {
     n00b_capture_t   kind;
 } n00b_cap_event_t;
 
+typedef struct n00b_capture_reader_t  n00b_capture_reader_t;
+typedef struct n00b_capture_encoder_t n00b_capture_encoder_t;
+
 // For replaying capture logs.
 typedef struct {
-    n00b_stream_t    *log;
-    n00b_stream_t    *stdin_dst;
-    n00b_stream_t    *stdout_dst;
-    n00b_stream_t    *stderr_dst;
-    n00b_duration_t  *cursor;
-    n00b_duration_t  *absolute_start;
-    n00b_duration_t  *max_gap;
-    n00b_cap_event_t *cache;
+    n00b_stream_t             *log;
+    n00b_capture_reader_t     *reader;
+    // Set by n00b_session_replay_seek(); picked up by the replay loop,
+    // which waits on 'wakeup' between events so a seek can cut the
+    // wait short.
+    _Atomic(n00b_duration_t *) seek_target;
+    n00b_futex_t               wakeup;
+    n00b_stream_t             *stdin_dst;
+    n00b_stream_t             *stdout_dst;
+    n00b_stream_t             *stderr_dst;
+    n00b_duration_t           *cursor;
+    n00b_duration_t           *absolute_start;
+    n00b_duration_t           *max_gap;
+    n00b_cap_event_t          *cache;
     // Use this when not pausing before inputs to even out typing
     // pauses, esp by setting min_gap == max_gap.
-    n00b_duration_t  *min_input_gap;
-    n00b_condition_t  unpause_notify;
-    double            time_scale;
-    int               streams;
-    bool              cinematic;
-    bool              paused;
-    bool              finished;
-    bool              pause_before_input;
-    bool              got_unpause;
-    bool              play_input_to_newline;
-    bool              remove_autopause;
+    n00b_duration_t           *min_input_gap;
+    n00b_condition_t           unpause_notify;
+    double                     time_scale;
+    int                        streams;
+    bool                       cinematic;
+    bool                       paused;
+    bool                       finished;
+    bool                       pause_before_input;
+    bool                       got_unpause;
+    bool                       play_input_to_newline;
+    bool                       remove_autopause;
 } n00b_log_cursor_t;
 
 typedef enum {
@@ -124,9 +133,16 @@ struct n00b_session_t {
     n00b_string_t           *pwd;
     n00b_dict_t             *user_states;
     n00b_session_state_t    *global_actions;
+    // Compiled matchers for each (state, capture kind) we've scanned
+    // for. See src/io/session_matcher.nc.
+    n00b_list_t             *trigger_matchers;
+    // Bumped whenever the match buffers are truncated, which
+    // invalidates any scan progress the matchers have made.
+    uint64_t                 match_epoch;
     _Atomic(n00b_stream_t *) capture_stream;
     n00b_stream_t           *saved_capture; // For pausing.
     n00b_stream_t           *unproxied_capture;
+    n00b_capture_encoder_t  *cap_encoder;
     n00b_string_t           *cap_filename;
     n00b_string_t           *launch_command;
     n00b_list_t             *launch_args;
@@ -174,6 +190,8 @@ extern void            n00b_session_set_replay_stream(n00b_session_t *,
                                                       n00b_stream_t *);
 extern n00b_table_t   *n00b_session_state_repr(n00b_session_t *);
 extern void            n00b_session_start_replay(n00b_session_t *);
+extern void            n00b_session_replay_seek(n00b_session_t *,
+                                                n00b_duration_t *);
 
 static inline void
 n00b_session_set_proxy_input(n00b_session_t *s, bool value)
@@ -666,8 +684,24 @@ n00b_session_disable_ansi_matching(n00b_session_t *session)
 
 #ifdef N00B_USE_INTERNAL_API
 
+// Original capture format; still readable, no longer written.
 #define N00B_SESSION_MAGIC 0x5355104f5355104fLL
 
+// Current capture format. See src/io/session_capture.nc for the
+// layout.
+#define N00B_CAPTURE_MAGIC            0x3270614330306e4eLL
+#define N00B_CAPTURE_VERSION          2
+#define N00B_CAPTURE_BLOCK_MAGIC      0x42706143 // "CapB"
+#define N00B_CAPTURE_INDEX_MAGIC      0x49706143 // "CapI"
+#define N00B_CAPTURE_TRAILER_MAGIC    0x7865644970614300LL
+#define N00B_CAPTURE_HEADER_LEN       32
+#define N00B_CAPTURE_BLOCK_HDR_LEN    40
+#define N00B_CAPTURE_BLOCK_COMPRESSED 0x01
+// A block gets written once it holds this much raw event data, or
+// once it's been open this long, whichever comes first.
+#define N00B_CAPTURE_BLOCK_SIZE       (64 * 1024)
+#define N00B_CAPTURE_BLOCK_NSEC       (N00B_NSEC_PER_SEC / 2)
+
 #define N00B_SESSION_BASH_SETUP                                             \
     "    if [[ -f ~/.bashrc ]] ; then . ~/.bashrc; fi\n"                    \
     "\n"                                                                    \
@@ -725,11 +759,31 @@ extern void                  n00b_capture_launch(n00b_session_t *,
                                                  n00b_string_t *,
                                                  n00b_list_t *);
 extern void                  n00b_session_finish_capture(n00b_session_t *);
+extern void                  n00b_capture_encoder_flush(n00b_capture_encoder_t *);
+extern void                  n00b_capture_encoder_finish(n00b_capture_encoder_t *);
+extern n00b_capture_reader_t *n00b_capture_reader_open(n00b_stream_t *);
+extern void                   n00b_capture_reader_close(n00b_capture_reader_t *);
+extern n00b_cap_event_t      *n00b_capture_reader_next(n00b_capture_reader_t *,
+                                                       double);
+extern void                   n00b_capture_reader_seek(n00b_capture_reader_t *,
+                                                       n00b_duration_t *);
 extern void                  n00b_session_setup_user_read_cb(n00b_session_t *s);
 extern void                  n00b_truncate_all_match_data(n00b_session_t *,
                                                           n00b_string_t *,
                                                           n00b_capture_t);
 extern void                  n00b_session_scan_for_matches(n00b_session_t *);
+
+typedef struct n00b_trigger_matcher_t n00b_trigger_matcher_t;
+
+extern n00b_trigger_matcher_t *n00b_get_trigger_matcher(n00b_session_t *,
+                                                        n00b_session_state_t *,
+                                                        n00b_string_t *,
+                                                        n00b_capture_t);
+extern bool                    n00b_trigger_matcher_check(n00b_trigger_matcher_t *,
+                                                          n00b_string_t *,
+                                                          int,
+                                                          int64_t *,
+                                                          void **);
 extern n00b_session_state_t *n00b_session_find_state(n00b_session_t *,
                                                      n00b_string_t *);
 #endif
@@ -295,6 +295,8 @@ n00b_get_stream_cookie(n00b_stream_t *stream)
     }
 
 extern void n00b_cache_read(n00b_stream_t *, void *);
+// Delivers one message that has already been through the read filters.
+extern void n00b_cache_one_read(n00b_stream_t *, void *);
 extern void n00b_route_stream_message(void *, void *);
 
 #endif
@@ -304,4 +306,15 @@ extern void n00b_route_stream_message(void *, void *);
 extern bool         n00b_filter_add(n00b_stream_t *, n00b_filter_spec_t *);
 extern n00b_list_t *n00b_filter_writes(n00b_stream_t *, n00b_stream_msg_t *);
 extern n00b_list_t *n00b_filter_reads(n00b_stream_t *, n00b_stream_msg_t *);
+extern int64_t      n00b_filter_run_writes(n00b_stream_t *,
+                                           n00b_stream_msg_t *,
+                                           n00b_filter_sink_fn,
+                                           void *);
+extern int64_t      n00b_filter_run_reads(n00b_stream_t *,
+                                          n00b_stream_msg_t *,
+                                          n00b_filter_sink_fn,
+                                          void *);
+extern int64_t      n00b_filter_flush_reads(n00b_stream_t *,
+                                            n00b_filter_sink_fn,
+                                            void *);
 extern void         n00b_flush(n00b_stream_t *);
@@ -3,15 +3,47 @@
 
 typedef void *(*n00b_stream_cb_t)(void *, void *);
 
+// What happens to a non-blocking write to a callback stream when its
+// backlog is full. By default there's no limit.
+typedef enum {
+    // The message is dropped, and counted (see
+    // n00b_callback_stream_dropped()).
+    N00B_CB_BACKLOG_DROP,
+    // The writer waits for room. When the writer is the I/O
+    // dispatcher, this stalls every fd it services until the callback
+    // catches up, so only ask for it if the callback is always fast,
+    // and never waits on I/O itself.
+    N00B_CB_BACKLOG_BLOCK,
+} n00b_cb_backlog_policy;
+
+typedef struct n00b_cb_msg_t n00b_cb_msg_t;
+
 typedef struct {
-    n00b_stream_cb_t cb;
-    void            *params;
-    void            *user_defined;
+    n00b_stream_cb_t       cb;
+    void                  *params;
+    void                  *user_defined;
+    // Non-blocking writes get queued here, oldest first, and run in
+    // order on the shared callback pool; see stream_callback.nc.
+    n00b_cb_msg_t         *head;
+    n00b_cb_msg_t         *tail;
+    n00b_stream_t         *next_ready;
+    n00b_thread_t         *runner;
+    int32_t                pending;
+    int32_t                backlog_limit;
+    int32_t                blocked;
+    int64_t                dropped;
+    n00b_futex_t           room;
+    n00b_cb_backlog_policy policy;
+    bool                   scheduled;
 } n00b_callback_cookie_t;
 
 extern n00b_stream_t *_n00b_new_callback_stream(n00b_stream_cb_t,
                                                 void *,
                                                 ...);
+extern void           n00b_callback_stream_set_backlog(n00b_stream_t *,
+                                                       int32_t,
+                                                       n00b_cb_backlog_policy);
+extern int64_t        n00b_callback_stream_dropped(n00b_stream_t *);
 
 static inline n00b_stream_t *
 n00b_name_cb_hack(n00b_stream_t *stream, char *s)
@@ -11,6 +11,7 @@ extern n00b_stream_t *n00b_stream_fd_open(int);
 extern n00b_stream_t *_n00b_new_fd_stream(n00b_fd_stream_t *fd, ...);
 extern n00b_stream_t *_n00b_stream_open_file(n00b_string_t *filename, ...);
 extern void          *_n00b_read_file(n00b_string_t *, ...);
+extern void          *n00b_map_file_contents(int, bool, n00b_string_t **);
 extern n00b_stream_t *_n00b_stream_connect(n00b_net_addr_t *, ...);
 extern n00b_stream_t *_n00b_create_listener(n00b_net_addr_t *, ...);
 
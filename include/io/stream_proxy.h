@@ -8,5 +8,6 @@ typedef struct {
 } n00b_proxy_info_t;
 
 extern n00b_stream_t *_n00b_new_stream_proxy(n00b_stream_t *, ...);
+extern bool           n00b_stream_splice(n00b_stream_t *, n00b_stream_t *);
 #define n00b_new_stream_proxy(other, ...) \
     _n00b_new_stream_proxy(other, __VA_ARGS__ __VA_OPT__(, ) 0ULL)
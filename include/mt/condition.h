@@ -72,7 +72,12 @@ extern bool N00B_DBG_DECL(n00b_condition_unlock, n00b_condition_t *);
 extern void n00b_condition_set_callback(n00b_condition_t *,
                                         n00b_condition_predicate_fn,
                                         void *);
-#define n00b_condition_init(x)   N00B_DBG_CALL(n00b_condition_init, x)
+#if defined(N00B_DEBUG)
+#define n00b_condition_init(x) N00B_DBG_CALL(n00b_condition_init, x)
+#else
+#define n00b_condition_init(x) \
+    (_n00b_condition_init(x), n00b_lock_note_site(x, __FILE__, __LINE__))
+#endif
 #define n00b_condition_lock(x)   N00B_DBG_CALL(n00b_condition_lock, x)
 #define n00b_condition_unlock(x) N00B_DBG_CALL(n00b_condition_unlock, x)
 
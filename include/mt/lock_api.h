@@ -20,17 +20,19 @@ _n00b_lock_init(n00b_lock_base_t *l,
     switch (t) {
     case N00B_NLT_MUTEX:
         N00B_DBG_CALL_NESTED(n00b_mutex_init, (void *)l);
-        return;
+        break;
     case N00B_NLT_RW:
         N00B_DBG_CALL_NESTED(n00b_rw_init, (void *)l);
-        return;
+        break;
     case N00B_NLT_CV:
         N00B_DBG_CALL_NESTED(n00b_condition_init, (void *)l);
-        return;
+        break;
     default:
         fprintf(stderr, "Fatal: Invalid lock type.\n");
         abort();
     }
+
+    n00b_lock_note_site(l, __file, __line);
 }
 
 #define n00b_lock_init(x, t) \
@@ -107,7 +109,33 @@ _n00b_lock_release_all(n00b_lock_base_t *l)
 
 #define n00b_lock_release_all(x) _n00b_lock_release_all((n00b_lock_base_t *)x)
 
+// The lock profiler. It's compiled into every build, but is off until
+// enabled, either with n00b_lock_profile_enable(), or by setting
+// N00B_LOCK_PROFILE in the environment (which also dumps the table to
+// stderr at exit). When off, the cost is one relaxed load per
+// acquisition and release.
+extern void           n00b_lock_profile_enable(bool);
+extern void           n00b_lock_profile_reset(void);
+extern n00b_table_t  *n00b_lock_profile_table(void);
+extern n00b_string_t *n00b_lock_profile_json(void);
+
 #if defined(N00B_USE_INTERNAL_API)
+extern _Atomic bool n00b_lock_profiling;
+extern void         n00b_lock_profile_init(void);
+extern void         n00b_lock_profile_wait_end(n00b_tsi_t *);
+extern void         n00b_lock_profile_read_acquire(n00b_lock_base_t *,
+                                                   n00b_tsi_t *);
+
+static inline void
+n00b_lock_profile_wait_start(n00b_tsi_t *tsi, n00b_lock_base_t *lock)
+{
+    tsi->lock_wait_target = lock;
+
+    if (atomic_load_explicit(&n00b_lock_profiling, memory_order_relaxed)) {
+        tsi->lock_wait_start = n00b_ns_timestamp();
+    }
+}
+
 extern void N00B_DBG_DECL(n00b_lock_init_accounting, n00b_lock_base_t *, int);
 extern int  N00B_DBG_DECL(n00b_lock_acquire_accounting,
                           n00b_lock_base_t *,
@@ -146,7 +174,8 @@ _n00b_register_lock_wait(n00b_tsi_t *tsi, void *lock, char *f, int line);
 #define n00b_rlock_accounting(...)
 #define n00b_runlock_accounting(...)
 
-#define n00b_register_lock_wait(tsi, lock) tsi->lock_wait_target = (void *)lock
+#define n00b_register_lock_wait(tsi, lock) \
+    n00b_lock_profile_wait_start(tsi, (void *)lock)
 
 #endif
 
@@ -159,6 +188,7 @@ extern void _n00b_wait_done(n00b_tsi_t *tsi, char *__file, int __line);
 static inline void
 n00b_wait_done(n00b_tsi_t *tsi)
 {
+    n00b_lock_profile_wait_end(tsi);
     tsi->lock_wait_target = NULL;
 }
 #endif
@@ -55,6 +55,23 @@ typedef struct {
     uint8_t reserved;
 } n00b_core_lock_info_t;
 
+// Contention statistics, aggregated across every lock with the same
+// debug name and creation site. These live in a fixed table in
+// src/mt/lock_accounting.nc, never in the heap, since the allocator
+// itself takes locks.
+typedef struct n00b_lock_profile_t {
+    char            *name;
+    char            *file;
+    int              line;
+    _Atomic int      state;
+    _Atomic uint64_t acquisitions;
+    _Atomic uint64_t contended;
+    _Atomic uint64_t wait_ns;
+    _Atomic uint64_t max_wait_ns;
+    _Atomic uint64_t hold_ns;
+    _Atomic uint64_t max_hold_ns;
+} n00b_lock_profile_t;
+
 #if defined(N00B_DEBUG)
 #define N00B_COMMON_LOCK_BASE                       \
     _Atomic(n00b_lock_base_t *)   next_thread_lock; \
@@ -63,6 +80,8 @@ typedef struct {
     _Atomic n00b_core_lock_info_t data;             \
     n00b_alloc_hdr               *allocation;       \
     n00b_lock_log_t              *logs;             \
+    n00b_lock_profile_t          *profile;          \
+    int64_t                       acquired_ns;      \
     char                         *creation_file;    \
     int                           creation_line;    \
     bool                          inited
@@ -71,7 +90,11 @@ typedef struct {
     _Atomic(n00b_lock_base_t *)   next_thread_lock; \
     _Atomic(n00b_lock_base_t *)   prev_thread_lock; \
     _Atomic n00b_core_lock_info_t data;             \
-    char                         *debug_name
+    char                         *debug_name;       \
+    n00b_lock_profile_t          *profile;          \
+    int64_t                       acquired_ns;      \
+    char                         *creation_file;    \
+    int                           creation_line
 #endif
 
 struct n00b_lock_base_t {
@@ -98,3 +121,13 @@ _n00b_lock_set_debug_name(n00b_lock_base_t *l, char *name)
 }
 
 #define n00b_lock_set_debug_name(x, y) _n00b_lock_set_debug_name(x, y)
+
+// In debug builds, the init functions get the call site already; in
+// release builds, the init macros record it with this, so that the
+// lock profiler can still attribute contention.
+static inline void
+n00b_lock_note_site(void *l, char *file, int line)
+{
+    ((n00b_lock_base_t *)l)->creation_file = file;
+    ((n00b_lock_base_t *)l)->creation_line = line;
+}
@@ -14,6 +14,11 @@ extern int  N00B_DBG_DECL(n00b_mutex_lock, n00b_mutex_t *);
 extern bool N00B_DBG_DECL(n00b_mutex_unlock, n00b_mutex_t *);
 extern bool N00B_DBG_DECL(n00b_mutex_try_lock, n00b_mutex_t *, int usec);
 
-#define n00b_mutex_init(x)   N00B_DBG_CALL(n00b_mutex_init, x)
+#if defined(N00B_DEBUG)
+#define n00b_mutex_init(x) N00B_DBG_CALL(n00b_mutex_init, x)
+#else
+#define n00b_mutex_init(x) \
+    (_n00b_mutex_init(x), n00b_lock_note_site(x, __FILE__, __LINE__))
+#endif
 #define n00b_mutex_lock(x)   N00B_DBG_CALL(n00b_mutex_lock, x)
 #define n00b_mutex_unlock(x) N00B_DBG_CALL(n00b_mutex_unlock, x)
@@ -33,7 +33,12 @@ extern bool N00B_DBG_DECL(n00b_rw_unlock, n00b_rwlock_t *);
 #define n00b_rw_write_lock(l) N00B_DBG_CALL(n00b_rw_write_lock, l)
 #define n00b_rw_read_lock(l)  N00B_DBG_CALL(n00b_rw_read_lock, l)
 #define n00b_rw_unlock(l)     N00B_DBG_CALL(n00b_rw_unlock, l)
-#define n00b_rw_lock_init(l)  N00B_DBG_CALL(n00b_rw_init, l)
+#if defined(N00B_DEBUG)
+#define n00b_rw_lock_init(l) N00B_DBG_CALL(n00b_rw_init, l)
+#else
+#define n00b_rw_lock_init(l) \
+    (_n00b_rw_init(l), n00b_lock_note_site(l, __FILE__, __LINE__))
+#endif
 #ifdef N00B_USE_INTERNAL_API
 
 #define N00B_RW_UNLOCKED 0x00000000
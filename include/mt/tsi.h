@@ -34,6 +34,11 @@ struct n00b_tsi_t {
     // State associated with any condition variable we are waiting on.
     n00b_condition_thread_state_t cv_info;
     n00b_lock_base_t             *lock_wait_target;
+    // For the lock profiler: when the current wait started, and how
+    // long we've waited in total for the lock we're about to get
+    // (some acquisition paths wait more than once).
+    int64_t                       lock_wait_start;
+    int64_t                       lock_wait_ns;
 #if defined(__linux__)
     pthread_attr_t attrs;
 #endif
@@ -43,6 +48,8 @@ struct n00b_tsi_t {
     char *lock_wait_trace;
 #endif
     void        *thread_runtime; // really n00b_vmthread_t
+    // Reused across regex matches on this thread.
+    void        *regex_match_data; // really pcre2_match_data
     // Used by libbacktrace.
     char        *bt_utf8_result;
     void        *trace_table; // really n00b_table_t
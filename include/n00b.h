@@ -169,12 +169,14 @@ extern bool n00b_gc_inited;
 #include "adts/datetime.h"
 #include "adts/duration.h"
 #include "adts/bytering.h"
+#include "adts/rope.h"
 #include "text/table.h"
 #include "util/sleep.h"
 
 // IO primitives.
 #include "io/print.h"
 #include "util/hex.h"
+#include "util/lz.h"
 #include "text/layout.h"
 #include "text/ansi.h"
 #include "text/regex.h"
@@ -211,6 +213,7 @@ extern bool n00b_gc_inited;
 
 // Yes we use cryptographic hashes internally for type IDing.
 #include "crypto/sha.h"
+#include "crypto/sha256.h"
 
 #include "compiler/module.h"
 
@@ -233,6 +236,7 @@ extern bool n00b_gc_inited;
 #include "compiler/ast_utils.h"
 #include "compiler/rtmodule.h"
 #include "compiler/compile.h"
+#include "compiler/compile_cache.h"
 #include "compiler/errors.h"
 #include "compiler/lex.h"
 #include "compiler/parse.h"
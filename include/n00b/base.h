@@ -32,6 +32,7 @@
 #include <sys/ioctl.h>
 #include <sys/wait.h>
 #include <sys/mman.h>
+#include <sys/uio.h>
 #include <sys/param.h>
 #include <sys/stat.h>
 #include <sys/utsname.h>
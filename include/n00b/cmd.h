@@ -18,6 +18,7 @@ extern const char *n00b_fl_verbose;
 extern const char *n00b_fl_ansi;
 extern const char *n00b_fl_merge;
 extern const char *n00b_fl_bright;
+extern const char *n00b_fl_no_cache;
 
 #define N00B_CMD_RUN       1
 #define N00B_CMD_COMPILE   2
@@ -50,6 +51,7 @@ extern void                n00b_record_testcase(n00b_cmdline_ctx *);
 extern void                n00b_run_tests(n00b_cmdline_ctx *);
 extern void                n00b_show_tests(n00b_cmdline_ctx *);
 extern void                n00b_play_capture(n00b_cmdline_ctx *);
+extern bool                n00b_cmd_wants_compiler_info(n00b_cmdline_ctx *);
 
 static inline bool
 n00b_cmd_merge(n00b_cmdline_ctx *ctx)
@@ -108,6 +110,15 @@ n00b_cmd_bright(n00b_cmdline_ctx *ctx)
     return hatrack_dict_get(ctx->opts, n00b_cstring(n00b_fl_bright), NULL);
 }
 
+static inline bool
+n00b_cmd_no_cache(n00b_cmdline_ctx *ctx)
+{
+    if (!ctx->opts) {
+        return false;
+    }
+    return hatrack_dict_get(ctx->opts, n00b_cstring(n00b_fl_no_cache), NULL);
+}
+
 static inline bool
 n00b_cmd_show_cmdline_parse(n00b_cmdline_ctx *ctx)
 {
@@ -157,6 +157,21 @@
 #define N00B_MARSHAL_CHUNK_SIZE 512
 #endif
 
+#ifndef N00B_MARSHAL_SEGMENT_SIZE
+// Parallel marshaling emits output in segments of about this size.
+#define N00B_MARSHAL_SEGMENT_SIZE (1 << 20)
+#endif
+
+#ifndef N00B_MARSHAL_MAX_WORKERS
+#define N00B_MARSHAL_MAX_WORKERS 64
+#endif
+
+#ifndef N00B_LOCK_PROFILE_SLOTS
+// Max number of distinct (name, creation site) pairs the lock
+// profiler tracks. Must be a power of two.
+#define N00B_LOCK_PROFILE_SLOTS 1024
+#endif
+
 #ifndef N00B_STACK_SIZE
 #define N00B_STACK_SIZE (1 << 17)
 #endif
@@ -165,6 +180,22 @@
 #define N00B_MAX_CALL_DEPTH 100
 #endif
 
+// VM threads keep room to marshal this many FFI arguments without
+// allocating.
+#ifndef N00B_FFI_MAX_ARGS
+#define N00B_FFI_MAX_ARGS 16
+#endif
+
+// Boxed integers in this range are shared, instead of being allocated
+// every time something gets boxed (see box.nc).
+#ifndef N00B_BOX_CACHE_MIN
+#define N00B_BOX_CACHE_MIN -128
+#endif
+
+#ifndef N00B_BOX_CACHE_MAX
+#define N00B_BOX_CACHE_MAX 1023
+#endif
+
 #if defined(N00B_GC_STATS) && !defined(N00B_SHOW_GC_DEFAULT)
 #define N00B_SHOW_GC_DEFAULT 0
 #endif
@@ -251,6 +282,26 @@
 #define N00B_CALLBACK_THREAD_POLL_INTERVAL 50000000
 #endif
 
+// Non-blocking writes to callback streams run on a shared pool of at
+// most this many threads.
+#ifndef N00B_CALLBACK_POOL_THREADS
+#define N00B_CALLBACK_POOL_THREADS 8
+#endif
+
+// How many messages a callback stream will queue up before it starts
+// dropping them (see n00b_callback_stream_set_backlog()). Zero means
+// no limit. The writer is usually the I/O dispatcher, so we never
+// block it by default; one slow callback would stall every fd.
+#ifndef N00B_CALLBACK_DEFAULT_BACKLOG
+#define N00B_CALLBACK_DEFAULT_BACKLOG 0
+#endif
+
+// Regular files at least this big get mapped into memory when read
+// whole, instead of being copied in (see file_map.nc).
+#ifndef N00B_FILE_MAP_THRESHOLD
+#define N00B_FILE_MAP_THRESHOLD 16384
+#endif
+
 #ifndef N00B_POLL_DEFAULT_MS
 #define N00B_POLL_DEFAULT_MS 1
 #endif
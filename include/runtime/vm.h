@@ -29,6 +29,12 @@ n00b_vmthread_run(n00b_vmthread_t *tstate);
 extern void
 n00b_vmthread_reset(n00b_vmthread_t *tstate);
 
+// how many allocations FFI calls made by the calling thread's vm
+// thread state have needed. exposed so tests can check that calls
+// which shouldn't allocate don't.
+extern uint64_t
+n00b_vm_ffi_alloc_count(void);
+
 // retrieve the attribute specified by key. if the `found param`is not
 // provided, throw an exception when the attribute is not found.
 extern void *
@@ -65,9 +71,18 @@ n00b_validate_runtime(n00b_vm_t *vm);
 extern n00b_buf_t *n00b_automarshal(void *);
 extern void       *n00b_autounmarshal(n00b_buf_t *);
 extern n00b_buf_t *n00b_vm_save(n00b_vm_t *vm);
+extern n00b_buf_t *n00b_vm_save_image(n00b_vm_t *vm);
+
+extern const n00b_version_t n00b_current_version;
 
 static inline n00b_vm_t *
 n00b_vm_restore(n00b_buf_t *b)
 {
     return n00b_autounmarshal(b);
 }
+
+static inline n00b_vm_t *
+n00b_vm_map_image(n00b_string_t *path)
+{
+    return n00b_image_load(path);
+}
@@ -34,9 +34,12 @@ typedef struct {
 } n00b_ansi_node_t;
 
 typedef struct {
-    char        *cur;
-    char        *end;
-    n00b_list_t *results;
+    char             *cur;
+    char             *end;
+    n00b_list_t      *results;
+    // Nodes get handed out from here.
+    n00b_ansi_node_t *arena;
+    int32_t           arena_ix;
 } n00b_ansi_ctx;
 
 extern n00b_ansi_ctx *n00b_ansi_parser_create(void);
@@ -3,6 +3,9 @@
 
 #define PCRE2_CODE_UNIT_WIDTH 8
 #define N00B_PCRE2_ERR_LEN    120 // More than needed according to docs.
+#define N00B_REGEX_MIN_PAIRS  16
+// Distinct patterns whose JIT-compiled code gets kept around.
+#define N00B_REGEX_CACHE_MAX  256
 
 #include "pcre2.h"
 
@@ -11,13 +14,26 @@
 typedef struct {
     n00b_string_t repr;
     pcre2_code   *regex;
+    // Number of ovector pairs a match needs (capture groups + 1).
+    uint32_t      ovector_pairs;
+    // True if pcre2 was able to JIT compile the pattern.
+    bool          jit;
+    bool          anchored;
 } n00b_regex_t;
 
+// Captures are lazy; we only keep their byte offsets into the input
+// string, and don't create strings for them until asked, via
+// n00b_match_capture() or n00b_match_captures(). The latter caches
+// its result in 'captures'.
 typedef struct {
     n00b_string_t *input_string;
     int64_t        start;
     int64_t        end;
     n00b_list_t   *captures;
+    int32_t        num_captures;
+    // Start / end pairs, one per capture group. Groups that didn't
+    // participate in the match are set to -1.
+    int64_t        spans[];
 } n00b_match_t;
 
 extern pcre2_compile_context *n00b_pcre2_compile;
@@ -28,6 +44,31 @@ extern n00b_list_t           *n00b_regex_raw_match(n00b_regex_t *,
                                                    bool exact,
                                                    bool no_eol,
                                                    bool all);
+extern n00b_match_t          *n00b_regex_search_incremental(n00b_regex_t *,
+                                                            n00b_string_t *,
+                                                            int64_t *);
+extern n00b_string_t         *n00b_match_capture(n00b_match_t *, int);
+extern n00b_list_t           *n00b_match_captures(n00b_match_t *);
+
+static inline int
+n00b_match_num_captures(n00b_match_t *m)
+{
+    return m->num_captures;
+}
+
+// Returns false if the group didn't participate in the match.
+static inline bool
+n00b_match_capture_span(n00b_match_t *m, int ix, int64_t *start, int64_t *end)
+{
+    if (ix < 0 || ix >= m->num_captures || m->spans[ix * 2] == -1) {
+        return false;
+    }
+
+    *start = m->spans[ix * 2];
+    *end   = m->spans[ix * 2 + 1];
+
+    return true;
+}
 static inline n00b_regex_t *
 n00b_regex(n00b_string_t *s)
 {
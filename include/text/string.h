@@ -55,7 +55,8 @@ extern bool              n00b_string_starts_with(n00b_string_t *,
                                                  n00b_string_t *);
 extern bool              n00b_string_ends_with(n00b_string_t *,
                                                n00b_string_t *);
-extern bool              n00b_string_from_file(n00b_string_t *, int *);
+extern n00b_string_t    *n00b_string_from_file(n00b_string_t *, int *);
+extern bool              n00b_cstring_validate_u8(char *, int *, int *, int);
 extern int64_t           _n00b_string_find(n00b_string_t *,
                                            n00b_string_t *,
                                            ...);
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "n00b.h"
+
+// A small, fast LZ77 block codec (the data format is the LZ4 block
+// format). Ratios are modest, but it's cheap enough to leave on for
+// anything that gets written continuously, like session captures;
+// terminal output tends to compress well with it.
+
+#define N00B_LZ_HASH_BITS     12
+#define N00B_LZ_MIN_MATCH     4
+#define N00B_LZ_MAX_OFFSET    65535
+// Matches can't start in the last 12 bytes, and the last 5 bytes are
+// always literals.
+#define N00B_LZ_MFLIMIT       12
+#define N00B_LZ_LAST_LITERALS 5
+
+// Framing used by the streaming filters (src/io/filter_compress.nc).
+// Each frame is a u32 magic, the u32 raw length and the u32 stored
+// length (all little endian), then the data. A stored length equal
+// to the raw length means the data is stored as-is.
+#define N00B_LZ_FRAME_MAGIC   0x315a306e // "n0Z1"
+#define N00B_LZ_FRAME_HDR_LEN 12
+#define N00B_LZ_DEFAULT_BLOCK (64 * 1024)
+#define N00B_LZ_MAX_BLOCK     (4 * 1024 * 1024)
+// How long the compressor holds on to data by default, in ms.
+#define N00B_LZ_DEFAULT_FLUSH 100
+
+// Worst-case output size for 'n' bytes of input.
+static inline int64_t
+n00b_lz_bound(int64_t n)
+{
+    return n + n / 255 + 16;
+}
+
+// Both of these return the number of bytes written, or -1 if the
+// output doesn't fit ('dst' for compression must hold at least
+// n00b_lz_bound(len) bytes), or if the input is malformed.
+extern int64_t     n00b_lz_compress_raw(char *, int64_t, char *, int64_t);
+extern int64_t     n00b_lz_decompress_raw(char *, int64_t, char *, int64_t);
+extern n00b_buf_t *n00b_lz_compress(n00b_buf_t *);
+extern n00b_buf_t *n00b_lz_decompress(n00b_buf_t *, int64_t);
@@ -14,6 +14,9 @@ typedef enum {
     N00B_FK_OTHER           = ~0,
 } n00b_file_kind;
 
+// Return false to stop the walk.
+typedef bool (*n00b_walk_cb)(n00b_string_t *, n00b_file_kind, void *);
+
 extern n00b_string_t *n00b_resolve_path(n00b_string_t *);
 extern n00b_string_t *n00b_path_tilde_expand(n00b_string_t *);
 extern n00b_string_t *n00b_get_user_dir(n00b_string_t *);
@@ -22,6 +25,10 @@ extern bool           n00b_set_current_directory(n00b_string_t *);
 extern n00b_string_t *n00b_path_join(n00b_list_t *);
 extern n00b_file_kind n00b_get_file_kind(n00b_string_t *);
 extern n00b_list_t   *_n00b_path_walk(n00b_string_t *, ...);
+extern void           _n00b_path_walk_each(n00b_string_t *,
+                                           n00b_walk_cb,
+                                           void *,
+                                           ...);
 extern n00b_string_t *n00b_app_path(void);
 extern n00b_string_t *n00b_path_trim_trailing_slashes(n00b_string_t *);
 extern n00b_string_t *n00b_new_temp_dir(n00b_string_t *, n00b_string_t *);
@@ -86,6 +93,8 @@ n00b_path_is_link(n00b_string_t *s)
 
 #define n00b_path_walk(x, ...) \
     _n00b_path_walk(x, N00B_VA(__VA_ARGS__))
+#define n00b_path_walk_each(x, cb, arg, ...) \
+    _n00b_path_walk_each(x, cb, arg, N00B_VA(__VA_ARGS__))
 #define n00b_list_directory(x, ...) \
     _n00b_list_directory(x, N00B_VA(__VA_ARGS__))
 
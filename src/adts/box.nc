@@ -1,6 +1,99 @@
 #define N00B_USE_INTERNAL_API
 #include "n00b.h"
 
+// Dynamic code boxes ints constantly (loop counters, attribute values,
+// FFI returns, etc), and the vast majority of them are small. Since
+// boxes never change once they're made, we keep one shared box for
+// each small value of each int type, built the first time it's asked
+// for, and hand that out instead of allocating.
+//
+// Floats don't get cached; there's no small set of them worth keeping.
+
+#define BOX_CACHE_LEN  (N00B_BOX_CACHE_MAX - N00B_BOX_CACHE_MIN + 1)
+#define BOX_CACHE_ROWS 8
+
+static _Atomic(n00b_obj_t) box_cache[BOX_CACHE_ROWS][BOX_CACHE_LEN];
+
+static once void
+box_cache_init(void)
+{
+    n00b_gc_register_root(&box_cache[0][0],
+                          sizeof(box_cache) / sizeof(n00b_obj_t));
+}
+
+// Returns the cache row for the type, or -1 if it doesn't get cached,
+// and puts the value in '*n', normalized the same way unboxing would
+// see it.
+static inline int
+box_cache_row(n00b_box_t value, n00b_type_t *type, int64_t *n)
+{
+    switch (type->base_index) {
+    case N00B_T_BOOL:
+        *n = !!value.u64;
+        return 0;
+    case N00B_T_I8:
+        *n = value.i8;
+        return 1;
+    case N00B_T_BYTE:
+        *n = value.u8;
+        return 2;
+    case N00B_T_I32:
+        *n = value.i32;
+        return 3;
+    case N00B_T_CHAR:
+        *n = value.i32;
+        return 4;
+    case N00B_T_U32:
+        *n = value.u32;
+        return 5;
+    case N00B_T_INT:
+        *n = value.i64;
+        return 6;
+    case N00B_T_UINT:
+        if (value.u64 > INT64_MAX) {
+            return -1;
+        }
+        *n = value.i64;
+        return 7;
+    default:
+        return -1;
+    }
+}
+
+// Returns a shared box for 'value' if it's small enough to cache, and
+// NULL otherwise, in which case the caller should allocate its own.
+n00b_obj_t
+n00b_box_cache_get(n00b_box_t value, n00b_type_t *type)
+{
+    int64_t n;
+    int     row = box_cache_row(value, type, &n);
+
+    if (row < 0 || n < N00B_BOX_CACHE_MIN || n > N00B_BOX_CACHE_MAX) {
+        return NULL;
+    }
+
+    _Atomic(n00b_obj_t) *slot   = &box_cache[row][n - N00B_BOX_CACHE_MIN];
+    n00b_obj_t           result = atomic_read(slot);
+
+    if (result) {
+        return result;
+    }
+
+    box_cache_init();
+
+    n00b_obj_t expected = NULL;
+
+    result = n00b_new(n00b_type_box(type), (n00b_box_t){.i64 = n});
+
+    // If someone else got there first, use theirs, so that there's
+    // only ever one box per value.
+    if (!CAS(slot, &expected, result)) {
+        return expected;
+    }
+
+    return result;
+}
+
 static void
 box_init(n00b_box_t *box, va_list args)
 {
@@ -36,15 +36,26 @@ n00b_list_init(n00b_list_t *list, va_list args)
     }
 }
 
+// Lists of value items (ints, floats, etc) keep the items right in
+// the slots, so the slots don't need to be scanned, and can be copied
+// around in bulk.
+static inline int64_t **
+list_alloc_slots(n00b_list_t *list, int64_t len)
+{
+    if (n00b_obj_item_type_is_value(list)) {
+        return n00b_gc_array_value_alloc(uint64_t *, len);
+    }
+
+    return n00b_gc_array_alloc(uint64_t *, len);
+}
+
 void
 n00b_private_list_resize(n00b_list_t *list, size_t len)
 {
     int64_t **old = list->data;
-    int64_t **new = n00b_gc_array_alloc(uint64_t *, len);
+    int64_t **new = list_alloc_slots(list, len);
 
-    for (int i = 0; i < list->length; i++) {
-        new[i] = old[i];
-    }
+    memcpy(new, old, n00b_min((int64_t)len, list->length) * sizeof(int64_t *));
 
     list->data   = new;
     list->length = len;
@@ -249,7 +260,15 @@ n00b_private_list_plus_eq(n00b_list_t *l1, n00b_list_t *l2)
     int needed = l1->append_ix + l2->append_ix;
 
     if (needed > l1->length) {
-        n00b_list_resize(l1, needed);
+        n00b_private_list_resize(l1, needed);
+    }
+
+    if (!l1->enforce_uniqueness) {
+        memcpy(&l1->data[l1->append_ix],
+               l2->data,
+               l2->append_ix * sizeof(int64_t *));
+        l1->append_ix = needed;
+        return;
     }
 
     for (int i = 0; i < l2->append_ix; i++) {
@@ -298,15 +317,12 @@ n00b_private_list_plus(n00b_list_t *l1, n00b_list_t *l2)
     size_t       needed = l1->append_ix + l2->append_ix;
     result              = n00b_new(t, length : needed);
 
-    for (int i = 0; i < l1->append_ix; i++) {
-        result->data[i] = l1->data[i];
-    }
+    memcpy(result->data, l1->data, l1->append_ix * sizeof(int64_t *));
+    memcpy(&result->data[l1->append_ix],
+           l2->data,
+           l2->append_ix * sizeof(int64_t *));
 
-    result->append_ix = l1->append_ix;
-
-    for (int i = 0; i < l2->append_ix; i++) {
-        result->data[result->append_ix++] = l2->data[i];
-    }
+    result->append_ix = needed;
 
     return result;
 }
@@ -336,15 +352,12 @@ n00b_list_plus(n00b_list_t *l1, n00b_list_t *l2)
     size_t       needed = l1->append_ix + l2->append_ix;
     result              = n00b_new(t, length : needed);
 
-    for (int i = 0; i < l1->append_ix; i++) {
-        result->data[i] = l1->data[i];
-    }
-
-    result->append_ix = l1->append_ix;
+    memcpy(result->data, l1->data, l1->append_ix * sizeof(int64_t *));
+    memcpy(&result->data[l1->append_ix],
+           l2->data,
+           l2->append_ix * sizeof(int64_t *));
 
-    for (int i = 0; i < l2->append_ix; i++) {
-        result->data[result->append_ix++] = l2->data[i];
-    }
+    result->append_ix = needed;
     read_end(l2);
     read_end(l1);
 
@@ -455,6 +468,11 @@ n00b_list_coerce_to(n00b_list_t *list, n00b_type_t *dst_type)
 n00b_list_t *
 n00b_private_list_copy(n00b_list_t *list)
 {
+    // Copying a value is a no-op.
+    if (n00b_obj_item_type_is_value(list)) {
+        return n00b_private_list_shallow_copy(list);
+    }
+
     int64_t      len     = n00b_list_len(list);
     n00b_type_t *my_type = n00b_get_my_type((n00b_obj_t)list);
     n00b_list_t *res     = n00b_new(my_type, length : len);
@@ -483,9 +501,8 @@ n00b_private_list_shallow_copy(n00b_list_t *list)
     n00b_type_t *my_type = n00b_get_my_type((n00b_obj_t)list);
     n00b_list_t *res     = n00b_new(my_type, length : len);
 
-    for (int i = 0; i < len; i++) {
-        n00b_private_list_set(res, i, n00b_list_get_base(list, i, NULL));
-    }
+    memcpy(res->data, list->data, len * sizeof(int64_t *));
+    res->append_ix = len;
 
     return res;
 }
@@ -553,10 +570,8 @@ n00b_private_list_get_slice(n00b_list_t *list, int64_t start, int64_t end)
     len = end - start;
     res = n00b_new(n00b_get_my_type(list), length : len);
 
-    for (int i = 0; i < len; i++) {
-        void *item = n00b_list_get_base(list, start + i, NULL);
-        n00b_list_set(res, i, item);
-    }
+    memcpy(res->data, &list->data[start], len * sizeof(int64_t *));
+    res->append_ix = len;
 
     return res;
 }
@@ -617,27 +632,17 @@ n00b_private_list_set_slice(n00b_list_t *list,
     int64_t slicelen = end - start;
     int64_t newlen   = len1 + len2 - slicelen;
 
-    void **newdata = n00b_gc_array_alloc(void *, newlen);
-
-    if (start > 0) {
-        for (int i = 0; i < start; i++) {
-            void *item = n00b_list_get_base(list, i, NULL);
-            newdata[i] = item;
-        }
-    }
-
-    for (int i = 0; i < len2; i++) {
-        void *item       = n00b_list_get_base(new, i, NULL);
-        newdata[start++] = item;
-    }
+    int64_t **newdata = list_alloc_slots(list, n00b_max(newlen, 16));
 
-    for (int i = end; i < len1; i++) {
-        void *item       = n00b_list_get_base(list, i, NULL);
-        newdata[start++] = item;
-    }
+    memcpy(newdata, list->data, start * sizeof(int64_t *));
+    memcpy(&newdata[start], new->data, len2 * sizeof(int64_t *));
+    memcpy(&newdata[start + len2],
+           &list->data[end],
+           (len1 - end) * sizeof(int64_t *));
 
-    list->data      = (int64_t **)newdata;
-    list->append_ix = start;
+    list->data      = newdata;
+    list->append_ix = newlen;
+    list->length    = n00b_max(newlen, 16);
 
     if (!private_new) {
         read_end(new);
@@ -800,6 +805,17 @@ int64_t
 n00b_private_list_find(n00b_list_t *list, void *item)
 {
     int n = n00b_list_len(list);
+
+    // n00b_equals() would end up comparing the bits anyway.
+    if (n00b_obj_item_type_is_value(list)) {
+        for (int i = 0; i < n; i++) {
+            if (list->data[i] == item) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
     for (int i = 0; i < n; i++) {
         void *candidate = n00b_private_list_get(list, i, NULL);
         if (n00b_equals(candidate, item)) {
@@ -835,9 +851,7 @@ n00b_list_view(n00b_list_t *list, uint64_t *n)
         view = n00b_gc_array_alloc(void *, len);
     }
 
-    for (int i = 0; i < len; i++) {
-        view[i] = n00b_list_get_base(list, i, NULL);
-    }
+    memcpy(view, list->data, len * sizeof(void *));
 
     read_end(list);
 
@@ -928,6 +942,47 @@ n00b_from_cstr_list(char **arr, int64_t n)
     return result;
 }
 
+// Copy-on-write updates, for lists that get read far more often than
+// they change (subscriber lists, mainly). A published list is never
+// modified, so readers just load the pointer once and iterate without
+// locking. Writers build a modified copy and swap it in; the caller
+// has to serialize writers to the same slot. Old versions need no
+// explicit reclamation, since the GC won't free one while a reader
+// can still reach it.
+void
+n00b_list_cow_append(_Atomic(n00b_list_t *) *slot, void *item)
+{
+    n00b_list_t *old = atomic_read(slot);
+    n00b_list_t *new;
+
+    if (old) {
+        new = n00b_private_list_shallow_copy(old);
+    }
+    else {
+        new = n00b_list(n00b_type_ref());
+    }
+
+    n00b_private_list_append(new, item);
+    atomic_store(slot, new);
+}
+
+bool
+n00b_list_cow_remove_item(_Atomic(n00b_list_t *) *slot, void *item)
+{
+    n00b_list_t *old = atomic_read(slot);
+
+    if (!old || n00b_private_list_find(old, item) == -1) {
+        return false;
+    }
+
+    n00b_list_t *new = n00b_private_list_shallow_copy(old);
+
+    n00b_private_list_remove_item(new, item);
+    atomic_store(slot, new);
+
+    return true;
+}
+
 extern bool n00b_flexarray_can_coerce_to(n00b_type_t *, n00b_type_t *);
 
 const n00b_vtable_t n00b_list_vtable = {
@@ -0,0 +1,306 @@
+// Kernels for lists of numbers.
+//
+// Lists of value items keep the item bits right in their slots, so a
+// list of ints is already a contiguous array of 64-bit words, and a
+// list of f64s is a contiguous array of doubles. The generic list
+// operations don't know that, and go through the object layer for
+// each item. These don't, so they're simple loops over the slots.
+//
+// The loops keep several independent accumulators, which breaks the
+// dependency chain from one item to the next, and lets the compiler
+// vectorize them. For floats, that means the sum is added up in a
+// different order than a naive loop would, so the last bits can
+// differ.
+//
+// Everything here raises if the list's item type isn't suitable.
+// Lists of bools, bytes, chars and the other small int types count as
+// ints; only f64 counts as a float.
+
+#define N00B_USE_INTERNAL_API
+#include "n00b.h"
+
+static inline n00b_type_t *
+list_item_type(n00b_list_t *list)
+{
+    n00b_type_t *t = n00b_type_get_param(n00b_get_my_type(list), 0);
+
+    return n00b_type_unbox(n00b_type_resolve(t));
+}
+
+// Returns true if the items should be compared as unsigned.
+static bool
+require_ints(n00b_list_t *list)
+{
+    n00b_type_t *t = list_item_type(list);
+
+    if (!n00b_type_is_int_type(t) && !n00b_type_is_bool(t)) {
+        N00B_CRAISE("List items must be integers.");
+    }
+
+    return !n00b_type_is_signed(t);
+}
+
+static void
+require_floats(n00b_list_t *list)
+{
+    if (list_item_type(list)->typeid != N00B_T_F64) {
+        N00B_CRAISE("List items must be f64s.");
+    }
+}
+
+// The sum wraps on overflow. It's added up unsigned, where wrapping
+// is defined; two's complement makes the bits the same either way.
+int64_t
+n00b_list_sum_ints(n00b_list_t *list)
+{
+    require_ints(list);
+    n00b_lock_list_read(list);
+
+    uint64_t *v     = (uint64_t *)list->data;
+    int64_t   n     = list->append_ix;
+    uint64_t  a[4]  = {0, 0, 0, 0};
+    int64_t   i     = 0;
+    uint64_t  total = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        a[0] += v[i];
+        a[1] += v[i + 1];
+        a[2] += v[i + 2];
+        a[3] += v[i + 3];
+    }
+
+    for (; i < n; i++) {
+        total += v[i];
+    }
+
+    n00b_unlock_list(list);
+
+    return (int64_t)(total + a[0] + a[1] + a[2] + a[3]);
+}
+
+double
+n00b_list_sum_floats(n00b_list_t *list)
+{
+    require_floats(list);
+    n00b_lock_list_read(list);
+
+    double *v     = (double *)list->data;
+    int64_t n     = list->append_ix;
+    double  a[4]  = {0, 0, 0, 0};
+    int64_t i     = 0;
+    double  total = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        a[0] += v[i];
+        a[1] += v[i + 1];
+        a[2] += v[i + 2];
+        a[3] += v[i + 3];
+    }
+
+    for (; i < n; i++) {
+        total += v[i];
+    }
+
+    n00b_unlock_list(list);
+
+    return total + (a[0] + a[1]) + (a[2] + a[3]);
+}
+
+// The unsigned version is the same thing w/ the sign bit flipped on
+// the way in and out, which maps unsigned order onto signed order.
+static int64_t
+int_extreme(n00b_list_t *list, bool max, bool *err)
+{
+    uint64_t flip = require_ints(list) ? (1ULL << 63) : 0;
+
+    n00b_lock_list_read(list);
+
+    int64_t *v = (int64_t *)list->data;
+    int64_t  n = list->append_ix;
+
+    if (!n) {
+        n00b_unlock_list(list);
+        if (err) {
+            *err = true;
+        }
+        return 0;
+    }
+
+    int64_t best = v[0] ^ flip;
+
+    if (max) {
+        for (int64_t i = 1; i < n; i++) {
+            int64_t x = v[i] ^ flip;
+            best      = x > best ? x : best;
+        }
+    }
+    else {
+        for (int64_t i = 1; i < n; i++) {
+            int64_t x = v[i] ^ flip;
+            best      = x < best ? x : best;
+        }
+    }
+
+    n00b_unlock_list(list);
+
+    if (err) {
+        *err = false;
+    }
+
+    return best ^ flip;
+}
+
+static double
+float_extreme(n00b_list_t *list, bool max, bool *err)
+{
+    require_floats(list);
+    n00b_lock_list_read(list);
+
+    double *v = (double *)list->data;
+    int64_t n = list->append_ix;
+
+    if (!n) {
+        n00b_unlock_list(list);
+        if (err) {
+            *err = true;
+        }
+        return 0;
+    }
+
+    double best = v[0];
+
+    if (max) {
+        for (int64_t i = 1; i < n; i++) {
+            best = v[i] > best ? v[i] : best;
+        }
+    }
+    else {
+        for (int64_t i = 1; i < n; i++) {
+            best = v[i] < best ? v[i] : best;
+        }
+    }
+
+    n00b_unlock_list(list);
+
+    if (err) {
+        *err = false;
+    }
+
+    return best;
+}
+
+// For the min / max functions, 'err' gets set if the list is empty.
+int64_t
+n00b_list_min_int(n00b_list_t *list, bool *err)
+{
+    return int_extreme(list, false, err);
+}
+
+int64_t
+n00b_list_max_int(n00b_list_t *list, bool *err)
+{
+    return int_extreme(list, true, err);
+}
+
+double
+n00b_list_min_float(n00b_list_t *list, bool *err)
+{
+    return float_extreme(list, false, err);
+}
+
+double
+n00b_list_max_float(n00b_list_t *list, bool *err)
+{
+    return float_extreme(list, true, err);
+}
+
+// Below this, a radix sort's passes over the counts cost more than
+// they save.
+#define N00B_RADIX_SORT_MIN 64
+
+static void
+insertion_sort(uint64_t *keys, int64_t n, uint64_t flip)
+{
+    for (int64_t i = 1; i < n; i++) {
+        uint64_t k = keys[i];
+        int64_t  j = i - 1;
+
+        while (j >= 0 && (keys[j] ^ flip) > (k ^ flip)) {
+            keys[j + 1] = keys[j];
+            j--;
+        }
+
+        keys[j + 1] = k;
+    }
+}
+
+// LSD radix sort, a byte at a time. All the counts get taken in a
+// single pass up front, and any byte where every key has the same
+// value gets skipped, so lists of small numbers only pay for the
+// bytes that actually vary.
+//
+// Keys get compared as unsigned; for signed ints, 'flip' is the sign
+// bit, which makes that come out right.
+static void
+radix_sort(uint64_t *keys, int64_t n, uint64_t flip)
+{
+    if (n < N00B_RADIX_SORT_MIN) {
+        insertion_sort(keys, n, flip);
+        return;
+    }
+
+    int64_t   counts[8][256] = {0};
+    uint64_t *src            = keys;
+    uint64_t *dst            = n00b_gc_array_value_alloc(uint64_t, n);
+
+    for (int64_t i = 0; i < n; i++) {
+        uint64_t k = keys[i] ^ flip;
+
+        for (int b = 0; b < 8; b++) {
+            counts[b][(k >> (b * 8)) & 0xff]++;
+        }
+    }
+
+    for (int b = 0; b < 8; b++) {
+        int64_t *c     = counts[b];
+        int      shift = b * 8;
+
+        if (c[((src[0] ^ flip) >> shift) & 0xff] == n) {
+            continue;
+        }
+
+        int64_t offset = 0;
+
+        for (int d = 0; d < 256; d++) {
+            int64_t count = c[d];
+            c[d]          = offset;
+            offset += count;
+        }
+
+        for (int64_t i = 0; i < n; i++) {
+            uint64_t k = src[i];
+
+            dst[c[((k ^ flip) >> shift) & 0xff]++] = k;
+        }
+
+        uint64_t *swap = src;
+        src            = dst;
+        dst            = swap;
+    }
+
+    if (src != keys) {
+        memcpy(keys, src, n * sizeof(uint64_t));
+    }
+}
+
+// Sorts a list of ints in place, in ascending order, without calling
+// a comparison function.
+void
+n00b_list_sort_ints(n00b_list_t *list)
+{
+    uint64_t flip = require_ints(list) ? 0 : (1ULL << 63);
+
+    n00b_lock_list(list);
+    radix_sort((uint64_t *)list->data, list->append_ix, flip);
+    n00b_unlock_list(list);
+}
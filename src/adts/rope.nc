@@ -0,0 +1,246 @@
+// Ropes, for building up large outputs a piece at a time.
+//
+// Adding buffers or concatenating strings copies both sides, so
+// building something big by appending one fragment at a time is
+// quadratic. A rope is a binary tree whose leaves point at the
+// fragments; appending or concatenating just makes a new interior
+// node, so it's constant time no matter how big either side is.
+//
+// When the bytes need to go somewhere, they usually don't need to be
+// contiguous; n00b_rope_iovec() gives you the fragments in order, and
+// n00b_rope_write_fd() hands them straight to writev(). When you do
+// need contiguous bytes, n00b_rope_to_buffer() flattens the rope
+// once, and caches the result in the node, so ropes built on top of
+// that one get to treat it as a single fragment from then on.
+//
+// We don't bother rebalancing. Appending one fragment at a time gives
+// a tree that's as deep as the number of fragments, but nothing here
+// recurses; traversal uses an explicit stack sized by the depth.
+#define N00B_USE_INTERNAL_API
+#include "n00b.h"
+
+static void
+n00b_rope_init(n00b_rope_t *r, va_list args)
+{
+    keywords
+    {
+        n00b_buf_t    *buffer      = NULL;
+        n00b_string_t *str(string) = NULL;
+    }
+
+    if (buffer && str) {
+        N00B_CRAISE("Cannot set 'string' and 'buffer' parameters at once.");
+    }
+
+    if (buffer) {
+        _n00b_buffer_acquire_r(buffer);
+        r->source   = buffer;
+        r->data     = buffer->data;
+        r->byte_len = buffer->byte_len;
+        n00b_buffer_release(buffer);
+    }
+
+    if (str) {
+        r->source   = str;
+        r->data     = str->data;
+        r->byte_len = str->u8_bytes;
+    }
+
+    if (r->byte_len) {
+        r->num_leaves = 1;
+    }
+}
+
+n00b_rope_t *
+n00b_rope_concat(n00b_rope_t *r1, n00b_rope_t *r2)
+{
+    if (!r1 || !r1->byte_len) {
+        return r2;
+    }
+    if (!r2 || !r2->byte_len) {
+        return r1;
+    }
+
+    n00b_rope_t *result = n00b_new(n00b_type_rope());
+
+    result->left       = r1;
+    result->right      = r2;
+    result->byte_len   = r1->byte_len + r2->byte_len;
+    result->depth      = n00b_max(r1->depth, r2->depth) + 1;
+    result->num_leaves = r1->num_leaves + r2->num_leaves;
+
+    return result;
+}
+
+n00b_rope_t *
+n00b_rope_append_buffer(n00b_rope_t *r, n00b_buf_t *b)
+{
+    return n00b_rope_concat(r, n00b_rope_from_buffer(b));
+}
+
+n00b_rope_t *
+n00b_rope_append_string(n00b_rope_t *r, n00b_string_t *s)
+{
+    return n00b_rope_concat(r, n00b_rope_from_string(s));
+}
+
+int64_t
+n00b_rope_len(n00b_rope_t *r)
+{
+    return r->byte_len;
+}
+
+// Fills in 'out' with the fragments, in order, and returns how many
+// there were. 'out' must have room for r->num_leaves entries.
+static int
+collect_fragments(n00b_rope_t *r, struct iovec *out)
+{
+    n00b_rope_t **stack = n00b_gc_array_alloc(n00b_rope_t *, r->depth + 1);
+    int           sp    = 0;
+    int           n     = 0;
+
+    stack[sp++] = r;
+
+    while (sp) {
+        n00b_rope_t *cur = stack[--sp];
+
+        if (cur->flat) {
+            out[n].iov_base = cur->flat->data;
+            out[n].iov_len  = cur->flat->byte_len;
+            n++;
+            continue;
+        }
+
+        if (!cur->left) {
+            if (cur->byte_len) {
+                out[n].iov_base = cur->data;
+                out[n].iov_len  = cur->byte_len;
+                n++;
+            }
+            continue;
+        }
+
+        stack[sp++] = cur->right;
+        stack[sp++] = cur->left;
+    }
+
+    return n;
+}
+
+// Returns the fragments of the rope, in order, w/ the count in '*n'.
+// The iovecs point into the rope's data, so the rope needs to stay
+// alive while you use them.
+struct iovec *
+n00b_rope_iovec(n00b_rope_t *r, int *n)
+{
+    struct iovec *result = n00b_gc_array_alloc(struct iovec,
+                                               n00b_max(r->num_leaves, 1));
+
+    *n = collect_fragments(r, result);
+
+    return result;
+}
+
+// The result is shared with the rope (and anything else that flattens
+// it), so treat it as read-only.
+n00b_buf_t *
+n00b_rope_to_buffer(n00b_rope_t *r)
+{
+    if (r->flat) {
+        return r->flat;
+    }
+
+    int           n;
+    struct iovec *iov    = n00b_rope_iovec(r, &n);
+    n00b_buf_t   *result = n00b_new(n00b_type_buffer(),
+                                  length : r->byte_len);
+    char         *p      = result->data;
+
+    for (int i = 0; i < n; i++) {
+        memcpy(p, iov[i].iov_base, iov[i].iov_len);
+        p += iov[i].iov_len;
+    }
+
+    // If two threads race to flatten, they both produce the same
+    // bytes, so it doesn't matter who wins.
+    r->flat = result;
+
+    return result;
+}
+
+n00b_string_t *
+n00b_rope_to_string(n00b_rope_t *r)
+{
+    return n00b_buf_to_string(n00b_rope_to_buffer(r));
+}
+
+// Writes the whole rope to a file descriptor, gathering the fragments
+// w/ writev(). Returns the number of bytes written, or -1 on error
+// (with errno set). Waits if the fd is non-blocking and full.
+int64_t
+n00b_rope_write_fd(n00b_rope_t *r, int fd)
+{
+    int           n;
+    struct iovec *iov     = n00b_rope_iovec(r, &n);
+    int64_t       written = 0;
+
+    while (n) {
+        ssize_t w = writev(fd, iov, n00b_min(n, IOV_MAX));
+
+        if (w < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN) {
+                struct pollfd pfd = {
+                    .fd     = fd,
+                    .events = POLLOUT,
+                };
+
+                poll(&pfd, 1, -1);
+                continue;
+            }
+            return -1;
+        }
+
+        written += w;
+
+        // Skip what got written; the last one may be partial.
+        while (n && (size_t)w >= iov->iov_len) {
+            w -= iov->iov_len;
+            iov++;
+            n--;
+        }
+
+        if (n) {
+            iov->iov_base = (char *)iov->iov_base + w;
+            iov->iov_len -= w;
+        }
+    }
+
+    return written;
+}
+
+static n00b_string_t *
+n00b_rope_to_str(n00b_rope_t *r)
+{
+    return n00b_to_string(n00b_rope_to_buffer(r));
+}
+
+static n00b_string_t *
+n00b_rope_to_lit(n00b_rope_t *r)
+{
+    return n00b_to_literal(n00b_rope_to_buffer(r));
+}
+
+const n00b_vtable_t n00b_rope_vtable = {
+    .methods = {
+        [N00B_BI_CONSTRUCTOR] = (n00b_vtable_entry)n00b_rope_init,
+        [N00B_BI_TO_STRING]   = (n00b_vtable_entry)n00b_rope_to_str,
+        [N00B_BI_TO_LITERAL]  = (n00b_vtable_entry)n00b_rope_to_lit,
+        [N00B_BI_ADD]         = (n00b_vtable_entry)n00b_rope_concat,
+        [N00B_BI_LEN]         = (n00b_vtable_entry)n00b_rope_len,
+        [N00B_BI_GC_MAP]      = (n00b_vtable_entry)N00B_GC_SCAN_ALL,
+        NULL,
+    },
+};
@@ -2,10 +2,32 @@
 #include "n00b.h"
 #include "n00b/cmd.h"
 
+static inline bool
+use_compile_cache(n00b_cmdline_ctx *ctx)
+{
+    return !n00b_cmd_no_cache(ctx) && !n00b_cmd_wants_compiler_info(ctx)
+        && n00b_compile_cache_enabled();
+}
+
+// When save_image is true, we also generate code and write the
+// resulting image to the compile cache. On a cache hit, ctx->vm is set
+// and ctx->cctx is left NULL, since we never ran the compiler.
 void
 n00b_compile(n00b_cmdline_ctx *ctx, bool save_image)
 {
-    n00b_string_t *s = n00b_list_get(ctx->args, 0, NULL);
+    n00b_string_t *s         = n00b_list_get(ctx->args, 0, NULL);
+    bool           use_cache = use_compile_cache(ctx);
+
+    if (use_cache) {
+        ctx->vm = n00b_compile_cache_lookup(s);
+
+        if (ctx->vm) {
+            if (n00b_cmd_verbose(ctx)) {
+                n00b_eprintf("Loaded «em1»«#»«/» from the compile cache", s);
+            }
+            return;
+        }
+    }
 
     if (!n00b_cmd_quiet(ctx)) {
         n00b_eprintf("Parsing module «em1»«#»«/» and its dependencies", s);
@@ -15,5 +37,26 @@ n00b_compile(n00b_cmdline_ctx *ctx, bool save_image)
 
     if (n00b_got_fatal_compiler_error(ctx->cctx)) {
         ctx->exit_code = -1;
+        return;
+    }
+
+    if (!save_image) {
+        return;
+    }
+
+    if (!n00b_cmd_quiet(ctx)) {
+        n00b_eprintf("«em1»Generating code.");
+    }
+
+    ctx->vm = n00b_vm_new(ctx->cctx);
+
+    if (!n00b_generate_code(ctx->cctx, ctx->vm)) {
+        ctx->exit_code = -1;
+        return;
+    }
+
+    if (use_cache && n00b_compile_cache_store(s, ctx->vm)
+        && n00b_cmd_verbose(ctx)) {
+        n00b_eprintf("Saved «em1»«#»«/» to the compile cache", s);
     }
 }
@@ -36,6 +36,14 @@ n00b_show_any_debug_info(n00b_cmdline_ctx *ctx)
         || n00b_cmd_show_function_info(ctx);
 }
 
+// The compile cache only holds the generated image, so when any of
+// this was asked for, we need to go through the full compiler.
+bool
+n00b_cmd_wants_compiler_info(n00b_cmdline_ctx *ctx)
+{
+    return n00b_show_any_debug_info(ctx) || n00b_cmd_show_modules(ctx);
+}
+
 static void
 n00b_show_module_debug_info(n00b_cmdline_ctx *ctx, n00b_module_t *m, bool entry)
 {
@@ -115,6 +123,11 @@ n00b_show_compiler_debug_info(n00b_cmdline_ctx *ctx)
         return;
     }
 
+    // Loaded from the compile cache.
+    if (!ctx->cctx) {
+        return;
+    }
+
     if (!ctx->cctx->entry_point->path) {
         return;
     }
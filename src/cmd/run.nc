@@ -5,18 +5,12 @@
 void
 n00b_compile_and_run(n00b_cmdline_ctx *ctx)
 {
-    n00b_compile(ctx, false);
+    n00b_compile(ctx, true);
 
-    if (n00b_got_fatal_compiler_error(ctx->cctx)) {
+    if (ctx->exit_code || !ctx->vm) {
         return;
     }
 
-    if (!n00b_cmd_quiet(ctx)) {
-        n00b_eprintf("«em1»Generating code.");
-    }
-    ctx->vm = n00b_vm_new(ctx->cctx);
-    n00b_generate_code(ctx->cctx, ctx->vm);
-
     if (!n00b_cmd_quiet(ctx)) {
         n00b_eprintf("«em4»Beginning execution.");
     }
@@ -18,6 +18,7 @@ const char *n00b_fl_verbose            = "verbose";
 const char *n00b_fl_merge              = "ansi";
 const char *n00b_fl_ansi               = "merge-output";
 const char *n00b_fl_bright             = "bright";
+const char *n00b_fl_no_cache           = "no-cache";
 
 const char *n00b_cmd_doc =
     "### The n00b compiler.\n\n"
@@ -117,6 +118,9 @@ n00b_setup_cmd_line(void)
     n00b_new(n00b_type_gopt_option(),
       name:           n00b_cstring((char *)n00b_fl_bright),
       linked_command: N00B_GOAT_BOOL_T_DEFAULT);
+    n00b_new(n00b_type_gopt_option(),
+      name:           n00b_cstring((char *)n00b_fl_no_cache),
+      linked_command: N00B_GOAT_BOOL_T_DEFAULT);
 
     n00b_gopt_add_subcommand(gopt, compile, n00b_cstring("(str)+"));
     n00b_gopt_add_subcommand(gopt, build, n00b_cstring("(str)+"));
@@ -0,0 +1,432 @@
+#define N00B_USE_INTERNAL_API
+#include "n00b.h"
+
+// The persistent compile cache. After a successful compile + code
+// generation, we save the generated VM as a mappable image (see
+// src/io/marshal_image.nc) along with a manifest of the modules that
+// went into it. On the next run with the same entry point, if every
+// module's source still hashes to what's in the manifest, we map the
+// image and skip lexing, parsing, checking and code generation
+// entirely.
+//
+// We cache at the granularity of the whole program, not each module
+// on its own. Code generation links every module into a single
+// object file (shared static memory, a single constant pool, module
+// ids assigned by topological order), so a module's artifacts aren't
+// meaningful outside of the image they were generated into. The
+// manifest still lets us invalidate on a change to any individual
+// module.
+//
+// File layout (all integers little endian):
+//
+//   u64  N00B_COMPILE_CACHE_MAGIC
+//   u64  n00b_current_version.number
+//   u64  N00B_MARSHAL_MAGIC
+//   u64  offset of the image (a multiple of N00B_IMAGE_ALIGN)
+//   u64  number of modules
+//   For each module:
+//     u64    path length
+//     bytes  path
+//     32     SHA-256 of the module's source
+//   Zero padding up to the image offset
+//   The n00b_vm_t image, which gets mapped directly from the file.
+
+#define SHA256_LEN 32
+#define PREAMBLE_LEN (5 * sizeof(uint64_t))
+
+typedef struct {
+    char *p;
+    char *end;
+} cache_cursor_t;
+
+bool
+n00b_compile_cache_enabled(void)
+{
+    return n00b_get_env(n00b_cstring("N00B_NO_CACHE")) == NULL;
+}
+
+static bool
+ensure_dir(n00b_string_t *path)
+{
+    if (!mkdir(path->data, 0755)) {
+        return true;
+    }
+
+    return errno == EEXIST && n00b_path_is_directory(path);
+}
+
+n00b_string_t *
+n00b_compile_cache_dir(void)
+{
+    n00b_string_t *dir = n00b_get_env(n00b_cstring("N00B_CACHE_DIR"));
+
+    if (dir) {
+        dir = n00b_resolve_path(dir);
+        return ensure_dir(dir) ? dir : NULL;
+    }
+
+    n00b_string_t *base = n00b_get_env(n00b_cstring("XDG_CACHE_HOME"));
+
+    if (!base) {
+        base = n00b_cformat("«#»/.cache", n00b_get_home_directory());
+    }
+
+    base = n00b_resolve_path(base);
+
+    if (!ensure_dir(base)) {
+        return NULL;
+    }
+
+    dir = n00b_cformat("«#»/n00b", base);
+
+    return ensure_dir(dir) ? dir : NULL;
+}
+
+// Anything that can change which files a program resolves to has to
+// be part of the key; the manifest only tells us whether the files
+// we used last time changed, not whether we'd now pick different
+// ones.
+static n00b_string_t *
+cache_filename(n00b_string_t *dir, n00b_string_t *entry)
+{
+    n00b_sha_t  *sha = n00b_new(n00b_type_hash());
+    n00b_list_t *sp  = n00b_get_module_search_path();
+    int          n   = n00b_list_len(sp);
+
+    n00b_sha_int_update(sha, N00B_COMPILE_CACHE_MAGIC);
+    n00b_sha_int_update(sha, n00b_current_version.number);
+    n00b_sha_int_update(sha, N00B_MARSHAL_MAGIC);
+    n00b_sha_string_update(sha, n00b_resolve_path(entry));
+    n00b_sha_string_update(sha, n00b_n00b_root());
+
+    for (int i = 0; i < n; i++) {
+        n00b_sha_int_update(sha, '\n');
+        n00b_sha_string_update(sha, n00b_list_get(sp, i, NULL));
+    }
+
+    n00b_string_t *hex = n00b_buffer_to_hex_str(n00b_sha_finish(sha));
+
+    return n00b_cformat("«#»/«#».«#»",
+                        dir,
+                        hex,
+                        n00b_cstring(N00B_COMPILE_CACHE_EXT));
+}
+
+static n00b_buf_t *
+source_digest(n00b_string_t *source)
+{
+    n00b_sha_t *sha = n00b_new(n00b_type_hash());
+
+    n00b_sha_string_update(sha, source);
+
+    return n00b_sha_finish(sha);
+}
+
+static inline bool
+cursor_u64(cache_cursor_t *c, uint64_t *out)
+{
+    if (c->end - c->p < (int64_t)sizeof(uint64_t)) {
+        return false;
+    }
+
+    memcpy(out, c->p, sizeof(uint64_t));
+    little_64(*out);
+    c->p += sizeof(uint64_t);
+
+    return true;
+}
+
+static inline char *
+cursor_bytes(cache_cursor_t *c, uint64_t len)
+{
+    if ((uint64_t)(c->end - c->p) < len) {
+        return NULL;
+    }
+
+    char *result = c->p;
+    c->p += len;
+
+    return result;
+}
+
+// Returns true if the source at 'path' still hashes to 'digest'.
+static bool
+module_is_current(n00b_string_t *path, char *digest)
+{
+    if (!n00b_path_is_file(path)) {
+        return false;
+    }
+
+    n00b_string_t *contents = n00b_read_file(path);
+
+    if (!contents) {
+        return false;
+    }
+
+    n00b_buf_t *d = source_digest(contents);
+
+    return !memcmp(d->data, digest, SHA256_LEN);
+}
+
+static bool
+read_all(int fd, char *p, int64_t len, int64_t offset)
+{
+    while (len) {
+        ssize_t n = pread(fd, p, len, offset);
+
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+
+        p += n;
+        len -= n;
+        offset += n;
+    }
+
+    return true;
+}
+
+// Checks the preamble and manifest; on success, returns the offset of
+// the image in the file, or -1 if the entry is stale or unusable.
+static int64_t
+check_manifest(int fd)
+{
+    char           preamble[PREAMBLE_LEN];
+    cache_cursor_t c = {
+        .p   = preamble,
+        .end = preamble + PREAMBLE_LEN,
+    };
+    uint64_t       word;
+    uint64_t       image_offset;
+    uint64_t       num_modules;
+
+    if (!read_all(fd, preamble, PREAMBLE_LEN, 0)) {
+        return -1;
+    }
+
+    if (!cursor_u64(&c, &word) || word != N00B_COMPILE_CACHE_MAGIC) {
+        return -1;
+    }
+    if (!cursor_u64(&c, &word) || word != n00b_current_version.number) {
+        return -1;
+    }
+    if (!cursor_u64(&c, &word) || word != N00B_MARSHAL_MAGIC) {
+        return -1;
+    }
+    if (!cursor_u64(&c, &image_offset) || !cursor_u64(&c, &num_modules)) {
+        return -1;
+    }
+
+    if (image_offset < PREAMBLE_LEN || image_offset % N00B_IMAGE_ALIGN) {
+        return -1;
+    }
+
+    int64_t     len      = image_offset - PREAMBLE_LEN;
+    n00b_buf_t *manifest = n00b_new(n00b_type_buffer(), length : len);
+
+    if (!read_all(fd, manifest->data, len, PREAMBLE_LEN)) {
+        return -1;
+    }
+
+    c.p   = manifest->data;
+    c.end = manifest->data + len;
+
+    for (uint64_t i = 0; i < num_modules; i++) {
+        char *path;
+        char *digest;
+
+        if (!cursor_u64(&c, &word)) {
+            return -1;
+        }
+
+        path   = cursor_bytes(&c, word);
+        digest = cursor_bytes(&c, SHA256_LEN);
+
+        if (!path || !digest) {
+            return -1;
+        }
+
+        if (!module_is_current(n00b_utf8(path, word), digest)) {
+            return -1;
+        }
+    }
+
+    return image_offset;
+}
+
+n00b_vm_t *
+n00b_compile_cache_lookup(n00b_string_t *entry)
+{
+    if (!n00b_compile_cache_enabled()) {
+        return NULL;
+    }
+
+    n00b_string_t *dir = n00b_compile_cache_dir();
+
+    if (!dir) {
+        return NULL;
+    }
+
+    n00b_string_t *fname = cache_filename(dir, entry);
+    int            fd    = open(fname->data, O_RDONLY | O_CLOEXEC);
+
+    if (fd == -1) {
+        return NULL;
+    }
+
+    n00b_vm_t *result       = NULL;
+    int64_t    image_offset = check_manifest(fd);
+
+    if (image_offset != -1) {
+        result = n00b_image_map(fd, image_offset);
+    }
+
+    close(fd);
+
+    return result;
+}
+
+static bool
+write_all(int fd, char *p, int64_t len)
+{
+    while (len) {
+        ssize_t n = write(fd, p, len);
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+
+        p += n;
+        len -= n;
+    }
+
+    return true;
+}
+
+static inline bool
+write_u64(int fd, uint64_t n)
+{
+    little_64(n);
+    return write_all(fd, (char *)&n, sizeof(uint64_t));
+}
+
+static bool
+write_cache_contents(int          fd,
+                     n00b_list_t *paths,
+                     n00b_list_t *digests,
+                     n00b_buf_t  *image)
+{
+    int      n            = n00b_list_len(paths);
+    uint64_t image_offset = PREAMBLE_LEN;
+
+    for (int i = 0; i < n; i++) {
+        n00b_string_t *path = n00b_list_get(paths, i, NULL);
+
+        image_offset += sizeof(uint64_t) + path->u8_bytes + SHA256_LEN;
+    }
+
+    image_offset = n00b_round_up_to_given_power_of_2(N00B_IMAGE_ALIGN,
+                                                     image_offset);
+
+    if (!write_u64(fd, N00B_COMPILE_CACHE_MAGIC)
+        || !write_u64(fd, n00b_current_version.number)
+        || !write_u64(fd, N00B_MARSHAL_MAGIC)
+        || !write_u64(fd, image_offset)
+        || !write_u64(fd, n)) {
+        return false;
+    }
+
+    for (int i = 0; i < n; i++) {
+        n00b_string_t *path   = n00b_list_get(paths, i, NULL);
+        n00b_buf_t    *digest = n00b_list_get(digests, i, NULL);
+
+        if (!write_u64(fd, path->u8_bytes)
+            || !write_all(fd, path->data, path->u8_bytes)
+            || !write_all(fd, digest->data, SHA256_LEN)) {
+            return false;
+        }
+    }
+
+    // The image gets mapped straight out of the file, so it has to
+    // start on an aligned boundary.
+    if (lseek(fd, image_offset, SEEK_SET) == -1) {
+        return false;
+    }
+
+    return write_all(fd, image->data, image->byte_len);
+}
+
+// Must be called after code generation, but before the VM runs for
+// the first time; we only cache pristine images.
+bool
+n00b_compile_cache_store(n00b_string_t *entry, n00b_vm_t *vm)
+{
+    if (!n00b_compile_cache_enabled() || vm->run_state != NULL) {
+        return false;
+    }
+
+    n00b_string_t *dir = n00b_compile_cache_dir();
+
+    if (!dir) {
+        return false;
+    }
+
+    n00b_list_t *mods    = vm->obj->module_contents;
+    n00b_list_t *paths   = n00b_list(n00b_type_string());
+    n00b_list_t *digests = n00b_list(n00b_type_buffer());
+    int          n       = n00b_list_len(mods);
+
+    for (int i = 0; i < n; i++) {
+        n00b_module_t *m    = n00b_list_get(mods, i, NULL);
+        n00b_string_t *path = m->full_uri;
+
+        // Modules loaded from URLs (or from raw strings) can't be
+        // revalidated cheaply, so programs using them don't get
+        // cached.
+        if (!path || !m->source || n00b_path_is_url(path)) {
+            return false;
+        }
+
+        n00b_list_append(paths, path);
+        n00b_list_append(digests, source_digest(m->source));
+    }
+
+    // Marshal without the compile-time info, but put it back
+    // afterward, since the caller may still want to report warnings
+    // or show debug output.
+    n00b_list_t *stash = n00b_vm_stash_compile_time_data(vm);
+    n00b_buf_t  *image = n00b_image_create(vm);
+
+    n00b_vm_restore_compile_time_data(stash);
+
+    // Write to a temporary file in the same directory, then rename,
+    // so that concurrent runs never see a partially written entry.
+    n00b_string_t *fname = cache_filename(dir, entry);
+    n00b_string_t *tmp   = n00b_cformat("«#».«#».tmp",
+                                      fname,
+                                      (int64_t)getpid());
+    int            fd    = open(tmp->data,
+                    O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                    0644);
+
+    if (fd == -1) {
+        return false;
+    }
+
+    bool ok = write_cache_contents(fd, paths, digests, image);
+
+    close(fd);
+
+    if (!ok || rename(tmp->data, fname->data)) {
+        unlink(tmp->data);
+        return false;
+    }
+
+    return true;
+}
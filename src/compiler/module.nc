@@ -64,7 +64,7 @@ module_key(n00b_string_t *package, n00b_string_t *module)
         package = n00b_cached_empty_string();
     }
 
-    n00b_sha_t sha;
+    n00b_sha_t sha = {0};
     n00b_sha_init(&sha, NULL);
     n00b_sha_string_update(&sha, package);
     n00b_sha_int_update(&sha, '.');
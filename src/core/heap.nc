@@ -4,8 +4,10 @@
 // There is one "global" heap for most allocations, but the same API
 // can be used for private heaps (the raw arena interface).
 //
-// n00b_in_heap() checks only the bounds of the main heap;
-// n00b_in_any_heap() checks all heaps we've allocated.
+// n00b_in_heap() skips private heaps (unless we're collecting them);
+// n00b_in_any_heap() checks all heaps we've allocated. Neither walks
+// the heaps; both go through the page map (see heap.h), so
+// classifying an address costs the same however many heaps exist.
 
 // This value is chosen randomly, and is used to identify the start of
 // memory records. Each process gets a single guard; it is not
@@ -24,58 +26,137 @@ uint64_t            n00b_page_modulus;
 uint64_t            n00b_modulus_mask;
 uint64_t            n00b_next_heap_index;
 int                 n00b_heap_entries_pp;
+// Until we know better, assume the smallest page size, which keeps
+// lookups in bounds.
+uint64_t            n00b_page_shift = 12;
 
-n00b_heap_t *
-n00b_addr_find_heap(void *p, bool any)
+_Atomic(n00b_arena_t **) n00b_pagemap_root[N00B_PAGEMAP_ROOT_LEN];
+
+static n00b_arena_t **
+pagemap_leaf(uint64_t page)
 {
-    if (!p) {
-        return NULL;
+    uint64_t                  ix   = page >> N00B_PAGEMAP_LEAF_BITS;
+    _Atomic(n00b_arena_t **) *slot = &n00b_pagemap_root[ix];
+    n00b_arena_t            **leaf = atomic_read(slot);
+
+    if (leaf) {
+        return leaf;
     }
 
-    n00b_heap_t *h = n00b_all_heaps;
+    size_t         len      = N00B_PAGEMAP_LEAF_LEN * sizeof(n00b_arena_t *);
+    n00b_arena_t **expected = NULL;
 
-    for (uint64_t i = 0; i < n00b_next_heap_index; i++) {
-        if (i && !(i % n00b_heap_entries_pp)) {
-            h = *(n00b_heap_t **)h;
-            continue;
-        }
+    leaf = mmap(NULL,
+                len,
+                PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANON,
+                -1,
+                0);
 
-        if (any && _n00b_addr_in_one_heap(h, p)) {
-            return h;
-        }
-        if (n00b_addr_in_one_heap(h, p)) {
-            return h;
-        }
+    if (leaf == MAP_FAILED) {
+        fprintf(stderr, "Out of memory.");
+        abort();
+    }
 
-        h++;
+    if (!CAS(slot, &expected, leaf)) {
+        munmap(leaf, len);
+        return expected;
     }
 
-    return NULL;
+    return leaf;
 }
 
-bool
-_n00b_addr_in_one_heap(n00b_heap_t *h, void *p)
+static inline void
+pagemap_range(n00b_arena_t *a, uint64_t *first, uint64_t *last)
 {
-    if (h->released) {
-        return false;
+    *first = ((uint64_t)a->addr_start) >> n00b_page_shift;
+    *last  = (((uint64_t)a->addr_end) - 1) >> n00b_page_shift;
+}
+
+void
+n00b_pagemap_add_arena(n00b_arena_t *a)
+{
+    uint64_t first, last;
+
+    pagemap_range(a, &first, &last);
+
+    for (uint64_t page = first; page <= last; page++) {
+        pagemap_leaf(page)[page & (N00B_PAGEMAP_LEAF_LEN - 1)] = a;
     }
+}
 
-    n00b_arena_t *a = h->first_arena;
+void
+n00b_pagemap_remove_arena(n00b_arena_t *a)
+{
+    uint64_t first, last;
 
-    while (a) {
-        if (n00b_addr_in_arena(a, p)) {
-            if (a == h->newest_arena) {
-                n00b_crit_t crit = atomic_read(&h->ptr);
-                if (p > (void *)crit.next_alloc) {
-                    return false;
-                }
-            }
-            return true;
+    pagemap_range(a, &first, &last);
+
+    for (uint64_t page = first; page <= last; page++) {
+        n00b_arena_t **leaf = atomic_read(
+            &n00b_pagemap_root[page >> N00B_PAGEMAP_LEAF_BITS]);
+        uint64_t       ix   = page & (N00B_PAGEMAP_LEAF_LEN - 1);
+
+        // Only clear pages that are still ours; mapped images can
+        // share a page with their neighbors.
+        if (leaf && leaf[ix] == a) {
+            leaf[ix] = NULL;
         }
+    }
+}
+
+void
+n00b_arenas_set_owner(n00b_arena_t *a, n00b_heap_t *h)
+{
+    while (a) {
+        n00b_unlock_arena_header(a);
+        a->heap = h;
+        n00b_lock_arena_header(a);
         a = a->successor;
     }
+}
+
+static inline bool
+addr_issued(n00b_heap_t *h, n00b_arena_t *a, void *p)
+{
+    if (h->released || !n00b_addr_in_arena(a, p)) {
+        return false;
+    }
+
+    if (a == h->newest_arena) {
+        n00b_crit_t crit = atomic_read(&h->ptr);
+        if (p > (void *)crit.next_alloc) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+n00b_heap_t *
+n00b_addr_find_heap(void *p, bool any)
+{
+    n00b_arena_t *a = n00b_pagemap_lookup(p);
+
+    if (!a) {
+        return NULL;
+    }
 
-    return false;
+    n00b_heap_t *h = a->heap;
+
+    if (!any && h->private && __n00b_current_from_space != h) {
+        return NULL;
+    }
+
+    return addr_issued(h, a, p) ? h : NULL;
+}
+
+bool
+_n00b_addr_in_one_heap(n00b_heap_t *h, void *p)
+{
+    n00b_arena_t *a = n00b_pagemap_lookup(p);
+
+    return a && a->heap == h && addr_issued(h, a, p);
 }
 
 n00b_string_t *
@@ -278,6 +359,7 @@ n00b_discover_page_info(void)
     // Page size is always a power of 2.
     n00b_page_modulus = n00b_page_bytes - 1;
     n00b_modulus_mask = ~n00b_page_modulus;
+    n00b_page_shift   = __builtin_ctzll(n00b_page_bytes);
 }
 
 static inline void
@@ -339,6 +421,8 @@ n00b_long_term_pin(n00b_heap_t *h)
         long_term_pins->ptr = crit;
     }
 
+    n00b_arenas_set_owner(h->first_arena, long_term_pins);
+
     h->first_arena  = NULL;
     h->newest_arena = NULL;
     n00b_add_arena(h, long_term_pins->newest_arena->user_length);
@@ -421,24 +505,13 @@ n00b_find_allocation_record(void *addr)
         addr = (void *)(((uint64_t)addr) & ~0x0000000000000007ULL);
     }
 
-    void       **p = (void **)addr;
-    n00b_heap_t *h = n00b_addr_find_heap(p, true);
+    void        **p = (void **)addr;
+    n00b_arena_t *a = n00b_pagemap_lookup(p);
 
-    if (!h) {
+    if (!a || !addr_issued(a->heap, a, p) || (void *)p >= a->last_issued) {
         return NULL;
     }
 
-    n00b_arena_t *a = h->first_arena;
-    while (true) {
-        if (!a) {
-            return NULL;
-        }
-        if (addr >= a->addr_start && addr < a->last_issued) {
-            break;
-        }
-        a = a->successor;
-    }
-
     while (p > (void **)a->addr_start) {
         // If we crash here do to an access protection issue, but the
         // address crashes w/ an access error, it's been mprotected to
@@ -149,6 +149,7 @@ n00b_new_arena_pre_aligned(n00b_heap_t *h, uint64_t byte_len)
     result->addr_start  = n00b_arena_user_data_start(result);
     result->addr_end    = n00b_arena_rear_guard_start(result);
     result->last_issued = result->addr_end;
+    result->heap        = h;
 
     n00b_dlog_alloc("New arena for heap %d (heap @%p): %p-%p @%p",
                     h->heap_id,
@@ -158,6 +159,7 @@ n00b_new_arena_pre_aligned(n00b_heap_t *h, uint64_t byte_len)
                     result);
 
     n00b_assert(result->addr_start < result->addr_end);
+    n00b_pagemap_add_arena(result);
 
     if (!h->first_arena) {
         h->first_arena = result;
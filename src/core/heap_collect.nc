@@ -216,14 +216,12 @@ initialize_dst_alloc(n00b_collection_ctx *ctx, n00b_alloc_record_t *from_p)
 
     ctx->next_alloc = ctx->next_alloc + from_p->alloc_len;
 
-    to_p->empty_guard      = n00b_gc_guard;
-    to_p->alloc_len        = from_p->alloc_len;
-    to_p->n00b_obj         = from_p->n00b_obj;
-    to_p->n00b_finalize    = from_p->n00b_finalize;
-    to_p->n00b_ptr_scan    = from_p->n00b_ptr_scan;
-    to_p->cached_hash[0]   = from_p->cached_hash[0];
-    to_p->cached_hash[1]   = from_p->cached_hash[1];
-    from_p->cached_hash[0] = (uint64_t)to_p; // Set forwarding address.
+    to_p->empty_guard   = n00b_gc_guard;
+    to_p->alloc_len     = from_p->alloc_len;
+    to_p->n00b_obj      = from_p->n00b_obj;
+    to_p->n00b_finalize = from_p->n00b_finalize;
+    to_p->n00b_ptr_scan = from_p->n00b_ptr_scan;
+    from_p->forward     = (uint64_t)to_p; // Set forwarding address.
 
 #if defined(N00B_ADD_ALLOC_LOC_INFO)
     to_p->alloc_file = from_p->alloc_file;
@@ -253,7 +251,12 @@ check_one_word(n00b_collection_ctx *ctx, void *addr)
     n00b_heap_t *h = n00b_addr_find_heap(addr, false);
 
     if (!h) {
-        // Not in any heap; it's data.
+        // Not in any heap; it's data, but it might point into a
+        // mapped file (see heap_mapped.nc).
+        if ((char *)addr >= n00b_mappings_lo
+            && (char *)addr < n00b_mappings_hi) {
+            n00b_gc_mark_mapping(addr);
+        }
         return NULL;
     }
 
@@ -295,7 +298,7 @@ static inline int64_t *
 rewrite_pointer(n00b_alloc_hdr *hdr, int64_t old_p)
 {
     int64_t diff = old_p - (int64_t)hdr;
-    char   *p    = (char *)(((n00b_alloc_record_t *)hdr)->cached_hash[0]);
+    char   *p    = (char *)hdr->forward;
 
     return (int64_t *)(p + diff);
 }
@@ -304,7 +307,7 @@ static inline void *
 load_forwarding_alloc(void *p)
 {
     n00b_alloc_record_t *from_hdr = p;
-    n00b_alloc_hdr      *fw       = (void *)from_hdr->cached_hash[0];
+    n00b_alloc_hdr      *fw       = (void *)from_hdr->forward;
 
     return fw;
 }
@@ -334,8 +337,7 @@ scan_one_alloc(n00b_collection_ctx *ctx, n00b_alloc_hdr *scanning)
                       n_words);
 
         if (copying) {
-            n00b_dlog_gc2("Moving to %p",
-                          ((n00b_alloc_record_t *)scanning)->cached_hash[0]);
+            n00b_dlog_gc2("Moving to %p", scanning->forward);
         }
     }
 #endif
@@ -577,6 +579,8 @@ make_to_space_our_space(n00b_collection_ctx *ctx, n00b_heap_t *h)
     n00b_to_space->first_arena  = NULL;
     n00b_to_space->newest_arena = NULL;
 
+    n00b_arenas_set_owner(h->first_arena, h);
+
     reset_next_alloc_ptr(h, ctx->next_alloc);
 }
 
@@ -715,6 +719,9 @@ trace_stack(n00b_collection_ctx *ctx)
 static inline void
 finish_collection(n00b_collection_ctx *ctx, n00b_heap_t *h)
 {
+    // Has to happen while the from-space records (and their
+    // forwarding addresses) are still there.
+    n00b_gc_sweep_mappings(ctx->from_space);
     cleanup_work_lists(ctx);
     n00b_heap_clear(h);
     make_to_space_our_space(ctx, h);
@@ -0,0 +1,150 @@
+// Memory mappings owned by garbage-collected objects.
+//
+// Some objects (currently, strings and buffers read from files; see
+// file_map.nc) point at memory we got from mmap(), not from a heap.
+// The collector never looks at that memory, since it isn't in any
+// heap, so it never moves. But someone needs to unmap it once the
+// object pointing to it is gone, and we don't have general
+// finalization right now (see heap_collect.nc).
+//
+// So we keep a side list of mappings, off-heap. Each one starts out
+// with an owner, the object we created to point at it. But other
+// objects can end up pointing into the same memory (a stripped
+// string, a buffer over a string's bytes, a rope leaf, or just a
+// char * on the stack), and they don't know it's a mapping.
+//
+// So the collector tells us about every word it sees that isn't in a
+// heap, but does fall between the lowest and highest mapped address
+// (which, since there are rarely many mappings, is cheap to check).
+// If the word lands inside a mapping, that mapping gets marked as
+// reached for this collection.
+//
+// At the end of each collection, before from-space goes away, we
+// walk the list. If the owner lived in the heap we just collected,
+// either it got copied (in which case we follow the forwarding
+// address), or it didn't (in which case we forget the owner). A
+// mapping with no owner gets unmapped once a full trace doesn't
+// reach it.
+
+#define N00B_USE_INTERNAL_API
+#include "n00b.h"
+
+typedef struct n00b_mapping_t n00b_mapping_t;
+
+struct n00b_mapping_t {
+    n00b_mapping_t *next;
+    char           *owner;
+    char           *addr;
+    size_t          len;
+    bool            reached;
+};
+
+static n00b_mapping_t  *mappings = NULL;
+static n00b_spin_lock_t mappings_lock;
+
+char *n00b_mappings_lo = (char *)UINTPTR_MAX;
+char *n00b_mappings_hi = NULL;
+
+// Ties the mapping at 'addr' to the lifetime of 'owner', which must
+// be a pointer to the start of a GC allocation, and of anything else
+// that points into it.
+void
+n00b_gc_add_mapping(void *owner, void *addr, size_t len)
+{
+    // This has to stay off the heap, and we don't want to allocate
+    // while holding the lock, since allocating can lead to a
+    // collection, which needs the lock.
+    n00b_mapping_t *m = calloc(1, sizeof(n00b_mapping_t));
+
+    m->owner = owner;
+    m->addr  = addr;
+    m->len   = len;
+
+    n00b_spin_lock(&mappings_lock);
+    m->next  = mappings;
+    mappings = m;
+
+    if (m->addr < n00b_mappings_lo) {
+        n00b_mappings_lo = m->addr;
+    }
+    if (m->addr + len > n00b_mappings_hi) {
+        n00b_mappings_hi = m->addr + len;
+    }
+
+    n00b_spin_unlock(&mappings_lock);
+}
+
+// Called by the collector, with the world stopped, for words in the
+// range of n00b_mappings_lo to n00b_mappings_hi that aren't in any
+// heap.
+void
+n00b_gc_mark_mapping(void *addr)
+{
+    char           *p = addr;
+    n00b_mapping_t *m = mappings;
+
+    while (m) {
+        if (p >= m->addr && p < m->addr + m->len) {
+            m->reached = true;
+            return;
+        }
+        m = m->next;
+    }
+}
+
+// Called by the collector once tracing is done, with the world
+// stopped.
+void
+n00b_gc_sweep_mappings(n00b_heap_t *from_space)
+{
+    n00b_spin_lock(&mappings_lock);
+
+    n00b_mapping_t **prevp = &mappings;
+    n00b_mapping_t  *m     = mappings;
+    char            *lo    = (char *)UINTPTR_MAX;
+    char            *hi    = NULL;
+
+    // When a collection only traces its own heap, not reaching a
+    // mapping doesn't tell us anything.
+    bool full_trace = !from_space->local_collects;
+
+    while (m) {
+        bool reached = m->reached;
+
+        m->reached = false;
+
+        if (m->owner && n00b_addr_find_heap(m->owner, false) == from_space) {
+            n00b_alloc_record_t *hdr;
+
+            hdr = (void *)n00b_find_allocation_record(m->owner);
+
+            if (hdr && hdr->n00b_traced) {
+                char *moved = (char *)hdr->forward;
+
+                m->owner = moved + (m->owner - (char *)hdr);
+            }
+            else {
+                m->owner = NULL;
+            }
+        }
+
+        if (m->owner || reached || !full_trace) {
+            lo    = n00b_min(lo, m->addr);
+            hi    = n00b_max(hi, m->addr + m->len);
+            prevp = &m->next;
+            m     = m->next;
+            continue;
+        }
+
+        n00b_mapping_t *dead = m;
+
+        munmap(dead->addr, dead->len);
+        *prevp = m = dead->next;
+        free(dead);
+    }
+
+    n00b_mappings_lo = lo;
+    n00b_mappings_hi = hi;
+
+    n00b_spin_unlock(&mappings_lock);
+}
@@ -418,6 +418,7 @@ n00b_init(int argc, char **argv, char **envp)
         n00b_crash_init();
         n00b_register_builtins();
         n00b_init_path();
+        n00b_lock_profile_init();
         n00b_theme_initialization();
         n00b_assertion_init();
         n00b_initialize_library();
@@ -27,6 +27,41 @@ n00b_kargs_acquire(void)
     return &tsi->kcache.ka;
 }
 
+// Varargs functions have to recognize their keyword arguments by
+// looking at them. Neither kind lives in the heap: the ones from
+// n00b_kargs_obj() are in thread-local storage, and the ones ncpp
+// builds are on the caller's stack, so n00b_get_my_type() would say
+// they're integers. The stack ones carry a header w/ the kargs type,
+// which we only read if the pointer is somewhere on this thread's
+// stack above us, where reading is safe.
+bool
+n00b_is_kargs(void *p)
+{
+    if (!p) {
+        return false;
+    }
+
+    if (n00b_in_heap(p)) {
+        return n00b_get_my_type(p) == n00b_type_kargs();
+    }
+
+    n00b_tsi_t *tsi = n00b_get_tsi_ptr();
+
+    if (p == &tsi->kcache.ka) {
+        return true;
+    }
+
+    n00b_alloc_record_t *h    = ((n00b_alloc_record_t *)p) - 1;
+    void                *top  = __builtin_frame_address(0);
+    void                *base = tsi->self_data.base;
+
+    if ((void *)h < top || p >= base) {
+        return false;
+    }
+
+    return h->empty_guard == n00b_gc_guard && h->type == n00b_type_kargs();
+}
+
 // This is for varargs functions, so it def needs to copy the va_list.
 n00b_karg_info_t *
 n00b_get_kargs_and_count(va_list args, int *nargs)
@@ -40,7 +75,7 @@ n00b_get_kargs_and_count(va_list args, int *nargs)
     cur = va_arg(arg_copy, n00b_obj_t);
 
     while (cur != NULL) {
-        if (n00b_get_my_type(cur) == n00b_type_kargs()) {
+        if (n00b_is_kargs(cur)) {
             *nargs = count;
             va_end(arg_copy);
             return cur;
@@ -55,9 +90,13 @@ n00b_get_kargs_and_count(va_list args, int *nargs)
     return NULL;
 }
 
-// We automatically cast (in ncpp) to int64_t, so that both integer and pointer
-// types will cast to it, even though we then store as 'void *', since it is
-// more appropriate in C for a 'mixed' type.
+// This is for hand-built keyword arguments (see n00b_header_kargs());
+// calls that go through ncpp build the n00b_karg_info_t on the
+// caller's stack instead (see n00b_stack_kargs()), and never get here.
+//
+// We cast to int64_t, so that both integer and pointer types will
+// cast to it, even though we then store as 'void *', since it is more
+// appropriate in C for a 'mixed' type.
 n00b_karg_info_t *
 n00b_kargs_obj(char *kw, int64_t val, ...)
 {
@@ -68,7 +107,11 @@ n00b_kargs_obj(char *kw, int64_t val, ...)
     n00b_karg_info_t *result = n00b_kargs_acquire();
 
     while (true) {
-        result->args[i++] = (n00b_one_karg_t){.kw = kw, .value = (void *)val};
+        result->args[i++] = (n00b_one_karg_t){
+            .kw    = kw,
+            .hash  = n00b_karg_hash(kw),
+            .value = (void *)val,
+        };
         kw                = va_arg(args, char *);
         if (!kw) {
             result->num_provided = i;
@@ -19,7 +19,20 @@ static const EVP_MD init_map[2][3] = {
 static void
 n00b_sha_cleanup(n00b_sha_t *ctx)
 {
-    EVP_MD_CTX_free(ctx->openssl_ctx);
+    if (ctx->openssl_ctx) {
+        EVP_MD_CTX_free(ctx->openssl_ctx);
+    }
+}
+
+static inline void
+sha_update(n00b_sha_t *ctx, void *p, size_t len)
+{
+    if (ctx->native) {
+        n00b_sha256_ctx_update(ctx->native, p, len);
+    }
+    else {
+        EVP_DigestUpdate(ctx->openssl_ctx, p, len);
+    }
 }
 
 void
@@ -38,7 +51,21 @@ n00b_sha_init(n00b_sha_t *ctx, va_list args)
         abort();
     }
 
-    ctx->digest        = n00b_new(n00b_type_buffer(), length : bits / 8);
+    // Callers may hand us uninitialized memory (e.g., on the stack),
+    // and which of these is set decides which implementation runs.
+    ctx->native      = NULL;
+    ctx->openssl_ctx = NULL;
+    ctx->digest = n00b_new(n00b_type_buffer(), length : bits / 8);
+
+    // openssl's SHA-256 is faster than our portable code, but when
+    // there's hardware support, we skip the EVP overhead.
+    if (version == 2 && bits == 256 && n00b_sha256_hw_accelerated()) {
+        ctx->native = n00b_gc_alloc_mapped(n00b_sha256_ctx_t,
+                                           N00B_GC_SCAN_NONE);
+        n00b_sha256_ctx_init(ctx->native);
+        return;
+    }
+
     version            = version - 2;
     bits               = (bits >> 7) - 2; // Maps the bit sizes to 0, 1 and 2,
                                           // by dividing by 128, then - 2.
@@ -49,11 +76,11 @@ n00b_sha_init(n00b_sha_t *ctx, va_list args)
 }
 
 void
-n00b_sha_cn00b_string_update(n00b_sha_t *ctx, char *str)
+n00b_sha_cstring_update(n00b_sha_t *ctx, char *str)
 {
     size_t len = strlen(str);
     if (len > 0) {
-        EVP_DigestUpdate(ctx->openssl_ctx, str, len);
+        sha_update(ctx, str, len);
     }
 }
 
@@ -61,7 +88,7 @@ void
 n00b_sha_int_update(n00b_sha_t *ctx, uint64_t n)
 {
     little_64(n);
-    EVP_DigestUpdate(ctx->openssl_ctx, &n, sizeof(uint64_t));
+    sha_update(ctx, &n, sizeof(uint64_t));
 }
 
 void
@@ -73,12 +100,12 @@ n00b_sha_string_update(n00b_sha_t *ctx, n00b_string_t *str)
         int64_t len = n00b_string_byte_len(str);
 
         if (len > 0) {
-            EVP_DigestUpdate(ctx->openssl_ctx, str->data, len);
+            sha_update(ctx, str->data, len);
         }
     }
     else {
         if (str->u8_bytes) {
-            EVP_DigestUpdate(ctx->openssl_ctx, str->data, str->u8_bytes);
+            sha_update(ctx, str->data, str->u8_bytes);
         }
     }
 }
@@ -90,8 +117,8 @@ n00b_sha_buffer_update(n00b_sha_t *ctx, n00b_buf_t *buffer)
     n00b_buffer_acquire_r(buffer);
 
     int32_t len = buffer->byte_len;
-    if (len > 1) {
-        EVP_DigestUpdate(ctx->openssl_ctx, buffer->data, len);
+    if (len > 0) {
+        sha_update(ctx, buffer->data, len);
     }
 
     Return;
@@ -101,7 +128,13 @@ n00b_sha_buffer_update(n00b_sha_t *ctx, n00b_buf_t *buffer)
 n00b_buf_t *
 n00b_sha_finish(n00b_sha_t *ctx)
 {
-    EVP_DigestFinal_ex(ctx->openssl_ctx, ctx->digest->data, NULL);
+    if (ctx->native) {
+        n00b_sha256_ctx_final(ctx->native, (uint8_t *)ctx->digest->data);
+    }
+    else {
+        EVP_DigestFinal_ex(ctx->openssl_ctx, ctx->digest->data, NULL);
+    }
+
     n00b_buf_t *result = ctx->digest;
     ctx->digest        = NULL;
 
@@ -0,0 +1,778 @@
+#define N00B_USE_INTERNAL_API
+#include "n00b.h"
+
+// A native SHA-256, for the places where we hash a lot of data
+// (module sources, content-addressed blobs, streams).
+//
+// The first time anything gets hashed, we pick a compression
+// function for the machine we're on:
+//
+// - On x86-64 with the SHA extensions, we use those (several times
+//   faster than the portable code).
+//
+// - On ARMv8, if the compiler is targeting the crypto extensions
+//   (which is the default on Apple silicon), we use those. There's no
+//   runtime check; if the compiler was told they're there, they're
+//   there.
+//
+// - Otherwise, we use the portable implementation below.
+//
+// There's also a multi-buffer interface, which hashes many
+// independent inputs at once. On x86-64 machines with AVX2 but
+// without the SHA extensions, it runs eight inputs side by side, one
+// per 32-bit lane. Elsewhere, it just hashes the inputs one at a
+// time with the best single-stream code we've got, which is faster
+// than eight lanes of AVX2 anyway when the SHA extensions are
+// present.
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define SHA256_X86
+#elif defined(__aarch64__) \
+    && (defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO))
+#include <arm_neon.h>
+#define SHA256_ARMV8
+#endif
+
+typedef void (*sha256_compress_fn)(uint32_t *, const uint8_t *, size_t);
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static const uint32_t sha256_iv[8] = {
+    0x6a09e667,
+    0xbb67ae85,
+    0x3c6ef372,
+    0xa54ff53a,
+    0x510e527f,
+    0x9b05688c,
+    0x1f83d9ab,
+    0x5be0cd19,
+};
+
+static inline uint32_t
+load_be32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16)
+         | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static inline void
+store_be32(uint8_t *p, uint32_t n)
+{
+    p[0] = n >> 24;
+    p[1] = n >> 16;
+    p[2] = n >> 8;
+    p[3] = n;
+}
+
+#define ROTR(x, n)   (((x) >> (n)) | ((x) << (32 - (n))))
+#define CH(x, y, z)  (((x) & (y)) ^ (~(x) & (z)))
+#define MAJ(x, y, z) (((x) & (y)) ^ ((x) & (z)) ^ ((y) & (z)))
+#define BSIG0(x)     (ROTR(x, 2) ^ ROTR(x, 13) ^ ROTR(x, 22))
+#define BSIG1(x)     (ROTR(x, 6) ^ ROTR(x, 11) ^ ROTR(x, 25))
+#define SSIG0(x)     (ROTR(x, 7) ^ ROTR(x, 18) ^ ((x) >> 3))
+#define SSIG1(x)     (ROTR(x, 17) ^ ROTR(x, 19) ^ ((x) >> 10))
+
+static void
+compress_portable(uint32_t *h, const uint8_t *p, size_t nblocks)
+{
+    uint32_t w[64];
+
+    while (nblocks--) {
+        for (int i = 0; i < 16; i++) {
+            w[i] = load_be32(p + i * 4);
+        }
+        for (int i = 16; i < 64; i++) {
+            w[i] = SSIG1(w[i - 2]) + w[i - 7] + SSIG0(w[i - 15]) + w[i - 16];
+        }
+
+        uint32_t a = h[0];
+        uint32_t b = h[1];
+        uint32_t c = h[2];
+        uint32_t d = h[3];
+        uint32_t e = h[4];
+        uint32_t f = h[5];
+        uint32_t g = h[6];
+        uint32_t x = h[7];
+
+        for (int i = 0; i < 64; i++) {
+            uint32_t t1 = x + BSIG1(e) + CH(e, f, g) + sha256_k[i] + w[i];
+            uint32_t t2 = BSIG0(a) + MAJ(a, b, c);
+
+            x = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+        h[5] += f;
+        h[6] += g;
+        h[7] += x;
+
+        p += N00B_SHA256_BLOCK;
+    }
+}
+
+#ifdef SHA256_X86
+// The SHA-NI instructions keep the state as two vectors, ABEF and
+// CDGH, and each sha256rnds2 does two rounds, so each group of four
+// rounds below is two of them. The message schedule for the next
+// groups gets computed alongside, in a rotating set of four vectors.
+__attribute__((target("sha,sse4.1"))) static void
+compress_shani(uint32_t *h, const uint8_t *p, size_t nblocks)
+{
+    const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL,
+                                        0x0405060700010203ULL);
+    __m128i       tmp  = _mm_loadu_si128((const __m128i *)&h[0]);
+    __m128i       s1   = _mm_loadu_si128((const __m128i *)&h[4]);
+    __m128i       s0;
+    __m128i       msg;
+    __m128i       m[4];
+
+    tmp = _mm_shuffle_epi32(tmp, 0xb1);
+    s1  = _mm_shuffle_epi32(s1, 0x1b);
+    s0  = _mm_alignr_epi8(tmp, s1, 8);
+    s1  = _mm_blend_epi16(s1, tmp, 0xf0);
+
+    while (nblocks--) {
+        __m128i save0 = s0;
+        __m128i save1 = s1;
+
+        for (int i = 0; i < 4; i++) {
+            msg  = _mm_loadu_si128((const __m128i *)(p + i * 16));
+            m[i] = _mm_shuffle_epi8(msg, mask);
+        }
+
+#pragma GCC unroll 16
+        for (int g = 0; g < 16; g++) {
+            __m128i k = _mm_loadu_si128((const __m128i *)&sha256_k[g * 4]);
+
+            msg = _mm_add_epi32(m[g & 3], k);
+            s1  = _mm_sha256rnds2_epu32(s1, s0, msg);
+
+            if (g >= 3 && g <= 14) {
+                __m128i *next = &m[(g + 1) & 3];
+
+                tmp   = _mm_alignr_epi8(m[g & 3], m[(g - 1) & 3], 4);
+                *next = _mm_add_epi32(*next, tmp);
+                *next = _mm_sha256msg2_epu32(*next, m[g & 3]);
+            }
+
+            msg = _mm_shuffle_epi32(msg, 0x0e);
+            s0  = _mm_sha256rnds2_epu32(s0, s1, msg);
+
+            if (g >= 1 && g <= 12) {
+                __m128i *prev = &m[(g - 1) & 3];
+
+                *prev = _mm_sha256msg1_epu32(*prev, m[g & 3]);
+            }
+        }
+
+        s0 = _mm_add_epi32(s0, save0);
+        s1 = _mm_add_epi32(s1, save1);
+        p += N00B_SHA256_BLOCK;
+    }
+
+    tmp = _mm_shuffle_epi32(s0, 0x1b);
+    s1  = _mm_shuffle_epi32(s1, 0xb1);
+    s0  = _mm_blend_epi16(tmp, s1, 0xf0);
+    s1  = _mm_alignr_epi8(s1, tmp, 8);
+
+    _mm_storeu_si128((__m128i *)&h[0], s0);
+    _mm_storeu_si128((__m128i *)&h[4], s1);
+}
+
+#define VROTR(x, n) \
+    _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - (n)))
+#define VXOR3(x, y, z) _mm256_xor_si256(_mm256_xor_si256(x, y), z)
+#define VADD(x, y)     _mm256_add_epi32(x, y)
+
+// One block each for eight independent hashes. The state is
+// word-major: st[i][lane] is word i of that lane's state.
+__attribute__((target("avx2"))) static void
+compress_x8(uint32_t st[8][8], const uint8_t **blocks)
+{
+    const __m256i bswap = _mm256_set_epi8(12, 13, 14, 15, 8,  9,  10, 11,
+                                          4,  5,  6,  7,  0,  1,  2,  3,
+                                          12, 13, 14, 15, 8,  9,  10, 11,
+                                          4,  5,  6,  7,  0,  1,  2,  3);
+    __m256i       w[64];
+    __m256i       r[8];
+    __m256i       t[8];
+    __m256i       u[8];
+
+    // Load eight words from each lane, then transpose so that each
+    // vector holds the same message word for all eight lanes.
+    for (int half = 0; half < 2; half++) {
+        for (int i = 0; i < 8; i++) {
+            r[i] = _mm256_loadu_si256(
+                (const __m256i *)(blocks[i] + half * 32));
+            r[i] = _mm256_shuffle_epi8(r[i], bswap);
+        }
+
+        for (int i = 0; i < 8; i += 2) {
+            t[i]     = _mm256_unpacklo_epi32(r[i], r[i + 1]);
+            t[i + 1] = _mm256_unpackhi_epi32(r[i], r[i + 1]);
+        }
+
+        for (int i = 0; i < 8; i += 4) {
+            u[i]     = _mm256_unpacklo_epi64(t[i], t[i + 2]);
+            u[i + 1] = _mm256_unpackhi_epi64(t[i], t[i + 2]);
+            u[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+            u[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+        }
+
+        __m256i *out = &w[half * 8];
+
+        for (int i = 0; i < 4; i++) {
+            out[i]     = _mm256_permute2x128_si256(u[i], u[i + 4], 0x20);
+            out[i + 4] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x31);
+        }
+    }
+
+    for (int i = 16; i < 64; i++) {
+        __m256i x  = w[i - 15];
+        __m256i y  = w[i - 2];
+        __m256i s0 = VXOR3(VROTR(x, 7), VROTR(x, 18), _mm256_srli_epi32(x, 3));
+        __m256i s1 = VXOR3(VROTR(y, 17),
+                           VROTR(y, 19),
+                           _mm256_srli_epi32(y, 10));
+
+        w[i] = VADD(VADD(s1, w[i - 7]), VADD(s0, w[i - 16]));
+    }
+
+    __m256i a = _mm256_loadu_si256((const __m256i *)st[0]);
+    __m256i b = _mm256_loadu_si256((const __m256i *)st[1]);
+    __m256i c = _mm256_loadu_si256((const __m256i *)st[2]);
+    __m256i d = _mm256_loadu_si256((const __m256i *)st[3]);
+    __m256i e = _mm256_loadu_si256((const __m256i *)st[4]);
+    __m256i f = _mm256_loadu_si256((const __m256i *)st[5]);
+    __m256i g = _mm256_loadu_si256((const __m256i *)st[6]);
+    __m256i x = _mm256_loadu_si256((const __m256i *)st[7]);
+
+    for (int i = 0; i < 64; i++) {
+        __m256i ch  = _mm256_xor_si256(_mm256_and_si256(e, f),
+                                      _mm256_andnot_si256(e, g));
+        __m256i maj = _mm256_or_si256(
+            _mm256_and_si256(_mm256_or_si256(a, b), c),
+            _mm256_and_si256(a, b));
+        __m256i t1  = VADD(VADD(x, VXOR3(VROTR(e, 6),
+                                        VROTR(e, 11),
+                                        VROTR(e, 25))),
+                          VADD(VADD(ch, w[i]),
+                               _mm256_set1_epi32(sha256_k[i])));
+        __m256i t2  = VADD(VXOR3(VROTR(a, 2), VROTR(a, 13), VROTR(a, 22)),
+                          maj);
+
+        x = g;
+        g = f;
+        f = e;
+        e = VADD(d, t1);
+        d = c;
+        c = b;
+        b = a;
+        a = VADD(t1, t2);
+    }
+
+    __m256i *out[8] = {&a, &b, &c, &d, &e, &f, &g, &x};
+
+    for (int i = 0; i < 8; i++) {
+        __m256i prev = _mm256_loadu_si256((const __m256i *)st[i]);
+
+        _mm256_storeu_si256((__m256i *)st[i], VADD(prev, *out[i]));
+    }
+}
+
+static void
+detect_x86(bool *sha, bool *avx2)
+{
+    unsigned int a, b, c, d;
+
+    *sha  = false;
+    *avx2 = false;
+
+    if (!__get_cpuid(1, &a, &b, &c, &d)) {
+        return;
+    }
+
+    bool ssse3   = c & (1 << 9);
+    bool sse41   = c & (1 << 19);
+    bool osxsave = c & (1 << 27);
+    bool avx     = c & (1 << 28);
+
+    if (!__get_cpuid_count(7, 0, &a, &b, &c, &d)) {
+        return;
+    }
+
+    *sha = ssse3 && sse41 && (b & (1 << 29));
+
+    // AVX2 also needs the OS to be saving the upper halves of the
+    // registers.
+    if (osxsave && avx && (b & (1 << 5))) {
+        uint32_t lo, hi;
+
+        __asm__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+        *avx2 = (lo & 6) == 6;
+    }
+}
+#endif
+
+#ifdef SHA256_ARMV8
+static void
+compress_armv8(uint32_t *h, const uint8_t *p, size_t nblocks)
+{
+    uint32x4_t s0 = vld1q_u32(&h[0]);
+    uint32x4_t s1 = vld1q_u32(&h[4]);
+    uint32x4_t m[4];
+
+    while (nblocks--) {
+        uint32x4_t save0 = s0;
+        uint32x4_t save1 = s1;
+
+        for (int i = 0; i < 4; i++) {
+            m[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p + i * 16)));
+        }
+
+        for (int g = 0; g < 16; g++) {
+            uint32x4_t wk = vaddq_u32(m[g & 3], vld1q_u32(&sha256_k[g * 4]));
+            uint32x4_t prev;
+
+            if (g < 12) {
+                m[g & 3] = vsha256su0q_u32(m[g & 3], m[(g + 1) & 3]);
+                m[g & 3] = vsha256su1q_u32(m[g & 3],
+                                           m[(g + 2) & 3],
+                                           m[(g + 3) & 3]);
+            }
+
+            prev = s0;
+            s0   = vsha256hq_u32(s0, s1, wk);
+            s1   = vsha256h2q_u32(s1, prev, wk);
+        }
+
+        s0 = vaddq_u32(s0, save0);
+        s1 = vaddq_u32(s1, save1);
+        p += N00B_SHA256_BLOCK;
+    }
+
+    vst1q_u32(&h[0], s0);
+    vst1q_u32(&h[4], s1);
+}
+#endif
+
+static sha256_compress_fn compress_fn;
+static bool               hw_accelerated;
+static bool               use_lanes;
+static char              *backend_name;
+
+static once void
+select_backend(void)
+{
+    compress_fn  = compress_portable;
+    backend_name = "portable";
+
+#if defined(SHA256_X86)
+    bool sha, avx2;
+
+    detect_x86(&sha, &avx2);
+
+    if (sha) {
+        compress_fn    = compress_shani;
+        backend_name   = "sha-ni";
+        hw_accelerated = true;
+    }
+    else if (avx2) {
+        use_lanes    = true;
+        backend_name = "portable (avx2 multi-buffer)";
+    }
+#elif defined(SHA256_ARMV8)
+    compress_fn    = compress_armv8;
+    backend_name   = "armv8";
+    hw_accelerated = true;
+#endif
+}
+
+static inline sha256_compress_fn
+get_compress_fn(void)
+{
+    if (!compress_fn) {
+        select_backend();
+    }
+
+    return compress_fn;
+}
+
+bool
+n00b_sha256_hw_accelerated(void)
+{
+    get_compress_fn();
+    return hw_accelerated;
+}
+
+char *
+n00b_sha256_backend_name(void)
+{
+    get_compress_fn();
+    return backend_name;
+}
+
+// Switches to a particular backend, by the name it reports; "avx2"
+// picks the multi-buffer lanes. This is for testing, so that each
+// backend the CPU supports can be checked against known answers.
+// Returns false, and leaves things alone, if the named backend can't
+// run here. Don't call it while hashing is going on elsewhere.
+bool
+n00b_sha256_set_backend(char *name)
+{
+    get_compress_fn();
+
+    if (!strcmp(name, "portable")) {
+        compress_fn    = compress_portable;
+        backend_name   = "portable";
+        hw_accelerated = false;
+        use_lanes      = false;
+        return true;
+    }
+
+#if defined(SHA256_X86)
+    bool sha, avx2;
+
+    detect_x86(&sha, &avx2);
+
+    if (sha && !strcmp(name, "sha-ni")) {
+        compress_fn    = compress_shani;
+        backend_name   = "sha-ni";
+        hw_accelerated = true;
+        use_lanes      = false;
+        return true;
+    }
+
+    if (avx2 && !strcmp(name, "avx2")) {
+        compress_fn    = compress_portable;
+        backend_name   = "portable (avx2 multi-buffer)";
+        hw_accelerated = false;
+        use_lanes      = true;
+        return true;
+    }
+#elif defined(SHA256_ARMV8)
+    if (!strcmp(name, "armv8")) {
+        compress_fn    = compress_armv8;
+        backend_name   = "armv8";
+        hw_accelerated = true;
+        use_lanes      = false;
+        return true;
+    }
+#endif
+
+    return false;
+}
+
+void
+n00b_sha256_ctx_init(n00b_sha256_ctx_t *ctx)
+{
+    memcpy(ctx->h, sha256_iv, sizeof(sha256_iv));
+    ctx->total   = 0;
+    ctx->buf_len = 0;
+}
+
+void
+n00b_sha256_ctx_update(n00b_sha256_ctx_t *ctx, const void *data, size_t len)
+{
+    sha256_compress_fn compress = get_compress_fn();
+    const uint8_t     *p        = data;
+
+    ctx->total += len;
+
+    if (ctx->buf_len) {
+        size_t n = n00b_min(len, N00B_SHA256_BLOCK - ctx->buf_len);
+
+        memcpy(ctx->buf + ctx->buf_len, p, n);
+        ctx->buf_len += n;
+        p += n;
+        len -= n;
+
+        if (ctx->buf_len < N00B_SHA256_BLOCK) {
+            return;
+        }
+
+        compress(ctx->h, ctx->buf, 1);
+        ctx->buf_len = 0;
+    }
+
+    // Whole blocks get compressed straight out of the input.
+    if (len >= N00B_SHA256_BLOCK) {
+        size_t nblocks = len / N00B_SHA256_BLOCK;
+
+        compress(ctx->h, p, nblocks);
+        p += nblocks * N00B_SHA256_BLOCK;
+        len -= nblocks * N00B_SHA256_BLOCK;
+    }
+
+    if (len) {
+        memcpy(ctx->buf, p, len);
+        ctx->buf_len = len;
+    }
+}
+
+// Writes the padding and length for a message of 'total' bytes, the
+// last 'rem' of which are already at the start of 'tail'. Returns the
+// number of blocks (1 or 2) the tail takes up.
+static int
+pad_tail(uint8_t *tail, size_t rem, uint64_t total)
+{
+    int      nblocks = rem < N00B_SHA256_BLOCK - 8 ? 1 : 2;
+    uint8_t *end     = tail + nblocks * N00B_SHA256_BLOCK;
+    uint64_t bits    = total << 3;
+
+    tail[rem] = 0x80;
+    memset(tail + rem + 1, 0, end - (tail + rem + 1) - 8);
+
+    for (int i = 1; i <= 8; i++) {
+        end[-i] = bits & 0xff;
+        bits >>= 8;
+    }
+
+    return nblocks;
+}
+
+void
+n00b_sha256_ctx_final(n00b_sha256_ctx_t *ctx, uint8_t *out)
+{
+    uint8_t tail[N00B_SHA256_BLOCK * 2];
+    int     nblocks;
+
+    memcpy(tail, ctx->buf, ctx->buf_len);
+    nblocks = pad_tail(tail, ctx->buf_len, ctx->total);
+
+    get_compress_fn()(ctx->h, tail, nblocks);
+
+    for (int i = 0; i < 8; i++) {
+        store_be32(out + i * 4, ctx->h[i]);
+    }
+
+    n00b_sha256_ctx_init(ctx);
+}
+
+void
+n00b_sha256_raw(const void *data, size_t len, uint8_t *out)
+{
+    n00b_sha256_ctx_t ctx;
+
+    n00b_sha256_ctx_init(&ctx);
+    n00b_sha256_ctx_update(&ctx, data, len);
+    n00b_sha256_ctx_final(&ctx, out);
+}
+
+#ifdef SHA256_X86
+typedef struct {
+    const uint8_t *p;
+    int64_t        full_blocks;
+    int            tail_blocks;
+    int            tail_ix;
+    int            job;
+    uint8_t        tail[N00B_SHA256_BLOCK * 2];
+} sha256_lane_t;
+
+static void
+lane_start(sha256_lane_t  *lane,
+           uint32_t        st[8][8],
+           int             ix,
+           int             job,
+           const uint8_t **data,
+           const int64_t  *lens)
+{
+    int64_t len = lens[job];
+    int64_t rem = len % N00B_SHA256_BLOCK;
+
+    lane->p           = data[job];
+    lane->full_blocks = len / N00B_SHA256_BLOCK;
+    lane->tail_ix     = 0;
+    lane->job         = job;
+
+    memcpy(lane->tail, data[job] + len - rem, rem);
+    lane->tail_blocks = pad_tail(lane->tail, rem, len);
+
+    for (int i = 0; i < 8; i++) {
+        st[i][ix] = sha256_iv[i];
+    }
+}
+
+static inline const uint8_t *
+lane_next_block(sha256_lane_t *lane)
+{
+    const uint8_t *result;
+
+    if (lane->full_blocks) {
+        result = lane->p;
+        lane->p += N00B_SHA256_BLOCK;
+        lane->full_blocks--;
+    }
+    else {
+        result = lane->tail + N00B_SHA256_BLOCK * lane->tail_ix++;
+    }
+
+    return result;
+}
+
+static inline bool
+lane_done(sha256_lane_t *lane)
+{
+    return !lane->full_blocks && lane->tail_ix == lane->tail_blocks;
+}
+
+static void
+multi_lanes(const uint8_t **data, const int64_t *lens, uint8_t **out, int n)
+{
+    static const uint8_t idle_block[N00B_SHA256_BLOCK];
+    sha256_lane_t        lanes[8];
+    uint32_t             st[8][8];
+    const uint8_t       *blocks[8];
+    bool                 busy[8] = {false};
+    int                  next    = 0;
+    int                  active  = 0;
+
+    for (int i = 0; i < 8 && next < n; i++) {
+        lane_start(&lanes[i], st, i, next++, data, lens);
+        busy[i] = true;
+        active++;
+    }
+
+    while (active > 1) {
+        for (int i = 0; i < 8; i++) {
+            blocks[i] = busy[i] ? lane_next_block(&lanes[i]) : idle_block;
+        }
+
+        compress_x8(st, blocks);
+
+        for (int i = 0; i < 8; i++) {
+            if (!busy[i] || !lane_done(&lanes[i])) {
+                continue;
+            }
+
+            for (int j = 0; j < 8; j++) {
+                store_be32(out[lanes[i].job] + j * 4, st[j][i]);
+            }
+
+            if (next < n) {
+                lane_start(&lanes[i], st, i, next++, data, lens);
+            }
+            else {
+                busy[i] = false;
+                active--;
+            }
+        }
+    }
+
+    // A single straggler (say, one big input among small ones) would
+    // waste seven lanes, so it gets finished on its own.
+    for (int i = 0; i < 8; i++) {
+        if (!busy[i]) {
+            continue;
+        }
+
+        sha256_lane_t *lane = &lanes[i];
+        uint32_t       h[8];
+
+        for (int j = 0; j < 8; j++) {
+            h[j] = st[j][i];
+        }
+
+        compress_fn(h, lane->p, lane->full_blocks);
+        compress_fn(h,
+                    lane->tail + N00B_SHA256_BLOCK * lane->tail_ix,
+                    lane->tail_blocks - lane->tail_ix);
+
+        for (int j = 0; j < 8; j++) {
+            store_be32(out[lane->job] + j * 4, h[j]);
+        }
+    }
+}
+#endif
+
+// Hashes 'n' independent inputs, writing each 32-byte digest to the
+// corresponding entry in 'out'.
+void
+n00b_sha256_multi_raw(const uint8_t **data,
+                      const int64_t  *lens,
+                      uint8_t       **out,
+                      int             n)
+{
+    get_compress_fn();
+
+#ifdef SHA256_X86
+    if (use_lanes && n > 1) {
+        multi_lanes(data, lens, out, n);
+        return;
+    }
+#endif
+
+    for (int i = 0; i < n; i++) {
+        n00b_sha256_raw(data[i], lens[i], out[i]);
+    }
+}
+
+n00b_buf_t *
+n00b_sha256(n00b_buf_t *input)
+{
+    n00b_buf_t *result = n00b_new(n00b_type_buffer(),
+                                  length : N00B_SHA256_LEN);
+
+    _n00b_buffer_acquire_r(input);
+    n00b_sha256_raw(input->data, input->byte_len, (uint8_t *)result->data);
+    n00b_buffer_release(input);
+
+    return result;
+}
+
+// Takes a list of buffers, and returns a list of their digests, in
+// the same order.
+n00b_list_t *
+n00b_sha256_multi(n00b_list_t *inputs)
+{
+    int             n      = n00b_list_len(inputs);
+    n00b_list_t    *result = n00b_list(n00b_type_buffer());
+    const uint8_t **data   = n00b_gc_array_alloc(uint8_t *, n);
+    uint8_t       **out    = n00b_gc_array_alloc(uint8_t *, n);
+    int64_t        *lens   = n00b_gc_array_value_alloc(int64_t, n);
+
+    for (int i = 0; i < n; i++) {
+        n00b_buf_t *b = n00b_list_get(inputs, i, NULL);
+        n00b_buf_t *d = n00b_new(n00b_type_buffer(),
+                                 length : N00B_SHA256_LEN);
+
+        _n00b_buffer_acquire_r(b);
+        data[i] = (uint8_t *)b->data;
+        lens[i] = b->byte_len;
+        out[i]  = (uint8_t *)d->data;
+        n00b_list_append(result, d);
+    }
+
+    n00b_sha256_multi_raw(data, lens, out, n);
+
+    for (int i = 0; i < n; i++) {
+        n00b_buffer_release(n00b_list_get(inputs, i, NULL));
+    }
+
+    return result;
+}
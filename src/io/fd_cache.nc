@@ -29,6 +29,16 @@ n00b_dict_t *n00b_fd_cache = NULL;
 // To make a long story short, we sidestep the issue by
 // creating a random heap key for the dispatcher, and then XORing
 // the fd into it.
+//
+// That said, fds are small, dense integers, and hashing on every
+// lookup is expensive for something the event loop does constantly.
+// So now, each event loop has a table indexed directly by fd: a
+// fixed array of pointers to chunks of slots, where chunks get
+// installed (with a CAS) the first time an fd in their range shows
+// up. Chunks never go away, so a lookup is two loads, no locks and
+// no hashing.
+//
+// The dictionary is only used for fds past the end of the table.
 
 static inline int64_t
 fd_hash_key(n00b_event_loop_t *loop, int fd)
@@ -40,23 +50,40 @@ fd_hash_key(n00b_event_loop_t *loop, int fd)
     return loop->heap_key ^ (int64_t)fd;
 }
 
-n00b_fd_stream_t *
-n00b_fd_cache_lookup(int fd, n00b_event_loop_t *loop)
+static n00b_fd_cell_t *
+fd_cell(n00b_event_loop_t *loop, int fd, bool create)
 {
-    int64_t           key    = fd_hash_key(loop, fd);
-    n00b_fd_stream_t *result = hatrack_dict_get(n00b_fd_cache,
-                                                (void *)key,
-                                                NULL);
+    int                        chunk_ix = fd >> N00B_FD_TABLE_CHUNK_BITS;
+    _Atomic(n00b_fd_cell_t *) *chunkp   = &loop->fd_table[chunk_ix];
+    n00b_fd_cell_t            *chunk    = atomic_read(chunkp);
 
-    if (result && result->fd == N00B_FD_CLOSED) {
-        return NULL;
+    if (!chunk) {
+        if (!create) {
+            return NULL;
+        }
+
+        n00b_fd_cell_t *expected = NULL;
+
+        chunk = n00b_gc_array_alloc(n00b_fd_cell_t, N00B_FD_TABLE_CHUNK_LEN);
+
+        if (!CAS(chunkp, &expected, chunk)) {
+            chunk = expected;
+        }
     }
 
-    return result;
+    return &chunk[fd & (N00B_FD_TABLE_CHUNK_LEN - 1)];
 }
 
-n00b_fd_stream_t *
-n00b_fd_cache_add(n00b_fd_stream_t *s)
+static n00b_fd_stream_t *
+dict_lookup(int fd, n00b_event_loop_t *loop)
+{
+    int64_t key = fd_hash_key(loop, fd);
+
+    return hatrack_dict_get(n00b_fd_cache, (void *)key, NULL);
+}
+
+static n00b_fd_stream_t *
+dict_add(n00b_fd_stream_t *s)
 {
     int64_t           key = fd_hash_key(s->evloop, s->fd);
     n00b_fd_stream_t *found_entry;
@@ -84,3 +111,98 @@ n00b_fd_cache_add(n00b_fd_stream_t *s)
         // the new value, so we need to re-load, so we loop.
     }
 }
+
+n00b_fd_stream_t *
+n00b_fd_cache_lookup(int fd, n00b_event_loop_t *loop)
+{
+    n00b_fd_stream_t *result;
+
+    if (fd < 0) {
+        return NULL;
+    }
+
+    if (fd < N00B_FD_TABLE_MAX) {
+        n00b_fd_cell_t *cell = fd_cell(loop, fd, false);
+
+        if (!cell) {
+            return NULL;
+        }
+
+        n00b_fd_slot_t slot = atomic_read(cell);
+
+        result = slot.stream;
+    }
+    else {
+        result = dict_lookup(fd, loop);
+    }
+
+    if (result && result->fd == N00B_FD_CLOSED) {
+        return NULL;
+    }
+
+    return result;
+}
+
+n00b_fd_stream_t *
+n00b_fd_cache_add(n00b_fd_stream_t *s)
+{
+    if (s->fd >= N00B_FD_TABLE_MAX) {
+        return dict_add(s);
+    }
+
+    n00b_fd_cell_t *cell     = fd_cell(s->evloop, s->fd, true);
+    n00b_fd_slot_t  expected = atomic_read(cell);
+    n00b_fd_slot_t  desired;
+
+    while (true) {
+        // There's something there that appears to be open.
+        if (expected.stream && expected.stream->fd >= 0) {
+            return expected.stream;
+        }
+
+        // Either there's nothing there, or the stream there is closed,
+        // and we replace it. The generation keeps us from clobbering
+        // someone who replaced it first, even if they put the same
+        // stream back.
+        desired.stream = s;
+        desired.gen    = expected.gen + 1;
+        s->cache_gen   = desired.gen;
+
+        if (CAS(cell, &expected, desired)) {
+            return s;
+        }
+
+        // On failure, 'expected' holds what's there now.
+    }
+}
+
+// Called when a stream gives up its fd, before the fd itself gets
+// closed, so that a stream created for the next fd w/ that number
+// doesn't find this one. The slot only gets cleared if it still holds
+// the generation this stream installed; if it's been replaced since,
+// it belongs to someone else now.
+void
+n00b_fd_cache_remove(n00b_fd_stream_t *s)
+{
+    if (s->fd < 0) {
+        return;
+    }
+
+    if (s->fd >= N00B_FD_TABLE_MAX) {
+        int64_t key = fd_hash_key(s->evloop, s->fd);
+
+        hatrack_dict_cas(n00b_fd_cache, (void *)key, NULL, s, false);
+        return;
+    }
+
+    n00b_fd_cell_t *cell = fd_cell(s->evloop, s->fd, false);
+
+    if (!cell) {
+        return;
+    }
+
+    n00b_fd_slot_t expected = {.stream = s, .gen = s->cache_gen};
+    n00b_fd_slot_t desired  = {.stream = NULL, .gen = s->cache_gen + 1};
+
+    CAS(cell, &expected, desired);
+}
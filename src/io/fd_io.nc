@@ -73,6 +73,20 @@ assemble_buffer(n00b_rdbuf_t *cache, int len)
     return result;
 }
 
+// Anything read goes to subscribers and, if the stream is spliced,
+// to the splice target; the splice fast path only runs when there
+// are no subscribers, so this is how the target keeps getting its
+// copy when there are.
+static inline void
+post_read(n00b_fd_stream_t *s, n00b_buf_t *msg)
+{
+    n00b_fd_post(s, s->read_subs, msg);
+
+    if (s->splice_target) {
+        n00b_fd_splice_forward(s, msg);
+    }
+}
+
 // This is the internal synchronous call for reading from a
 // non-blocking file descriptor.
 //
@@ -116,6 +130,14 @@ n00b_handle_one_read(n00b_fd_stream_t *s)
         return false;
     }
 
+    if (s->splice_target && !n00b_list_len(s->read_subs)) {
+        int result = n00b_fd_splice_one_read(s);
+
+        if (result != -1) {
+            return result;
+        }
+    }
+
     while (true) {
         // If the fd's been set back to blocking, we'd like to undo that;
         // ideally we have exclusive access here.
@@ -137,10 +159,11 @@ n00b_handle_one_read(n00b_fd_stream_t *s)
             case EAGAIN:
                 if (first) {
                     msg = assemble_buffer(first, total);
-                    n00b_fd_post(s, s->read_subs, msg);
+                    post_read(s, msg);
                     first = last = NULL;
                 }
-                if (s->r_added && !n00b_list_len(s->read_subs)) {
+                if (s->r_added && !n00b_list_len(s->read_subs)
+                    && !s->splice_target) {
                     return true;
                 }
                 return false;
@@ -346,7 +369,7 @@ blocking_greedy_read(n00b_fd_stream_t *s,
 finish:
                 if (first) {
                     msg = assemble_buffer(first, total);
-                    n00b_fd_post(s, s->read_subs, msg);
+                    post_read(s, msg);
                     first = last = NULL;
                 }
 
@@ -531,7 +554,7 @@ finish:
         int l = p - buf;
         b     = n00b_buffer_from_bytes(buf, l);
         s->total_read += l;
-        n00b_fd_post(s, s->read_subs, b);
+        post_read(s, b);
         n00b_fd_worker_yield(s);
         return b;
     }
@@ -7,14 +7,61 @@ sub_alloc(void)
     return n00b_gc_alloc_mapped(n00b_fd_sub_t, N00B_GC_SCAN_ALL);
 }
 
+static _Atomic(n00b_list_t *) *
+sub_slot(n00b_fd_stream_t *s, n00b_fd_sub_kind kind)
+{
+    switch (kind) {
+    case N00B_FD_SUB_READ:
+        return &s->read_subs;
+    case N00B_FD_SUB_QUEUED_WRITE:
+        return &s->queued_subs;
+    case N00B_FD_SUB_SENT_WRITE:
+        return &s->sent_subs;
+    case N00B_FD_SUB_CLOSE:
+        return &s->close_subs;
+    case N00B_FD_SUB_ERROR:
+        return &s->err_subs;
+    default:
+        n00b_unreachable();
+    }
+}
+
+static bool
+remove_sub(n00b_fd_stream_t *s, n00b_fd_sub_t *sub)
+{
+    _Atomic(n00b_list_t *) *slot = sub_slot(s, sub->kind);
+    bool                    result;
+
+    n00b_spin_lock(&s->subs_lock);
+    result = n00b_list_cow_remove_item(slot, sub);
+    n00b_spin_unlock(&s->subs_lock);
+
+    return result;
+}
+
+// Returns false if a oneshot subscription was already delivered by
+// someone else.
+static inline bool
+claim_sub(n00b_fd_sub_t *sub)
+{
+    bool expected = false;
+
+    if (!sub->oneshot) {
+        return true;
+    }
+
+    return CAS(&sub->fired, &expected, true);
+}
+
 static n00b_fd_sub_t *
 raw_fd_subscribe(n00b_fd_stream_t *s,
                  void             *action,
                  n00b_fd_sub_kind  kind,
-                 n00b_list_t      *subs,
                  va_list           args)
 {
-    if (!subs || s->fd == N00B_FD_CLOSED) {
+    _Atomic(n00b_list_t *) *slot = sub_slot(s, kind);
+
+    if (!atomic_read(slot) || s->fd == N00B_FD_CLOSED) {
         return NULL;
     }
     if (kind == N00B_FD_SUB_READ && s->read_closed) {
@@ -46,7 +93,9 @@ raw_fd_subscribe(n00b_fd_stream_t *s,
     result->kind          = kind;
     result->action.msg    = action;
 
-    n00b_private_list_append(subs, result);
+    n00b_spin_lock(&s->subs_lock);
+    n00b_list_cow_append(slot, result);
+    n00b_spin_unlock(&s->subs_lock);
 
     return result;
 }
@@ -59,7 +108,7 @@ _n00b_fd_read_subscribe(n00b_fd_stream_t *s, n00b_fd_cb action, ...)
 
     va_start(args, action);
 
-    result = raw_fd_subscribe(s, action, N00B_FD_SUB_READ, s->read_subs, args);
+    result = raw_fd_subscribe(s, action, N00B_FD_SUB_READ, args);
 
     n00b_fd_become_worker(s);
 
@@ -86,7 +135,6 @@ _n00b_fd_enqueue_subscribe(n00b_fd_stream_t *s, n00b_fd_cb action, ...)
     return raw_fd_subscribe(s,
                             action,
                             N00B_FD_SUB_QUEUED_WRITE,
-                            s->queued_subs,
                             args);
 }
 
@@ -99,7 +147,6 @@ _n00b_fd_write_subscribe(n00b_fd_stream_t *s, n00b_fd_cb action, ...)
     return raw_fd_subscribe(s,
                             action,
                             N00B_FD_SUB_SENT_WRITE,
-                            s->sent_subs,
                             args);
 }
 
@@ -112,7 +159,6 @@ _n00b_fd_close_subscribe(n00b_fd_stream_t *s, n00b_close_cb action, ...)
     return raw_fd_subscribe(s,
                             action,
                             N00B_FD_SUB_CLOSE,
-                            s->close_subs,
                             args);
 }
 
@@ -125,39 +171,17 @@ _n00b_fd_error_subscribe(n00b_fd_stream_t *s, n00b_err_cb action, ...)
     return raw_fd_subscribe(s,
                             action,
                             N00B_FD_SUB_ERROR,
-                            s->err_subs,
                             args);
 }
 
 bool
 n00b_fd_unsubscribe(n00b_fd_stream_t *s, n00b_fd_sub_t *sub)
 {
-    n00b_list_t *l = NULL;
-    switch (sub->kind) {
-    case N00B_FD_SUB_READ:
-        l = s->read_subs;
-        break;
-    case N00B_FD_SUB_QUEUED_WRITE:
-        l = s->queued_subs;
-        break;
-    case N00B_FD_SUB_SENT_WRITE:
-        l = s->sent_subs;
-        break;
-    case N00B_FD_SUB_CLOSE:
-        l = s->close_subs;
-        break;
-    case N00B_FD_SUB_ERROR:
-        l = s->err_subs;
-        break;
-    }
-
-    if (!l) {
-        return false;
-    }
-
-    return n00b_private_list_remove_item(l, sub);
+    return remove_sub(s, sub);
 }
 
+// 'subs' is a snapshot of one of the stream's subscriber lists; it
+// never changes under us, so no locking is needed to walk it.
 void
 n00b_fd_post(n00b_fd_stream_t *s, n00b_list_t *subs, void *msg)
 {
@@ -169,12 +193,12 @@ n00b_fd_post(n00b_fd_stream_t *s, n00b_list_t *subs, void *msg)
     while (n--) {
         n00b_fd_sub_t *sub = n00b_private_list_get(subs, n, NULL);
 
-        if (!sub) {
+        if (!sub || !claim_sub(sub)) {
             continue;
         }
         (*sub->action.msg)(s, sub, msg, sub->thunk);
         if (sub->oneshot) {
-            n00b_private_list_remove_item(subs, sub);
+            remove_sub(s, sub);
         }
     }
 }
@@ -182,13 +206,25 @@ n00b_fd_post(n00b_fd_stream_t *s, n00b_list_t *subs, void *msg)
 void
 n00b_fd_post_close(n00b_fd_stream_t *s)
 {
+    if (s->splice_target) {
+        n00b_fd_unsplice(s);
+    }
+
+    n00b_fd_cache_remove(s);
     n00b_raw_fd_close(s->fd);
     s->read_closed  = true;
     s->write_closed = true;
 
-    while (n00b_list_len(s->close_subs)) {
-        n00b_fd_sub_t *sub = n00b_list_pop(s->close_subs);
-        if (!sub) {
+    n00b_spin_lock(&s->subs_lock);
+    n00b_list_t *subs = atomic_read(&s->close_subs);
+    atomic_store(&s->close_subs, n00b_list(n00b_type_ref()));
+    n00b_spin_unlock(&s->subs_lock);
+
+    int n = n00b_list_len(subs);
+
+    while (n--) {
+        n00b_fd_sub_t *sub = n00b_private_list_get(subs, n, NULL);
+        if (!sub || !claim_sub(sub)) {
             continue;
         }
         if (sub->action.close) {
@@ -213,7 +249,8 @@ n00b_fd_post_error(n00b_fd_stream_t *s,
         n00b_fd_post_close(s);
     }
 
-    int n = n00b_list_len(s->err_subs);
+    n00b_list_t *subs = atomic_read(&s->err_subs);
+    int          n    = n00b_list_len(subs);
 
     if (!n) {
         return;
@@ -232,10 +269,13 @@ n00b_fd_post_error(n00b_fd_stream_t *s,
     }
 
     while (n--) {
-        n00b_fd_sub_t *sub = n00b_list_get(s->err_subs, n, NULL);
+        n00b_fd_sub_t *sub = n00b_private_list_get(subs, n, NULL);
+        if (!sub || !claim_sub(sub)) {
+            continue;
+        }
         (*sub->action.err)(err, sub->thunk);
         if (sub->oneshot) {
-            n00b_private_list_remove_item(s->err_subs, sub);
+            remove_sub(s, sub);
         }
     }
 }
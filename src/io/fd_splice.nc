@@ -0,0 +1,440 @@
+// Kernel-side forwarding from one fd to another.
+//
+// The regular read path pulls bytes into GC-allocated buffers, hands
+// them to subscribers, and when the subscriber is just another fd,
+// copies them right back out through its write queue. When nothing
+// needs to look at the data, that's a lot of work to move bytes from
+// one fd to another.
+//
+// n00b_fd_splice() gives a source fd a target. As long as the source
+// has no read subscribers of its own, the event loop moves the data
+// with:
+//
+// - copy_file_range(), when both sides are regular files;
+// - splice(), when either side is a pipe;
+// - splice() through a private staging pipe otherwise (e.g., from a
+//   pty to the terminal).
+//
+// If the kernel won't splice between the two (or we're not on
+// Linux), we read() and write() through a stack buffer instead, which
+// still means no heap allocation per read.
+//
+// Anything that can't go straight out goes through the target's write
+// queue, same as it would have without splicing. That covers the
+// target having writes queued already (going around the queue would
+// reorder output), the target not taking everything right now, and
+// errors. In those cases, we hand the rest of the read off to the
+// regular read path, which knows to queue what it reads for the
+// target (see n00b_fd_splice_forward()).
+//
+// Similarly, once anyone subscribes to reads on the source, this
+// path gets out of the way; the regular path runs, and still gets
+// the target its copy.
+#define N00B_USE_INTERNAL_API
+#include "n00b.h"
+
+// The default pipe capacity on Linux; splicing more than this at a
+// time through a pipe doesn't buy anything.
+#define SPLICE_CHUNK (64 * 1024)
+
+enum {
+    SPLICE_DRAINED  = 0,
+    SPLICE_EOF      = 1,
+    SPLICE_HAND_OFF = -1,
+};
+
+bool
+n00b_fd_splice(n00b_fd_stream_t *src, n00b_fd_stream_t *dst)
+{
+    if (!dst || dst == src || dst->write_closed || !dst->write_queue) {
+        return false;
+    }
+
+    if (src->read_closed || src->listener || src->no_dispatcher_rw) {
+        return false;
+    }
+
+    if (src->splice_target) {
+        return src->splice_target == dst;
+    }
+
+    src->splice_target = dst;
+
+    // Same registration as _n00b_fd_read_subscribe(); the event loop
+    // needs to be polling the source, even though there may not be
+    // any subscribers.
+    n00b_fd_become_worker(src);
+
+    if (!src->r_added) {
+        while (!src->needs_r) {
+            src->needs_r = true;
+        }
+        n00b_list_append(src->evloop->pending, src);
+    }
+
+    n00b_fd_worker_yield(src);
+
+    return true;
+}
+
+void
+n00b_fd_unsplice(n00b_fd_stream_t *s)
+{
+    // This gets called on close, from within the event loop, where
+    // we already own the stream.
+    bool mine = atomic_read(&s->worker) == n00b_thread_self();
+
+    if (!mine) {
+        n00b_fd_become_worker(s);
+    }
+
+    s->splice_target = NULL;
+
+    if (s->splice_staged) {
+        close(s->splice_pipe[0]);
+        close(s->splice_pipe[1]);
+        s->splice_staged = false;
+    }
+
+    if (!mine) {
+        n00b_fd_worker_yield(s);
+    }
+}
+
+// Called by the regular read path with whatever it read, so that the
+// target doesn't miss anything while we're not splicing.
+void
+n00b_fd_splice_forward(n00b_fd_stream_t *s, n00b_buf_t *msg)
+{
+    n00b_fd_stream_t *dst = s->splice_target;
+
+    if (!dst || !msg || !msg->byte_len) {
+        return;
+    }
+
+    if (n00b_fd_send(dst, msg->data, msg->byte_len)) {
+        // In case the target couldn't take it all, make sure the
+        // event loop knows to poll for writability.
+        n00b_list_append(dst->evloop->pending, dst);
+    }
+}
+
+static inline void
+count_moved(n00b_fd_stream_t *s, n00b_fd_stream_t *dst, int64_t n)
+{
+    s->total_read += n;
+    dst->total_written += n;
+}
+
+// Queues bytes the target wouldn't take. This is the one place we
+// allocate, and only under back-pressure.
+static void
+queue_leftovers(n00b_fd_stream_t *dst, char *p, int64_t len)
+{
+    char *copy = n00b_gc_array_value_alloc(char, len);
+
+    memcpy(copy, p, len);
+
+    if (n00b_fd_send(dst, copy, len)) {
+        n00b_list_append(dst->evloop->pending, dst);
+    }
+}
+
+static int
+copy_through_stack(n00b_fd_stream_t *s, n00b_fd_stream_t *dst)
+{
+    char buf[PIPE_BUF];
+
+    while (true) {
+        int64_t n = read(s->fd, buf, PIPE_BUF);
+
+        if (n == 0) {
+            return SPLICE_EOF;
+        }
+
+        if (n < 0) {
+            switch (errno) {
+            case EINTR:
+                continue;
+            case EAGAIN:
+                return SPLICE_DRAINED;
+            default:
+                // Let the regular read path deal with (and report)
+                // the error.
+                return SPLICE_HAND_OFF;
+            }
+        }
+
+        s->total_read += n;
+
+        int64_t done = 0;
+
+        while (done < n) {
+            int64_t w = write(dst->fd, buf + done, n - done);
+
+            if (w > 0) {
+                done += w;
+                dst->total_written += w;
+                continue;
+            }
+            if (w < 0 && errno == EINTR) {
+                continue;
+            }
+
+            // Either it'd block, or it's an error; the write queue
+            // handles both.
+            queue_leftovers(dst, buf + done, n - done);
+            return SPLICE_HAND_OFF;
+        }
+    }
+}
+
+#if defined(__linux__)
+static inline bool
+kernel_refused(int err)
+{
+    switch (err) {
+    case EINVAL:
+    case ENOSYS:
+    case EXDEV:
+    case EOPNOTSUPP:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static inline bool
+target_writable(n00b_fd_stream_t *dst)
+{
+    struct pollfd pfd = {
+        .fd     = dst->fd,
+        .events = POLLOUT,
+    };
+
+    return poll(&pfd, 1, 0) == 1 && (pfd.revents & POLLOUT);
+}
+
+static int
+copy_file_to_file(n00b_fd_stream_t *s, n00b_fd_stream_t *dst)
+{
+    while (true) {
+        int64_t n = copy_file_range(s->fd,
+                                    NULL,
+                                    dst->fd,
+                                    NULL,
+                                    SPLICE_CHUNK,
+                                    0);
+
+        if (n > 0) {
+            count_moved(s, dst, n);
+            continue;
+        }
+        if (n == 0) {
+            return SPLICE_EOF;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (kernel_refused(errno)) {
+            s->splice_fallback = true;
+            return copy_through_stack(s, dst);
+        }
+
+        return SPLICE_HAND_OFF;
+    }
+}
+
+static int
+splice_direct(n00b_fd_stream_t *s, n00b_fd_stream_t *dst)
+{
+    while (true) {
+        int64_t n = splice(s->fd,
+                           NULL,
+                           dst->fd,
+                           NULL,
+                           SPLICE_CHUNK,
+                           SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+
+        if (n > 0) {
+            count_moved(s, dst, n);
+            continue;
+        }
+        if (n == 0) {
+            return SPLICE_EOF;
+        }
+
+        switch (errno) {
+        case EINTR:
+            continue;
+        case EAGAIN:
+            // Could be either side. If the target's the one that's
+            // full, the regular path reads the rest into the queue.
+            if (target_writable(dst)) {
+                return SPLICE_DRAINED;
+            }
+            return SPLICE_HAND_OFF;
+        default:
+            if (kernel_refused(errno)) {
+                s->splice_fallback = true;
+                return copy_through_stack(s, dst);
+            }
+            return SPLICE_HAND_OFF;
+        }
+    }
+}
+
+// Moves whatever is in the staging pipe to the target. If the target
+// stops taking it, the rest of the pipe gets queued.
+static bool
+flush_staged(n00b_fd_stream_t *s, n00b_fd_stream_t *dst, int64_t staged)
+{
+    while (staged) {
+        int64_t n = splice(s->splice_pipe[0],
+                           NULL,
+                           dst->fd,
+                           NULL,
+                           staged,
+                           SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+
+        if (n > 0) {
+            staged -= n;
+            dst->total_written += n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+
+        char *rest = n00b_gc_array_value_alloc(char, staged);
+
+        n = read(s->splice_pipe[0], rest, staged);
+
+        if (n > 0 && n00b_fd_send(dst, rest, n)) {
+            n00b_list_append(dst->evloop->pending, dst);
+        }
+
+        return false;
+    }
+
+    return true;
+}
+
+static int
+splice_staged(n00b_fd_stream_t *s, n00b_fd_stream_t *dst)
+{
+    if (!s->splice_staged) {
+        if (pipe2(s->splice_pipe, O_NONBLOCK | O_CLOEXEC)) {
+            s->splice_fallback = true;
+            return copy_through_stack(s, dst);
+        }
+        s->splice_staged = true;
+    }
+
+    while (true) {
+        int64_t n = splice(s->fd,
+                           NULL,
+                           s->splice_pipe[1],
+                           NULL,
+                           SPLICE_CHUNK,
+                           SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+
+        if (n > 0) {
+            s->total_read += n;
+            if (!flush_staged(s, dst, n)) {
+                return SPLICE_HAND_OFF;
+            }
+            continue;
+        }
+        if (n == 0) {
+            return SPLICE_EOF;
+        }
+
+        switch (errno) {
+        case EINTR:
+            continue;
+        case EAGAIN:
+            return SPLICE_DRAINED;
+        default:
+            if (kernel_refused(errno)) {
+                s->splice_fallback = true;
+                return copy_through_stack(s, dst);
+            }
+            return SPLICE_HAND_OFF;
+        }
+    }
+}
+
+static int
+kernel_move(n00b_fd_stream_t *s, n00b_fd_stream_t *dst)
+{
+    if (S_ISREG(s->fd_mode) && S_ISREG(dst->fd_mode)) {
+        // copy_file_range() doesn't do appends.
+        if (dst->fd_flags & O_APPEND) {
+            s->splice_fallback = true;
+            return copy_through_stack(s, dst);
+        }
+        return copy_file_to_file(s, dst);
+    }
+
+    if (S_ISFIFO(s->fd_mode) || S_ISFIFO(dst->fd_mode)) {
+        return splice_direct(s, dst);
+    }
+
+    return splice_staged(s, dst);
+}
+#else
+#define kernel_move(s, dst) copy_through_stack(s, dst)
+#endif
+
+// Called from n00b_handle_one_read() when the stream has a splice
+// target and no read subscribers. Returns 1 if the stream should
+// come off the poll list, 0 if it should stay, and -1 if the regular
+// read path should take it from here.
+int
+n00b_fd_splice_one_read(n00b_fd_stream_t *s)
+{
+    n00b_fd_stream_t *dst      = s->splice_target;
+    n00b_thread_t    *expected = NULL;
+    int               result;
+
+    if (!dst || dst->write_closed || dst->fd == N00B_FD_CLOSED) {
+        return SPLICE_HAND_OFF;
+    }
+
+    // Going around queued writes would reorder the output, and if
+    // someone else is working the target, we can't write to it.
+    if (n00b_list_len(dst->write_queue)) {
+        return SPLICE_HAND_OFF;
+    }
+
+    if (!CAS(&dst->worker, &expected, n00b_thread_self())) {
+        return SPLICE_HAND_OFF;
+    }
+
+    // Someone may have queued something before we got the target.
+    if (n00b_list_len(dst->write_queue)) {
+        n00b_fd_worker_yield(dst);
+        return SPLICE_HAND_OFF;
+    }
+
+    n00b_fd_stream_nonblocking(s);
+
+    if (s->splice_fallback) {
+        result = copy_through_stack(s, dst);
+    }
+    else {
+        result = kernel_move(s, dst);
+    }
+
+    n00b_fd_worker_yield(dst);
+
+    if (result == SPLICE_EOF) {
+        n00b_dlog_io("Splice from fd %d to fd %d hit EOF", s->fd, dst->fd);
+        if (s->socket) {
+            n00b_fd_discovered_read_close(s);
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,102 @@
+// Reading whole files without copying them.
+//
+// The generic way to slurp a file goes through a stream: chunked
+// reads, a list of buffers, a join, and then another copy if the
+// caller wants a string. For anything big, it's much cheaper to let
+// the kernel map the file in, and point the buffer or string right at
+// the mapping.
+//
+// The mapping lives outside of every heap, so the collector never
+// scans or moves it. Once nothing points into it anymore (including
+// anything that aliases the bytes, like a stripped string), the
+// collector unmaps it (see heap_mapped.nc).
+//
+// Mappings are private, so the object is a snapshot: writes through a
+// buffer go to our own copy of the page, not to the file. However,
+// like any mapping, if someone truncates the file while we're still
+// looking at it, we'll get a SIGBUS, so this is only used when
+// reading a file in full, which is the case where people expect a
+// snapshot anyway.
+//
+// Strings need to be NUL-terminated, which we get for free from the
+// kernel zero-filling the rest of the last page. If the file fills
+// its last page exactly, there's no room, and we don't map it as a
+// string.
+
+#define N00B_USE_INTERNAL_API
+#include "n00b.h"
+
+// Returns a string (or, if 'buffer' is true, a buffer) with the
+// contents of the file open on 'fd', or NULL if the file isn't worth
+// mapping (or can't be mapped). In the latter case, the caller should
+// read it the old fashioned way.
+//
+// If we're asked for a string and the file isn't valid UTF-8, this
+// sets 'error_ptr' and returns NULL, or raises if 'error_ptr' is NULL.
+void *
+n00b_map_file_contents(int fd, bool buffer, n00b_string_t **error_ptr)
+{
+    struct stat info;
+
+    if (fstat(fd, &info) || !S_ISREG(info.st_mode)) {
+        return NULL;
+    }
+
+    int64_t len = info.st_size;
+
+    // Buffers and strings hold 32-bit lengths.
+    if (len < N00B_FILE_MAP_THRESHOLD || len > INT32_MAX) {
+        return NULL;
+    }
+
+    if (!buffer && !(len & (n00b_page_bytes - 1))) {
+        return NULL;
+    }
+
+    char *p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+
+    if (p == MAP_FAILED) {
+        return NULL;
+    }
+
+    madvise(p, len, MADV_SEQUENTIAL);
+
+    void *result;
+
+    if (buffer) {
+        result = n00b_new(n00b_type_buffer(),
+                          n00b_header_kargs("length",
+                                            len,
+                                            "ptr",
+                                            (int64_t)p));
+    }
+    else {
+        int            num_cp;
+        int            num_bytes;
+        n00b_string_t *s;
+
+        if (!n00b_cstring_validate_u8(p, &num_cp, &num_bytes, len)
+            || num_bytes != len) {
+            munmap(p, len);
+
+            n00b_string_t *msg = n00b_cstring("Invalid UTF-8 in file.");
+
+            if (error_ptr) {
+                *error_ptr = msg;
+                return NULL;
+            }
+
+            N00B_RAISE(msg);
+        }
+
+        s             = n00b_string_empty();
+        s->data       = p;
+        s->codepoints = num_cp;
+        s->u8_bytes   = num_bytes;
+        result        = s;
+    }
+
+    n00b_gc_add_mapping(result, p, len);
+
+    return result;
+}
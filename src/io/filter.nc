@@ -24,11 +24,13 @@ n00b_filter_add(n00b_stream_t *c, n00b_filter_spec_t *spec)
         return false;
     }
 
-    if (!impl->write_fn || (c->w && !(policy & N00B_FILTER_WRITE))) {
+    if ((!impl->write_fn && !impl->push_write_fn)
+        || (c->w && !(policy & N00B_FILTER_WRITE))) {
         f->w_skip = true;
     }
 
-    if (!impl->read_fn || (c->r && !(policy & N00B_FILTER_READ))) {
+    if ((!impl->read_fn && !impl->push_read_fn)
+        || (c->r && !(policy & N00B_FILTER_READ))) {
         f->r_skip = true;
     }
 
@@ -44,6 +46,7 @@ n00b_filter_add(n00b_stream_t *c, n00b_filter_spec_t *spec)
     }
 
     f->impl           = impl;
+    f->stream         = c;
     f->next_read_step = c->read_top;
     c->read_top       = f;
 
@@ -56,155 +59,256 @@ n00b_filter_add(n00b_stream_t *c, n00b_filter_spec_t *spec)
     return true;
 }
 
-// The pkg construct is currently more to be able to add debug logging if
-// needed.
-n00b_list_t *
-n00b_filter_writes(n00b_stream_t *c, n00b_stream_msg_t *pkg)
+// Messages go through the pipeline depth-first: as soon as a filter
+// produces an output, we hand it to the next filter, and whatever
+// makes it out the bottom goes to the run's sink. That way, we never
+// need to collect the outputs of one level before starting on the
+// next, and for push-style filters, nothing gets allocated to move
+// messages between levels at all.
+static inline n00b_filter_t *
+following_stage(n00b_filter_run_t *run, n00b_filter_t *f)
 {
-    n00b_filter_t *f      = c->write_top;
-    int            n_msgs = pkg->nitems;
-    void          *msg;
-
-    n00b_list_t *cur_msgs;  // In the process of passing
-    n00b_list_t *pass;      // One set of msgs to pass to next filter level.
-    n00b_list_t *next_msgs; // All msgs currently bound for next level.
+    return run->reads ? f->next_read_step : f->next_write_step;
+}
 
-    if (n_msgs == 1) {
-        cur_msgs = n00b_list(n00b_type_ref());
-        n00b_list_append(cur_msgs, pkg->payload);
-    }
-    else {
-        cur_msgs = pkg->payload;
+static inline n00b_filter_t *
+active_stage(n00b_filter_run_t *run, n00b_filter_t *f)
+{
+    while (f && (run->reads ? f->r_skip : f->w_skip)) {
+        f = following_stage(run, f);
     }
 
-    next_msgs = cur_msgs;
+    return f;
+}
 
-    while (f) {
-        if (!f->w_skip) {
-            next_msgs = n00b_list(n00b_type_ref());
-            n_msgs    = n00b_list_len(cur_msgs);
+static inline bool
+stage_can_flush(n00b_filter_t *f)
+{
+    return f->impl->push_flush_fn || f->impl->flush_fn;
+}
+
+static void
+run_stage(n00b_filter_run_t *run, n00b_filter_t *f, void *msg)
+{
+    f = active_stage(run, f);
+
+    if (!f) {
+        run->delivered++;
+        (*run->sink)(run->sink_arg, msg);
+        return;
+    }
 
-            for (int i = 0; i < n_msgs; i++) {
-                msg  = n00b_private_list_get(cur_msgs, i, NULL);
-                pass = (*f->impl->write_fn)((void *)f->cookie, msg);
-                if (!pass || !n00b_list_len(pass)) {
-                    continue;
-                }
-                next_msgs = n00b_private_list_plus(next_msgs, pass);
-            }
+    n00b_filter_impl     *impl = f->impl;
+    n00b_filter_out_t     out  = {
+        .run  = run,
+        .next = following_stage(run, f),
+    };
+    n00b_stream_push_fn   push;
+    n00b_stream_filter_fn fn;
 
-            if (!n00b_list_len(next_msgs)) {
-                return NULL;
-            }
-            cur_msgs = next_msgs;
+    if (run->reads) {
+        if (run->flushing && impl->push_read_flush_fn) {
+            push = impl->push_read_flush_fn;
+        }
+        else {
+            push = impl->push_read_fn;
         }
-        f = f->next_write_step;
+        fn = impl->read_fn;
+    }
+    else {
+        if (run->flushing && stage_can_flush(f)) {
+            push = impl->push_flush_fn;
+            fn   = impl->flush_fn;
+        }
+        else {
+            push = impl->push_write_fn;
+            fn   = impl->write_fn;
+        }
+    }
+
+    if (push) {
+        (*push)((void *)f->cookie, msg, &out);
+        return;
     }
 
-    return next_msgs;
+    n00b_list_t *pass = (*fn)((void *)f->cookie, msg);
+    int          n    = n00b_list_len(pass);
+
+    for (int i = 0; i < n; i++) {
+        run_stage(run, out.next, n00b_private_list_get(pass, i, NULL));
+    }
 }
 
 void
-n00b_flush(n00b_stream_t *c)
+n00b_filter_emit(n00b_filter_out_t *out, void *msg)
 {
-    n00b_list_t          *cur_msgs    = n00b_list(n00b_type_ref());
-    n00b_list_t          *next_msgs   = cur_msgs;
-    n00b_filter_t        *f           = c->write_top;
-    bool                  found_flush = false;
-    n00b_list_t          *pass;
-    n00b_stream_filter_fn fn;
-    int                   n_msgs;
-
-    n00b_list_append(cur_msgs, NULL);
-
-    while (f) {
-        if (!f->w_skip) {
-            fn = f->impl->flush_fn;
-
-            if (!fn) {
-                if (found_flush) {
-                    fn = f->impl->write_fn;
-                }
-                else {
-                    return;
-                }
-            }
-            else {
-                found_flush = true;
-            }
-
-            next_msgs = n00b_list(n00b_type_ref());
-            n_msgs    = n00b_list_len(cur_msgs);
-
-            for (int i = 0; i < n_msgs; i++) {
-                void *msg = n00b_private_list_get(cur_msgs, i, NULL);
-
-                pass = (*fn)((void *)f->cookie, msg);
-                if (!pass || !n00b_list_len(pass)) {
-                    continue;
-                }
-                next_msgs = n00b_private_list_plus(next_msgs, pass);
-            }
-
-            if (!n00b_list_len(next_msgs)) {
-                return;
-            }
-            cur_msgs = next_msgs;
-        }
-        f = f->next_write_step;
+    run_stage(out->run, out->next, msg);
+}
+
+// The pkg construct is currently more to be able to add debug logging if
+// needed.
+static int64_t
+run_pipeline(n00b_filter_run_t *run,
+             n00b_filter_t     *top,
+             n00b_stream_msg_t *pkg)
+{
+    if (pkg->nitems == 1) {
+        run_stage(run, top, pkg->payload);
     }
+    else {
+        n00b_list_t *msgs = pkg->payload;
+        int          n    = n00b_list_len(msgs);
 
-    if (!found_flush) {
-        return;
+        for (int i = 0; i < n; i++) {
+            run_stage(run, top, n00b_private_list_get(msgs, i, NULL));
+        }
     }
 
-    n_msgs = n00b_list_len(next_msgs);
+    return run->delivered;
+}
+
+// Returns the number of messages that came out the bottom.
+int64_t
+n00b_filter_run_writes(n00b_stream_t      *c,
+                       n00b_stream_msg_t  *pkg,
+                       n00b_filter_sink_fn sink,
+                       void               *arg)
+{
+    n00b_filter_run_t run = {
+        .sink     = sink,
+        .sink_arg = arg,
+    };
+
+    return run_pipeline(&run, c->write_top, pkg);
+}
 
-    for (int i = 0; i < n_msgs; i++) {
-        void *out_msg = n00b_list_get(next_msgs, i, NULL);
-        n00b_cnotify_w(c, out_msg);
-        (*c->impl->write_impl)(c, out_msg, false);
+int64_t
+n00b_filter_run_reads(n00b_stream_t      *c,
+                      n00b_stream_msg_t  *pkg,
+                      n00b_filter_sink_fn sink,
+                      void               *arg)
+{
+    n00b_filter_run_t run = {
+        .sink     = sink,
+        .sink_arg = arg,
+        .reads    = true,
+    };
+
+    return run_pipeline(&run, c->read_top, pkg);
+}
+
+static void
+collect_output(n00b_list_t *l, void *msg)
+{
+    n00b_private_list_append(l, msg);
+}
+
+n00b_list_t *
+n00b_filter_writes(n00b_stream_t *c, n00b_stream_msg_t *pkg)
+{
+    n00b_list_t *result = n00b_list(n00b_type_ref());
+
+    if (!n00b_filter_run_writes(c, pkg, (void *)collect_output, result)) {
+        return NULL;
     }
+
+    return result;
 }
 
 n00b_list_t *
 n00b_filter_reads(n00b_stream_t *c, n00b_stream_msg_t *pkg)
 {
-    n00b_filter_t *f      = c->read_top;
-    int            n_msgs = pkg->nitems;
-    void          *msg;
-    n00b_list_t   *cur_msgs;  // In the process of passing
-    n00b_list_t   *pass;      // One set of msgs to pass to next filter level.
-    n00b_list_t   *next_msgs; // All msgs currently bound for next level.
+    n00b_list_t *result = n00b_list(n00b_type_ref());
 
-    if (n_msgs == 1) {
-        cur_msgs = n00b_list(n00b_type_ref());
-        n00b_list_append(cur_msgs, pkg->payload);
+    if (!n00b_filter_run_reads(c, pkg, (void *)collect_output, result)) {
+        return NULL;
     }
-    else {
-        cur_msgs = pkg->payload;
-    }
-
-    next_msgs = cur_msgs;
-
-    while (f) {
-        if (!f->r_skip) {
-            next_msgs = n00b_list(n00b_type_ref());
-            for (int i = 0; i < n_msgs; i++) {
-                msg  = n00b_private_list_get(cur_msgs, i, NULL);
-                pass = (*f->impl->read_fn)((void *)f->cookie, msg);
-                if (!pass || !n00b_list_len(pass)) {
-                    continue;
-                }
-                next_msgs = n00b_private_list_plus(next_msgs, pass);
-            }
-
-            if (!n00b_list_len(next_msgs)) {
-                return NULL;
-            }
-        }
-        f = f->next_read_step;
+
+    return result;
+}
+
+// The read side equivalent of n00b_flush(), below, which the stream
+// runs when closing. Returns the number of messages that came out the
+// bottom.
+int64_t
+n00b_filter_flush_reads(n00b_stream_t      *c,
+                        n00b_filter_sink_fn sink,
+                        void               *arg)
+{
+    n00b_filter_run_t run = {
+        .sink     = sink,
+        .sink_arg = arg,
+        .reads    = true,
+        .flushing = true,
+    };
+    n00b_filter_t    *f   = active_stage(&run, c->read_top);
+
+    if (!f || !f->impl->push_read_flush_fn) {
+        return 0;
+    }
+
+    run_stage(&run, f, NULL);
+
+    return run.delivered;
+}
+
+static void
+deliver_flushed(n00b_stream_t *c, void *msg)
+{
+    n00b_cnotify_w(c, msg);
+    (*c->impl->write_impl)(c, msg, false);
+}
+
+// For filters that hold data back, and need to push it out on their
+// own schedule (from a timer, say), instead of waiting for more input,
+// n00b_flush() or n00b_close(). Runs the flush function of the filter
+// that 'cookie' belongs to, and sends whatever it emits down the rest
+// of the pipeline as ordinary messages; the filters below don't get
+// flushed. Does nothing once the stream is closed in that direction.
+void
+n00b_filter_flush_stage(void *cookie, bool reads)
+{
+    n00b_filter_t      *f    = (void *)((char *)cookie
+                                - offsetof(n00b_filter_t, cookie));
+    n00b_stream_t      *c    = f->stream;
+    n00b_stream_push_fn push = reads ? f->impl->push_read_flush_fn
+                                     : f->impl->push_flush_fn;
+
+    if (!push || !(reads ? c->r : c->w)) {
+        return;
+    }
+
+    n00b_filter_run_t run = {
+        .sink     = reads ? (void *)n00b_cache_one_read
+                          : (void *)deliver_flushed,
+        .sink_arg = c,
+        .reads    = reads,
+    };
+    n00b_filter_out_t out = {
+        .run  = &run,
+        .next = following_stage(&run, f),
+    };
+
+    (*push)(cookie, NULL, &out);
+}
+
+// Flushing only happens if the first active write filter knows how
+// to flush. From there, a NULL goes down the pipeline; each level
+// uses its flush function if it has one, and its write function
+// otherwise.
+void
+n00b_flush(n00b_stream_t *c)
+{
+    n00b_filter_run_t run = {
+        .sink     = (void *)deliver_flushed,
+        .sink_arg = c,
+        .flushing = true,
+    };
+    n00b_filter_t    *f   = active_stage(&run, c->write_top);
+
+    if (!f || !stage_can_flush(f)) {
+        return;
     }
 
-    return next_msgs;
+    run_stage(&run, f, NULL);
 }
@@ -1,21 +1,19 @@
 #include "n00b.h"
 
+// Returns the complete nodes parsed so far, holding back a partial
+// one (if any) until more input arrives.
 static n00b_list_t *
-ansi_parse(n00b_ansi_ctx *ctx, n00b_buf_t *b)
+parse_nodes(n00b_ansi_ctx *ctx, n00b_buf_t *b)
 {
-    n00b_list_t *result = n00b_list(n00b_type_list(n00b_type_ref()));
-
     n00b_ansi_parse(ctx, b);
 
     n00b_list_t      *nodes = ctx->results;
     n00b_ansi_node_t *last  = n00b_list_pop(nodes);
 
     if (!last) {
-        return result;
+        return NULL;
     }
 
-    n00b_private_list_append(result, nodes);
-
     ctx->results = n00b_list(n00b_type_ref());
 
     if (last->kind == N00B_ANSI_PARTIAL) {
@@ -25,57 +23,58 @@ ansi_parse(n00b_ansi_ctx *ctx, n00b_buf_t *b)
         n00b_private_list_append(nodes, last);
     }
 
-    return result;
+    return nodes;
 }
 
-static n00b_list_t *
-ansi_flush(n00b_ansi_ctx *ctx, n00b_buf_t *b)
+static void
+ansi_parse(n00b_ansi_ctx *ctx, n00b_buf_t *b, n00b_filter_out_t *out)
 {
-    n00b_list_t *result;
+    n00b_list_t *nodes = parse_nodes(ctx, b);
 
-    if (b) {
-        result = ansi_parse(ctx, b);
+    if (nodes) {
+        n00b_filter_emit(out, nodes);
     }
-    else {
-        result = n00b_list(n00b_type_ref());
+}
+
+static void
+ansi_flush(n00b_ansi_ctx *ctx, n00b_buf_t *b, n00b_filter_out_t *out)
+{
+    if (b) {
+        ansi_parse(ctx, b, out);
     }
 
     void *item = n00b_private_list_pop(ctx->results);
 
     if (item) {
-        n00b_private_list_append(result, item);
+        n00b_filter_emit(out, item);
     }
-
-    return result;
 }
 
-static n00b_list_t *
-ansi_strip(n00b_ansi_ctx *ctx, n00b_buf_t *b)
+static void
+ansi_strip(n00b_ansi_ctx *ctx, n00b_buf_t *b, n00b_filter_out_t *out)
 {
-    n00b_list_t   *result = n00b_list(n00b_type_string());
-    n00b_list_t   *nodes  = ansi_parse(ctx, b);
-    n00b_string_t *s      = n00b_ansi_nodes_to_string(nodes, false);
+    n00b_list_t *nodes = parse_nodes(ctx, b);
 
-    if (s) {
-        n00b_private_list_append(result, s);
+    if (!nodes) {
+        return;
     }
 
-    return result;
+    n00b_string_t *s = n00b_ansi_nodes_to_string(nodes, false);
+
+    if (s) {
+        n00b_filter_emit(out, s);
+    }
 }
 
-static n00b_list_t *
-ansi_strip_flush(n00b_ansi_ctx *ctx, n00b_buf_t *b)
+static void
+ansi_strip_flush(n00b_ansi_ctx *ctx, n00b_buf_t *b, n00b_filter_out_t *out)
 {
-    n00b_list_t *result = NULL;
-
     if (b) {
-        result = ansi_strip(ctx, b);
+        ansi_strip(ctx, b, out);
     }
 
     // This will nuke any partial on flush.
     n00b_list_pop(ctx->results);
-
-    return result;
 }
 
 static void *
@@ -87,21 +86,21 @@ ansi_setup(n00b_ansi_ctx *ctx, void *unused)
 }
 
 static n00b_filter_impl parse_ansi = {
-    .setup_fn    = (void *)ansi_setup,
-    .cookie_size = sizeof(n00b_ansi_ctx),
-    .flush_fn    = (void *)ansi_flush,
-    .read_fn     = (void *)ansi_parse,
-    .write_fn    = (void *)ansi_parse,
-    .name        = NULL,
+    .setup_fn      = (void *)ansi_setup,
+    .cookie_size   = sizeof(n00b_ansi_ctx),
+    .push_flush_fn = (void *)ansi_flush,
+    .push_read_fn  = (void *)ansi_parse,
+    .push_write_fn = (void *)ansi_parse,
+    .name          = NULL,
 };
 
 static n00b_filter_impl strip_ansi = {
-    .setup_fn    = (void *)ansi_setup,
-    .cookie_size = sizeof(n00b_ansi_ctx),
-    .flush_fn    = (void *)ansi_strip_flush,
-    .read_fn     = (void *)ansi_strip,
-    .write_fn    = (void *)ansi_strip,
-    .name        = NULL,
+    .setup_fn      = (void *)ansi_setup,
+    .cookie_size   = sizeof(n00b_ansi_ctx),
+    .push_flush_fn = (void *)ansi_strip_flush,
+    .push_read_fn  = (void *)ansi_strip,
+    .push_write_fn = (void *)ansi_strip,
+    .name          = NULL,
 };
 
 n00b_filter_spec_t *
@@ -17,11 +17,10 @@ color_setup(colorterm_ctx *ctx, void *width)
     return NULL;
 }
 
-static n00b_list_t *
-n00b_filter_add_color(colorterm_ctx *ctx, void *msg)
+static void
+n00b_filter_add_color(colorterm_ctx *ctx, void *msg, n00b_filter_out_t *out)
 {
     n00b_type_t   *t            = n00b_get_my_type(msg);
-    n00b_list_t   *l            = n00b_list(n00b_type_ref());
     bool           partial_line = false;
     n00b_string_t *s            = NULL;
     n00b_buf_t    *b;
@@ -32,8 +31,8 @@ n00b_filter_add_color(colorterm_ctx *ctx, void *msg)
     width = n00b_calculate_render_width(ctx->width);
 
     if (n00b_type_is_buffer(t)) {
-        n00b_list_append(l, msg);
-        return l;
+        n00b_filter_emit(out, msg);
+        return;
     }
 
     // Temporary compatability.
@@ -44,12 +43,12 @@ n00b_filter_add_color(colorterm_ctx *ctx, void *msg)
     s = (n00b_string_t *)msg;
 
     if (n00b_string_find(s, n00b_cached_escape()) != -1) {
-        n00b_list_append(l, s);
-        return l;
+        n00b_filter_emit(out, s);
+        return;
     }
 
     if (!s->codepoints) {
-        return NULL;
+        return;
     }
 
     if (ctx->s) {
@@ -94,18 +93,17 @@ n00b_filter_add_color(colorterm_ctx *ctx, void *msg)
 
         b = n00b_apply_ansi_with_theme(line, ctx->theme);
 
-        n00b_private_list_append(l, b);
+        n00b_filter_emit(out, b);
     }
-
-    return l;
 }
 
 static n00b_filter_impl color_filter = {
-    .cookie_size = sizeof(colorterm_ctx),
-    .setup_fn    = (void *)color_setup,
-    .read_fn     = NULL,
-    .write_fn    = (void *)n00b_filter_add_color,
-    .name        = NULL,
+    .cookie_size    = sizeof(colorterm_ctx),
+    .setup_fn       = (void *)color_setup,
+    .read_fn        = NULL,
+    .push_write_fn  = (void *)n00b_filter_add_color,
+    .name           = NULL,
+    .passes_buffers = true,
 };
 
 n00b_filter_spec_t *
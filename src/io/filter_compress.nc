@@ -0,0 +1,407 @@
+#include "n00b.h"
+
+// Streaming compression filters, using the codec in src/util/lz.nc.
+//
+// The compressor collects input until it has a full block, then
+// emits it as a single frame. So that a slow trickle of data doesn't
+// sit around indefinitely, it also emits whatever it has once the
+// oldest pending byte has been waiting longer than the flush time.
+// That gets checked whenever more data arrives, and by a timer (the
+// same one-shot n00b_run_after() timer session capture uses), so a
+// stream that goes quiet still gets its data out. Anything pending
+// also goes out on n00b_flush() for writes, or when the stream closes
+// for reads.
+//
+// The decompressor takes frames in arbitrary pieces, and emits each
+// block's data as soon as the whole frame is in. Either way, memory
+// use is bounded by the block size, no matter how much data goes
+// through.
+
+typedef struct {
+    char         *pending;
+    int64_t       pending_len;
+    int64_t       alloc_len;
+    int64_t       block_size;
+    int64_t       flush_ns;
+    int64_t       oldest;   // When the first pending byte arrived.
+    int64_t       consumed; // Decompression only.
+    // Compression only; the idle timer flushes from its own thread.
+    n00b_mutex_t  lock;
+    _Atomic(bool) timer_armed;
+    bool          reads;
+} lz_filter_ctx;
+
+typedef struct {
+    int64_t block_size;
+    int64_t flush_ms;
+    bool    reads;
+} lz_filter_params;
+
+static void *
+lz_setup(lz_filter_ctx *ctx, lz_filter_params *params)
+{
+    ctx->block_size = N00B_LZ_DEFAULT_BLOCK;
+    ctx->flush_ns   = N00B_LZ_DEFAULT_FLUSH * N00B_NS_PER_MS;
+
+    if (params && params->block_size > 0) {
+        ctx->block_size = n00b_min(params->block_size, N00B_LZ_MAX_BLOCK);
+    }
+    if (params && params->flush_ms > 0) {
+        ctx->flush_ns = params->flush_ms * N00B_NS_PER_MS;
+    }
+
+    ctx->reads = params && params->reads;
+    n00b_named_lock_init(&ctx->lock, N00B_NLT_MUTEX, "lz filter");
+
+    ctx->alloc_len = ctx->block_size;
+    ctx->pending   = n00b_gc_array_value_alloc(char, ctx->alloc_len);
+
+    return NULL;
+}
+
+static n00b_buf_t *
+input_buffer(void *msg)
+{
+    n00b_type_t *t = n00b_get_my_type(msg);
+
+    if (n00b_type_is_buffer(t)) {
+        return msg;
+    }
+
+    if (!n00b_type_is_string(t)) {
+        msg = n00b_to_string(msg);
+        if (!msg) {
+            return NULL;
+        }
+    }
+
+    return n00b_string_to_buffer(msg);
+}
+
+static inline char *
+le32(char *p, uint32_t n)
+{
+    little_32(n);
+    memcpy(p, &n, sizeof(uint32_t));
+
+    return p + sizeof(uint32_t);
+}
+
+static void
+emit_frame(char *data, int64_t len, n00b_filter_out_t *out)
+{
+    int64_t     bound  = n00b_lz_bound(len);
+    int64_t     alloc  = N00B_LZ_FRAME_HDR_LEN + bound;
+    n00b_buf_t *frame  = n00b_new(n00b_type_buffer(), length : alloc);
+    char       *stored = frame->data + N00B_LZ_FRAME_HDR_LEN;
+    int64_t     n      = n00b_lz_compress_raw(data, len, stored, bound);
+
+    if (n < 0 || n >= len) {
+        memcpy(stored, data, len);
+        n = len;
+    }
+
+    char *p = frame->data;
+
+    p = le32(p, N00B_LZ_FRAME_MAGIC);
+    p = le32(p, len);
+    p = le32(p, n);
+
+    frame->byte_len = N00B_LZ_FRAME_HDR_LEN + n;
+
+    n00b_filter_emit(out, frame);
+}
+
+static void
+emit_pending(lz_filter_ctx *ctx, n00b_filter_out_t *out)
+{
+    if (!ctx->pending_len) {
+        return;
+    }
+
+    emit_frame(ctx->pending, ctx->pending_len, out);
+    ctx->pending_len = 0;
+}
+
+static void *lz_idle_flush(lz_filter_ctx *);
+
+// Called w/ the lock held, when the first byte of a new partial block
+// comes in.
+static void
+arm_idle_flush(lz_filter_ctx *ctx)
+{
+    bool expected = false;
+
+    ctx->oldest = n00b_ns_timestamp();
+
+    if (CAS(&ctx->timer_armed, &expected, true)) {
+        n00b_run_after(ctx->flush_ns, (void *)lz_idle_flush, ctx);
+    }
+}
+
+static void *
+lz_idle_flush(lz_filter_ctx *ctx)
+{
+    n00b_lock_acquire(&ctx->lock);
+
+    if (ctx->pending_len) {
+        int64_t wait = ctx->flush_ns - (n00b_ns_timestamp() - ctx->oldest);
+
+        // What's pending arrived after the timer was set; wait for it
+        // to age.
+        if (wait > 0) {
+            n00b_run_after(wait, (void *)lz_idle_flush, ctx);
+            n00b_lock_release(&ctx->lock);
+            return NULL;
+        }
+    }
+
+    bool pending = ctx->pending_len != 0;
+
+    atomic_store(&ctx->timer_armed, false);
+    n00b_lock_release(&ctx->lock);
+
+    if (pending) {
+        n00b_filter_flush_stage(ctx, ctx->reads);
+    }
+
+    return NULL;
+}
+
+static void
+compress_locked(lz_filter_ctx *ctx, void *msg, n00b_filter_out_t *out)
+{
+    n00b_buf_t *b = input_buffer(msg);
+
+    if (!b) {
+        return;
+    }
+
+    char   *p   = b->data;
+    int64_t len = n00b_buffer_len(b);
+
+    while (len) {
+        // Full blocks go straight from the input, w/o a copy.
+        if (!ctx->pending_len && len >= ctx->block_size) {
+            emit_frame(p, ctx->block_size, out);
+            p += ctx->block_size;
+            len -= ctx->block_size;
+            continue;
+        }
+
+        int64_t n = n00b_min(len, ctx->block_size - ctx->pending_len);
+
+        if (!ctx->pending_len) {
+            arm_idle_flush(ctx);
+        }
+
+        memcpy(ctx->pending + ctx->pending_len, p, n);
+        ctx->pending_len += n;
+        p += n;
+        len -= n;
+
+        if (ctx->pending_len == ctx->block_size) {
+            emit_pending(ctx, out);
+        }
+    }
+
+    if (ctx->pending_len
+        && n00b_ns_timestamp() - ctx->oldest >= ctx->flush_ns) {
+        emit_pending(ctx, out);
+    }
+}
+
+static void
+lz_compress(lz_filter_ctx *ctx, void *msg, n00b_filter_out_t *out)
+{
+    n00b_lock_acquire(&ctx->lock);
+    compress_locked(ctx, msg, out);
+    n00b_lock_release(&ctx->lock);
+}
+
+static void
+lz_compress_flush(lz_filter_ctx *ctx, void *msg, n00b_filter_out_t *out)
+{
+    n00b_lock_acquire(&ctx->lock);
+
+    if (msg) {
+        compress_locked(ctx, msg, out);
+    }
+
+    emit_pending(ctx, out);
+    n00b_lock_release(&ctx->lock);
+}
+
+static inline uint32_t
+frame_u32(char *p)
+{
+    uint32_t result;
+
+    memcpy(&result, p, sizeof(uint32_t));
+    little_32(result);
+
+    return result;
+}
+
+static void
+pending_append(lz_filter_ctx *ctx, char *p, int64_t n)
+{
+    // Slide out whatever's already been decoded before growing.
+    if (ctx->consumed) {
+        ctx->pending_len -= ctx->consumed;
+        memmove(ctx->pending, ctx->pending + ctx->consumed, ctx->pending_len);
+        ctx->consumed = 0;
+    }
+
+    if (ctx->pending_len + n > ctx->alloc_len) {
+        int64_t sz = ctx->alloc_len << 1;
+
+        while (sz < ctx->pending_len + n) {
+            sz <<= 1;
+        }
+
+        char *new = n00b_gc_array_value_alloc(char, sz);
+
+        memcpy(new, ctx->pending, ctx->pending_len);
+        ctx->pending   = new;
+        ctx->alloc_len = sz;
+    }
+
+    memcpy(ctx->pending + ctx->pending_len, p, n);
+    ctx->pending_len += n;
+}
+
+static void
+lz_decompress(lz_filter_ctx *ctx, void *msg, n00b_filter_out_t *out)
+{
+    n00b_buf_t *b = input_buffer(msg);
+
+    if (!b) {
+        return;
+    }
+
+    pending_append(ctx, b->data, n00b_buffer_len(b));
+
+    while (ctx->pending_len - ctx->consumed >= N00B_LZ_FRAME_HDR_LEN) {
+        char    *p          = ctx->pending + ctx->consumed;
+        uint32_t raw_len    = frame_u32(p + 4);
+        uint32_t stored_len = frame_u32(p + 8);
+
+        if (frame_u32(p) != N00B_LZ_FRAME_MAGIC || raw_len > N00B_LZ_MAX_BLOCK
+            || stored_len > n00b_lz_bound(raw_len)) {
+            ctx->pending_len = 0;
+            ctx->consumed    = 0;
+            N00B_CRAISE("Corrupt compressed stream.");
+        }
+
+        if (ctx->pending_len - ctx->consumed
+            < N00B_LZ_FRAME_HDR_LEN + stored_len) {
+            return;
+        }
+
+        char       *data   = p + N00B_LZ_FRAME_HDR_LEN;
+        n00b_buf_t *result = n00b_new(n00b_type_buffer(), length : raw_len);
+
+        if (stored_len == raw_len) {
+            memcpy(result->data, data, raw_len);
+        }
+        else if (n00b_lz_decompress_raw(data,
+                                        stored_len,
+                                        result->data,
+                                        raw_len)
+                 != raw_len) {
+            ctx->pending_len = 0;
+            ctx->consumed    = 0;
+            N00B_CRAISE("Corrupt compressed stream.");
+        }
+
+        ctx->consumed += N00B_LZ_FRAME_HDR_LEN + stored_len;
+
+        if (raw_len) {
+            n00b_filter_emit(out, result);
+        }
+    }
+}
+
+// A partial frame at the end is dropped.
+static void
+lz_decompress_flush(lz_filter_ctx *ctx, void *msg, n00b_filter_out_t *out)
+{
+    if (msg) {
+        lz_decompress(ctx, msg, out);
+    }
+
+    ctx->pending_len = 0;
+    ctx->consumed    = 0;
+}
+
+static n00b_filter_impl compress_filter = {
+    .cookie_size   = sizeof(lz_filter_ctx),
+    .setup_fn      = (void *)lz_setup,
+    .push_write_fn = (void *)lz_compress,
+    .push_read_fn  = (void *)lz_decompress,
+    .push_flush_fn = (void *)lz_compress_flush,
+    .name          = NULL,
+};
+
+static n00b_filter_impl inverse_compress_filter = {
+    .cookie_size        = sizeof(lz_filter_ctx),
+    .setup_fn           = (void *)lz_setup,
+    .push_write_fn      = (void *)lz_decompress,
+    .push_read_fn       = (void *)lz_compress,
+    .push_flush_fn      = (void *)lz_decompress_flush,
+    .push_read_flush_fn = (void *)lz_compress_flush,
+    .name               = NULL,
+};
+
+static void
+init_names(void)
+{
+    if (!compress_filter.name) {
+        compress_filter.name         = n00b_cstring("compress");
+        inverse_compress_filter.name = n00b_cstring("decompress");
+    }
+}
+
+// Compresses writes, or, if 'compress_reads' is true, reads. Partial
+// blocks go out once they're 'flush_ms' old, whether or not more data
+// shows up.
+n00b_filter_spec_t *
+n00b_filter_compress(bool compress_reads, int64_t block_size, int64_t flush_ms)
+{
+    n00b_filter_spec_t *result;
+    lz_filter_params   *params;
+
+    init_names();
+
+    result = n00b_gc_alloc_mapped(n00b_filter_spec_t, N00B_GC_SCAN_ALL);
+    params = n00b_gc_alloc_mapped(lz_filter_params, N00B_GC_SCAN_NONE);
+
+    params->block_size = block_size;
+    params->flush_ms   = flush_ms;
+    params->reads      = compress_reads;
+
+    result->impl   = compress_reads ? &inverse_compress_filter
+                                    : &compress_filter;
+    result->policy = compress_reads ? N00B_FILTER_READ : N00B_FILTER_WRITE;
+    result->param  = params;
+
+    return result;
+}
+
+// Decompresses reads, or, if 'decompress_writes' is true, writes.
+n00b_filter_spec_t *
+n00b_filter_decompress(bool decompress_writes)
+{
+    n00b_filter_spec_t *result;
+
+    init_names();
+
+    result = n00b_gc_alloc_mapped(n00b_filter_spec_t, N00B_GC_SCAN_ALL);
+
+    result->impl   = decompress_writes ? &inverse_compress_filter
+                                       : &compress_filter;
+    result->policy = decompress_writes ? N00B_FILTER_WRITE : N00B_FILTER_READ;
+
+    return result;
+}
@@ -0,0 +1,80 @@
+#include "n00b.h"
+
+// A pass-through filter that feeds everything going by into a hash
+// object. Messages come out exactly as they went in; we hash straight
+// out of the message's own bytes, so there's no copy. Call
+// n00b_sha_finish() on the hash object whenever you want the digest
+// (typically once the stream is closed).
+//
+// Messages that are neither buffers nor strings get hashed via their
+// string representation, which does require a conversion.
+
+typedef struct {
+    n00b_sha_t *sha;
+} hash_filter_ctx;
+
+static void *
+hash_setup(hash_filter_ctx *ctx, n00b_sha_t *sha)
+{
+    ctx->sha = sha;
+
+    return NULL;
+}
+
+static void
+hash_msg(hash_filter_ctx *ctx, void *msg, n00b_filter_out_t *out)
+{
+    n00b_type_t *t = n00b_get_my_type(msg);
+
+    if (n00b_type_is_buffer(t)) {
+        n00b_sha_buffer_update(ctx->sha, msg);
+    }
+    else if (n00b_type_is_string(t)) {
+        n00b_sha_string_update(ctx->sha, msg);
+    }
+    else {
+        n00b_string_t *s = n00b_to_string(msg);
+
+        if (s) {
+            n00b_sha_string_update(ctx->sha, s);
+        }
+    }
+
+    n00b_filter_emit(out, msg);
+}
+
+static void
+hash_flush(hash_filter_ctx *ctx, void *msg, n00b_filter_out_t *out)
+{
+    if (msg) {
+        hash_msg(ctx, msg, out);
+    }
+}
+
+static n00b_filter_impl hash_filter = {
+    .cookie_size   = sizeof(hash_filter_ctx),
+    .setup_fn      = (void *)hash_setup,
+    .push_write_fn = (void *)hash_msg,
+    .push_read_fn  = (void *)hash_msg,
+    .push_flush_fn = (void *)hash_flush,
+    .name          = NULL,
+};
+
+// Hashes writes into 'sha', or, if 'hash_reads' is true, reads.
+n00b_filter_spec_t *
+n00b_filter_hash(n00b_sha_t *sha, bool hash_reads)
+{
+    n00b_filter_spec_t *result;
+
+    if (!hash_filter.name) {
+        hash_filter.name = n00b_cstring("hash");
+    }
+
+    result = n00b_gc_alloc_mapped(n00b_filter_spec_t, N00B_GC_SCAN_ALL);
+
+    result->impl   = &hash_filter;
+    result->policy = hash_reads ? N00B_FILTER_READ : N00B_FILTER_WRITE;
+    result->param  = sha;
+
+    return result;
+}
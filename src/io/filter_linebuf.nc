@@ -1,10 +1,11 @@
 #include "n00b.h"
 
-static n00b_list_t *
-n00b_apply_line_buffering(n00b_buf_t **state, void *msg)
+static void
+n00b_apply_line_buffering(n00b_buf_t       **state,
+                          void              *msg,
+                          n00b_filter_out_t *out)
 {
-    n00b_type_t *t      = n00b_get_my_type(msg);
-    n00b_list_t *result = n00b_list(n00b_type_ref());
+    n00b_type_t *t = n00b_get_my_type(msg);
     n00b_buf_t  *input;
     n00b_buf_t  *tmp;
 
@@ -17,7 +18,7 @@ n00b_apply_line_buffering(n00b_buf_t **state, void *msg)
                                  "Cannot line buffer object that cannot "
                                  "be converted to a buffer or string.",
                                  msg);*/
-            return result;
+            return;
         }
 
         t   = n00b_type_string();
@@ -27,7 +28,7 @@ n00b_apply_line_buffering(n00b_buf_t **state, void *msg)
     input = n00b_coerce(msg, t, n00b_type_buffer());
 
     if (input->byte_len == 0) {
-        return result;
+        return;
     }
 
     n00b_buf_t *remainder = *state;
@@ -50,7 +51,7 @@ n00b_apply_line_buffering(n00b_buf_t **state, void *msg)
                 tmp       = n00b_buffer_add(remainder, tmp);
                 remainder = NULL;
             }
-            n00b_list_append(result, tmp);
+            n00b_filter_emit(out, tmp);
             start = p;
         }
     }
@@ -71,15 +72,13 @@ n00b_apply_line_buffering(n00b_buf_t **state, void *msg)
             }
         }
     }
-
-    return result;
 }
 
 static n00b_filter_impl line_buf_filter = {
-    .cookie_size = sizeof(n00b_buf_t *),
-    .read_fn     = (void *)n00b_apply_line_buffering,
-    .write_fn    = (void *)n00b_apply_line_buffering,
-    .name        = NULL,
+    .cookie_size   = sizeof(n00b_buf_t *),
+    .push_read_fn  = (void *)n00b_apply_line_buffering,
+    .push_write_fn = (void *)n00b_apply_line_buffering,
+    .name          = NULL,
 };
 
 n00b_filter_spec_t *
@@ -92,10 +92,13 @@
 // handling this is to have a callback for the toplevel object
 // that can be used to auto-re-initialize. But that's a TODO item.
 //
-// Also, we currently are treating anything that looks like a valid
-// heap address as a pointer. This is mainly because, while the GC is
-// capable to tracking the difference, I'm not using it yet, and
-// planning on making some eventual changes.
+// We only look for pointers where the collector would: allocations
+// made with N00B_GC_SCAN_NONE (string bytes, buffer contents, etc.)
+// are copied whole, and in everything else, we stop at the
+// N00B_NOSCAN sentinel. Within the words we do scan, anything that
+// looks like a valid heap address is still treated as a pointer,
+// since we don't have finer-grained pointer maps yet; so collisions
+// are still possible there, just a lot less likely.
 //
 //
 // TODO:
@@ -116,27 +119,6 @@ msb_erase(uint64_t n, n00b_unpickle_ctx *ctx)
 
 static int64_t translate_pointer(n00b_pickle_ctx *ctx, void *p);
 
-#if defined(N00B_ALLOC_LOC_INF0)
-#define N00B_MARSHAL_OPT_1 0x01
-#else
-#define N00B_MARSHAL_OPT_1 0x00
-#endif
-
-#if defined(N00B_FULL_MEMCHECK)
-#define N00B_MARSHAL_OPT_2 0x02
-#else
-#define N00B_MARSHAL_OPT_2 0x00
-#endif
-
-#define N00B_MAGIC_FLIPS (N00B_MARSHAL_OPT_1 | N00B_MARSHAL_OPT_2)
-
-static inline uint64_t
-n00b_get_marshal_magic(void)
-{
-    return (N00B_MARSHAL_MAGIC_BASE & 0xffffffffffffff00)
-         | ((N00B_MAGIC_FLIPS) ^ N00B_MARSHAL_MAGIC_BASE);
-}
-
 static inline bool
 check_magic(uint64_t found)
 {
@@ -211,20 +193,12 @@ setup_new_header(n00b_pickle_ctx *ctx, n00b_marshaled_hdr *h, n00b_alloc_hdr *s)
     h->alloc_line = 0xeeee; // s->alloc_line;
 #endif
 
-    h->type           = (void *)translate_pointer(ctx, s->type);
-    h->n00b_obj       = s->n00b_obj;
-    h->cached_hash[0] = ((n00b_marshaled_hdr *)s)->cached_hash[0];
-    h->cached_hash[1] = ((n00b_marshaled_hdr *)s)->cached_hash[1];
+    h->type     = (void *)translate_pointer(ctx, s->type);
+    h->n00b_obj = s->n00b_obj;
 
     // Convert endianness on big endian machines; should not generate
     // any code at all most places.
     little_32(h->alloc_len);
-
-#if BYTE_ORDER == BIG_ENDIAN
-    uint64_t *p = (uint64_t *)&h->cached_hash;
-    little_64(*p[0]);
-    little_64(*p[1]);
-#endif
 }
 
 // Alloc one internal record big enough to copy a record we've found,
@@ -289,7 +263,11 @@ handle_collision(n00b_pickle_ctx *ctx, uint64_t val, int64_t o)
                                         n00b_type_u64());
     }
 
-    hatrack_dict_put(ctx->needed_patches, (void *)o, (void *)val);
+    // 'o' is a virtual address; the unmarshal side wants the offset
+    // from the start of the virtual heap, same as the parallel path.
+    hatrack_dict_put(ctx->needed_patches,
+                     (void *)(o - (int64_t)ctx->base),
+                     (void *)val);
 }
 
 static int64_t
@@ -344,12 +322,25 @@ process_queue_item(n00b_pickle_ctx *ctx, n00b_pickle_wl_item_t *item)
     n00b_assert(item->src->guard == n00b_gc_guard);
     n00b_assert(item->dst->guard == N00B_MARSHAL_RECORD_GUARD);
 
-    while (sptr < end) {
-        *dptr = process_one_word(ctx, sptr, offset);
-        sptr++;
-        dptr++;
-        offset++;
+    // We use the same layout info the collector does: allocations
+    // without the scan bit hold no pointers at all, and in the rest,
+    // N00B_NOSCAN marks the end of the words that might. Anything we
+    // don't scan goes over as-is, and the unmarshal side skips it the
+    // same way.
+    if (item->src->n00b_ptr_scan) {
+        while (sptr < end) {
+            if (*sptr == N00B_NOSCAN) {
+                break;
+            }
+
+            *dptr = process_one_word(ctx, sptr, offset);
+            sptr++;
+            dptr++;
+            offset += sizeof(uint64_t);
+        }
     }
+
+    memcpy(dptr, sptr, ((char *)end) - (char *)sptr);
 }
 
 static inline void
@@ -414,7 +405,7 @@ create_object_end_record(n00b_pickle_ctx *ctx)
     ctx->offset    = saved_offset;
 
     if (n) {
-        memcpy(rec->data, patches, n * sizeof(uint64_t));
+        memcpy(rec->data, patches, n * 16);
         ctx->needed_patches = NULL;
     }
 
@@ -451,7 +442,8 @@ bundle_result(n00b_pickle_ctx *ctx, n00b_alloc_hdr *end_record)
         to_alloc += sizeof(uint64_t) * 2;
     }
 
-    to_alloc += (sizeof(uint64_t) * end_record->alloc_len);
+    // The end record's alloc_len is the byte length of its patches.
+    to_alloc += end_record->alloc_len;
 
     b           = n00b_new(n00b_type_buffer(), length : to_alloc);
     b->byte_len = to_alloc;
@@ -494,7 +486,7 @@ bundle_result(n00b_pickle_ctx *ctx, n00b_alloc_hdr *end_record)
     p = p + sizeof(n00b_alloc_hdr);
 
     if (end_record->alloc_len) {
-        to_copy = end_record->alloc_len * sizeof(uint64_t);
+        to_copy = end_record->alloc_len;
 
         memcpy(p, end_record->data, to_copy);
 
@@ -531,6 +523,12 @@ n00b_get_virtual_heap_start(void)
         uint64_t low_check  = result & 0xffffffffffff0000ULL;
         uint64_t high_check = result | 0xffffULL;
 
+        // A translated pointer must never look like the NOSCAN
+        // sentinel.
+        if (low_check == (N00B_NOSCAN & 0xffffffffffff0000ULL)) {
+            continue;
+        }
+
         if (!n00b_in_heap((void *)low_check)
             && !n00b_in_heap((void *)high_check)) {
             result &= ~0xffff;
@@ -702,12 +700,21 @@ static inline void
 n00b_munge_user_data(n00b_unpickle_ctx *ctx, n00b_alloc_hdr *record)
 {
     uint64_t *cur      = record->data;
-    uint64_t  word_len = record->alloc_len / 8;
+    uint64_t  word_len = (record->alloc_len - sizeof(n00b_alloc_hdr)) / 8;
     uint64_t *end      = cur + word_len;
 
+    // Must match what process_queue_item() scanned.
+    if (!record->n00b_ptr_scan) {
+        return;
+    }
+
     while (cur != end) {
         uint64_t word = *cur;
 
+        if (word == N00B_NOSCAN) {
+            return;
+        }
+
         if (lsb_erase(word) == ctx->vaddr_start) {
             *cur = (uint64_t)n00b_raw_unmunge_pointer(ctx, (void *)word);
         }
@@ -742,7 +749,7 @@ n00b_perform_unmarshal_backpatching(n00b_unpickle_ctx *ctx, n00b_alloc_hdr *end)
     int       n          = end->alloc_len / 16;
     uint64_t *cur_record = end->data;
 
-    while (n) {
+    while (n--) {
         uint64_t offset = *cur_record++;
         uint64_t value  = *cur_record++;
 
@@ -873,6 +880,8 @@ marshal_setup(n00b_marshal_filter_t *c, int64_t opts)
         c->pickle.base            = n00b_get_virtual_heap_start();
         c->pickle.offset          = c->pickle.base;
         c->pickle.last_offset_end = c->pickle.base;
+        c->pickle.workers         = n00b_min(opts >> 1,
+                                     N00B_MARSHAL_MAX_WORKERS);
 
 #if defined(N00B_ADD_ALLOC_LOC_INFO)
         c->pickle.file_cache = n00b_new_unmanaged_dict(
@@ -940,6 +949,10 @@ incremental_marshal(n00b_pickle_ctx *ctx, void *obj)
         }
     }
 
+    if (ctx->workers > 1) {
+        return n00b_parallel_marshal(ctx, obj);
+    }
+
     return n00b_internal_marshal(ctx, obj);
 }
 
@@ -1034,6 +1047,18 @@ n00b_filter_marshal(bool marshal_reads)
     return result;
 }
 
+// Same as n00b_filter_marshal(), but traces and copies with the given
+// number of threads. The output format is the same.
+n00b_filter_spec_t *
+n00b_filter_marshal_parallel(bool marshal_reads, int workers)
+{
+    n00b_filter_spec_t *result = n00b_filter_marshal(marshal_reads);
+
+    result->param = (void *)(((uint64_t)workers << 1) | 1ULL);
+
+    return result;
+}
+
 n00b_filter_spec_t *
 n00b_filter_unmarshal(bool unmarshal_writes)
 {
@@ -1086,3 +1111,42 @@ n00b_automarshal(void *obj)
 
     return result;
 }
+
+static void
+append_cb(n00b_list_t *pieces, n00b_buf_t *value)
+{
+    n00b_list_append(pieces, value);
+}
+
+n00b_buf_t *
+n00b_automarshal_parallel(void *obj, int workers)
+{
+    n00b_list_t        *pieces = n00b_list(n00b_type_buffer());
+    n00b_filter_spec_t *f      = n00b_filter_marshal_parallel(false, workers);
+    n00b_stream_t      *cb     = n00b_new_callback_stream((void *)append_cb,
+                                                     pieces,
+                                                     f);
+
+    n00b_write(cb, obj);
+
+    int     n   = n00b_list_len(pieces);
+    int64_t len = 0;
+
+    for (int i = 0; i < n; i++) {
+        len += n00b_buffer_len(n00b_list_get(pieces, i, NULL));
+    }
+
+    n00b_buf_t *result = n00b_new(n00b_type_buffer(), length : len);
+    char       *p      = result->data;
+
+    result->byte_len = len;
+
+    for (int i = 0; i < n; i++) {
+        n00b_buf_t *piece = n00b_list_get(pieces, i, NULL);
+
+        memcpy(p, piece->data, piece->byte_len);
+        p += piece->byte_len;
+    }
+
+    return result;
+}
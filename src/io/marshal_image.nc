@@ -0,0 +1,416 @@
+#define N00B_USE_INTERNAL_API
+#include "n00b.h"
+
+// Mappable images.
+//
+// n00b_autounmarshal() has to walk every word of its input, looking
+// for values in the virtual heap and translating them, so loading is
+// proportional to the size of the data. That's fine for messages, but
+// not for things like a fully generated VM that we'd like to start
+// instantly, no matter how much static data it carries.
+//
+// An image is built from the output of n00b_automarshal() (so it
+// holds exactly the same object graph), but we do the pointer
+// translation once, at creation time. We pick a preferred load
+// address, and rewrite every virtual heap pointer to the address it
+// would have if the image gets mapped there. Along the way, we
+// remember which words we rewrote (the relocation table), and where
+// each allocation record starts (the record table).
+//
+// At load time, we mmap() the image MAP_PRIVATE, asking for the
+// preferred address. If we get it (the common case), there is no
+// pointer fixing to do at all. If we don't, we add the difference to
+// each word in the relocation table.
+//
+// Either way, allocation headers need to get this process's guard
+// value written into them, which is why we keep the record table.
+// That's proportional to the number of allocations, not to their
+// size, so big static data segments and instruction streams never get
+// read at load time; since the mapping is private, pages that never
+// get written stay shared with the page cache.
+//
+// Finally, the mapped data is registered as a pinned heap, so that
+// n00b_in_heap(), n00b_find_allocation_record() and the collector
+// all treat it as normal (but immovable) memory.
+//
+// Layout (native byte order, which is always little endian for us):
+//
+//   n00b_image_hdr_t, padded out to N00B_IMAGE_ALIGN
+//   The allocation records (data_len bytes)
+//   The relocation table (num_relocs uint32_t word indexes)
+//   The record table (num_records uint32_t word indexes)
+
+// Preferred addresses come from a region that is normally well clear
+// of both the program break and where the kernel hands out mmap()s.
+#define N00B_IMAGE_BASE_LOW   0x200000000000ULL
+#define N00B_IMAGE_BASE_SLOTS 0xfffffULL
+#define N00B_IMAGE_BASE_SHIFT 24
+
+typedef struct {
+    char        *data;
+    uint64_t     data_len;
+    uint64_t     vbase;
+    uint64_t     pbase;
+    n00b_list_t *relocs;
+    n00b_list_t *records;
+} image_ctx_t;
+
+static inline uint64_t
+pick_preferred_base(void)
+{
+    uint64_t slot = n00b_rand64() & N00B_IMAGE_BASE_SLOTS;
+
+    return N00B_IMAGE_BASE_LOW + (slot << N00B_IMAGE_BASE_SHIFT);
+}
+
+// If the word at 'p' points into the marshaled data, rewrite it to
+// the address it'll have when mapped at the preferred base, and
+// remember it for relocation.
+static inline void
+translate_word(image_ctx_t *ctx, uint64_t *p)
+{
+    uint64_t val = *p;
+
+    if (val < ctx->vbase || val >= ctx->vbase + ctx->data_len) {
+        return;
+    }
+
+    uint64_t offset = ((char *)p) - ctx->data;
+
+    *p = ctx->pbase + N00B_IMAGE_ALIGN + (val - ctx->vbase);
+
+    n00b_list_append(ctx->relocs, (void *)(offset / sizeof(uint64_t)));
+}
+
+static n00b_alloc_hdr *
+translate_records(image_ctx_t *ctx, char *end)
+{
+    char *p = ctx->data;
+
+    while (p + sizeof(n00b_alloc_hdr) <= end) {
+        n00b_alloc_hdr *hdr = (n00b_alloc_hdr *)p;
+
+        if (hdr->guard != N00B_MARSHAL_RECORD_GUARD) {
+            N00B_CRAISE("Corrupt marshal data when building image.");
+        }
+
+        if (hdr->n00b_marshal_end) {
+            return hdr;
+        }
+
+        if (hdr->alloc_len <= 0 || p + hdr->alloc_len > end) {
+            N00B_CRAISE("Corrupt marshal data when building image.");
+        }
+
+        n00b_list_append(ctx->records,
+                         (void *)((p - ctx->data) / sizeof(uint64_t)));
+
+        translate_word(ctx, (uint64_t *)&hdr->type);
+#if defined(N00B_ADD_ALLOC_LOC_INFO)
+        translate_word(ctx, (uint64_t *)&hdr->alloc_file);
+#endif
+
+        uint64_t *word = (uint64_t *)hdr->data;
+        uint64_t *wend = (uint64_t *)(p + hdr->alloc_len);
+
+        // Only the words the marshaler translated can hold pointers.
+        if (hdr->n00b_ptr_scan) {
+            while (word < wend && *word != N00B_NOSCAN) {
+                translate_word(ctx, word++);
+            }
+        }
+
+        p += hdr->alloc_len;
+    }
+
+    return N00B_CRAISE("Marshal data is missing its end record."), NULL;
+}
+
+// Collisions (non-pointer data that looked like a virtual heap
+// address) got zeroed out by the marshaler; put the real values back.
+//
+// The end record holds alloc_len bytes of (offset, value) pairs,
+// where the offset is from the virtual heap base, which for a single
+// object is also the offset into the records that follow the stream
+// header.
+static void
+apply_backpatches(image_ctx_t *ctx, n00b_alloc_hdr *end, char *buf_end)
+{
+    int64_t   n     = end->alloc_len / 16;
+    uint64_t *patch = (uint64_t *)end->data;
+
+    if (end->alloc_len % 16 || (char *)(patch + n * 2) > buf_end) {
+        N00B_CRAISE("Bad backpatch when building image.");
+    }
+
+    while (n--) {
+        uint64_t offset = *patch++;
+        uint64_t value  = *patch++;
+
+        if (offset % sizeof(uint64_t)
+            || offset + sizeof(uint64_t) > ctx->data_len) {
+            N00B_CRAISE("Bad backpatch when building image.");
+        }
+
+        *(uint64_t *)(ctx->data + offset) = value;
+    }
+}
+
+static inline char *
+write_table(char *p, n00b_list_t *l)
+{
+    int       n   = n00b_list_len(l);
+    uint32_t *out = (uint32_t *)p;
+
+    for (int i = 0; i < n; i++) {
+        *out++ = (uint32_t)(uint64_t)n00b_list_get(l, i, NULL);
+    }
+
+    return (char *)out;
+}
+
+// Builds an image from the output of n00b_automarshal() (a stream
+// holding exactly one object). The buffer gets translated in place.
+n00b_buf_t *
+n00b_image_from_marshal(n00b_buf_t *m)
+{
+    if (!m || n00b_buffer_len(m) < 16 + (int64_t)sizeof(n00b_alloc_hdr)) {
+        N00B_CRAISE("Could not marshal object for image.");
+    }
+
+    if (*(uint64_t *)m->data != n00b_get_marshal_magic()) {
+        N00B_CRAISE("Marshal data in invalid format for image.");
+    }
+
+    uint64_t   *words   = (uint64_t *)m->data;
+    char       *buf_end = m->data + n00b_buffer_len(m);
+    image_ctx_t ctx     = {
+            .data    = m->data + 16,
+            .vbase   = words[1],
+            .pbase   = pick_preferred_base(),
+            .relocs  = n00b_list(n00b_type_u64()),
+            .records = n00b_list(n00b_type_u64()),
+    };
+
+    // We translate in place, which is fine; the marshal output is
+    // ours. The data length isn't known until we find the end record,
+    // but nothing before it can point past it, so bound it by the
+    // buffer for now.
+    ctx.data_len        = buf_end - ctx.data;
+    n00b_alloc_hdr *end = translate_records(&ctx, buf_end);
+    ctx.data_len        = ((char *)end) - ctx.data;
+
+    apply_backpatches(&ctx, end, buf_end);
+
+    if (ctx.data_len / sizeof(uint64_t) > UINT32_MAX) {
+        N00B_CRAISE("Object too large to store as an image.");
+    }
+
+    uint64_t num_relocs  = n00b_list_len(ctx.relocs);
+    uint64_t num_records = n00b_list_len(ctx.records);
+    uint64_t reloc_off   = N00B_IMAGE_ALIGN + ctx.data_len;
+    uint64_t record_off  = reloc_off + num_relocs * sizeof(uint32_t);
+    uint64_t total       = record_off + num_records * sizeof(uint32_t);
+
+    total = n00b_round_up_to_given_power_of_2(N00B_IMAGE_ALIGN, total);
+
+    n00b_buf_t *result = n00b_new(n00b_type_buffer(), length : total);
+
+    result->byte_len = total;
+
+    n00b_image_hdr_t *hdr = (n00b_image_hdr_t *)result->data;
+
+    hdr->magic         = N00B_IMAGE_MAGIC;
+    hdr->version       = n00b_current_version.number;
+    hdr->marshal_magic = n00b_get_marshal_magic();
+    hdr->base          = ctx.pbase;
+    hdr->data_offset   = N00B_IMAGE_ALIGN;
+    hdr->data_len      = ctx.data_len;
+    hdr->root_offset   = sizeof(n00b_alloc_hdr);
+    hdr->reloc_offset  = reloc_off;
+    hdr->num_relocs    = num_relocs;
+    hdr->record_offset = record_off;
+    hdr->num_records   = num_records;
+
+    char *p = result->data + N00B_IMAGE_ALIGN;
+
+    memcpy(p, ctx.data, ctx.data_len);
+    p = write_table(p + ctx.data_len, ctx.relocs);
+    write_table(p, ctx.records);
+
+    return result;
+}
+
+n00b_buf_t *
+n00b_image_create(void *obj)
+{
+    return n00b_image_from_marshal(n00b_automarshal(obj));
+}
+
+static bool
+image_header_ok(n00b_image_hdr_t *hdr, uint64_t map_len)
+{
+    if (hdr->magic != N00B_IMAGE_MAGIC
+        || hdr->version != n00b_current_version.number
+        || hdr->marshal_magic != n00b_get_marshal_magic()
+        || hdr->data_offset != N00B_IMAGE_ALIGN) {
+        return false;
+    }
+
+    uint64_t data_end   = hdr->data_offset + hdr->data_len;
+    uint64_t reloc_end  = hdr->reloc_offset
+                       + hdr->num_relocs * sizeof(uint32_t);
+    uint64_t record_end = hdr->record_offset
+                        + hdr->num_records * sizeof(uint32_t);
+
+    return hdr->data_len > hdr->root_offset
+        && data_end <= map_len
+        && hdr->reloc_offset >= data_end
+        && reloc_end <= map_len
+        && hdr->record_offset >= reloc_end
+        && record_end <= map_len;
+}
+
+static bool
+fix_records(n00b_image_hdr_t *hdr, char *data)
+{
+    uint32_t *records = (uint32_t *)(((char *)hdr) + hdr->record_offset);
+    uint64_t  max     = hdr->data_len / sizeof(uint64_t);
+
+    for (uint64_t i = 0; i < hdr->num_records; i++) {
+        if (records[i] >= max) {
+            return false;
+        }
+
+        n00b_alloc_hdr *h = (n00b_alloc_hdr *)(data + records[i] * 8ULL);
+
+        if (h->guard != N00B_MARSHAL_RECORD_GUARD) {
+            return false;
+        }
+
+        h->guard = n00b_gc_guard;
+    }
+
+    return true;
+}
+
+static bool
+relocate(n00b_image_hdr_t *hdr, char *data, int64_t delta)
+{
+    uint32_t *relocs = (uint32_t *)(((char *)hdr) + hdr->reloc_offset);
+    uint64_t  max    = hdr->data_len / sizeof(uint64_t);
+    uint64_t *words  = (uint64_t *)data;
+
+    for (uint64_t i = 0; i < hdr->num_relocs; i++) {
+        if (relocs[i] >= max) {
+            return false;
+        }
+
+        words[relocs[i]] += delta;
+    }
+
+    return true;
+}
+
+static void
+register_image_heap(n00b_image_hdr_t *hdr, char *data)
+{
+    n00b_heap_t  *h = n00b_new_heap(0);
+    n00b_arena_t *a = &hdr->arena;
+
+    a->addr_start  = data;
+    a->addr_end    = data + hdr->data_len;
+    a->last_issued = a->addr_end;
+    a->successor   = NULL;
+    a->user_length = hdr->data_len;
+    a->heap        = h;
+
+    n00b_crit_t crit = {
+        .next_alloc = a->addr_end,
+        .thread     = NULL,
+    };
+
+    // Nothing ever gets allocated out of this heap, and it must never
+    // be collected (or, the arena would get unmapped out from under
+    // us).
+    n00b_heap_set_name(h, "mapped image");
+    n00b_heap_pin(h);
+
+    h->first_arena   = a;
+    h->cur_arena_end = a->addr_end;
+    atomic_store(&h->newest_arena, a);
+    atomic_store(&h->ptr, crit);
+
+    n00b_pagemap_add_arena(a);
+}
+
+// Maps the image that starts at 'offset' into the file 'fd' (which
+// must be a multiple of N00B_IMAGE_ALIGN), returning the root object,
+// or NULL if the image isn't valid for this build. The fd may be
+// closed afterward.
+void *
+n00b_image_map(int fd, int64_t offset)
+{
+    n00b_image_hdr_t hdr;
+    struct stat      info;
+
+    if (offset % N00B_IMAGE_ALIGN || fstat(fd, &info)) {
+        return NULL;
+    }
+
+    if (pread(fd, &hdr, sizeof(hdr), offset) != sizeof(hdr)) {
+        return NULL;
+    }
+
+    if (info.st_size < offset
+        || !image_header_ok(&hdr, info.st_size - offset)) {
+        return NULL;
+    }
+
+    uint64_t map_len = hdr.record_offset
+                     + hdr.num_records * sizeof(uint32_t);
+    char    *p       = mmap((void *)hdr.base,
+                     map_len,
+                     PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE,
+                     fd,
+                     offset);
+
+    if (p == MAP_FAILED) {
+        return NULL;
+    }
+
+    n00b_image_hdr_t *mapped = (n00b_image_hdr_t *)p;
+    char             *data   = p + mapped->data_offset;
+
+    if ((uint64_t)p != mapped->base
+        && !relocate(mapped, data, (int64_t)((uint64_t)p - mapped->base))) {
+        munmap(p, map_len);
+        return NULL;
+    }
+
+    if (!fix_records(mapped, data)) {
+        munmap(p, map_len);
+        return NULL;
+    }
+
+    register_image_heap(mapped, data);
+
+    return data + mapped->root_offset;
+}
+
+void *
+n00b_image_load(n00b_string_t *path)
+{
+    int fd = open(path->data, O_RDONLY | O_CLOEXEC);
+
+    if (fd == -1) {
+        return NULL;
+    }
+
+    void *result = n00b_image_map(fd, 0);
+
+    close(fd);
+
+    return result;
+}
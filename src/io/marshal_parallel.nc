@@ -0,0 +1,740 @@
+#define N00B_USE_INTERNAL_API
+#include "n00b.h"
+
+// Parallel marshaling.
+//
+// This produces exactly the same wire format as the single-threaded
+// marshal in filter_marshal.nc (the unmarshal side doesn't know or
+// care which one produced its input), but splits the work across a
+// set of worker threads. It's selected by asking for more than one
+// worker when setting up the marshal filter.
+//
+// We still stop the world for the duration; we need a consistent
+// snapshot. But the goal is to keep that window as short as possible
+// when marshaling big graphs. The work happens in two phases:
+//
+// 1. Tracing. Each worker has its own work list; it scans records
+//    and claims any record it finds that nobody has claimed yet in
+//    the memo table. A claim assigns the record its offset in the
+//    virtual heap, via an atomic add. Workers with a surplus of work
+//    donate batches to a shared pool, which idle workers pull from.
+//
+// 2. Copying. Once every reachable record has an offset, we know the
+//    full layout. We sort the claimed records by offset, cut them
+//    into segments of roughly N00B_MARSHAL_SEGMENT_SIZE bytes, and
+//    the workers copy and translate records straight into their
+//    final spot in those segments, in parallel.
+//
+// Segments are handed downstream as individual messages, instead of
+// being copied into one bundle at the end. We can't write to streams
+// until the world restarts, so they go out once the snapshot is
+// complete; but the unmarshal side buffers until it sees the end
+// record anyway.
+//
+// The workers are plain pthreads, not n00b threads, and they never
+// touch the GC heap: the world is stopped, and any allocation could
+// end up trying to collect. That rules out hatrack's crown (its
+// allocator hooks go through our heap), so the memo here is a private
+// table sharded by address, living in mmap()'d memory, with a lock
+// per shard. It only lives for one write; since offsets need to stay
+// consistent across messages on the same stream, the long-lived memo
+// is still ctx->memos, which we seed the shards from, and merge new
+// claims back into.
+//
+// The worker's lists use the same page-chained scheme as the
+// collector's work lists.
+
+#define N00B_MARSHAL_MEMO_SHARD_BITS 6
+#define N00B_MARSHAL_MEMO_SHARDS     (1 << N00B_MARSHAL_MEMO_SHARD_BITS)
+#define N00B_MARSHAL_MEMO_MIN_SLOTS  256
+// Once a worker has more than this many records queued, and somebody
+// is idle, it'll share half of them (up to a batch).
+#define N00B_MARSHAL_SHARE_MIN       32
+#define N00B_MARSHAL_SHARE_BATCH     256
+// During copying, workers grab this many records at a time.
+#define N00B_MARSHAL_COPY_BATCH      64
+
+typedef struct {
+    n00b_alloc_hdr *key;
+    uint64_t        offset;
+} memo_entry_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    memo_entry_t   *entries;
+    uint64_t        capacity;
+    uint64_t        count;
+} memo_shard_t;
+
+// A LIFO of words, chained through mmap()'d pages. The first word of
+// each page points to the previous page.
+typedef struct {
+    uint64_t *page;
+    int64_t   count;
+    int       index;
+    int       per_page;
+} page_stack_t;
+
+typedef struct {
+    n00b_alloc_hdr *src;
+    char           *dst;
+    uint64_t        offset;
+} copy_item_t;
+
+typedef struct par_ctx_t par_ctx_t;
+
+typedef struct {
+    par_ctx_t   *ctx;
+    pthread_t    pthread;
+    page_stack_t work;
+    page_stack_t claimed;
+    // Pairs of (offset relative to the virtual heap base, value).
+    page_stack_t patches;
+} par_worker_t;
+
+struct par_ctx_t {
+    n00b_pickle_ctx *pickle;
+    par_worker_t    *workers;
+    int              num_workers;
+    memo_shard_t     memo[N00B_MARSHAL_MEMO_SHARDS];
+    _Atomic uint64_t next_offset;
+    pthread_mutex_t  pool_lock;
+    pthread_cond_t   pool_cv;
+    page_stack_t     pool;
+    _Atomic int      idle;
+    copy_item_t     *items;
+    uint64_t         num_items;
+    _Atomic uint64_t next_item;
+};
+
+static inline uint64_t
+lsb_erase(uint64_t n)
+{
+    return n & 0xffffffffffff0000ull;
+}
+
+static void *
+raw_pages(uint64_t len)
+{
+    void *result = mmap(NULL,
+                        len,
+                        PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANON,
+                        -1,
+                        0);
+
+    if (result == MAP_FAILED) {
+        fprintf(stderr, "Out of memory.");
+        abort();
+    }
+
+    return result;
+}
+
+static inline void
+stack_init(page_stack_t *s)
+{
+    s->page     = n00b_unprotected_mempage();
+    s->page[0]  = 0;
+    s->index    = 1;
+    s->count    = 0;
+    s->per_page = n00b_page_bytes / sizeof(uint64_t);
+}
+
+static inline void
+stack_push(page_stack_t *s, uint64_t item)
+{
+    if (s->index == s->per_page) {
+        uint64_t *page = n00b_unprotected_mempage();
+
+        page[0]  = (uint64_t)s->page;
+        s->page  = page;
+        s->index = 1;
+    }
+
+    s->page[s->index++] = item;
+    s->count++;
+}
+
+static inline bool
+stack_pop(page_stack_t *s, uint64_t *item)
+{
+    if (s->index == 1) {
+        uint64_t *prev = (uint64_t *)s->page[0];
+
+        if (!prev) {
+            return false;
+        }
+
+        n00b_delete_mempage(s->page);
+        s->page  = prev;
+        s->index = s->per_page;
+    }
+
+    *item = s->page[--s->index];
+    s->count--;
+
+    return true;
+}
+
+static inline void
+stack_delete(page_stack_t *s)
+{
+    uint64_t ignore;
+
+    while (stack_pop(s, &ignore))
+        ;
+
+    n00b_delete_mempage(s->page);
+}
+
+static inline uint64_t
+memo_hash(n00b_alloc_hdr *key)
+{
+    return (((uint64_t)key) >> 4) * 0x9e3779b97f4a7c15ULL;
+}
+
+static inline memo_shard_t *
+memo_shard(par_ctx_t *ctx, uint64_t hv)
+{
+    return &ctx->memo[hv >> (64 - N00B_MARSHAL_MEMO_SHARD_BITS)];
+}
+
+static inline memo_entry_t *
+memo_slot(memo_shard_t *shard, n00b_alloc_hdr *key, uint64_t hv)
+{
+    uint64_t mask = shard->capacity - 1;
+    uint64_t i    = hv & mask;
+
+    while (true) {
+        memo_entry_t *e = &shard->entries[i];
+
+        if (!e->key || e->key == key) {
+            return e;
+        }
+
+        i = (i + 1) & mask;
+    }
+}
+
+static void
+memo_grow(memo_shard_t *shard)
+{
+    memo_entry_t *old     = shard->entries;
+    uint64_t      old_cap = shard->capacity;
+
+    shard->capacity <<= 1;
+    shard->entries = raw_pages(shard->capacity * sizeof(memo_entry_t));
+
+    for (uint64_t i = 0; i < old_cap; i++) {
+        if (old[i].key) {
+            *memo_slot(shard, old[i].key, memo_hash(old[i].key)) = old[i];
+        }
+    }
+
+    munmap(old, old_cap * sizeof(memo_entry_t));
+}
+
+// Returns true if we were the first to see this record, in which case
+// it gets assigned an offset.
+static bool
+memo_claim(par_ctx_t *ctx, n00b_alloc_hdr *key)
+{
+    uint64_t      hv    = memo_hash(key);
+    memo_shard_t *shard = memo_shard(ctx, hv);
+    bool          result;
+
+    pthread_mutex_lock(&shard->lock);
+
+    memo_entry_t *e = memo_slot(shard, key, hv);
+
+    if (e->key) {
+        result = false;
+    }
+    else {
+        e->key    = key;
+        e->offset = atomic_fetch_add(&ctx->next_offset, key->alloc_len);
+        result    = true;
+
+        if (++shard->count * 2 > shard->capacity) {
+            memo_grow(shard);
+        }
+    }
+
+    pthread_mutex_unlock(&shard->lock);
+
+    return result;
+}
+
+// Only used once tracing is done, when the tables are read-only.
+static inline uint64_t
+memo_lookup(par_ctx_t *ctx, n00b_alloc_hdr *key)
+{
+    uint64_t      hv    = memo_hash(key);
+    memo_shard_t *shard = memo_shard(ctx, hv);
+    memo_entry_t *e     = memo_slot(shard, key, hv);
+
+    n00b_assert(e->key == key);
+
+    return e->offset;
+}
+
+static void
+memo_setup(par_ctx_t *ctx)
+{
+    for (int i = 0; i < N00B_MARSHAL_MEMO_SHARDS; i++) {
+        memo_shard_t *shard = &ctx->memo[i];
+
+        pthread_mutex_init(&shard->lock, NULL);
+        shard->capacity = N00B_MARSHAL_MEMO_MIN_SLOTS;
+        shard->count    = 0;
+        shard->entries  = raw_pages(shard->capacity * sizeof(memo_entry_t));
+    }
+
+    // Seed with anything earlier messages on this stream marshaled.
+    uint64_t             n;
+    hatrack_dict_item_t *items = hatrack_dict_items_nosort(ctx->pickle->memos,
+                                                           &n);
+
+    for (uint64_t i = 0; i < n; i++) {
+        n00b_alloc_hdr *key   = items[i].key;
+        uint64_t        hv    = memo_hash(key);
+        memo_shard_t   *shard = memo_shard(ctx, hv);
+        memo_entry_t   *e     = memo_slot(shard, key, hv);
+
+        e->key    = key;
+        e->offset = (uint64_t)items[i].value;
+
+        if (++shard->count * 2 > shard->capacity) {
+            memo_grow(shard);
+        }
+    }
+}
+
+static void
+memo_teardown(par_ctx_t *ctx)
+{
+    for (int i = 0; i < N00B_MARSHAL_MEMO_SHARDS; i++) {
+        memo_shard_t *shard = &ctx->memo[i];
+
+        munmap(shard->entries, shard->capacity * sizeof(memo_entry_t));
+        pthread_mutex_destroy(&shard->lock);
+    }
+}
+
+static inline n00b_alloc_hdr *
+find_record(par_ctx_t *ctx, uint64_t val)
+{
+    if (lsb_erase(val) == ctx->pickle->base) {
+        return NULL;
+    }
+
+    if (!n00b_in_heap((void *)val)) {
+        return NULL;
+    }
+
+    return n00b_find_allocation_record((void *)val);
+}
+
+static inline void
+trace_word(par_worker_t *w, uint64_t val)
+{
+    n00b_alloc_hdr *rec = find_record(w->ctx, val);
+
+    if (rec && memo_claim(w->ctx, rec)) {
+        stack_push(&w->work, (uint64_t)rec);
+        stack_push(&w->claimed, (uint64_t)rec);
+    }
+}
+
+static inline void
+trace_record(par_worker_t *w, n00b_alloc_hdr *src)
+{
+    uint64_t *p   = src->data;
+    uint64_t  len = (src->alloc_len - sizeof(n00b_alloc_hdr)) / 8;
+    uint64_t *end = p + len;
+
+    trace_word(w, (uint64_t)src->type);
+
+    if (!src->n00b_ptr_scan) {
+        return;
+    }
+
+    while (p < end && *p != N00B_NOSCAN) {
+        trace_word(w, *p++);
+    }
+}
+
+static inline void
+maybe_share(par_worker_t *w)
+{
+    par_ctx_t *ctx = w->ctx;
+
+    if (w->work.count < N00B_MARSHAL_SHARE_MIN || !atomic_read(&ctx->idle)) {
+        return;
+    }
+
+    int64_t  n = n00b_min(w->work.count / 2, N00B_MARSHAL_SHARE_BATCH);
+    uint64_t item;
+
+    pthread_mutex_lock(&ctx->pool_lock);
+
+    while (n-- && stack_pop(&w->work, &item)) {
+        stack_push(&ctx->pool, item);
+    }
+
+    pthread_cond_broadcast(&ctx->pool_cv);
+    pthread_mutex_unlock(&ctx->pool_lock);
+}
+
+// Blocks until there's shared work or everybody is idle (in which
+// case we're done, and this returns false).
+static bool
+get_shared_work(par_worker_t *w)
+{
+    par_ctx_t *ctx = w->ctx;
+    uint64_t   item;
+    int        n   = N00B_MARSHAL_SHARE_BATCH;
+
+    pthread_mutex_lock(&ctx->pool_lock);
+    atomic_fetch_add(&ctx->idle, 1);
+
+    while (!ctx->pool.count && atomic_read(&ctx->idle) < ctx->num_workers) {
+        pthread_cond_wait(&ctx->pool_cv, &ctx->pool_lock);
+    }
+
+    if (!ctx->pool.count) {
+        pthread_cond_broadcast(&ctx->pool_cv);
+        pthread_mutex_unlock(&ctx->pool_lock);
+        return false;
+    }
+
+    atomic_fetch_add(&ctx->idle, -1);
+
+    while (n-- && stack_pop(&ctx->pool, &item)) {
+        stack_push(&w->work, item);
+    }
+
+    pthread_mutex_unlock(&ctx->pool_lock);
+
+    return true;
+}
+
+static void *
+trace_worker(void *arg)
+{
+    par_worker_t *w = arg;
+    uint64_t      item;
+
+    while (true) {
+        while (stack_pop(&w->work, &item)) {
+            trace_record(w, (n00b_alloc_hdr *)item);
+            maybe_share(w);
+        }
+
+        if (!get_shared_work(w)) {
+            return NULL;
+        }
+    }
+}
+
+static inline uint64_t
+translate_word(par_worker_t *w, uint64_t *src, uint64_t offset)
+{
+    par_ctx_t      *ctx = w->ctx;
+    uint64_t        val = *src;
+    n00b_alloc_hdr *rec;
+
+    if (lsb_erase(val) == ctx->pickle->base) {
+        stack_push(&w->patches, offset - ctx->pickle->base);
+        stack_push(&w->patches, val);
+        return 0;
+    }
+
+    rec = find_record(ctx, val);
+
+    if (!rec) {
+        return val;
+    }
+
+    return memo_lookup(ctx, rec) + (val - (uint64_t)rec);
+}
+
+static inline void
+copy_record(par_worker_t *w, copy_item_t *item)
+{
+    n00b_alloc_hdr     *src = item->src;
+    n00b_marshaled_hdr *dst = (n00b_marshaled_hdr *)item->dst;
+    uint64_t           *sp  = src->data;
+    uint64_t           *dp  = dst->data;
+    uint64_t            len = (src->alloc_len - sizeof(n00b_alloc_hdr)) / 8;
+    uint64_t            off = item->offset + sizeof(n00b_alloc_hdr);
+
+    dst->empty_guard   = N00B_MARSHAL_RECORD_GUARD;
+    dst->alloc_len     = src->alloc_len;
+    dst->n00b_ptr_scan = src->n00b_ptr_scan;
+    dst->n00b_obj      = src->n00b_obj;
+    dst->type          = (void *)translate_word(w,
+                                       (uint64_t *)&src->type,
+                                       item->offset
+                                           + offsetof(n00b_alloc_hdr, type));
+
+    uint64_t i = 0;
+
+    if (src->n00b_ptr_scan) {
+        for (; i < len && sp[i] != N00B_NOSCAN; i++) {
+            dp[i] = translate_word(w, &sp[i], off + i * 8);
+        }
+    }
+
+    memcpy(dp + i, sp + i, (len - i) * sizeof(uint64_t));
+}
+
+static void *
+copy_worker(void *arg)
+{
+    par_worker_t *w   = arg;
+    par_ctx_t    *ctx = w->ctx;
+
+    while (true) {
+        uint64_t start = atomic_fetch_add(&ctx->next_item,
+                                          N00B_MARSHAL_COPY_BATCH);
+
+        if (start >= ctx->num_items) {
+            return NULL;
+        }
+
+        uint64_t end = n00b_min(start + N00B_MARSHAL_COPY_BATCH,
+                                ctx->num_items);
+
+        for (uint64_t i = start; i < end; i++) {
+            copy_record(w, &ctx->items[i]);
+        }
+    }
+}
+
+static void
+run_workers(par_ctx_t *ctx, void *(*fn)(void *))
+{
+    // The calling thread acts as worker 0.
+    for (int i = 1; i < ctx->num_workers; i++) {
+        par_worker_t *w = &ctx->workers[i];
+
+        if (pthread_create(&w->pthread, NULL, fn, w)) {
+            n00b_abort();
+        }
+    }
+
+    (*fn)(&ctx->workers[0]);
+
+    for (int i = 1; i < ctx->num_workers; i++) {
+        pthread_join(ctx->workers[i].pthread, NULL);
+    }
+}
+
+static int
+cmp_items(const void *a, const void *b)
+{
+    uint64_t x = ((copy_item_t *)a)->offset;
+    uint64_t y = ((copy_item_t *)b)->offset;
+
+    return (x > y) - (x < y);
+}
+
+static void
+collect_items(par_ctx_t *ctx)
+{
+    uint64_t n = 0;
+    uint64_t item;
+
+    for (int i = 0; i < ctx->num_workers; i++) {
+        n += ctx->workers[i].claimed.count;
+    }
+
+    ctx->num_items = n;
+
+    if (!n) {
+        ctx->items = NULL;
+        return;
+    }
+
+    ctx->items = raw_pages(n * sizeof(copy_item_t));
+    n          = 0;
+
+    for (int i = 0; i < ctx->num_workers; i++) {
+        while (stack_pop(&ctx->workers[i].claimed, &item)) {
+            n00b_alloc_hdr *src = (n00b_alloc_hdr *)item;
+
+            ctx->items[n].src      = src;
+            ctx->items[n++].offset = memo_lookup(ctx, src);
+        }
+    }
+
+    qsort(ctx->items, n, sizeof(copy_item_t), cmp_items);
+}
+
+// Cuts the (sorted) records into segments, allocates an output buffer
+// for each, and assigns every record its destination.
+static n00b_list_t *
+layout_segments(par_ctx_t *ctx)
+{
+    n00b_pickle_ctx *pickle = ctx->pickle;
+    n00b_list_t     *result = n00b_list(n00b_type_buffer());
+    uint64_t         i      = 0;
+
+    while (i < ctx->num_items) {
+        uint64_t first  = i;
+        uint64_t seglen = 0;
+        uint64_t prefix = 0;
+
+        do {
+            seglen += ctx->items[i++].src->alloc_len;
+        } while (i < ctx->num_items
+                 && seglen + ctx->items[i].src->alloc_len
+                        <= N00B_MARSHAL_SEGMENT_SIZE);
+
+        if (!pickle->started) {
+            prefix = sizeof(uint64_t) * 2;
+        }
+
+        n00b_buf_t *b = n00b_new(n00b_type_buffer(),
+                                 length : (int64_t)(seglen + prefix));
+        char       *p = b->data;
+
+        b->byte_len = seglen + prefix;
+
+        if (!pickle->started) {
+            ((uint64_t *)p)[0] = n00b_get_marshal_magic();
+            ((uint64_t *)p)[1] = pickle->base;
+            p += prefix;
+            pickle->started = true;
+        }
+
+        uint64_t seg_start = ctx->items[first].offset;
+
+        for (uint64_t j = first; j < i; j++) {
+            ctx->items[j].dst = p + (ctx->items[j].offset - seg_start);
+        }
+
+        n00b_list_append(result, b);
+    }
+
+    return result;
+}
+
+static n00b_buf_t *
+build_end_record(par_ctx_t *ctx)
+{
+    int64_t  n = 0;
+    uint64_t word;
+
+    for (int i = 0; i < ctx->num_workers; i++) {
+        n += ctx->workers[i].patches.count;
+    }
+
+    int64_t     len = sizeof(n00b_alloc_hdr) + n * sizeof(uint64_t);
+    n00b_buf_t *b   = n00b_new(n00b_type_buffer(), length : len);
+
+    b->byte_len = len;
+
+    n00b_marshaled_hdr *end   = (n00b_marshaled_hdr *)b->data;
+    uint64_t           *patch = (uint64_t *)(b->data + len);
+
+    end->empty_guard      = N00B_MARSHAL_RECORD_GUARD;
+    end->n00b_marshal_end = true;
+    end->alloc_len        = n * sizeof(uint64_t);
+
+    // Patches were pushed as (offset, value), so pop them backward.
+    for (int i = 0; i < ctx->num_workers; i++) {
+        while (stack_pop(&ctx->workers[i].patches, &word)) {
+            *--patch = word;
+        }
+    }
+
+    return b;
+}
+
+static void
+merge_memos(par_ctx_t *ctx)
+{
+    for (uint64_t i = 0; i < ctx->num_items; i++) {
+        hatrack_dict_put(ctx->pickle->memos,
+                         ctx->items[i].src,
+                         (void *)ctx->items[i].offset);
+    }
+}
+
+n00b_list_t *
+n00b_parallel_marshal(n00b_pickle_ctx *pickle, void *addr)
+{
+    n00b_alloc_hdr *root = n00b_object_header(addr);
+    n00b_list_t    *result;
+    par_ctx_t       ctx  = {
+               .pickle      = pickle,
+               .num_workers = pickle->workers,
+    };
+    par_worker_t workers[pickle->workers];
+
+    // Allocations while the world is stopped must not move anything
+    // out from under the memo table.
+    n00b_suspend_collections();
+    n00b_stop_the_world();
+
+    atomic_store(&ctx.next_offset, pickle->offset);
+    memo_setup(&ctx);
+
+    if (!memo_claim(&ctx, root)) {
+        // Already sent on this stream.
+        memo_teardown(&ctx);
+        n00b_restart_the_world();
+        n00b_allow_collections();
+        return NULL;
+    }
+
+    ctx.workers = workers;
+    pthread_mutex_init(&ctx.pool_lock, NULL);
+    pthread_cond_init(&ctx.pool_cv, NULL);
+    stack_init(&ctx.pool);
+
+    for (int i = 0; i < ctx.num_workers; i++) {
+        workers[i].ctx = &ctx;
+        stack_init(&workers[i].work);
+        stack_init(&workers[i].claimed);
+        stack_init(&workers[i].patches);
+    }
+
+    stack_push(&workers[0].work, (uint64_t)root);
+    stack_push(&workers[0].claimed, (uint64_t)root);
+
+    run_workers(&ctx, trace_worker);
+    collect_items(&ctx);
+
+    result = layout_segments(&ctx);
+
+    run_workers(&ctx, copy_worker);
+    n00b_list_append(result, build_end_record(&ctx));
+    merge_memos(&ctx);
+
+    pickle->offset          = atomic_read(&ctx.next_offset);
+    pickle->last_offset_end = pickle->offset;
+
+    for (int i = 0; i < ctx.num_workers; i++) {
+        stack_delete(&workers[i].work);
+        stack_delete(&workers[i].claimed);
+        stack_delete(&workers[i].patches);
+    }
+
+    stack_delete(&ctx.pool);
+    pthread_cond_destroy(&ctx.pool_cv);
+    pthread_mutex_destroy(&ctx.pool_lock);
+    memo_teardown(&ctx);
+
+    if (ctx.items) {
+        munmap(ctx.items, ctx.num_items * sizeof(copy_item_t));
+    }
+
+    n00b_restart_the_world();
+    n00b_allow_collections();
+
+    return result;
+}
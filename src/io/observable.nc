@@ -12,7 +12,7 @@ n00b_observable_init(n00b_observable_t *o, n00b_list_t *topics)
         o->topics = n00b_list(n00b_type_string());
     }
 
-    o->observers = n00b_list(n00b_type_ref());
+    atomic_store(&o->observers, n00b_list(n00b_type_ref()));
     n00b_named_lock_init(&o->lock, N00B_NLT_MUTEX, "observable");
 }
 
@@ -61,7 +61,44 @@ n00b_observable_set_num_topics(n00b_observable_t *o, uint32_t n)
 static inline n00b_list_t *
 get_topic_subs(n00b_observable_t *o, int64_t ix)
 {
-    return n00b_private_list_get(o->observers, ix, NULL);
+    return n00b_private_list_get(atomic_read(&o->observers), ix, NULL);
+}
+
+// Publishes a new version of one topic's subscriber list. The caller
+// must hold the observable's lock.
+static void
+publish_topic_subs(n00b_observable_t *o, int64_t ix, n00b_list_t *subs)
+{
+    n00b_list_t *all = n00b_private_list_shallow_copy(atomic_read(&o->observers));
+
+    n00b_private_list_set(all, ix, subs);
+    atomic_store(&o->observers, all);
+}
+
+// Returns the number of subscribers left on the topic, or -1 if the
+// subscription wasn't there.
+static int64_t
+remove_subscription(n00b_observable_t *o, n00b_observer_t *sub)
+{
+    n00b_list_t *subs = get_topic_subs(o, sub->topic_ix);
+
+    if (!subs || n00b_private_list_find(subs, sub) == -1) {
+        return -1;
+    }
+
+    subs = n00b_private_list_shallow_copy(subs);
+    n00b_private_list_remove_item(subs, sub);
+    publish_topic_subs(o, sub->topic_ix, subs);
+
+    return n00b_list_len(subs);
+}
+
+static void
+drop_subscription(n00b_observable_t *o, n00b_observer_t *sub)
+{
+    n00b_lock_acquire(&o->lock);
+    remove_subscription(o, sub);
+    n00b_lock_release(&o->lock);
 }
 
 n00b_list_t *
@@ -72,6 +109,10 @@ n00b_observable_all_subscribers(n00b_observable_t *o,
 }
 
 // Topic is either a string or an int.
+//
+// This doesn't lock; we walk whatever version of the subscriber list
+// was current when we started. Callbacks are free to subscribe or
+// unsubscribe (including themselves); that only affects later posts.
 int
 n00b_observable_post(n00b_observable_t *o, void *topic_info, void *msg)
 {
@@ -84,8 +125,6 @@ n00b_observable_post(n00b_observable_t *o, void *topic_info, void *msg)
         return 0;
     }
 
-    n00b_lock_list_read(subs);
-
     int n = n00b_list_len(subs);
     int r = 0;
 
@@ -103,19 +142,26 @@ n00b_observable_post(n00b_observable_t *o, void *topic_info, void *msg)
         }
 
         if (!n00b_in_heap(target)) {
-            n00b_private_list_remove(subs, n);
+            drop_subscription(o, item);
             continue;
         }
 
+        if (item->oneshot) {
+            bool expected = false;
+
+            if (!CAS(&item->fired, &expected, true)) {
+                continue;
+            }
+        }
+
         (*item->callback)(msg, target);
         r++;
 
         if (item->oneshot) {
-            n00b_private_list_remove_item(subs, item);
+            drop_subscription(o, item);
         }
     }
 
-    n00b_unlock_list(subs);
     return r;
 }
 
@@ -127,32 +173,16 @@ n00b_observable_add_subscribers(n00b_observable_t *target,
                                 bool               oneshot)
 
 {
-    int64_t        topic_ix   = get_topic_ix(target, topic_info);
-    n00b_list_t   *topic_subs = get_topic_subs(target, topic_ix);
-    n00b_string_t *topic      = n00b_list_get(target->topics,
+    int64_t        topic_ix = get_topic_ix(target, topic_info);
+    n00b_string_t *topic    = n00b_list_get(target->topics,
                                          topic_ix,
                                          NULL);
 
-    if (!topic_subs) {
-        //        n00b_lock_list(target->observers);
-        topic_subs = get_topic_subs(target, topic_ix);
-        if (!topic_subs) {
-            topic_subs = n00b_list(n00b_type_ref());
-            n00b_list_set(target->observers, topic_ix, topic_subs);
-        }
-        //        n00b_unlock_list(target->observers);
-    }
-
-    //    n00b_lock_list(topic_subs);
-
     n00b_list_t *result           = n00b_list(n00b_type_ref());
     n00b_list_t *to_process       = NULL;
+    n00b_list_t *topic_subs;
     bool         first_subscriber = false;
 
-    if (!n00b_list_len(topic_subs) || target->lt_sub) {
-        first_subscriber = true;
-    }
-
     if (n00b_type_is_list(n00b_get_my_type(sub_list))) {
         to_process = n00b_shallow(sub_list);
     }
@@ -176,16 +206,34 @@ n00b_observable_add_subscribers(n00b_observable_t *target,
         subscription->topic_ix        = topic_ix;
         subscription->target          = target;
 
-        n00b_private_list_append(topic_subs, subscription);
         n00b_private_list_append(result, subscription);
     }
 
+    n00b_lock_acquire(&target->lock);
+
+    topic_subs = get_topic_subs(target, topic_ix);
+
+    if (!n00b_list_len(topic_subs) || target->lt_sub) {
+        first_subscriber = true;
+    }
+
+    if (topic_subs) {
+        topic_subs = n00b_private_list_shallow_copy(topic_subs);
+        n00b_private_list_plus_eq(topic_subs, result);
+    }
+    else {
+        topic_subs = n00b_private_list_shallow_copy(result);
+    }
+
+    publish_topic_subs(target, topic_ix, topic_subs);
+
+    n00b_lock_release(&target->lock);
+
     if (target->on_subscribe && first_subscriber) {
         n00b_barrier();
         (*target->on_subscribe)(target,
                                 n00b_private_list_get(result, 0, NULL));
     }
-    //    n00b_unlock_list(topic_subs);
 
     return result;
 }
@@ -193,19 +241,14 @@ n00b_observable_add_subscribers(n00b_observable_t *target,
 void
 n00b_observable_unsubscribe(n00b_observer_t *sub)
 {
-    n00b_observable_t *target     = sub->target;
-    n00b_list_t       *topic_subs = get_topic_subs(target, sub->topic_ix);
-
-    if (!topic_subs) {
-        return;
-    }
+    n00b_observable_t *target = sub->target;
 
     n00b_lock_acquire(&target->lock);
 
-    n00b_list_remove_item(topic_subs, sub);
+    int64_t remaining = remove_subscription(target, sub);
 
-    if (target->on_unsubscribe) {
-        if (target->lt_unsub || !n00b_list_len(topic_subs)) {
+    if (remaining != -1 && target->on_unsubscribe) {
+        if (target->lt_unsub || !remaining) {
             (*target->on_unsubscribe)(target, sub);
         }
     }
@@ -44,19 +44,14 @@ _n00b_print(void *first, ...)
         }
     }
 
-    if (n00b_type_is_keyword(t)) {
+    // The things to print end at either the keywords or a NULL.
+    if (n00b_is_kargs(first)) {
         _n00b_karg = first;
-        va_arg(args, int); // will be a 0
-        numargs = va_arg(args, int);
-
-        if (numargs < 0) {
-            numargs = 0;
-            cur     = va_arg(args, void *);
-        }
-        else {
-            _n00b_karg = n00b_get_kargs_and_count(args, &numargs);
-            numargs++;
-        }
+        numargs    = 0;
+    }
+    else {
+        _n00b_karg = n00b_get_kargs_and_count(args, &numargs);
+        numargs++;
     }
 
     if (_n00b_karg != NULL) {
@@ -119,6 +119,23 @@ bulk_subscribe(n00b_stream_t *target, n00b_list_t *subs)
     return result;
 }
 
+// When the only thing reading the subprocess' output is one of our
+// own output streams, we don't need to look at the bytes at all; the
+// kernel can move them. Otherwise, we leave the subscribers be.
+static inline n00b_list_t *
+splice_if_only_proxying(n00b_stream_t *src, n00b_list_t *subs)
+{
+    if (!src || n00b_list_len(subs) != 1) {
+        return subs;
+    }
+
+    if (!n00b_stream_splice(src, n00b_list_get(subs, 0, NULL))) {
+        return subs;
+    }
+
+    return NULL;
+}
+
 static void
 post_spawn_subscription_setup(n00b_proc_t *ctx)
 {
@@ -189,6 +206,11 @@ post_spawn_subscription_setup(n00b_proc_t *ctx)
         n00b_list_append(ctx->stderr_subs, n00b_stderr());
     }
 
+    ctx->stdout_subs = splice_if_only_proxying(ctx->subproc_stdout,
+                                               ctx->stdout_subs);
+    ctx->stderr_subs = splice_if_only_proxying(ctx->subproc_stderr,
+                                               ctx->stderr_subs);
+
     ctx->stdin_subs  = bulk_subscribe(n00b_stdin(), ctx->stdin_subs);
     ctx->stdout_subs = bulk_subscribe(ctx->subproc_stdout, ctx->stdout_subs);
     ctx->stderr_subs = bulk_subscribe(ctx->subproc_stderr, ctx->stderr_subs);
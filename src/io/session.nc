@@ -287,6 +287,7 @@ session_cleanup(n00b_session_t *session)
 
     session->capture_stream = NULL;
     session->saved_capture  = NULL;
+    session->cap_encoder    = NULL;
 
     if (session->subprocess) {
         n00b_proc_close(session->subprocess);
@@ -3,150 +3,444 @@
 
 #define capture(x, y, z) n00b_session_capture(x, y, z)
 
+// Capture file layout (version 2). All fixed-width integers are
+// little endian.
+//
+// Header (N00B_CAPTURE_HEADER_LEN bytes):
+//   u64  N00B_CAPTURE_MAGIC
+//   u32  N00B_CAPTURE_VERSION
+//   u32  Reserved (0)
+//   i64  Session start (seconds)
+//   i64  Session start (nanoseconds)
+//
+// Then any number of blocks, each holding a run of events:
+//   u32  N00B_CAPTURE_BLOCK_MAGIC
+//   u32  Flags (N00B_CAPTURE_BLOCK_COMPRESSED)
+//   u32  Raw length of the event data
+//   u32  Stored length of the event data
+//   u32  Id of the first event
+//   u32  Number of events
+//   i64  Timestamp of the first event (ns since session start)
+//   i64  Timestamp of the last event
+//   ...  Event data, compressed w/ n00b_lz_compress_raw() if flagged.
+//
+// When the capture is finished, an index of the blocks follows:
+//   u32  N00B_CAPTURE_INDEX_MAGIC
+//   u32  Number of blocks
+//   For each block: u64 file offset, i64 first timestamp
+//   u64  Offset of the index
+//   u64  N00B_CAPTURE_TRAILER_MAGIC
+//
+// Readers use the index to seek by time w/o decoding anything. If it
+// isn't there (the capture didn't finish cleanly), block headers are
+// enough to rebuild it, since they can be walked w/o touching the
+// data.
+//
+// Inside a block, each event is:
+//   varint  Event kind
+//   varint  Id, relative to the block's first id
+//   varint  Timestamp delta from the previous event (zigzag encoded)
+//   ...     Payload; strings are a varint length, then the bytes.
+//
+// Since writes only happen a block at a time, at most
+// N00B_CAPTURE_BLOCK_NSEC worth of events is at risk if the process
+// dies. A timer on the system dispatcher writes out blocks that have
+// been open that long, even if no more events come in to notice; the
+// block also gets written when recording pauses, and when the
+// session ends.
+
+struct n00b_capture_encoder_t {
+    n00b_mutex_t   lock;
+    n00b_stream_t *target;
+    char          *block;
+    int64_t        block_len;
+    int64_t        block_alloc;
+    int64_t        block_opened; // Wall clock, ns.
+    int64_t        first_ts;
+    int64_t        last_ts;
+    uint32_t       first_id;
+    uint32_t       num_events;
+    int64_t        offset; // Where the next block goes.
+    int64_t       *index;  // Pairs of (offset, first timestamp).
+    int32_t        index_len;
+    int32_t        index_alloc;
+    _Atomic(bool)  timer_armed;
+    bool           wrote_header;
+};
+
+static inline void
+block_reserve(n00b_capture_encoder_t *enc, int64_t n)
+{
+    if (enc->block_len + n <= enc->block_alloc) {
+        return;
+    }
+
+    int64_t sz = n00b_max(enc->block_alloc << 1, N00B_CAPTURE_BLOCK_SIZE);
+
+    while (sz < enc->block_len + n) {
+        sz <<= 1;
+    }
+
+    char *p = n00b_gc_array_value_alloc(char, sz);
+
+    if (enc->block_len) {
+        memcpy(p, enc->block, enc->block_len);
+    }
+
+    enc->block       = p;
+    enc->block_alloc = sz;
+}
+
 static inline void
-write_capture_header(n00b_stream_t *s)
+put_bytes(n00b_capture_encoder_t *enc, void *p, int64_t n)
 {
-    const int64_t    len = sizeof(int64_t) + sizeof(n00b_duration_t);
-    n00b_buf_t      *b   = n00b_new(n00b_type_buffer(), length : len);
-    int64_t         *mp  = (int64_t *)b->data;
-    char            *p   = b->data + sizeof(int64_t);
-    n00b_duration_t *d   = n00b_now();
-
-    *mp = (int64_t)N00B_SESSION_MAGIC;
-    memcpy(p, d, sizeof(n00b_duration_t));
-    n00b_stream_unfiltered_write(s, b);
+    block_reserve(enc, n);
+    memcpy(enc->block + enc->block_len, p, n);
+    enc->block_len += n;
 }
 
 static inline void
-add_record_header(n00b_cap_event_t *event, n00b_stream_t *s)
+put_varint(n00b_capture_encoder_t *enc, uint64_t n)
 {
-    const int64_t len = sizeof(n00b_duration_t) + sizeof(uint32_t) + 2;
+    block_reserve(enc, 10);
 
-    n00b_buf_t *b = n00b_new(n00b_type_buffer(), length : len);
-    char       *p = b->data;
-    memcpy(p, &event->id, sizeof(uint32_t));
-    p += sizeof(uint32_t);
-    memcpy(p, event->timestamp, sizeof(n00b_duration_t));
-    p += sizeof(n00b_duration_t);
-    *(int16_t *)p = (int16_t)event->kind;
+    uint8_t *p = (uint8_t *)enc->block + enc->block_len;
 
-    n00b_stream_unfiltered_write(s, b);
+    while (n >= 0x80) {
+        *p++ = (uint8_t)n | 0x80;
+        n >>= 7;
+    }
+
+    *p++ = (uint8_t)n;
+
+    enc->block_len = (char *)p - enc->block;
 }
 
 static inline void
-add_capture_payload_str(n00b_string_t *s, n00b_stream_t *strm)
+put_str(n00b_capture_encoder_t *enc, n00b_string_t *s)
 {
     if (!s) {
         s = n00b_cached_empty_string();
     }
-    n00b_buf_t *b1 = n00b_new(n00b_type_buffer(), length : 4);
-    uint32_t   *n  = (uint32_t *)b1->data;
-    *n             = s->u8_bytes;
-    n00b_buf_t *b2 = n00b_new(n00b_type_buffer(),
-                              length : s->u8_bytes, ptr : s->data);
 
-    n00b_stream_unfiltered_write(strm, b1);
-    n00b_stream_unfiltered_write(strm, b2);
+    put_varint(enc, s->u8_bytes);
+    put_bytes(enc, s->data, s->u8_bytes);
     n00b_dlog_io("%capture: %s\n", s->data);
 }
 
-static inline void
-add_capture_payload_ansi(n00b_list_t *anodes, n00b_stream_t *strm)
+static inline char *
+le32(char *p, uint32_t n)
 {
-    n00b_string_t *s = n00b_ansi_nodes_to_string(anodes, true);
+    little_32(n);
+    memcpy(p, &n, sizeof(uint32_t));
 
-    add_capture_payload_str(s, strm);
+    return p + sizeof(uint32_t);
 }
 
-static inline void
-add_capture_winch(struct winsize *dims, n00b_stream_t *strm)
+static inline char *
+le64(char *p, uint64_t n)
+{
+    little_64(n);
+    memcpy(p, &n, sizeof(uint64_t));
+
+    return p + sizeof(uint64_t);
+}
+
+static void
+write_out(n00b_capture_encoder_t *enc, n00b_buf_t *b)
+{
+    n00b_stream_unfiltered_write(enc->target, b);
+    enc->offset += n00b_buffer_len(b);
+}
+
+static void
+write_capture_header(n00b_capture_encoder_t *enc, n00b_duration_t *start)
 {
     n00b_buf_t *b = n00b_new(n00b_type_buffer(),
-                             length : sizeof(struct winsize), ptr : dims);
-    n00b_stream_unfiltered_write(strm, b);
+                             length : N00B_CAPTURE_HEADER_LEN);
+    char       *p = b->data;
+
+    p = le64(p, N00B_CAPTURE_MAGIC);
+    p = le32(p, N00B_CAPTURE_VERSION);
+    p = le32(p, 0);
+    p = le64(p, start->tv_sec);
+    p = le64(p, start->tv_nsec);
+
+    write_out(enc, b);
+    enc->wrote_header = true;
+}
+
+static void
+add_index_entry(n00b_capture_encoder_t *enc)
+{
+    if (enc->index_len == enc->index_alloc) {
+        int32_t  n = n00b_max(enc->index_alloc << 1, 64);
+        int64_t *p = n00b_gc_array_value_alloc(int64_t, n * 2);
+
+        if (enc->index_len) {
+            memcpy(p, enc->index, enc->index_len * 2 * sizeof(int64_t));
+        }
+
+        enc->index       = p;
+        enc->index_alloc = n;
+    }
+
+    enc->index[enc->index_len * 2]     = enc->offset;
+    enc->index[enc->index_len * 2 + 1] = enc->first_ts;
+    enc->index_len++;
+}
+
+// The caller must hold the encoder's lock.
+static void
+flush_block(n00b_capture_encoder_t *enc)
+{
+    if (!enc->num_events) {
+        return;
+    }
+
+    int64_t     raw_len    = enc->block_len;
+    int64_t     bound      = n00b_lz_bound(raw_len);
+    int64_t     alloc      = N00B_CAPTURE_BLOCK_HDR_LEN + bound;
+    n00b_buf_t *b          = n00b_new(n00b_type_buffer(), length : alloc);
+    char       *data       = b->data + N00B_CAPTURE_BLOCK_HDR_LEN;
+    int64_t     stored_len = n00b_lz_compress_raw(enc->block,
+                                                  raw_len,
+                                                  data,
+                                                  bound);
+    uint32_t    flags      = N00B_CAPTURE_BLOCK_COMPRESSED;
+
+    if (stored_len < 0 || stored_len >= raw_len) {
+        memcpy(data, enc->block, raw_len);
+        stored_len = raw_len;
+        flags      = 0;
+    }
+
+    char *p = b->data;
+
+    p = le32(p, N00B_CAPTURE_BLOCK_MAGIC);
+    p = le32(p, flags);
+    p = le32(p, raw_len);
+    p = le32(p, stored_len);
+    p = le32(p, enc->first_id);
+    p = le32(p, enc->num_events);
+    p = le64(p, enc->first_ts);
+    p = le64(p, enc->last_ts);
+
+    b->byte_len = N00B_CAPTURE_BLOCK_HDR_LEN + stored_len;
+
+    add_index_entry(enc);
+    write_out(enc, b);
+
+    enc->block_len  = 0;
+    enc->num_events = 0;
+}
+
+void
+n00b_capture_encoder_flush(n00b_capture_encoder_t *enc)
+{
+    n00b_lock_acquire(&enc->lock);
+    flush_block(enc);
+    n00b_lock_release(&enc->lock);
+}
+
+// Writes out anything pending, along with the index. Events that show
+// up afterward still get recorded; the index just won't cover them.
+void
+n00b_capture_encoder_finish(n00b_capture_encoder_t *enc)
+{
+    n00b_lock_acquire(&enc->lock);
+    flush_block(enc);
+
+    if (!enc->index_len) {
+        n00b_lock_release(&enc->lock);
+        return;
+    }
+
+    int64_t     len = 8 + enc->index_len * 16 + 16;
+    n00b_buf_t *b   = n00b_new(n00b_type_buffer(), length : len);
+    char       *p   = b->data;
+
+    p = le32(p, N00B_CAPTURE_INDEX_MAGIC);
+    p = le32(p, enc->index_len);
+
+    for (int i = 0; i < enc->index_len; i++) {
+        p = le64(p, enc->index[i * 2]);
+        p = le64(p, enc->index[i * 2 + 1]);
+    }
+
+    p = le64(p, enc->offset);
+    p = le64(p, N00B_CAPTURE_TRAILER_MAGIC);
+
+    write_out(enc, b);
+    n00b_lock_release(&enc->lock);
+}
+
+static inline void
+add_capture_payload_ansi(n00b_capture_encoder_t *enc, n00b_list_t *anodes)
+{
+    put_str(enc, n00b_ansi_nodes_to_string(anodes, true));
 }
 
 static inline void
-add_capture_spawn(n00b_cap_spawn_info_t *si, n00b_stream_t *strm)
+add_capture_winch(n00b_capture_encoder_t *enc, struct winsize *dims)
 {
-    add_capture_payload_str(si->command, strm);
+    put_varint(enc, dims->ws_row);
+    put_varint(enc, dims->ws_col);
+    put_varint(enc, dims->ws_xpixel);
+    put_varint(enc, dims->ws_ypixel);
+}
 
-    int32_t     n = si->args ? n00b_list_len(si->args) : 0;
-    n00b_buf_t *b = n00b_new(n00b_type_buffer(), length : sizeof(uint32_t));
+static inline void
+add_capture_spawn(n00b_capture_encoder_t *enc, n00b_cap_spawn_info_t *si)
+{
+    put_str(enc, si->command);
 
-    *(int32_t *)b->data = n;
-    n00b_stream_unfiltered_write(strm, b);
+    int32_t n = si->args ? n00b_list_len(si->args) : 0;
+
+    put_varint(enc, n);
 
     for (int i = 0; i < n; i++) {
-        n00b_string_t *s = n00b_list_get(si->args, i, NULL);
-        add_capture_payload_str(s, strm);
+        put_str(enc, n00b_list_get(si->args, i, NULL));
     }
 }
 
-typedef struct cap_cookie_t {
-    n00b_stream_t *s;
-} cap_cookie_t;
+static void *idle_flush(n00b_capture_encoder_t *);
 
-static n00b_list_t *
-n00b_capture_encode(cap_cookie_t *cookie, n00b_cap_event_t *event)
+// Writing a block can wait on I/O that the dispatcher itself
+// services, so the flush runs on its own thread, not in the timer.
+static inline void
+arm_idle_flush(n00b_capture_encoder_t *enc, int64_t ns)
 {
-    n00b_stream_t *stream = cookie->s;
-    n00b_list_t   *result = n00b_list(n00b_type_ref());
+    n00b_run_after(ns, (void *)idle_flush, enc);
+}
 
-    if (!event) {
-        return result;
+static void *
+idle_flush(n00b_capture_encoder_t *enc)
+{
+    n00b_lock_acquire(&enc->lock);
+
+    if (enc->num_events) {
+        int64_t age = n00b_ns_timestamp() - enc->block_opened;
+
+        // If it's a newer block than the one we were set for, wait
+        // for that one to age.
+        if (age < N00B_CAPTURE_BLOCK_NSEC) {
+            arm_idle_flush(enc, N00B_CAPTURE_BLOCK_NSEC - age);
+            n00b_lock_release(&enc->lock);
+            return NULL;
+        }
+
+        flush_block(enc);
     }
 
-    n00b_list_append(result, event);
+    atomic_store(&enc->timer_armed, false);
+    n00b_lock_release(&enc->lock);
 
-    if (!event->id) {
-        write_capture_header(stream);
+    return NULL;
+}
+
+static void
+encode_event(n00b_capture_encoder_t *enc, n00b_cap_event_t *event)
+{
+    int64_t ts = n00b_ns_from_duration(event->timestamp);
+
+    if (!enc->num_events) {
+        enc->first_id     = event->id;
+        enc->first_ts     = ts;
+        enc->last_ts      = ts;
+        enc->block_opened = n00b_ns_timestamp();
+
+        bool expected = false;
+
+        if (CAS(&enc->timer_armed, &expected, true)) {
+            arm_idle_flush(enc, N00B_CAPTURE_BLOCK_NSEC);
+        }
     }
-    // Since captures may already take up a lot of space, we are going to
-    // avoid a full marshal and do a somewhat more compact encoding. At some
-    // point we should hook up compression too.
-    add_record_header(event, stream);
+
+    int64_t delta = ts - enc->last_ts;
+
+    put_varint(enc, (uint16_t)event->kind);
+    put_varint(enc, event->id - enc->first_id);
+    put_varint(enc, (uint64_t)((delta << 1) ^ (delta >> 63)));
+
+    enc->last_ts = ts;
+    enc->num_events++;
 
     switch (event->kind) {
     case N00B_CAPTURE_STDIN:
     case N00B_CAPTURE_CMD_RUN:
-        add_capture_payload_str(event->contents, stream);
+        put_str(enc, event->contents);
         break;
     case N00B_CAPTURE_INJECTED:
     case N00B_CAPTURE_STDOUT:
     case N00B_CAPTURE_STDERR:
-        add_capture_payload_ansi(event->contents, stream);
+        add_capture_payload_ansi(enc, event->contents);
         break;
     case N00B_CAPTURE_WINCH:
-        add_capture_winch(event->contents, stream);
+        add_capture_winch(enc, event->contents);
         break;
     case N00B_CAPTURE_SPAWN:
-        add_capture_spawn(event->contents, stream);
+        add_capture_spawn(enc, event->contents);
         break;
     default:
         break;
     }
 
-    return result;
+    if (enc->block_len >= N00B_CAPTURE_BLOCK_SIZE
+        || n00b_ns_timestamp() - enc->block_opened
+               >= N00B_CAPTURE_BLOCK_NSEC) {
+        flush_block(enc);
+    }
+}
+
+typedef struct cap_cookie_t {
+    n00b_session_t *session;
+} cap_cookie_t;
+
+static void
+n00b_capture_encode(cap_cookie_t      *cookie,
+                    n00b_cap_event_t  *event,
+                    n00b_filter_out_t *out)
+{
+    n00b_session_t         *session = cookie->session;
+    n00b_capture_encoder_t *enc     = session->cap_encoder;
+
+    n00b_lock_acquire(&enc->lock);
+
+    if (!event) {
+        flush_block(enc);
+    }
+    else {
+        if (!enc->wrote_header) {
+            write_capture_header(enc, session->start_time);
+        }
+
+        encode_event(enc, event);
+    }
+
+    n00b_lock_release(&enc->lock);
 }
 
 static void *
-cap_encode_setup(cap_cookie_t *ctx, n00b_stream_t *stream)
+cap_encode_setup(cap_cookie_t *ctx, n00b_session_t *session)
 {
-    ctx->s = stream;
+    ctx->session = session;
 
     return NULL;
 }
 
+// The encoder writes straight to the underlying stream, and doesn't
+// pass anything on.
 static n00b_filter_impl cap_encode = {
-    .cookie_size = sizeof(cap_cookie_t),
-    .setup_fn    = (void *)cap_encode_setup,
-    .write_fn    = (void *)n00b_capture_encode,
-    .name        = NULL,
+    .cookie_size   = sizeof(cap_cookie_t),
+    .setup_fn      = (void *)cap_encode_setup,
+    .push_write_fn = (void *)n00b_capture_encode,
+    .push_flush_fn = (void *)n00b_capture_encode,
+    .name          = NULL,
 };
 
 static inline n00b_filter_spec_t *
-n00b_capture_encoder(n00b_stream_t *param)
+n00b_capture_encoder(n00b_session_t *param)
 {
     if (!cap_encode.name) {
         cap_encode.name = n00b_cstring("capture-encoder");
@@ -158,6 +452,7 @@ n00b_capture_encoder(n00b_stream_t *param)
 
     return result;
 }
+
 void
 n00b_session_capture(n00b_session_t *s, n00b_capture_t kind, void *contents)
 {
@@ -225,8 +520,13 @@ n00b_setup_capture(n00b_session_t *s, n00b_stream_t *target, int policy)
     n00b_stream_t *p  = n00b_new_stream_proxy(target);
     s->capture_stream = p;
     s->capture_policy = policy;
+    s->cap_encoder    = n00b_gc_alloc_mapped(n00b_capture_encoder_t,
+                                          N00B_GC_SCAN_ALL);
 
-    n00b_filter_add(p, n00b_capture_encoder(p));
+    s->cap_encoder->target = target;
+    n00b_named_lock_init(&s->cap_encoder->lock, N00B_NLT_MUTEX, "capture");
+
+    n00b_filter_add(p, n00b_capture_encoder(s));
 
     n00b_signal_register(SIGWINCH, (void *)record_winch, s);
 }
@@ -251,6 +551,10 @@ n00b_capture_launch(n00b_session_t *s, n00b_string_t *cmd, n00b_list_t *args)
 void
 n00b_session_finish_capture(n00b_session_t *session)
 {
+    if (session->cap_encoder) {
+        n00b_capture_encoder_finish(session->cap_encoder);
+    }
+
     if (session->saved_capture) {
         n00b_close(session->saved_capture);
     }
@@ -267,6 +571,10 @@ n00b_session_pause_recording(n00b_session_t *s)
     s->saved_capture = atomic_read(&s->capture_stream);
 
     CAS(&s->capture_stream, &s->saved_capture, NULL);
+
+    if (s->cap_encoder) {
+        n00b_capture_encoder_flush(s->cap_encoder);
+    }
 }
 
 void
@@ -0,0 +1,355 @@
+// Incremental trigger matching for sessions.
+//
+// Match buffers only ever grow, until a trigger fires and they get
+// truncated. Previously, every time output arrived, each trigger
+// searched the entire buffer again, which is quadratic in the amount
+// of output a process produces before something matches.
+//
+// Instead, for each (state, capture kind) pair, we compile the
+// state's triggers into a matcher that remembers how far into the
+// buffer it's gotten:
+//
+// - All substring triggers go into a single Aho-Corasick automaton
+//   (with the transitions fully expanded, so it's one table lookup per
+//   byte). We feed it only the bytes that arrived since the last scan,
+//   and record where each trigger's first occurrence ends.
+//
+// - Pattern triggers each keep a resume offset; see
+//   n00b_regex_search_incremental(). pcre2 has no notion of a regex
+//   set, but partial matching gets us the property we care about,
+//   which is that each byte of output only gets looked at a bounded
+//   number of times.
+//
+// Trigger priority doesn't change: the caller still walks the
+// triggers in order, and asks the matcher about each one, so the
+// first trigger in the list with a match wins, no matter where in the
+// buffer its match is.
+//
+// All offsets in here are byte offsets; the trigger code works in
+// codepoints, so we convert on the way out.
+
+#define N00B_USE_INTERNAL_API
+#include "n00b.h"
+
+#define AC_NO_HIT -1
+
+struct n00b_trigger_matcher_t {
+    n00b_session_state_t *state;
+    n00b_capture_t        kind;
+    // Number of triggers in the state when we compiled; if triggers
+    // get added, we recompile.
+    int32_t               num_triggers;
+    // The automaton. delta has 256 entries per node.
+    int32_t              *delta;
+    int32_t              *out;      // First trigger ending at a node.
+    int32_t              *dict;     // Next node on the fail chain w/ output.
+    int32_t              *out_next; // Next trigger ending at the same node.
+    int32_t               num_substrings;
+    // Scan state.
+    uint64_t              epoch;
+    int64_t               scanned;
+    int32_t               ac_state;
+    int32_t               unhit;
+    int64_t              *hit_end; // Per trigger.
+    int64_t              *resume;  // Per trigger.
+};
+
+static inline bool
+wants_trigger(n00b_trigger_t *t, n00b_capture_t kind)
+{
+    return t->target == kind
+        && (t->kind == N00B_TRIGGER_SUBSTRING
+            || t->kind == N00B_TRIGGER_PATTERN);
+}
+
+static void
+build_automaton(n00b_trigger_matcher_t *m, n00b_list_t *triggers)
+{
+    int32_t n         = m->num_triggers;
+    int32_t max_nodes = 1;
+
+    for (int32_t i = 0; i < n; i++) {
+        n00b_trigger_t *t = n00b_list_get(triggers, i, NULL);
+
+        if (wants_trigger(t, m->kind) && t->kind == N00B_TRIGGER_SUBSTRING) {
+            max_nodes += t->match_info.substring->u8_bytes;
+        }
+    }
+
+    m->delta    = n00b_gc_array_value_alloc(int32_t, max_nodes * 256);
+    m->out      = n00b_gc_array_value_alloc(int32_t, max_nodes);
+    m->dict     = n00b_gc_array_value_alloc(int32_t, max_nodes);
+    m->out_next = n00b_gc_array_value_alloc(int32_t, n);
+
+    for (int32_t i = 0; i < max_nodes; i++) {
+        m->out[i]  = -1;
+        m->dict[i] = -1;
+    }
+
+    // Build the trie. While building, a 0 transition means "no
+    // edge", which is unambiguous since nothing points back to the
+    // root.
+    int32_t num_nodes = 1;
+
+    for (int32_t i = 0; i < n; i++) {
+        n00b_trigger_t *t = n00b_list_get(triggers, i, NULL);
+
+        m->out_next[i] = -1;
+
+        if (!wants_trigger(t, m->kind) || t->kind != N00B_TRIGGER_SUBSTRING) {
+            continue;
+        }
+
+        n00b_string_t *sub = t->match_info.substring;
+
+        m->num_substrings++;
+
+        // Empty substrings match immediately; they're handled on
+        // reset, not by the automaton.
+        if (!sub->u8_bytes) {
+            continue;
+        }
+
+        int32_t node = 0;
+
+        for (int j = 0; j < sub->u8_bytes; j++) {
+            int32_t *slot = &m->delta[node * 256 + (uint8_t)sub->data[j]];
+
+            if (!*slot) {
+                *slot = num_nodes++;
+            }
+            node = *slot;
+        }
+
+        m->out_next[i] = m->out[node];
+        m->out[node]   = i;
+    }
+
+    // Breadth-first, compute fail links and fill in the missing
+    // transitions. We don't need to keep the fail links themselves,
+    // only the output chain they imply.
+    int32_t *fail  = n00b_gc_array_value_alloc(int32_t, num_nodes);
+    int32_t *queue = n00b_gc_array_value_alloc(int32_t, num_nodes);
+    int32_t  head  = 0;
+    int32_t  tail  = 0;
+
+    for (int b = 0; b < 256; b++) {
+        int32_t child = m->delta[b];
+
+        if (child) {
+            fail[child]    = 0;
+            queue[tail++] = child;
+        }
+    }
+
+    while (head < tail) {
+        int32_t node = queue[head++];
+
+        for (int b = 0; b < 256; b++) {
+            int32_t *slot = &m->delta[node * 256 + b];
+            int32_t  f    = m->delta[fail[node] * 256 + b];
+
+            if (!*slot) {
+                *slot = f;
+                continue;
+            }
+
+            int32_t child = *slot;
+
+            fail[child]    = f;
+            m->dict[child] = m->out[f] != -1 ? f : m->dict[f];
+            queue[tail++]  = child;
+        }
+    }
+}
+
+static void
+reset_scan(n00b_trigger_matcher_t *m, n00b_session_t *s)
+{
+    n00b_list_t *triggers = (n00b_list_t *)m->state;
+
+    m->epoch    = s->match_epoch;
+    m->scanned  = 0;
+    m->ac_state = 0;
+    m->unhit    = 0;
+
+    for (int32_t i = 0; i < m->num_triggers; i++) {
+        n00b_trigger_t *t = n00b_list_get(triggers, i, NULL);
+
+        m->hit_end[i] = AC_NO_HIT;
+        m->resume[i]  = 0;
+
+        if (!wants_trigger(t, m->kind) || t->kind != N00B_TRIGGER_SUBSTRING) {
+            continue;
+        }
+
+        if (!t->match_info.substring->u8_bytes) {
+            m->hit_end[i] = 0;
+        }
+        else {
+            m->unhit++;
+        }
+    }
+}
+
+static n00b_trigger_matcher_t *
+compile_matcher(n00b_session_t       *s,
+                n00b_session_state_t *state,
+                n00b_capture_t        kind)
+{
+    n00b_trigger_matcher_t *m = n00b_gc_alloc_mapped(n00b_trigger_matcher_t,
+                                                     N00B_GC_SCAN_ALL);
+    int32_t                 n = n00b_list_len((n00b_list_t *)state);
+
+    m->state        = state;
+    m->kind         = kind;
+    m->num_triggers = n;
+    m->hit_end      = n00b_gc_array_value_alloc(int64_t, n);
+    m->resume       = n00b_gc_array_value_alloc(int64_t, n);
+
+    build_automaton(m, (n00b_list_t *)state);
+    reset_scan(m, s);
+
+    return m;
+}
+
+// Feed the automaton whatever arrived since the last call.
+static void
+scan_new_bytes(n00b_trigger_matcher_t *m, n00b_string_t *str)
+{
+    uint8_t *data  = (uint8_t *)str->data;
+    int64_t  len   = str->u8_bytes;
+    int32_t  state = m->ac_state;
+
+    if (!m->unhit) {
+        m->scanned = len;
+        return;
+    }
+
+    for (int64_t p = m->scanned; p < len; p++) {
+        state = m->delta[state * 256 + data[p]];
+
+        int32_t node = m->out[state] != -1 ? state : m->dict[state];
+
+        while (node > 0) {
+            for (int32_t i = m->out[node]; i != -1; i = m->out_next[i]) {
+                if (m->hit_end[i] == AC_NO_HIT) {
+                    m->hit_end[i] = p + 1;
+                    m->unhit--;
+                }
+            }
+            node = m->dict[node];
+        }
+    }
+
+    m->ac_state = state;
+    m->scanned  = len;
+}
+
+// Returns the matcher for the given state and kind, brought up to
+// date w/ the contents of 'str'.
+n00b_trigger_matcher_t *
+n00b_get_trigger_matcher(n00b_session_t       *s,
+                         n00b_session_state_t *state,
+                         n00b_string_t        *str,
+                         n00b_capture_t        kind)
+{
+    n00b_trigger_matcher_t *m = NULL;
+    int                     n;
+
+    if (!s->trigger_matchers) {
+        s->trigger_matchers = n00b_list(n00b_type_ref());
+    }
+
+    n = n00b_list_len(s->trigger_matchers);
+
+    for (int i = 0; i < n; i++) {
+        n00b_trigger_matcher_t *cur = n00b_list_get(s->trigger_matchers,
+                                                    i,
+                                                    NULL);
+
+        if (cur->state == state && cur->kind == kind) {
+            m = cur;
+            if (m->num_triggers != n00b_list_len((n00b_list_t *)state)) {
+                m = compile_matcher(s, state, kind);
+                n00b_list_set(s->trigger_matchers, i, m);
+            }
+            break;
+        }
+    }
+
+    if (!m) {
+        m = compile_matcher(s, state, kind);
+        n00b_private_list_append(s->trigger_matchers, m);
+    }
+
+    // Buffers only get replaced wholesale on truncation, which bumps
+    // the epoch. The length check is a backstop for anyone resetting
+    // a buffer directly.
+    if (m->epoch != s->match_epoch || !str || str->u8_bytes < m->scanned) {
+        reset_scan(m, s);
+    }
+
+    if (str) {
+        scan_new_bytes(m, str);
+    }
+
+    return m;
+}
+
+static inline int64_t
+byte_to_cp_offset(n00b_string_t *str, int64_t byte_offset)
+{
+    int64_t result = 0;
+
+    for (int64_t i = 0; i < byte_offset; i++) {
+        if ((str->data[i] & 0xc0) != 0x80) {
+            result++;
+        }
+    }
+
+    return result;
+}
+
+// Checks whether trigger 'ix' (which must be a substring or pattern
+// trigger for the matcher's kind) matches. If so, '*last' gets the
+// codepoint offset just past the match, and '*match' gets what gets
+// handed to the trigger's callback.
+bool
+n00b_trigger_matcher_check(n00b_trigger_matcher_t *m,
+                           n00b_string_t          *str,
+                           int                     ix,
+                           int64_t                *last,
+                           void                  **match)
+{
+    n00b_list_t    *triggers = (n00b_list_t *)m->state;
+    n00b_trigger_t *t        = n00b_list_get(triggers, ix, NULL);
+
+    if (!str) {
+        return false;
+    }
+
+    if (t->kind == N00B_TRIGGER_SUBSTRING) {
+        if (m->hit_end[ix] == AC_NO_HIT) {
+            return false;
+        }
+
+        *last  = byte_to_cp_offset(str, m->hit_end[ix]);
+        *match = t->match_info.substring;
+
+        return true;
+    }
+
+    n00b_match_t *found = n00b_regex_search_incremental(t->match_info.regexp,
+                                                        str,
+                                                        &m->resume[ix]);
+
+    if (!found) {
+        return false;
+    }
+
+    *last  = byte_to_cp_offset(str, found->end);
+    *match = found;
+
+    return true;
+}
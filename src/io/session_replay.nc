@@ -1,106 +1,641 @@
 #define N00B_USE_INTERNAL_API
 #include "n00b.h"
 
+// Capture files get mapped into memory when possible (and read in
+// whole when not), so decoding events never goes back to the file.
+// See src/io/session_capture.nc for the format. We also still read
+// the original format, which has no blocks or index; seeking there
+// means decoding from the start.
+
+struct n00b_capture_reader_t {
+    char            *data;
+    int64_t          len;
+    int              version;
+    bool             mapped;
+    n00b_duration_t *start;
+    int64_t         *block_offsets;
+    int64_t         *block_ts;
+    int32_t          num_blocks;
+    int32_t          next_block;
+    char            *block; // Decompressed events for the current block.
+    int64_t          block_len;
+    int64_t          pos; // Into 'block' for v2, or 'data' for v1.
+    uint32_t         first_id;
+    int64_t          prev_ts;
+};
+
+static inline bool
+get_u32(n00b_capture_reader_t *r, int64_t offset, uint32_t *out)
+{
+    if (offset < 0 || offset + (int64_t)sizeof(uint32_t) > r->len) {
+        return false;
+    }
+
+    memcpy(out, r->data + offset, sizeof(uint32_t));
+    little_32(*out);
+
+    return true;
+}
+
 static inline bool
-read_capture_magic(n00b_stream_t *s)
-{
-    char              buf[8];
-    n00b_fd_cookie_t *cookie   = n00b_get_stream_cookie(s);
-    const int64_t     expected = N00B_SESSION_MAGIC;
-    int               r        = 0;
-    int64_t          *magic    = (int64_t *)&buf[0];
-
-    while (r < 8) {
-        int x = read(cookie->stream->fd, buf + r, sizeof(int64_t));
-        if (x == -1) {
-            n00b_raise_errno();
+get_u64(n00b_capture_reader_t *r, int64_t offset, uint64_t *out)
+{
+    if (offset < 0 || offset + (int64_t)sizeof(uint64_t) > r->len) {
+        return false;
+    }
+
+    memcpy(out, r->data + offset, sizeof(uint64_t));
+    little_64(*out);
+
+    return true;
+}
+
+static bool
+load_file(n00b_capture_reader_t *r, int fd)
+{
+    struct stat info;
+
+    if (fstat(fd, &info) || !info.st_size) {
+        return false;
+    }
+
+    r->len  = info.st_size;
+    r->data = mmap(NULL, r->len, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (r->data != MAP_FAILED) {
+        r->mapped = true;
+        return true;
+    }
+
+    r->data    = n00b_gc_array_value_alloc(char, r->len);
+    int64_t nr = 0;
+
+    while (nr < r->len) {
+        ssize_t n = pread(fd, r->data + nr, r->len - nr, nr);
+
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            return false;
         }
-        r += x;
+        nr += n;
     }
 
-    return *magic == expected;
+    return true;
 }
 
-static inline n00b_duration_t *
-read_timestamp(n00b_stream_t *s, double scale)
+static void
+add_block(n00b_capture_reader_t *r, int64_t offset, int64_t ts, int *alloc)
 {
-    n00b_fd_cookie_t *cookie = n00b_get_stream_cookie(s);
-    char              buf[sizeof(n00b_duration_t)];
+    if (r->num_blocks == *alloc) {
+        int      n  = n00b_max(*alloc << 1, 64);
+        int64_t *bo = n00b_gc_array_value_alloc(int64_t, n);
+        int64_t *bt = n00b_gc_array_value_alloc(int64_t, n);
+
+        if (r->num_blocks) {
+            memcpy(bo, r->block_offsets, r->num_blocks * sizeof(int64_t));
+            memcpy(bt, r->block_ts, r->num_blocks * sizeof(int64_t));
+        }
 
-    read(cookie->stream->fd, buf, sizeof(n00b_duration_t));
+        r->block_offsets = bo;
+        r->block_ts      = bt;
+        *alloc           = n;
+    }
 
-    return n00b_duration_multiply((n00b_duration_t *)&buf[0], scale);
+    r->block_offsets[r->num_blocks] = offset;
+    r->block_ts[r->num_blocks]      = ts;
+    r->num_blocks++;
 }
 
-static inline int32_t
-read_capture_int32(n00b_stream_t *s)
+// Use the index if the capture has one at the end.
+static bool
+read_index(n00b_capture_reader_t *r)
 {
-    n00b_fd_cookie_t *cookie = n00b_get_stream_cookie(s);
-    char              buf[sizeof(int32_t)];
-    read(cookie->stream->fd, buf, sizeof(int32_t));
+    uint64_t magic;
+    uint64_t idx;
+    uint32_t word;
+    uint32_t count;
+    int      alloc = 0;
+
+    if (!get_u64(r, r->len - 8, &magic)
+        || magic != (uint64_t)N00B_CAPTURE_TRAILER_MAGIC
+        || !get_u64(r, r->len - 16, &idx) || !get_u32(r, idx, &word)
+        || word != N00B_CAPTURE_INDEX_MAGIC || !get_u32(r, idx + 4, &count)
+        || (int64_t)idx + 8 + (int64_t)count * 16 + 16 != r->len) {
+        return false;
+    }
 
-    int32_t result = *(int32_t *)&buf[0];
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t offset;
+        uint64_t ts;
+
+        get_u64(r, idx + 8 + i * 16, &offset);
+        get_u64(r, idx + 16 + i * 16, &ts);
+        add_block(r, offset, ts, &alloc);
+    }
+
+    return true;
+}
+
+// Otherwise, walk the block headers. A truncated block at the end
+// (from a capture that didn't get to finish) gets ignored.
+static void
+scan_blocks(n00b_capture_reader_t *r)
+{
+    int64_t  pos   = N00B_CAPTURE_HEADER_LEN;
+    int      alloc = 0;
+    uint32_t magic;
+    uint32_t n;
+    uint64_t ts;
+
+    while (get_u32(r, pos, &magic)) {
+        if (magic == N00B_CAPTURE_INDEX_MAGIC) {
+            if (!get_u32(r, pos + 4, &n)) {
+                return;
+            }
+            pos += 8 + (int64_t)n * 16 + 16;
+            continue;
+        }
+
+        if (magic != N00B_CAPTURE_BLOCK_MAGIC
+            || pos + N00B_CAPTURE_BLOCK_HDR_LEN > r->len
+            || !get_u32(r, pos + 12, &n)
+            || pos + N00B_CAPTURE_BLOCK_HDR_LEN + n > r->len) {
+            return;
+        }
+
+        get_u64(r, pos + 24, &ts);
+        add_block(r, pos, ts, &alloc);
+        pos += N00B_CAPTURE_BLOCK_HDR_LEN + n;
+    }
+}
+
+static inline n00b_duration_t *
+ns_to_duration(int64_t ns)
+{
+    n00b_duration_t *result = n00b_new(n00b_type_duration());
+
+    result->tv_sec  = ns / N00B_NSEC_PER_SEC;
+    result->tv_nsec = ns % N00B_NSEC_PER_SEC;
 
     return result;
 }
 
-static inline int
-read_event_type(n00b_stream_t *s)
+static bool
+parse_header(n00b_capture_reader_t *r)
+{
+    uint64_t magic;
+    uint32_t version;
+    uint64_t sec;
+    uint64_t nsec;
+
+    if (!get_u64(r, 0, &magic)) {
+        return false;
+    }
+
+    if (magic == (uint64_t)N00B_SESSION_MAGIC) {
+        if (r->len < (int64_t)(8 + sizeof(n00b_duration_t))) {
+            return false;
+        }
+
+        r->version = 1;
+        r->start   = n00b_new(n00b_type_duration());
+        r->pos     = 8 + sizeof(n00b_duration_t);
+
+        memcpy(r->start, r->data + 8, sizeof(n00b_duration_t));
+
+        return true;
+    }
+
+    if (magic != (uint64_t)N00B_CAPTURE_MAGIC || !get_u32(r, 8, &version)
+        || version != N00B_CAPTURE_VERSION || !get_u64(r, 16, &sec)
+        || !get_u64(r, 24, &nsec)) {
+        return false;
+    }
+
+    r->version = N00B_CAPTURE_VERSION;
+    r->start   = n00b_new(n00b_type_duration());
+
+    r->start->tv_sec  = sec;
+    r->start->tv_nsec = nsec;
+
+    if (!read_index(r)) {
+        scan_blocks(r);
+    }
+
+    return true;
+}
+
+// Returns NULL if the stream isn't a capture file we understand.
+n00b_capture_reader_t *
+n00b_capture_reader_open(n00b_stream_t *s)
 {
-    n00b_fd_cookie_t *cookie = n00b_get_stream_cookie(s);
-    uint16_t          result;
+    if (!s->fd_backed) {
+        return NULL;
+    }
+
+    n00b_fd_cookie_t      *cookie = n00b_get_stream_cookie(s);
+    n00b_capture_reader_t *result;
 
-    read(cookie->stream->fd, &result, 2);
+    result = n00b_gc_alloc_mapped(n00b_capture_reader_t, N00B_GC_SCAN_ALL);
+
+    if (!load_file(result, cookie->stream->fd) || !parse_header(result)) {
+        n00b_capture_reader_close(result);
+        return NULL;
+    }
 
     return result;
 }
 
-static inline n00b_string_t *
-read_capture_payload_str(n00b_stream_t *s)
+void
+n00b_capture_reader_close(n00b_capture_reader_t *r)
+{
+    if (r->mapped) {
+        munmap(r->data, r->len);
+        r->mapped = false;
+    }
+
+    r->data       = NULL;
+    r->len        = 0;
+    r->block      = NULL;
+    r->block_len  = 0;
+    r->pos        = 0;
+    r->num_blocks = 0;
+}
+
+static bool
+load_block(n00b_capture_reader_t *r, int32_t ix)
 {
-    n00b_buf_t *sbuf;
-    int64_t     len;
+    int64_t  offset = r->block_offsets[ix];
+    uint32_t flags;
+    uint32_t raw_len;
+    uint32_t stored_len;
+    uint64_t ts;
+
+    if (!get_u32(r, offset + 4, &flags) || !get_u32(r, offset + 8, &raw_len)
+        || !get_u32(r, offset + 12, &stored_len)
+        || !get_u32(r, offset + 16, &r->first_id)
+        || !get_u64(r, offset + 24, &ts)
+        || offset + N00B_CAPTURE_BLOCK_HDR_LEN + stored_len > r->len) {
+        return false;
+    }
+
+    char *src = r->data + offset + N00B_CAPTURE_BLOCK_HDR_LEN;
+
+    if (flags & N00B_CAPTURE_BLOCK_COMPRESSED) {
+        r->block = n00b_gc_array_value_alloc(char, raw_len);
+
+        if (n00b_lz_decompress_raw(src, stored_len, r->block, raw_len)
+            != raw_len) {
+            return false;
+        }
+    }
+    else {
+        if (stored_len != raw_len) {
+            return false;
+        }
+        r->block = src;
+    }
 
-    sbuf = n00b_stream_unfiltered_read(s, 4);
-    len  = *(int32_t *)sbuf->data;
-    sbuf = n00b_stream_unfiltered_read(s, len);
+    r->block_len  = raw_len;
+    r->pos        = 0;
+    r->prev_ts    = ts;
+    r->next_block = ix + 1;
 
-    return n00b_buf_to_string(sbuf);
+    return true;
 }
 
-static inline n00b_list_t *
-read_ansi_payload_str(n00b_stream_t *s)
+typedef struct {
+    char *p;
+    char *end;
+} cap_cursor_t;
+
+static inline bool
+get_varint(cap_cursor_t *c, uint64_t *out)
 {
-    n00b_string_t *str = read_capture_payload_str(s);
-    return n00b_string_to_ansi_node_list(str);
+    uint64_t result = 0;
+    int      shift  = 0;
+
+    while (c->p < c->end && shift < 64) {
+        uint8_t b = *(uint8_t *)c->p++;
+
+        result |= (uint64_t)(b & 0x7f) << shift;
+
+        if (!(b & 0x80)) {
+            *out = result;
+            return true;
+        }
+        shift += 7;
+    }
+
+    return false;
 }
 
-static inline struct winsize *
-read_winch_payload(n00b_stream_t *s)
+static inline n00b_string_t *
+get_str(cap_cursor_t *c)
 {
-    const int64_t len  = sizeof(struct winsize *);
-    n00b_buf_t   *sbuf = n00b_stream_unfiltered_read(s, len);
+    uint64_t len;
+
+    if (!get_varint(c, &len) || len > (uint64_t)(c->end - c->p)) {
+        return NULL;
+    }
+
+    n00b_string_t *result = n00b_utf8(c->p, len);
+    c->p += len;
 
-    return (struct winsize *)sbuf->data;
+    return result;
 }
 
-static inline n00b_cap_spawn_info_t *
-read_spawn_payload(n00b_stream_t *s)
+static n00b_cap_spawn_info_t *
+get_spawn(cap_cursor_t *c)
 {
     n00b_cap_spawn_info_t *result = n00b_gc_alloc_mapped(n00b_cap_spawn_info_t,
                                                          N00B_GC_SCAN_ALL);
+    uint64_t               n;
 
-    result->command = read_capture_payload_str(s);
-    int n           = read_capture_int32(s);
+    result->command = get_str(c);
     result->args    = n00b_list(n00b_type_string());
 
-    for (int i = 0; i < n; i++) {
-        n00b_list_append(result->args, read_capture_payload_str(s));
+    if (!result->command || !get_varint(c, &n)) {
+        return NULL;
+    }
+
+    for (uint64_t i = 0; i < n; i++) {
+        n00b_string_t *arg = get_str(c);
+
+        if (!arg) {
+            return NULL;
+        }
+        n00b_list_append(result->args, arg);
     }
 
     return result;
 }
 
+static struct winsize *
+get_winch(cap_cursor_t *c)
+{
+    struct winsize *result = n00b_gc_alloc_mapped(struct winsize,
+                                                  N00B_GC_SCAN_ALL);
+    uint64_t        v[4];
+
+    for (int i = 0; i < 4; i++) {
+        if (!get_varint(c, &v[i])) {
+            return NULL;
+        }
+    }
+
+    result->ws_row    = v[0];
+    result->ws_col    = v[1];
+    result->ws_xpixel = v[2];
+    result->ws_ypixel = v[3];
+
+    return result;
+}
+
+static n00b_cap_event_t *
+next_v2(n00b_capture_reader_t *r, int64_t *ts)
+{
+    while (r->pos >= r->block_len) {
+        if (r->next_block >= r->num_blocks
+            || !load_block(r, r->next_block)) {
+            return NULL;
+        }
+    }
+
+    cap_cursor_t c = {
+        .p   = r->block + r->pos,
+        .end = r->block + r->block_len,
+    };
+    uint64_t     kind;
+    uint64_t     id;
+    uint64_t     zz;
+
+    if (!get_varint(&c, &kind) || !get_varint(&c, &id)
+        || !get_varint(&c, &zz)) {
+        return NULL;
+    }
+
+    n00b_cap_event_t *result = n00b_gc_alloc_mapped(n00b_cap_event_t,
+                                                    N00B_GC_SCAN_ALL);
+
+    r->prev_ts += (int64_t)(zz >> 1) ^ -(int64_t)(zz & 1);
+    *ts          = r->prev_ts;
+    result->id   = r->first_id + id;
+    result->kind = kind;
+
+    switch (result->kind) {
+    case N00B_CAPTURE_STDIN:
+    case N00B_CAPTURE_CMD_RUN:
+        result->contents = get_str(&c);
+        break;
+    case N00B_CAPTURE_INJECTED:
+    case N00B_CAPTURE_STDOUT:
+    case N00B_CAPTURE_STDERR:
+        result->contents = get_str(&c);
+        if (result->contents) {
+            result->contents = n00b_string_to_ansi_node_list(result->contents);
+        }
+        break;
+    case N00B_CAPTURE_WINCH:
+        result->contents = get_winch(&c);
+        break;
+    case N00B_CAPTURE_SPAWN:
+        result->contents = get_spawn(&c);
+        break;
+    default:
+        r->pos = c.p - r->block;
+        return result;
+    }
+
+    if (!result->contents) {
+        return NULL;
+    }
+
+    r->pos = c.p - r->block;
+
+    return result;
+}
+
+static inline bool
+v1_take(n00b_capture_reader_t *r, void *out, int64_t n)
+{
+    if (r->pos + n > r->len) {
+        return false;
+    }
+
+    memcpy(out, r->data + r->pos, n);
+    r->pos += n;
+
+    return true;
+}
+
+static n00b_string_t *
+v1_str(n00b_capture_reader_t *r)
+{
+    uint32_t len;
+
+    if (!v1_take(r, &len, sizeof(uint32_t)) || r->pos + len > r->len) {
+        return NULL;
+    }
+
+    n00b_string_t *result = n00b_utf8(r->data + r->pos, len);
+    r->pos += len;
+
+    return result;
+}
+
+static n00b_cap_event_t *
+next_v1(n00b_capture_reader_t *r, int64_t *ts)
+{
+    n00b_cap_event_t *result = n00b_gc_alloc_mapped(n00b_cap_event_t,
+                                                    N00B_GC_SCAN_ALL);
+    n00b_duration_t   d;
+    uint16_t          kind;
+
+    if (!v1_take(r, &result->id, sizeof(uint32_t))
+        || !v1_take(r, &d, sizeof(n00b_duration_t))
+        || !v1_take(r, &kind, sizeof(uint16_t))) {
+        return NULL;
+    }
+
+    *ts          = n00b_ns_from_duration(&d);
+    result->kind = kind;
+
+    switch (result->kind) {
+    case N00B_CAPTURE_STDIN:
+    case N00B_CAPTURE_CMD_RUN:
+        result->contents = v1_str(r);
+        break;
+    case N00B_CAPTURE_INJECTED:
+    case N00B_CAPTURE_STDOUT:
+    case N00B_CAPTURE_STDERR:
+        result->contents = v1_str(r);
+        if (result->contents) {
+            result->contents = n00b_string_to_ansi_node_list(result->contents);
+        }
+        break;
+    case N00B_CAPTURE_WINCH:
+        result->contents = n00b_gc_alloc_mapped(struct winsize,
+                                                N00B_GC_SCAN_ALL);
+        if (!v1_take(r, result->contents, sizeof(struct winsize))) {
+            return NULL;
+        }
+        break;
+    case N00B_CAPTURE_SPAWN:;
+        n00b_cap_spawn_info_t *si = n00b_gc_alloc_mapped(n00b_cap_spawn_info_t,
+                                                         N00B_GC_SCAN_ALL);
+        uint32_t               n;
+
+        si->command = v1_str(r);
+        si->args    = n00b_list(n00b_type_string());
+
+        if (!si->command || !v1_take(r, &n, sizeof(uint32_t))) {
+            return NULL;
+        }
+
+        for (uint32_t i = 0; i < n; i++) {
+            n00b_string_t *arg = v1_str(r);
+            if (!arg) {
+                return NULL;
+            }
+            n00b_list_append(si->args, arg);
+        }
+
+        result->contents = si;
+        return result;
+    default:
+        return result;
+    }
+
+    if (!result->contents) {
+        return NULL;
+    }
+
+    return result;
+}
+
+// Returns NULL at the end of the capture. Timestamps get multiplied
+// by 'scale'.
+n00b_cap_event_t *
+n00b_capture_reader_next(n00b_capture_reader_t *r, double scale)
+{
+    n00b_cap_event_t *result;
+    int64_t           ts;
+
+    if (!r->data) {
+        return NULL;
+    }
+
+    if (r->version == 1) {
+        result = next_v1(r, &ts);
+    }
+    else {
+        result = next_v2(r, &ts);
+    }
+
+    if (!result || result->kind == N00B_CAPTURE_END) {
+        return NULL;
+    }
+
+    result->timestamp = n00b_duration_multiply(ns_to_duration(ts), scale);
+
+    return result;
+}
+
+// Positions the reader so that the next event returned is the first
+// one at or after 'when' (relative to the start of the session).
+void
+n00b_capture_reader_seek(n00b_capture_reader_t *r, n00b_duration_t *when)
+{
+    int64_t target = n00b_ns_from_duration(when);
+
+    if (!r->data) {
+        return;
+    }
+
+    if (r->version == 1) {
+        r->pos = 8 + sizeof(n00b_duration_t);
+    }
+    else {
+        // Find the last block that starts at or before the target.
+        int32_t lo = 0;
+        int32_t hi = r->num_blocks - 1;
+        int32_t ix = 0;
+
+        while (lo <= hi) {
+            int32_t mid = (lo + hi) / 2;
+
+            if (r->block_ts[mid] <= target) {
+                ix = mid;
+                lo = mid + 1;
+            }
+            else {
+                hi = mid - 1;
+            }
+        }
+
+        r->block      = NULL;
+        r->block_len  = 0;
+        r->pos        = 0;
+        r->next_block = ix;
+    }
+
+    while (true) {
+        n00b_capture_reader_t saved = *r;
+        n00b_cap_event_t     *e;
+        int64_t               ts;
+
+        e = r->version == 1 ? next_v1(r, &ts) : next_v2(r, &ts);
+
+        if (!e || ts >= target) {
+            *r = saved;
+            return;
+        }
+    }
+}
+
 static inline void
 make_gap_adjustment(n00b_log_cursor_t *cap, n00b_cap_event_t *cur)
 {
@@ -159,43 +694,6 @@ replay_one_event(n00b_session_t *session, n00b_cap_event_t *event)
     }
 }
 
-static inline n00b_cap_event_t *
-get_next_event(n00b_stream_t *s, double scale)
-{
-    if (n00b_stream_eof(s)) {
-        return NULL;
-    }
-    n00b_cap_event_t *result = n00b_gc_alloc_mapped(n00b_cap_event_t,
-                                                    N00B_GC_SCAN_ALL);
-    result->id               = read_capture_int32(s);
-    result->timestamp        = read_timestamp(s, scale);
-    result->kind             = read_event_type(s);
-
-    switch (result->kind) {
-    case N00B_CAPTURE_STDIN:
-    case N00B_CAPTURE_CMD_RUN:
-        result->contents = read_capture_payload_str(s);
-        break;
-    case N00B_CAPTURE_INJECTED:
-    case N00B_CAPTURE_STDOUT:
-    case N00B_CAPTURE_STDERR:
-        result->contents = read_ansi_payload_str(s);
-        break;
-    case N00B_CAPTURE_WINCH:
-        result->contents = read_winch_payload(s);
-        break;
-    case N00B_CAPTURE_SPAWN:
-        result->contents = read_spawn_payload(s);
-        break;
-    case N00B_CAPTURE_END:
-        return NULL;
-    default:
-        break;
-    }
-
-    return result;
-}
-
 static inline bool
 has_newline(n00b_cap_event_t *event)
 {
@@ -227,7 +725,7 @@ process_partial_replay(n00b_session_t *session)
     n00b_cap_event_t  *cur = cap->cache;
 
     if (!cur) {
-        cur = get_next_event(cap->log, cap->time_scale);
+        cur = n00b_capture_reader_next(cap->reader, cap->time_scale);
         if (!cur) {
             cap->finished = true;
             return false;
@@ -273,7 +771,7 @@ process_partial_replay(n00b_session_t *session)
             keep_going = !has_newline(cur);
         }
 
-        cur = get_next_event(cap->log, cap->time_scale);
+        cur = n00b_capture_reader_next(cap->reader, cap->time_scale);
 
         if (!cur) {
             cap->cache = NULL;
@@ -282,15 +780,35 @@ process_partial_replay(n00b_session_t *session)
     }
 }
 
+// Sleeps until the next event is due, unless a seek comes in first.
+static void
+wait_for_next_event(n00b_log_cursor_t *cap, int64_t ns)
+{
+    int64_t due = n00b_ns_timestamp() + ns;
+
+    while (!atomic_read(&cap->seek_target)) {
+        int64_t  left = due - n00b_ns_timestamp();
+        uint32_t seen = atomic_read(&cap->wakeup);
+
+        if (left <= 0 || atomic_read(&cap->seek_target)) {
+            return;
+        }
+
+        n00b_futex_wait(&cap->wakeup,
+                        seen,
+                        n00b_min(left, (int64_t)N00B_NSEC_PER_SEC - 1));
+    }
+}
+
 void *
 n00b_session_run_replay_loop(n00b_session_t *session)
 {
     n00b_log_cursor_t *cap = &session->log_cursor;
     n00b_stream_t     *log = cap->log;
 
-    n00b_stream_set_absolute_position(log, 0);
+    cap->reader = n00b_capture_reader_open(log);
 
-    if (!read_capture_magic(log)) {
+    if (!cap->reader) {
         n00b_string_t *err;
 
         err = n00b_cformat("Stream «em»«#»«/» is not a capture file.",
@@ -298,11 +816,11 @@ n00b_session_run_replay_loop(n00b_session_t *session)
         N00B_RAISE(err);
     }
 
-    n00b_duration_t *soff = read_timestamp(log, 1.0);
+    n00b_duration_t *soff = cap->reader->start;
     n00b_duration_t *now  = n00b_now();
+    n00b_duration_t *target;
     n00b_duration_t *dur;
     n00b_duration_t  wait;
-    n00b_duration_t  leftover;
 
     if (!cap->cursor) {
         cap->cursor = soff;
@@ -321,20 +839,29 @@ n00b_session_run_replay_loop(n00b_session_t *session)
 
         n00b_lock_release(&cap->unpause_notify);
 
-        now         = n00b_now();
+        now    = n00b_now();
+        target = atomic_exchange(&cap->seek_target, NULL);
+
+        // Rewind the clock so that the target is what's due now.
+        if (target) {
+            n00b_capture_reader_seek(cap->reader, target);
+            target = n00b_duration_multiply(target, cap->time_scale);
+
+            cap->cache          = NULL;
+            cap->absolute_start = n00b_duration_diff(now, target);
+        }
+
         dur         = n00b_duration_diff(cap->absolute_start, now);
         cap->cursor = n00b_duration_add(cap->absolute_start, dur);
 
         if (!process_partial_replay(session)) {
             cap->finished = true;
+            n00b_capture_reader_close(cap->reader);
             return NULL;
         }
 
         wait = *n00b_duration_diff(cap->cache->timestamp, dur);
-
-        while (!n00b_nanosleep_raw(&wait, &leftover)) {
-            wait = leftover;
-        }
+        wait_for_next_event(cap, n00b_ns_from_duration(&wait));
     }
 }
 
@@ -465,20 +992,18 @@ n00b_capture_stream_extractor(n00b_stream_t *stream, int events)
         N00B_CRAISE("Capture stream must be open and readable.");
     }
 
-    n00b_fd_cookie_t *cookie = n00b_get_stream_cookie(stream);
-    lseek(cookie->stream->fd, 0, SEEK_SET);
+    n00b_capture_reader_t *reader = n00b_capture_reader_open(stream);
 
-    if (!read_capture_magic(stream)) {
+    if (!reader) {
         N00B_CRAISE("Stream is not a capture file.");
     }
 
-    /*n00b_duration_t *soff   = */ read_timestamp(stream, 1.0);
-
     n00b_list_t *result = n00b_list(n00b_type_ref());
 
     while (true) {
-        n00b_cap_event_t *e = get_next_event(stream, 1.0);
+        n00b_cap_event_t *e = n00b_capture_reader_next(reader, 1.0);
         if (!e) {
+            n00b_capture_reader_close(reader);
             return result;
         }
 
@@ -488,6 +1013,23 @@ n00b_capture_stream_extractor(n00b_stream_t *stream, int events)
     }
 }
 
+// Jumps the replay to the given offset from the start of the
+// capture. If the replay is waiting for its next event, this wakes it
+// up; if it's paused, the seek happens once it resumes.
+void
+n00b_session_replay_seek(n00b_session_t *session, n00b_duration_t *when)
+{
+    n00b_log_cursor_t *cap = &session->log_cursor;
+
+    if (!cap->log) {
+        N00B_CRAISE("No replay session");
+    }
+
+    atomic_store(&cap->seek_target, when);
+    atomic_fetch_add(&cap->wakeup, 1);
+    n00b_futex_wake(&cap->wakeup, false);
+}
+
 void
 n00b_session_set_replay_stream(n00b_session_t *session, n00b_stream_t *s)
 {
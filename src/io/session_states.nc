@@ -216,6 +216,7 @@ n00b_truncate_all_match_data(n00b_session_t *s,
     else {
         s->stderr_match_buffer = NULL;
     }
+    s->match_epoch++;
     s->launch_command = NULL;
     s->got_user_input = false;
     s->got_injection  = false;
@@ -270,53 +271,16 @@ successful_match(n00b_session_t *session,
     }
 }
 
-static bool
-try_pattern_match(n00b_session_t *session,
-                  n00b_string_t  *str,
-                  n00b_trigger_t *trigger,
-                  n00b_capture_t  kind)
-{
-    n00b_regex_t *re    = trigger->match_info.regexp;
-    n00b_match_t *match = n00b_match(re, str);
-
-    if (!match) {
-        return false;
-    }
-    successful_match(session, trigger, str, match->end, kind, match);
-
-    return true;
-}
-
-static bool
-try_substring_match(n00b_session_t *session,
-                    n00b_string_t  *str,
-                    n00b_trigger_t *trigger,
-                    n00b_capture_t  kind)
-{
-    if (!str) {
-        return false;
-    }
-
-    n00b_string_t *sub   = trigger->match_info.substring;
-    int64_t        where = n00b_string_find(str, sub);
-
-    if (where == -1) {
-        return false;
-    }
-
-    int last = where + n00b_string_codepoint_len(sub);
-    successful_match(session, trigger, str, last, kind, sub);
-
-    return true;
-}
-
 static n00b_trigger_t *
 match_base(n00b_session_t       *s,
            n00b_string_t        *str,
            n00b_capture_t        kind,
            n00b_session_state_t *l)
 {
-    int n = n00b_list_len((n00b_list_t *)l);
+    n00b_trigger_matcher_t *matcher = NULL;
+    int64_t                 last;
+    void                   *match;
+    int                     n = n00b_list_len((n00b_list_t *)l);
 
     for (int i = 0; i < n; i++) {
         n00b_trigger_t *trigger = n00b_list_get((n00b_list_t *)l, i, NULL);
@@ -333,17 +297,18 @@ match_base(n00b_session_t       *s,
             successful_match(s, trigger, NULL, 0, kind, trigger->thunk);
             return trigger;
         }
-        if (trigger->target == kind) {
-            if (trigger->kind == N00B_TRIGGER_SUBSTRING) {
-                if (try_substring_match(s, str, trigger, kind)) {
-                    return trigger;
-                }
+        if (str && trigger->target == kind
+            && (trigger->kind == N00B_TRIGGER_SUBSTRING
+                || trigger->kind == N00B_TRIGGER_PATTERN)) {
+            // Only bring the matcher up to date if we get to a
+            // trigger that needs it.
+            if (!matcher) {
+                matcher = n00b_get_trigger_matcher(s, l, str, kind);
             }
-            else {
-                if (trigger->kind == N00B_TRIGGER_PATTERN
-                    && try_pattern_match(s, str, trigger, kind)) {
-                    return trigger;
-                }
+
+            if (n00b_trigger_matcher_check(matcher, str, i, &last, &match)) {
+                successful_match(s, trigger, str, last, kind, match);
+                return trigger;
             }
         }
 
@@ -457,8 +422,8 @@ n00b_session_scan_for_matches(n00b_session_t *s)
     //
     // For each item, we look at the current state to see if there
     // might be something to check. If not, we truncate the associated
-    // buffer.  If there is, we check all appropriate rules. Currently
-    // we are not combining regexes.
+    // buffer.  If there is, we check all appropriate rules; the
+    // matchers only look at data that's new since the last scan.
     if (s->got_user_input) {
         if (handle_input_matching(s)) {
             return;
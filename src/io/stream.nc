@@ -152,20 +152,33 @@ package_message(void *m, int nitems, char *f, int l)
     return result;
 }
 
+void
+n00b_cache_one_read(n00b_stream_t *s, void *one)
+{
+    if (!n00b_cnotify_r(s, one)) {
+        n00b_list_append(s->read_cache, one);
+    }
+}
+
 void
 n00b_cache_read(n00b_stream_t *s, void *m)
 {
     n00b_cnotify_raw(s, m);
     n00b_stream_msg_t *msg = package_message(m, 1, __FILE__, __LINE__);
-    n00b_list_t       *l   = n00b_filter_reads(s, msg);
-    int                n   = n00b_list_len(l);
 
-    for (int i = 0; i < n; i++) {
-        void *one = n00b_private_list_get(l, i, NULL);
-        if (!n00b_cnotify_r(s, one)) {
-            n00b_list_append(s->read_cache, one);
-        }
-    }
+    n00b_filter_run_reads(s, msg, (void *)n00b_cache_one_read, s);
+}
+
+typedef struct {
+    n00b_stream_t *stream;
+    bool           blocking;
+} write_sink_t;
+
+static void
+deliver_one_write(write_sink_t *ctx, void *out_msg)
+{
+    n00b_cnotify_w(ctx->stream, out_msg);
+    (*ctx->stream->impl->write_impl)(ctx->stream, out_msg, ctx->blocking);
 }
 
 static void
@@ -186,21 +199,13 @@ internal_write(n00b_stream_t *stream,
     n00b_lock_acquire(stream->locks[N00B_LOCKWR_IX]);
     n00b_cnotify_q(stream, pkg);
     n00b_lock_release(stream->locks[N00B_LOCKWR_IX]);
-    n00b_list_t *to_deliver = n00b_filter_writes(stream, pkg);
-
-    if (!to_deliver) {
-        return;
-    }
 
-    void *out_msg;
+    write_sink_t sink = {
+        .stream   = stream,
+        .blocking = blocking,
+    };
 
-    int n = n00b_list_len(to_deliver);
-
-    for (int i = 0; i < n; i++) {
-        out_msg = n00b_list_get(to_deliver, i, NULL);
-        n00b_cnotify_w(stream, out_msg);
-        (*stream->impl->write_impl)(stream, out_msg, blocking);
-    }
+    n00b_filter_run_writes(stream, pkg, (void *)deliver_one_write, &sink);
 }
 
 // BLOCKING
@@ -623,6 +628,7 @@ void
 n00b_close(n00b_stream_t *c)
 {
     n00b_flush(c);
+    n00b_filter_flush_reads(c, (void *)n00b_cache_one_read, c);
 
     if (c->impl->close_impl) {
         (*c->impl->close_impl)(c);
@@ -6,9 +6,11 @@ callback_stream_init(n00b_stream_t *stream, n00b_list_t *args)
 {
     n00b_callback_cookie_t *c = n00b_get_stream_cookie(stream);
 
-    c->params    = n00b_private_list_pop(args);
-    c->cb        = n00b_private_list_pop(args);
-    stream->name = n00b_cformat("Callback @«#:p»", c->cb);
+    c->params        = n00b_private_list_pop(args);
+    c->cb            = n00b_private_list_pop(args);
+    c->backlog_limit = N00B_CALLBACK_DEFAULT_BACKLOG;
+    c->policy        = N00B_CB_BACKLOG_DROP;
+    stream->name     = n00b_cformat("Callback @«#:p»", c->cb);
 
     return O_RDWR;
 }
@@ -25,36 +27,275 @@ callback_stream_read(n00b_stream_t *stream, bool *err)
     return NULL;
 }
 
-typedef struct {
-    n00b_stream_t *s;
+// Non-blocking writes come (indirectly) from the I/O polling loop,
+// and we don't want user code blocking that. We used to spawn a
+// thread per message to run the callback, which gets very expensive
+// for busy streams, and doesn't keep messages in order.
+//
+// Instead, each callback stream has a serial queue of messages, and
+// streams with work to do go on a ready list, which a small shared
+// pool of threads services. A stream is on the ready list (or being
+// run) at most once at a time, which keeps its messages in order;
+// workers run one message per turn, so busy streams can't starve the
+// others.
+//
+// Workers get started as needed, up to N00B_CALLBACK_POOL_THREADS,
+// and stick around once started.
+struct n00b_cb_msg_t {
+    n00b_cb_msg_t *next;
     void          *msg;
-} cb_stream_info_t;
+};
+
+static struct {
+    n00b_stream_t *ready_head;
+    n00b_stream_t *ready_tail;
+    n00b_mutex_t   lock;
+    n00b_futex_t   work;
+    int32_t        threads;
+    int32_t        idle;
+} cb_pool;
 
 static void callback_stream_write(n00b_stream_t *,
                                   void *,
                                   bool);
+
+static once void
+cb_pool_init(void)
+{
+    n00b_named_lock_init(&cb_pool.lock, N00B_NLT_MUTEX, "callback pool");
+    n00b_gc_register_root(&cb_pool.ready_head, 2);
+}
+
+static inline void
+make_ready(n00b_stream_t *stream)
+{
+    n00b_callback_cookie_t *c = n00b_get_stream_cookie(stream);
+
+    c->next_ready = NULL;
+
+    if (cb_pool.ready_tail) {
+        n00b_callback_cookie_t *last;
+
+        last             = n00b_get_stream_cookie(cb_pool.ready_tail);
+        last->next_ready = stream;
+    }
+    else {
+        cb_pool.ready_head = stream;
+    }
+
+    cb_pool.ready_tail = stream;
+}
+
+static inline n00b_stream_t *
+next_ready(void)
+{
+    n00b_stream_t *result = cb_pool.ready_head;
+
+    if (result) {
+        n00b_callback_cookie_t *c = n00b_get_stream_cookie(result);
+
+        cb_pool.ready_head = c->next_ready;
+        c->next_ready      = NULL;
+
+        if (!cb_pool.ready_head) {
+            cb_pool.ready_tail = NULL;
+        }
+    }
+
+    return result;
+}
+
+// Runs one message for the stream. Called with the pool lock held;
+// returns with it held.
+static void
+run_one(n00b_stream_t *stream)
+{
+    n00b_callback_cookie_t *c   = n00b_get_stream_cookie(stream);
+    n00b_cb_msg_t          *msg = c->head;
+
+    c->head = msg->next;
+
+    if (!c->head) {
+        c->tail = NULL;
+    }
+
+    c->pending--;
+    c->runner = n00b_thread_self();
+
+    if (c->blocked) {
+        atomic_fetch_add(&c->room, 1);
+        n00b_futex_wake(&c->room, true);
+    }
+
+    n00b_lock_release(&cb_pool.lock);
+    callback_stream_write(stream, msg->msg, true);
+    n00b_lock_acquire(&cb_pool.lock);
+
+    c->runner = NULL;
+
+    if (c->head) {
+        make_ready(stream);
+    }
+    else {
+        c->scheduled = false;
+    }
+}
+
 static void *
-async_callback_runner(cb_stream_info_t *info)
+cb_pool_worker(void *ignore)
 {
-    callback_stream_write(info->s, info->msg, true);
+    n00b_lock_acquire(&cb_pool.lock);
+
+    while (true) {
+        n00b_stream_t *stream = next_ready();
+
+        if (stream) {
+            run_one(stream);
+            continue;
+        }
+
+        uint32_t seen = atomic_read(&cb_pool.work);
+
+        cb_pool.idle++;
+        n00b_lock_release(&cb_pool.lock);
+        n00b_futex_wait(&cb_pool.work,
+                        seen,
+                        N00B_CALLBACK_THREAD_POLL_INTERVAL);
+        n00b_lock_acquire(&cb_pool.lock);
+        cb_pool.idle--;
+    }
+
     return NULL;
 }
 
+// Returns false if the message got dropped. Called with the pool
+// lock held.
+static bool
+wait_for_room(n00b_stream_t *stream)
+{
+    n00b_callback_cookie_t *c = n00b_get_stream_cookie(stream);
+
+    while (c->backlog_limit && c->pending >= c->backlog_limit) {
+        if (c->policy == N00B_CB_BACKLOG_DROP) {
+            c->dropped++;
+            return false;
+        }
+        // If a callback writes to its own stream, waiting would
+        // deadlock; let the backlog run over instead.
+        if (c->runner == n00b_thread_self()) {
+            return true;
+        }
+
+        uint32_t seen = atomic_read(&c->room);
+
+        c->blocked++;
+        n00b_lock_release(&cb_pool.lock);
+        n00b_futex_wait(&c->room, seen, N00B_CALLBACK_THREAD_POLL_INTERVAL);
+        n00b_lock_acquire(&cb_pool.lock);
+        c->blocked--;
+    }
+
+    return true;
+}
+
+static void
+cb_pool_submit(n00b_stream_t *stream, void *msg)
+{
+    n00b_callback_cookie_t *c    = n00b_get_stream_cookie(stream);
+    n00b_cb_msg_t          *item = n00b_gc_alloc_mapped(n00b_cb_msg_t,
+                                                        N00B_GC_SCAN_ALL);
+    bool                    spawn = false;
+
+    item->msg = msg;
+
+    cb_pool_init();
+    n00b_lock_acquire(&cb_pool.lock);
+
+    if (!wait_for_room(stream)) {
+        n00b_lock_release(&cb_pool.lock);
+        return;
+    }
+
+    if (c->tail) {
+        c->tail->next = item;
+    }
+    else {
+        c->head = item;
+    }
+
+    c->tail = item;
+    c->pending++;
+
+    if (!c->scheduled) {
+        c->scheduled = true;
+        make_ready(stream);
+    }
+
+    if (!cb_pool.idle && cb_pool.threads < N00B_CALLBACK_POOL_THREADS) {
+        cb_pool.threads++;
+        spawn = true;
+    }
+
+    atomic_fetch_add(&cb_pool.work, 1);
+    n00b_lock_release(&cb_pool.lock);
+
+    if (spawn) {
+        n00b_thread_spawn(cb_pool_worker, NULL);
+    }
+    else {
+        n00b_futex_wake(&cb_pool.work, false);
+    }
+}
+
+// Sets how many messages the stream will queue (zero for no limit),
+// and what happens to writes past that. Streams start out with
+// N00B_CALLBACK_DEFAULT_BACKLOG and N00B_CB_BACKLOG_DROP; blocking
+// has to be asked for.
+void
+n00b_callback_stream_set_backlog(n00b_stream_t         *stream,
+                                 int32_t                limit,
+                                 n00b_cb_backlog_policy policy)
+{
+    n00b_callback_cookie_t *c = n00b_get_stream_cookie(stream);
+
+    cb_pool_init();
+    n00b_lock_acquire(&cb_pool.lock);
+
+    c->backlog_limit = limit;
+    c->policy        = policy;
+
+    if (c->blocked) {
+        atomic_fetch_add(&c->room, 1);
+        n00b_futex_wake(&c->room, true);
+    }
+
+    n00b_lock_release(&cb_pool.lock);
+}
+
+// Returns how many messages got dropped because the backlog was
+// full.
+int64_t
+n00b_callback_stream_dropped(n00b_stream_t *stream)
+{
+    n00b_callback_cookie_t *c = n00b_get_stream_cookie(stream);
+
+    cb_pool_init();
+    n00b_lock_acquire(&cb_pool.lock);
+
+    int64_t result = c->dropped;
+
+    n00b_lock_release(&cb_pool.lock);
+
+    return result;
+}
+
 static void
 callback_stream_write(n00b_stream_t *stream, void *msg, bool block)
 {
     n00b_callback_cookie_t *c = n00b_get_stream_cookie(stream);
 
     if (!block) {
-        // We spawn a thread to call ourselves, because this is called
-        // (indirectly) from the main IO polling loop, and we do not
-        // want user code potentially blocking.
-        cb_stream_info_t *info = n00b_gc_alloc_mapped(cb_stream_info_t,
-                                                      N00B_GC_SCAN_ALL);
-        info->s                = stream;
-        info->msg              = msg;
-
-        n00b_thread_spawn((void *)async_callback_runner, info);
+        cb_pool_submit(stream, msg);
         return;
     }
 
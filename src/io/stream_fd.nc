@@ -201,6 +201,7 @@ n00b_fd_stream_close(n00b_stream_t *stream)
 {
     n00b_fd_cookie_t *c = n00b_get_stream_cookie(stream);
 
+    n00b_fd_cache_remove(c->stream);
     n00b_raw_fd_close(c->stream->fd);
 
     if (c->sub) {
@@ -666,6 +667,27 @@ _n00b_read_file(n00b_string_t *path, ...)
         return NULL;
     }
 
+    n00b_string_t *msg    = NULL;
+    void          *mapped = n00b_map_file_contents(n00b_stream_fileno(f),
+                                                  buffer,
+                                                  &msg);
+
+    if (mapped) {
+        n00b_close(f);
+        return mapped;
+    }
+
+    if (msg) {
+        n00b_close(f);
+
+        if (error_ptr) {
+            *error_ptr = msg;
+            return NULL;
+        }
+
+        N00B_RAISE(msg);
+    }
+
     bool        err = false;
     n00b_buf_t *b   = n00b_stream_read(f, 0, NULL);
 
@@ -687,5 +709,25 @@ _n00b_read_file(n00b_string_t *path, ...)
         return b;
     }
 
+    // Report bad UTF-8 the same way as when the file gets mapped.
+    int num_cp;
+    int num_bytes;
+
+    if (b->byte_len
+        && (!n00b_cstring_validate_u8(b->data,
+                                      &num_cp,
+                                      &num_bytes,
+                                      b->byte_len)
+            || num_bytes != b->byte_len)) {
+        n00b_string_t *msg = n00b_cstring("Invalid UTF-8 in file.");
+
+        if (error_ptr) {
+            *error_ptr = msg;
+            return NULL;
+        }
+
+        N00B_RAISE(msg);
+    }
+
     return n00b_buf_to_string(b);
 }
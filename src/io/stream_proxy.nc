@@ -93,3 +93,75 @@ _n00b_new_stream_proxy(n00b_stream_t *target, ...)
 
     return n00b_new(n00b_type_stream(), &proxy_impl, target, filters);
 }
+
+static bool
+filters_pass_buffers(n00b_filter_t *f, bool reads)
+{
+    while (f) {
+        bool skip = reads ? f->r_skip : f->w_skip;
+
+        if (!skip && !f->impl->passes_buffers) {
+            return false;
+        }
+
+        f = reads ? f->next_read_step : f->next_write_step;
+    }
+
+    return true;
+}
+
+// Follows proxies down to the fd that writes to 's' actually land
+// on, as long as nothing along the way would do anything to raw
+// bytes.
+static n00b_fd_stream_t *
+splice_write_end(n00b_stream_t *s)
+{
+    while (s && s->w) {
+        if (!filters_pass_buffers(s->write_top, false)) {
+            return NULL;
+        }
+
+        if (s->fd_backed) {
+            n00b_fd_cookie_t *c = n00b_get_stream_cookie(s);
+            return c->stream;
+        }
+
+        if (s->impl != &proxy_impl) {
+            return NULL;
+        }
+
+        n00b_proxy_info_t *info = n00b_get_stream_cookie(s);
+        s                       = info->target;
+    }
+
+    return NULL;
+}
+
+// Forwards everything read from 'src' to 'dst' in the kernel,
+// skipping the dispatcher entirely, when no filter on either side
+// needs to see the data. Returns false if that's not possible, in
+// which case the caller should subscribe as usual.
+//
+// Read subscribers added to 'src' later on still get their messages;
+// see fd_splice.nc. Filters added later do not apply to spliced data.
+bool
+n00b_stream_splice(n00b_stream_t *src, n00b_stream_t *dst)
+{
+    if (!src->fd_backed || !src->r) {
+        return false;
+    }
+
+    if (!filters_pass_buffers(src->read_top, true)) {
+        return false;
+    }
+
+    n00b_fd_stream_t *target = splice_write_end(dst);
+
+    if (!target) {
+        return false;
+    }
+
+    n00b_fd_cookie_t *c = n00b_get_stream_cookie(src);
+
+    return n00b_fd_splice(c->stream, target);
+}
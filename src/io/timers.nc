@@ -40,6 +40,35 @@ _n00b_add_timer(n00b_duration_t *time,
     return result;
 }
 
+typedef struct {
+    void *(*fn)(void *);
+    void *arg;
+} deferred_run_t;
+
+static void
+run_deferred(n00b_timer_t *t, n00b_duration_t *now, deferred_run_t *d)
+{
+    n00b_thread_spawn(d->fn, d->arg);
+}
+
+// Runs 'fn(arg)' on a thread of its own, once 'ns' nanoseconds have
+// passed. Timer actions run on the dispatcher, so anything that might
+// wait on I/O the dispatcher services (like flushing buffered output)
+// needs to go through this instead.
+void
+n00b_run_after(int64_t ns, void *(*fn)(void *), void *arg)
+{
+    deferred_run_t *d = n00b_gc_alloc_mapped(deferred_run_t,
+                                             N00B_GC_SCAN_ALL);
+
+    d->fn  = fn;
+    d->arg = arg;
+
+    n00b_add_timer(n00b_new_ms_timeout(ns / N00B_NS_PER_MS + 1),
+                   (n00b_timer_cb)run_deferred,
+                   d);
+}
+
 void
 n00b_remove_timer(n00b_timer_t *timer)
 {
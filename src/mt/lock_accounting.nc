@@ -14,6 +14,8 @@ N00B_DBG_DECL(n00b_lock_init_accounting, n00b_lock_base_t *lock, int type)
     atomic_store(&lock->data, info);
     atomic_store(&lock->next_thread_lock, NULL);
     atomic_store(&lock->prev_thread_lock, NULL);
+    lock->profile     = NULL;
+    lock->acquired_ns = 0;
     // Static locks may hold pointers to dynamic locks
     // when we build our linked list.
     if (!n00b_in_heap(lock)) {
@@ -25,9 +27,424 @@ N00B_DBG_DECL(n00b_lock_init_accounting, n00b_lock_base_t *lock, int type)
     lock->creation_file = __file;
     lock->creation_line = __line;
     lock->allocation    = n00b_find_allocation_record(lock);
+#else
+    // The init macros fill this in after we return.
+    lock->creation_file = NULL;
+    lock->creation_line = 0;
 #endif
 }
 
+// The lock profiler.
+//
+// Stats get aggregated by (debug name, creation site), since an
+// individual lock is often short lived, and what we usually want to
+// know is which *kind* of lock is hot. The table is a fixed size,
+// statically allocated open-addressed hash table, because we can't
+// allocate from inside lock accounting (the allocator takes locks).
+// If it fills up, further sites just don't get profiled; we keep a
+// count of those.
+//
+// A lock caches its profile record; since a lock's debug name is
+// often set after it's initialized, we check the name pointer on the
+// cached record on each use, and look it up again if it changed.
+//
+// Contention is anything that makes us wait in the kernel (spinning
+// doesn't count). Some acquisition paths wait more than once, so
+// waits accumulate in the thread state, and get charged when the
+// lock is finally acquired. Hold time is only measured for exclusive
+// acquisitions, from the outermost acquire to the final release.
+// Condition variable waits aren't contention, so they're not counted.
+
+_Atomic bool n00b_lock_profiling = false;
+
+static n00b_lock_profile_t lock_profiles[N00B_LOCK_PROFILE_SLOTS];
+static _Atomic uint64_t    profile_overflow = 0;
+
+enum {
+    PROFILE_EMPTY,
+    PROFILE_CLAIMED,
+    PROFILE_READY,
+};
+
+static inline bool
+profile_str_eq(char *s1, char *s2)
+{
+    if (s1 == s2) {
+        return true;
+    }
+
+    if (!s1 || !s2) {
+        return false;
+    }
+
+    return !strcmp(s1, s2);
+}
+
+static inline uint64_t
+profile_hash(char *name, char *file, int line)
+{
+    // FNV-1a.
+    uint64_t h = 0xcbf29ce484222325ULL;
+
+    if (name) {
+        while (*name) {
+            h = (h ^ (uint8_t)*name++) * 0x100000001b3ULL;
+        }
+    }
+
+    if (file) {
+        while (*file) {
+            h = (h ^ (uint8_t)*file++) * 0x100000001b3ULL;
+        }
+    }
+
+    return (h ^ (uint64_t)line) * 0x100000001b3ULL;
+}
+
+static n00b_lock_profile_t *
+profile_lookup(n00b_lock_base_t *lock)
+{
+    char    *name = lock->debug_name;
+    char    *file = lock->creation_file;
+    int      line = lock->creation_line;
+    uint64_t mask = N00B_LOCK_PROFILE_SLOTS - 1;
+    uint64_t ix   = profile_hash(name, file, line) & mask;
+
+    for (int i = 0; i < N00B_LOCK_PROFILE_SLOTS; i++) {
+        n00b_lock_profile_t *p     = &lock_profiles[ix];
+        int                  state = atomic_load(&p->state);
+
+        if (state == PROFILE_EMPTY) {
+            if (CAS(&p->state, &state, PROFILE_CLAIMED)) {
+                p->name = name;
+                p->file = file;
+                p->line = line;
+                atomic_store(&p->state, PROFILE_READY);
+                return p;
+            }
+        }
+
+        // Someone else is filling this slot in; it's only a few
+        // stores away from being ready.
+        while (state == PROFILE_CLAIMED) {
+            state = atomic_load(&p->state);
+        }
+
+        if (p->line == line && profile_str_eq(p->name, name)
+            && profile_str_eq(p->file, file)) {
+            return p;
+        }
+
+        ix = (ix + 1) & mask;
+    }
+
+    atomic_fetch_add(&profile_overflow, 1);
+
+    return NULL;
+}
+
+static inline n00b_lock_profile_t *
+get_profile(n00b_lock_base_t *lock)
+{
+    n00b_lock_profile_t *p = lock->profile;
+
+    if (!p || p->name != lock->debug_name) {
+        p             = profile_lookup(lock);
+        lock->profile = p;
+    }
+
+    return p;
+}
+
+static inline void
+profile_max(_Atomic uint64_t *field, uint64_t value)
+{
+    uint64_t cur = atomic_load_explicit(field, memory_order_relaxed);
+
+    while (value > cur) {
+        if (CAS(field, &cur, value)) {
+            return;
+        }
+    }
+}
+
+static inline void
+profile_acquire(n00b_lock_base_t *lock, n00b_tsi_t *tsi, bool exclusive)
+{
+    n00b_lock_profile_t *p    = get_profile(lock);
+    int64_t              wait = tsi->lock_wait_ns;
+
+    tsi->lock_wait_ns = 0;
+
+    if (exclusive) {
+        lock->acquired_ns = n00b_ns_timestamp();
+    }
+
+    if (!p) {
+        return;
+    }
+
+    atomic_fetch_add_explicit(&p->acquisitions, 1, memory_order_relaxed);
+
+    if (wait) {
+        atomic_fetch_add_explicit(&p->contended, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&p->wait_ns, wait, memory_order_relaxed);
+        profile_max(&p->max_wait_ns, wait);
+    }
+}
+
+static inline void
+profile_release(n00b_lock_base_t *lock)
+{
+    int64_t start = lock->acquired_ns;
+
+    lock->acquired_ns = 0;
+
+    // If profiling was turned on while we held the lock, we don't
+    // know when we got it.
+    if (!start) {
+        return;
+    }
+
+    n00b_lock_profile_t *p    = get_profile(lock);
+    int64_t              held = n00b_ns_timestamp() - start;
+
+    if (!p) {
+        return;
+    }
+
+    atomic_fetch_add_explicit(&p->hold_ns, held, memory_order_relaxed);
+    profile_max(&p->max_hold_ns, held);
+}
+
+void
+n00b_lock_profile_wait_end(n00b_tsi_t *tsi)
+{
+    n00b_lock_base_t *lock  = tsi->lock_wait_target;
+    int64_t           start = tsi->lock_wait_start;
+
+    tsi->lock_wait_start = 0;
+
+    if (!start || !lock) {
+        return;
+    }
+
+    n00b_core_lock_info_t info = atomic_read(&lock->data);
+
+    if (info.type == N00B_NLT_CV) {
+        return;
+    }
+
+    // Guarantee a non-zero value, so the acquisition gets counted as
+    // contended even w/ a coarse clock.
+    tsi->lock_wait_ns += n00b_max(n00b_ns_timestamp() - start, 1);
+}
+
+void
+n00b_lock_profile_read_acquire(n00b_lock_base_t *lock, n00b_tsi_t *tsi)
+{
+    if (atomic_load_explicit(&n00b_lock_profiling, memory_order_relaxed)) {
+        profile_acquire(lock, tsi, false);
+    }
+}
+
+void
+n00b_lock_profile_enable(bool enable)
+{
+    atomic_store(&n00b_lock_profiling, enable);
+}
+
+void
+n00b_lock_profile_reset(void)
+{
+    for (int i = 0; i < N00B_LOCK_PROFILE_SLOTS; i++) {
+        n00b_lock_profile_t *p = &lock_profiles[i];
+
+        atomic_store(&p->acquisitions, 0);
+        atomic_store(&p->contended, 0);
+        atomic_store(&p->wait_ns, 0);
+        atomic_store(&p->max_wait_ns, 0);
+        atomic_store(&p->hold_ns, 0);
+        atomic_store(&p->max_hold_ns, 0);
+    }
+
+    atomic_store(&profile_overflow, 0);
+}
+
+// Returns the records with any activity, most contended first (then
+// by total wait time).
+static int
+profile_cmp(const void *v1, const void *v2)
+{
+    n00b_lock_profile_t *p1 = *(n00b_lock_profile_t **)v1;
+    n00b_lock_profile_t *p2 = *(n00b_lock_profile_t **)v2;
+    uint64_t             c1 = atomic_load(&p1->contended);
+    uint64_t             c2 = atomic_load(&p2->contended);
+
+    if (c1 != c2) {
+        return c1 < c2 ? 1 : -1;
+    }
+
+    uint64_t w1 = atomic_load(&p1->wait_ns);
+    uint64_t w2 = atomic_load(&p2->wait_ns);
+
+    if (w1 != w2) {
+        return w1 < w2 ? 1 : -1;
+    }
+
+    return 0;
+}
+
+static int
+active_profiles(n00b_lock_profile_t **out)
+{
+    int n = 0;
+
+    for (int i = 0; i < N00B_LOCK_PROFILE_SLOTS; i++) {
+        n00b_lock_profile_t *p = &lock_profiles[i];
+
+        if (atomic_load(&p->state) != PROFILE_READY) {
+            continue;
+        }
+        if (!atomic_load(&p->acquisitions)) {
+            continue;
+        }
+        out[n++] = p;
+    }
+
+    qsort(out, n, sizeof(n00b_lock_profile_t *), profile_cmp);
+
+    return n;
+}
+
+static inline n00b_string_t *
+profile_name(n00b_lock_profile_t *p)
+{
+    return n00b_cstring(p->name ? p->name : "(no name)");
+}
+
+static inline n00b_string_t *
+profile_site(n00b_lock_profile_t *p)
+{
+    if (!p->file) {
+        return n00b_cstring("(unknown)");
+    }
+
+    return n00b_cformat("«#»:«#»", n00b_cstring(p->file), (int64_t)p->line);
+}
+
+n00b_table_t *
+n00b_lock_profile_table(void)
+{
+    n00b_lock_profile_t **records;
+    n00b_table_t         *tbl = n00b_table(columns : 8);
+    int                   n;
+
+    records = n00b_gc_array_alloc(n00b_lock_profile_t *,
+                                  N00B_LOCK_PROFILE_SLOTS);
+    n       = active_profiles(records);
+
+    n00b_table_add_cell(tbl, n00b_cstring("Lock"));
+    n00b_table_add_cell(tbl, n00b_cstring("Created At"));
+    n00b_table_add_cell(tbl, n00b_cstring("Acquired"));
+    n00b_table_add_cell(tbl, n00b_cstring("Contended"));
+    n00b_table_add_cell(tbl, n00b_cstring("Total Wait (ns)"));
+    n00b_table_add_cell(tbl, n00b_cstring("Max Wait (ns)"));
+    n00b_table_add_cell(tbl, n00b_cstring("Total Hold (ns)"));
+    n00b_table_add_cell(tbl, n00b_cstring("Max Hold (ns)"));
+
+    for (int i = 0; i < n; i++) {
+        n00b_lock_profile_t *p = records[i];
+
+        n00b_table_add_cell(tbl, profile_name(p));
+        n00b_table_add_cell(tbl, profile_site(p));
+        n00b_table_add_cell(tbl,
+                            n00b_cformat("«#»",
+                                         (int64_t)atomic_load(&p->acquisitions)));
+        n00b_table_add_cell(tbl,
+                            n00b_cformat("«#»",
+                                         (int64_t)atomic_load(&p->contended)));
+        n00b_table_add_cell(tbl,
+                            n00b_cformat("«#»",
+                                         (int64_t)atomic_load(&p->wait_ns)));
+        n00b_table_add_cell(tbl,
+                            n00b_cformat("«#»",
+                                         (int64_t)atomic_load(&p->max_wait_ns)));
+        n00b_table_add_cell(tbl,
+                            n00b_cformat("«#»",
+                                         (int64_t)atomic_load(&p->hold_ns)));
+        n00b_table_add_cell(tbl,
+                            n00b_cformat("«#»",
+                                         (int64_t)atomic_load(&p->max_hold_ns)));
+    }
+
+    return tbl;
+}
+
+n00b_string_t *
+n00b_lock_profile_json(void)
+{
+    n00b_lock_profile_t **records;
+    n00b_list_t          *items = n00b_list(n00b_type_string());
+    int                   n;
+
+    records = n00b_gc_array_alloc(n00b_lock_profile_t *,
+                                  N00B_LOCK_PROFILE_SLOTS);
+    n       = active_profiles(records);
+
+    for (int i = 0; i < n; i++) {
+        n00b_lock_profile_t *p = records[i];
+        n00b_string_t       *file;
+
+        if (p->file) {
+            file = n00b_cformat("\"«#»\"",
+                                n00b_string_escape(n00b_cstring(p->file)));
+        }
+        else {
+            file = n00b_cstring("null");
+        }
+
+        n00b_list_append(
+            items,
+            n00b_cformat(
+                "{\"name\": \"«#»\", \"file\": «#», \"line\": «#», "
+                "\"acquisitions\": «#», \"contended\": «#», "
+                "\"wait_ns\": «#», \"max_wait_ns\": «#», "
+                "\"hold_ns\": «#», \"max_hold_ns\": «#»}",
+                n00b_string_escape(profile_name(p)),
+                file,
+                (int64_t)p->line,
+                (int64_t)atomic_load(&p->acquisitions),
+                (int64_t)atomic_load(&p->contended),
+                (int64_t)atomic_load(&p->wait_ns),
+                (int64_t)atomic_load(&p->max_wait_ns),
+                (int64_t)atomic_load(&p->hold_ns),
+                (int64_t)atomic_load(&p->max_hold_ns)));
+    }
+
+    return n00b_cformat("{\"untracked_sites\": «#», \"locks\": [«#»]}",
+                        (int64_t)atomic_load(&profile_overflow),
+                        n00b_string_join(items, n00b_cstring(", ")));
+}
+
+static void
+lock_profile_at_exit(void)
+{
+    n00b_lock_profile_enable(false);
+    n00b_eprint(n00b_lock_profile_table());
+}
+
+void
+n00b_lock_profile_init(void)
+{
+    if (!n00b_get_env(n00b_cstring("N00B_LOCK_PROFILE"))) {
+        return;
+    }
+
+    n00b_add_exit_handler(lock_profile_at_exit);
+    n00b_lock_profile_enable(true);
+}
+
 #if defined(N00B_DEBUG) && N00B_DLOG_LOCK_LEVEL >= 3
 static inline char *
 lock_kind(n00b_core_lock_info_t *info)
@@ -123,7 +540,6 @@ N00B_DBG_DECL(n00b_lock_acquire_accounting,
     log->next_entry      = lock->logs;
     lock->logs           = log;
 
-    atomic_store(&lock->data, info);
     n00b_dlog_lock3("%s:%d:@%p LOCK %s %s\n(tid: %x; init: %s:%d; level: %d)",
                     __file,
                     __line,
@@ -134,9 +550,15 @@ N00B_DBG_DECL(n00b_lock_acquire_accounting,
                     lock->creation_file,
                     lock->creation_line,
                     info.nesting);
-
 #endif
 
+    atomic_store(&lock->data, info);
+
+    if (atomic_load_explicit(&n00b_lock_profiling, memory_order_relaxed)
+        && info.nesting == 1) {
+        profile_acquire(lock, tsi, true);
+    }
+
     return 0;
 }
 
@@ -278,6 +700,10 @@ N00B_DBG_DECL(n00b_lock_release_accounting, n00b_lock_base_t *lock)
         unlock     = true;
         info.owner = N00B_NO_OWNER;
 
+        if (lock->acquired_ns) {
+            profile_release(lock);
+        }
+
         prev = atomic_read(&lock->prev_thread_lock);
         next = atomic_read(&lock->next_thread_lock);
 
@@ -574,9 +1000,9 @@ void
 _n00b_register_lock_wait(n00b_tsi_t *tsi, void *lock, char *f, int line)
 {
     assert(lock);
-    tsi->lock_wait_target = lock;
-    tsi->lock_wait_file   = f;
-    tsi->lock_wait_line   = line;
+    n00b_lock_profile_wait_start(tsi, lock);
+    tsi->lock_wait_file = f;
+    tsi->lock_wait_line = line;
 
     n00b_wait_log(tsi, lock, f, line, false);
 }
@@ -589,6 +1015,7 @@ _n00b_wait_done(n00b_tsi_t *tsi, char *__file, int __line)
     if (lock) {
         n00b_wait_log(tsi, lock, __file, __line, true);
     }
+    n00b_lock_profile_wait_end(tsi);
     tsi->lock_wait_target = NULL;
 }
 #endif
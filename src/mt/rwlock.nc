@@ -60,6 +60,7 @@ add_read_record(n00b_rwlock_t *lock,
         prev->prev_entry = log;
     }
 
+    n00b_lock_profile_read_acquire((n00b_lock_base_t *)lock, tsi);
     n00b_rlock_accounting(lock, log, tsi, value, __file, __line);
 }
 
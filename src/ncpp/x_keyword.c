@@ -1,5 +1,34 @@
 #include "ncpp.h"
 
+// This has to give the same answer as n00b_karg_hash() in
+// include/core/kargs.h, since callers built by hand hash their
+// keywords at runtime, and match against the constants we emit.
+static uint64_t
+kw_hash(char *s)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+
+    while (*s) {
+        h ^= (uint8_t)*s++;
+        h *= 0x100000001b3ULL;
+    }
+
+    return h;
+}
+
+static buf_t *
+kw_hash_literal(buf_t *b, char *kw)
+{
+    char hex[32];
+
+    snprintf(hex,
+             sizeof(hex),
+             "0x%016llxULL",
+             (unsigned long long)kw_hash(kw));
+
+    return concat_static(b, hex);
+}
+
 static inline char *
 kw_param_name_elipsis(xform_t *ctx, int ix)
 {
@@ -96,7 +125,7 @@ kw_param_name_fixed(xform_t *ctx, int ix, bool *va)
 // creates a new buffer for the check within the loop, which is
 // passed through the second parameter.
 static buf_t *
-next_kw_param(buf_t *decl_buf, buf_t **loop_buf, xform_t *ctx)
+next_kw_param(buf_t *decl_buf, buf_t **loop_buf, char **kw_out, xform_t *ctx)
 {
     // This implements kw_list below, and translates it into both a
     // variable declaration, and a test / assign.
@@ -226,13 +255,13 @@ syntax_err:
     // Cool, we're done with the declaration portion of the game. Time
     // to put together the kw check / assignment portion.
 
-    buf_t *b = concat_static(NULL, "            if (!strcmp(__ka->kw, \"");
-    b        = concat_static(b, kw_name);
-    b        = concat_static(b, "\")) {\n\n                if(__found_");
+    buf_t *b = concat_static(NULL, "            case ");
+    b        = kw_hash_literal(b, kw_name);
+    b        = concat_static(b, ":\n                if (__found_");
     b        = concat_static(b, kw_name);
     b        = concat_static(b,
                       ") {\n                    goto __dupe_kw_found;\n"
-                             "                }\n\n                __found_");
+                             "                }\n                __found_");
     b        = concat_static(b, kw_name);
     b        = concat_static(b, " = true;\n                ");
     b        = concat_static(b, var_name);
@@ -243,16 +272,15 @@ syntax_err:
 
     if (!got_star) {
         b = concat_static(b,
-                          ")(int64_t)__ka->value;\n                continue;\n"
-                          "            }\n");
+                          ")(int64_t)__ka->value;\n"
+                          "                continue;\n");
     }
     else {
-        b = concat_static(b,
-                          ")__ka->value;\n                continue;\n"
-                          "            }\n");
+        b = concat_static(b, ")__ka->value;\n                continue;\n");
     }
 
     *loop_buf = b;
+    *kw_out   = kw_name;
 
     advance(ctx, true);
 
@@ -275,6 +303,14 @@ syntax_err:
 //
 // Otherwise, it scans back to the comma, and grabs the previous
 // variable name to set up the va_arg properly.
+//
+// Keyword names get resolved here, not at runtime; each one becomes a
+// case label w/ the hash of its name, so matching a provided keyword
+// is a single switch, instead of a strcmp() against every keyword the
+// function accepts. Two keywords in the same block that hash the same
+// are an error. A misspelled keyword that happens to hash the same as
+// a real one would get accepted, but with 64 bits, that isn't going to
+// happen to anyone.
 
 bool
 keyword_xform(xform_t *ctx, tok_t *start)
@@ -285,6 +321,8 @@ keyword_xform(xform_t *ctx, tok_t *start)
     bool   va              = false;
     buf_t *result          = NULL;
     buf_t *inner           = NULL;
+    char  *seen[N00B_MAX_KEYWORD_SIZE];
+    int    num_seen        = 0;
     tok_t *t;
 
     do {
@@ -354,20 +392,52 @@ keyword_xform(xform_t *ctx, tok_t *start)
                           "->num_provided; __i++) {\n"
                           "            n00b_one_karg_t *__ka = &");
     inner = concat_static(inner, last_param_name);
-    inner = concat_static(inner, "->args[__i];\n");
+    inner = concat_static(inner,
+                          "->args[__i];\n\n"
+                          "            switch (__ka->hash) {\n");
 
     // Skip past the {
     advance(ctx, true);
 
     while (true) {
         buf_t *check;
+        char  *kw;
 
-        result = next_kw_param(result, &check, ctx);
+        result = next_kw_param(result, &check, &kw, ctx);
 
         if (!result) {
             return false;
         }
 
+        if (num_seen == N00B_MAX_KEYWORD_SIZE) {
+            fprintf(stderr,
+                    "%s: Exceeded max allowed keyword args (%d)\n",
+                    ctx->in_file,
+                    N00B_MAX_KEYWORD_SIZE);
+            return false;
+        }
+
+        for (int i = 0; i < num_seen; i++) {
+            if (!strcmp(seen[i], kw)) {
+                fprintf(stderr,
+                        "%s: Keyword '%s' declared twice.\n",
+                        ctx->in_file,
+                        kw);
+                return false;
+            }
+            if (kw_hash(seen[i]) == kw_hash(kw)) {
+                fprintf(stderr,
+                        "%s: Keywords '%s' and '%s' have the same hash; "
+                        "rename one of them.\n",
+                        ctx->in_file,
+                        seen[i],
+                        kw);
+                return false;
+            }
+        }
+
+        seen[num_seen++] = kw;
+
         inner = concat(inner, check->data, check->len);
         free(check);
 
@@ -384,6 +454,9 @@ keyword_xform(xform_t *ctx, tok_t *start)
     // Since we're done w/ keywords, we can combine our two pieces.
     result = concat(result, inner->data, inner->len);
     result = concat_static(result,
+                           "            default:\n"
+                           "                break;\n"
+                           "            }\n\n"
                            "            __err  = "
                            "n00b_cformat(\"Invalid keyword param: "
                            "«em»«#»«/»\",\n         "
@@ -418,27 +491,51 @@ keyword_xform(xform_t *ctx, tok_t *start)
 //
 // This doesn't consider what function is being called or anything
 // like that. It just converts spans of keywords matching the above
-// pattern into a single call that acquires the keyword object.
+// pattern into a single n00b_karg_info_t, built right there as a
+// compound literal on the caller's stack:
+//
+//     f(x, a: 1, b: y)
+//
+// becomes
+//
+//     f(x, n00b_stack_kargs(((n00b_one_karg_t[]){
+//              {"a", <hash of a>, (void *)(int64_t)(1)},
+//              {"b", <hash of b>, (void *)(int64_t)(y)}}), 2))
+//
+// So passing keywords costs no function call, and the callee can
+// match on the precomputed hashes (see keyword_xform() above). The
+// compound literal lives until the end of the enclosing block, which
+// outlasts the call. n00b_stack_kargs() (in kargs.h) gives it a
+// header, so varargs callees like n00b_print() can still pick it out
+// of their arguments.
 //
 // Also, this does not try to pick out function declarations
 // whatsoever. If you try to use keywords in a declaration, it'll
 // translate to broken C and give you some gnarly errors I'm sure.
 
-static char *arg_fn_name = " n00b_kargs_obj(";
-static char *cast        = ", (int64_t)(";
-// The first paren ends the cast of the last kw_arg to an int64,
-// Then there's a sentinal to tell n00b_kargs_obj when keywords
-// are done.
-// The second paren ends the n00b_kargs_obj call.
-// The third paren ends the original call.
-static char *ka_end      = "), NULL))";
-// Here, the added paren ends the cast of the previous kw_arg.
-static char *pkc         = "), ";
+static char *arg_fn_name = " n00b_stack_kargs(((n00b_one_karg_t[]){";
+static char *cast        = ", (void *)(int64_t)(";
+// Here, the added paren ends the cast of the previous kw_arg, and the
+// brace ends its entry.
+static char *pkc         = ")}, ";
 
 buf_t *comma_buf     = NULL;
-buf_t *tri_paren     = NULL;
 buf_t *post_ka_comma = NULL;
 
+// The paren ends the cast of the last kw_arg, then the braces end its
+// entry and the array, and the next paren the array's parens. Then we
+// fill in the count, end the n00b_stack_kargs() and finally end the
+// original call.
+static buf_t *
+kargs_end(int count)
+{
+    char tmp[64];
+
+    snprintf(tmp, sizeof(tmp), ")}}), %d))", count);
+
+    return concat_static(NULL, tmp);
+}
+
 static void
 open_paren_tracking(xform_t *ctx, bool id)
 {
@@ -467,7 +564,7 @@ close_paren_tracking(xform_t *ctx, tok_t *cur)
         kw_use_ctx_t *record = ctx->kw_stack;
 
         if (record->started_kobj) {
-            cur->replacement = tri_paren;
+            cur->replacement = kargs_end(record->kw_count);
         }
 
         ctx->kw_stack = record->next;
@@ -505,13 +602,10 @@ possible_keyword(xform_t *ctx, tok_t *cur)
 
         if (!comma_buf) {
             comma_buf          = calloc(1, sizeof(buf_t) + strlen(cast) + 1);
-            tri_paren          = calloc(1, sizeof(buf_t) + strlen(ka_end) + 1);
             post_ka_comma      = calloc(1, sizeof(buf_t) + strlen(pkc) + 1);
             comma_buf->len     = strlen(cast);
-            tri_paren->len     = strlen(ka_end);
             post_ka_comma->len = strlen(pkc);
             memcpy(comma_buf->data, cast, strlen(cast));
-            memcpy(tri_paren->data, ka_end, strlen(ka_end));
             memcpy(post_ka_comma->data, pkc, strlen(pkc));
         }
     }
@@ -531,15 +625,16 @@ possible_keyword(xform_t *ctx, tok_t *cur)
     }
 
     ctx->kw_stack->started_kobj = true;
-    la1->replacement            = calloc(1, sizeof(buf_t) + 3 + la1->len);
-    la1->replacement->len       = la1->len + 2;
     la2->replacement            = comma_buf;
 
-    char *p = la1->replacement->data;
-    *p++    = '"';
-    memcpy(p, ctx->input->data + la1->offset, la1->len);
-    p += la1->len;
-    *p = '"';
+    // The keyword becomes the start of its entry: the name, and the
+    // hash the callee will match against.
+    char *kw         = extract(ctx->input, la1);
+    la1->replacement = concat_static(NULL, "{\"");
+    la1->replacement = concat_static(la1->replacement, kw);
+    la1->replacement = concat_static(la1->replacement, "\", ");
+    la1->replacement = kw_hash_literal(la1->replacement, kw);
+    free(kw);
 
     return;
 
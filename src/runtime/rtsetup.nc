@@ -31,6 +31,16 @@ n00b_add_module(n00b_zobject_file_t *obj, n00b_module_t *module)
     n00b_list_append(obj->module_contents, module);
 }
 
+// Where n00b_ref_via_ffi_type() would point for an argument of the
+// given type, relative to the start of the value.
+static inline uint8_t
+ffi_val_offset(n00b_ffi_type *t)
+{
+    n00b_box_t box;
+
+    return (uint8_t)((char *)n00b_ref_via_ffi_type(&box, t) - (char *)&box);
+}
+
 static inline void
 n00b_vm_setup_ffi(n00b_vm_t *vm)
 {
@@ -40,9 +50,16 @@ n00b_vm_setup_ffi(n00b_vm_t *vm)
         return;
     }
 
+    n00b_zrun_state_t *rs = vm->run_state;
+
+    rs->num_ffi_plans = vm->obj->ffi_info_entries;
+    rs->ffi_plans     = n00b_gc_array_alloc(n00b_ffi_plan_t,
+                                        rs->num_ffi_plans);
+
     for (int i = 0; i < vm->obj->ffi_info_entries; i++) {
         n00b_ffi_decl_t *ffi_info = n00b_list_get(vm->obj->ffi_info, i, NULL);
         n00b_zffi_cif   *cif      = &ffi_info->cif;
+        n00b_ffi_plan_t *plan     = &rs->ffi_plans[i];
 
         cif->fptr = n00b_ffi_find_symbol(ffi_info->external_name,
                                          ffi_info->dll_list);
@@ -76,6 +93,15 @@ n00b_vm_setup_ffi(n00b_vm_t *vm)
                      n,
                      n00b_ffi_arg_type_map(ffi_info->external_return_type),
                      arglist);
+
+        // Leaving 'cif' unset for functions we couldn't find makes
+        // calls to them raise.
+        plan->cif        = cif;
+        plan->val_offset = n00b_gc_array_value_alloc(uint8_t, n + 1);
+
+        for (int j = 0; j < n; j++) {
+            plan->val_offset[j] = ffi_val_offset(arglist[j]);
+        }
     }
 }
 
@@ -116,8 +142,8 @@ n00b_setup_new_module_allocations(n00b_compile_ctx *cctx, n00b_vm_t *vm)
     vm->module_allocations = new_allocs;
 }
 
-n00b_buf_t *
-n00b_vm_save(n00b_vm_t *vm)
+static void
+prep_for_save(n00b_vm_t *vm)
 {
     // Any future runs should reset to this point, if it's our first
     // run, and the original entry point != the current one.
@@ -139,10 +165,26 @@ n00b_vm_save(n00b_vm_t *vm)
 
     vm->run_state = NULL;
     n00b_vm_remove_compile_time_data(vm);
+}
+
+n00b_buf_t *
+n00b_vm_save(n00b_vm_t *vm)
+{
+    prep_for_save(vm);
 
     return n00b_automarshal(vm);
 }
 
+// Same as n00b_vm_save(), but produces a mappable image; load it with
+// n00b_vm_map_image().
+n00b_buf_t *
+n00b_vm_save_image(n00b_vm_t *vm)
+{
+    prep_for_save(vm);
+
+    return n00b_image_create(vm);
+}
+
 void
 n00b_vm_global_run_state_init(n00b_vm_t *vm)
 {
@@ -270,23 +312,39 @@ n00b_vmthread_reset(n00b_vmthread_t *tstate)
                                            NULL);
 }
 
-void
-n00b_vm_remove_compile_time_data(n00b_vm_t *vm)
+// When 'undo' is non-NULL, we record each slot we clear, along with
+// its old value, so that n00b_vm_restore_compile_time_data() can put
+// things back. That lets us save a clean image (e.g., into the
+// compile cache) without throwing away info the compiler still
+// wants for error reporting and debug output.
+static inline void
+ct_clear(void **slot, n00b_list_t *undo)
+{
+    if (undo && *slot) {
+        n00b_list_append(undo, slot);
+        n00b_list_append(undo, *slot);
+    }
+
+    *slot = NULL;
+}
+
+static void
+strip_compile_time_data(n00b_vm_t *vm, n00b_list_t *undo)
 {
     int n = n00b_list_len(vm->obj->module_contents);
 
     for (int i = 0; i < n; i++) {
-        n00b_module_t *m        = n00b_list_get(vm->obj->module_contents,
+        n00b_module_t *m = n00b_list_get(vm->obj->module_contents,
                                          i,
                                          NULL);
-        m->ct                   = NULL;
-        m->module_scope->parent = NULL;
+        ct_clear((void **)&m->ct, undo);
+        ct_clear((void **)&m->module_scope->parent, undo);
         uint64_t nsyms;
         void   **syms = hatrack_dict_values(m->module_scope->symbols, &nsyms);
 
         for (uint64_t j = 0; j < nsyms; j++) {
             n00b_symbol_t *sym = syms[j];
-            sym->ct            = NULL;
+            ct_clear((void **)&sym->ct, undo);
 
             if (sym->kind == N00B_SK_FUNC) {
                 n00b_fn_decl_t *fn      = sym->value;
@@ -297,7 +355,7 @@ n00b_vm_remove_compile_time_data(n00b_vm_t *vm)
 
                 for (uint64_t k = 0; k < nsub; k++) {
                     n00b_symbol_t *sub = sub_syms[k];
-                    sub->ct            = NULL;
+                    ct_clear((void **)&sub->ct, undo);
                 }
 
                 fnscope  = fn->signature_info->formals;
@@ -305,15 +363,43 @@ n00b_vm_remove_compile_time_data(n00b_vm_t *vm)
 
                 for (uint64_t k = 0; k < nsub; k++) {
                     n00b_symbol_t *sub = sub_syms[k];
-                    sub->ct            = NULL;
+                    ct_clear((void **)&sub->ct, undo);
                 }
 
-                fn->cfg = NULL; // TODO: move to a ct object
+                // TODO: move to a ct object
+                ct_clear((void **)&fn->cfg, undo);
             }
         }
     }
 }
 
+void
+n00b_vm_remove_compile_time_data(n00b_vm_t *vm)
+{
+    strip_compile_time_data(vm, NULL);
+}
+
+n00b_list_t *
+n00b_vm_stash_compile_time_data(n00b_vm_t *vm)
+{
+    n00b_list_t *undo = n00b_list(n00b_type_ref());
+
+    strip_compile_time_data(vm, undo);
+
+    return undo;
+}
+
+void
+n00b_vm_restore_compile_time_data(n00b_list_t *undo)
+{
+    int n = n00b_list_len(undo);
+
+    for (int i = 0; i < n; i += 2) {
+        void **slot = n00b_list_get(undo, i, NULL);
+        *slot       = n00b_list_get(undo, i + 1, NULL);
+    }
+}
+
 const n00b_vtable_t n00b_vm_vtable = {
     .methods = {
         [N00B_BI_GC_MAP] = (n00b_vtable_entry)n00b_vm_gc_bits,
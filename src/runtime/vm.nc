@@ -629,7 +629,14 @@ ffi_possibly_box(n00b_vmthread_t     *tstate,
             .u64 = tstate->sp[local_param].uint,
         };
 
-        return (uint64_t)n00b_box_obj(box, actual);
+        n00b_obj_t result = n00b_box_cache_get(box, actual);
+
+        if (!result) {
+            tstate->ffi_allocs++;
+            result = n00b_new(n00b_type_box(actual), box);
+        }
+
+        return (uint64_t)result;
     }
 
     return tstate->sp[local_param].uint;
@@ -644,6 +651,7 @@ ffi_possible_ret_munge(n00b_vmthread_t *tstate, n00b_type_t *at, n00b_type_t *ft
 
     if (!n00b_type_is_concrete(at)) {
         if (n00b_type_is_concrete(ft) && n00b_type_is_value_type(ft)) {
+            tstate->ffi_allocs++;
             tstate->r0 = n00b_box_obj((n00b_box_t){.v = tstate->r0}, ft);
         }
     }
@@ -656,32 +664,47 @@ ffi_possible_ret_munge(n00b_vmthread_t *tstate, n00b_type_t *at, n00b_type_t *ft
     return;
 }
 
+// Argument values go in the thread's scratch area when they fit, and
+// get boxed on the heap otherwise.
+static inline void **
+ffi_arg_area(n00b_vmthread_t *tstate, int nargs, n00b_box_t **vals)
+{
+    if (nargs <= N00B_FFI_MAX_ARGS) {
+        *vals = tstate->ffi_vals;
+        return tstate->ffi_args;
+    }
+
+    tstate->ffi_allocs += 2;
+    *vals = n00b_gc_array_value_alloc(n00b_box_t, nargs);
+
+    return n00b_gc_array_value_alloc(void *, nargs);
+}
+
 static void
 n00b_vm_ffi_call(n00b_vmthread_t     *tstate,
                  n00b_zinstruction_t *instr,
                  int64_t              ix,
                  n00b_type_t         *dynamic_type)
 {
-    n00b_ffi_decl_t *decl = n00b_list_get(tstate->vm->obj->ffi_info,
-                                          instr->arg,
-                                          NULL);
+    n00b_zrun_state_t *rs = tstate->vm->run_state;
 
-    if (decl == NULL) {
+    if (instr->arg < 0 || instr->arg >= rs->num_ffi_plans
+        || !rs->ffi_plans[instr->arg].cif) {
         N00B_CRAISE("Could not load external function.");
     }
 
-    n00b_zffi_cif *ffiinfo     = &decl->cif;
-    int            local_param = 0;
-    void         **args;
+    n00b_ffi_plan_t *plan        = &rs->ffi_plans[instr->arg];
+    n00b_zffi_cif   *ffiinfo     = plan->cif;
+    int              local_param = 0;
+    int              nargs       = ffiinfo->cif.nargs;
+    void           **args        = NULL;
+    n00b_box_t      *vals;
 
-    if (!ffiinfo->cif.nargs) {
-        args = NULL;
-    }
-    else {
-        args  = n00b_gc_array_value_alloc(void *, ffiinfo->cif.nargs);
-        int n = ffiinfo->cif.nargs;
+    if (nargs) {
+        args  = ffi_arg_area(tstate, nargs, &vals);
+        int n = nargs;
 
-        for (unsigned int i = 0; i < ffiinfo->cif.nargs; i++) {
+        for (int i = 0; i < nargs; i++) {
             // clang-format off
 	    --n;
 
@@ -694,18 +717,11 @@ n00b_vm_ffi_call(n00b_vmthread_t     *tstate,
             }
             // clang-format on
             else {
-                uint64_t raw;
-                raw = ffi_possibly_box(tstate,
-                                       instr,
-                                       dynamic_type,
-                                       i);
-
-                n00b_box_t value = {.u64 = raw};
-
-                n00b_box_t *box = n00b_new(n00b_type_box(n00b_type_i64()),
-                                           value);
-                args[n]         = n00b_ref_via_ffi_type(box,
-                                                ffiinfo->cif.arg_types[n]);
+                vals[n].u64 = ffi_possibly_box(tstate,
+                                               instr,
+                                               dynamic_type,
+                                               i);
+                args[n]     = ((char *)&vals[n]) + plan->val_offset[n];
             }
 
             // From old heap code.
@@ -720,6 +736,7 @@ n00b_vm_ffi_call(n00b_vmthread_t     *tstate,
     if (ffiinfo->str_convert & (1UL << 63)) {
         char *s    = (char *)tstate->r0;
         tstate->r0 = n00b_cstring(s);
+        tstate->ffi_allocs++;
     }
 
     if (dynamic_type != NULL) {
@@ -1582,3 +1599,15 @@ n00b_vmthread_run(n00b_vmthread_t *tstate)
 
     return result;
 }
+
+uint64_t
+n00b_vm_ffi_alloc_count(void)
+{
+    n00b_vmthread_t *tstate = n00b_thread_runtime_acquire();
+
+    if (!tstate) {
+        return 0;
+    }
+
+    return tstate->ffi_allocs;
+}
@@ -1,6 +1,12 @@
 #define N00B_USE_INTERNAL_API
 #include "n00b.h"
 
+#if defined(__x86_64__)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 // Parse ANSI codes from a UTF-8 string, and be able to generate
 // strings from a series of ansi nodes.
 //
@@ -22,20 +28,116 @@
 //
 // This API is meant to do as little as possible in the parse, so doesn't
 // do any up-leveling of codes, doesn't pull out parameters, etc.
+//
+// Most of what goes through here is plain text, so that case is the
+// one that needs to be fast. Text nodes are just slices of the input,
+// and we find where a run of text ends 16 bytes at a time, looking
+// for anything that isn't printable ASCII. Only when we hit a byte
+// with the high bit set do we decode, to check for C1 controls and
+// bad UTF-8. Nodes get carved out of arrays, instead of being
+// allocated one at a time; an array's leftovers carry over to the
+// next parse.
+
+#define N00B_ANSI_ARENA_NODES 128
 
 static inline n00b_ansi_node_t *
 ansi_node(n00b_ansi_ctx *ctx, n00b_ansi_kind kind, int backup)
 {
-    n00b_ansi_node_t *result = n00b_gc_alloc_mapped(n00b_ansi_node_t,
-                                                    N00B_GC_SCAN_ALL);
+    if (!ctx->arena || ctx->arena_ix == N00B_ANSI_ARENA_NODES) {
+        ctx->arena    = n00b_gc_array_alloc_mapped(n00b_ansi_node_t,
+                                                N00B_ANSI_ARENA_NODES,
+                                                N00B_GC_SCAN_ALL);
+        ctx->arena_ix = 0;
+    }
+
+    n00b_ansi_node_t *result = &ctx->arena[ctx->arena_ix++];
     result->kind             = kind;
     result->start            = ctx->cur - (backup ? 1 : 0);
 
-    n00b_list_append(ctx->results, result);
+    n00b_private_list_append(ctx->results, result);
 
     return result;
 }
 
+// Cc, which is all utf8proc_category() was getting used to check.
+static inline bool
+is_control(n00b_codepoint_t cp)
+{
+    return cp < 0x20 || (cp >= 0x7f && cp < 0xa0);
+}
+
+static inline bool
+is_printable_ascii(char c)
+{
+    return (uint8_t)c >= 0x20 && (uint8_t)c < 0x7f;
+}
+
+// Returns the first byte in [p, end) that isn't printable ASCII, or
+// end.
+static inline char *
+skip_printable_ascii(char *p, char *end)
+{
+#if defined(__x86_64__)
+    const __m128i low = _mm_set1_epi8(0x1f);
+    const __m128i del = _mm_set1_epi8(0x7f);
+
+    while (end - p >= 16) {
+        __m128i  v    = _mm_loadu_si128((const __m128i *)p);
+        // Bytes >= 0x80 are negative here, so they fail the compare.
+        __m128i  ok   = _mm_andnot_si128(_mm_cmpeq_epi8(v, del),
+                                      _mm_cmpgt_epi8(v, low));
+        uint32_t stop = ~_mm_movemask_epi8(ok) & 0xffff;
+
+        if (stop) {
+            return p + __builtin_ctz(stop);
+        }
+
+        p += 16;
+    }
+#elif defined(__aarch64__)
+    const uint8x16_t low = vdupq_n_u8(0x20);
+    const uint8x16_t del = vdupq_n_u8(0x7f);
+
+    while (end - p >= 16) {
+        uint8x16_t v    = vld1q_u8((const uint8_t *)p);
+        uint8x16_t stop = vorrq_u8(vcltq_u8(v, low), vcgeq_u8(v, del));
+
+        if (vmaxvq_u8(stop)) {
+            break;
+        }
+
+        p += 16;
+    }
+#endif
+
+    while (p < end && is_printable_ascii(*p)) {
+        p++;
+    }
+
+    return p;
+}
+
+// True if p starts a multi-byte sequence that's only cut off by the
+// end of the input.
+static inline bool
+truncated_codepoint(char *p, char *end)
+{
+    uint8_t b    = *p;
+    int     need = b >= 0xf0 ? 4 : b >= 0xe0 ? 3 : b >= 0xc0 ? 2 : 0;
+
+    if (!need || end - p >= need) {
+        return false;
+    }
+
+    while (++p < end) {
+        if (((uint8_t)*p & 0xc0) != 0x80) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 static inline char *
 ansi_advance(n00b_ansi_ctx *ctx, int l)
 {
@@ -73,26 +175,34 @@ c1_code(n00b_ansi_ctx *ctx, int l)
     n->end            = ansi_advance(ctx, l);
 }
 
+// The caller has already checked that the first codepoint is
+// printable.
 static inline void
-printable_string(n00b_ansi_ctx *ctx, int l)
+printable_string(n00b_ansi_ctx *ctx)
 {
-    n00b_ansi_node_t *n = ansi_node(ctx, N00B_ANSI_TEXT, 0);
+    n00b_ansi_node_t *n   = ansi_node(ctx, N00B_ANSI_TEXT, 0);
+    char             *p   = ctx->cur;
+    char             *end = ctx->end;
     n00b_codepoint_t  cp;
 
-    while (ctx->cur < ctx->end) {
-        ansi_advance(ctx, l);
-        l = ansi_current(ctx, &cp);
-        if (l < 0) {
-            n->kind = N00B_ANSI_PARTIAL;
-            return;
+    while (true) {
+        p = skip_printable_ascii(p, end);
+
+        if (p == end || (uint8_t)*p < 0x80) {
+            break;
         }
 
-        if (utf8proc_category(cp) == UTF8PROC_CATEGORY_CC) {
+        int l = utf8proc_iterate((uint8_t *)p, n00b_min(4, end - p), &cp);
+
+        if (l < 0 || is_control(cp)) {
             break;
         }
+
+        p += l;
     }
 
-    n->end = ctx->cur;
+    ctx->cur = p;
+    n->end   = p;
 }
 
 static inline void
@@ -471,22 +581,36 @@ n00b_ansi_parser_create(void)
 static void
 n00b_ansi_parse_internal(n00b_ansi_ctx *ctx)
 {
-    n00b_codepoint_t cp;
+    n00b_codepoint_t  cp;
+    n00b_ansi_node_t *n;
 
     while (ctx->cur < ctx->end) {
+        if (is_printable_ascii(*ctx->cur)) {
+            printable_string(ctx);
+            continue;
+        }
+
         int l = ansi_current(ctx, &cp);
-        // We can end up past the end of the input in our accounting.
-        // Ideally, we won't have checked those bytes, we just add
-        // to the pointer optimistically.
+
         if (l < 0) {
-            return;
+            // Either the rest of a codepoint is in the next buffer,
+            // or this is garbage, which we skip a byte at a time.
+            if (truncated_codepoint(ctx->cur, ctx->end)) {
+                n      = ansi_node(ctx, N00B_ANSI_PARTIAL, 0);
+                n->end = ansi_advance(ctx, ctx->end - ctx->cur);
+                return;
+            }
+
+            n      = ansi_node(ctx, N00B_ANSI_INVALID, 0);
+            n->end = ansi_advance(ctx, 1);
+            continue;
         }
 
-        if (utf8proc_category(cp) == UTF8PROC_CATEGORY_CC) {
+        if (is_control(cp)) {
             control_start(ctx, cp, l);
         }
         else {
-            printable_string(ctx, l);
+            printable_string(ctx);
         }
     }
 }
@@ -494,10 +618,14 @@ n00b_ansi_parse_internal(n00b_ansi_ctx *ctx)
 static inline n00b_buf_t *
 combine_partial(n00b_ansi_ctx *ctx, n00b_buf_t *b)
 {
-    n00b_ansi_node_t *n = n00b_list_pop(ctx->results);
+    n00b_ansi_node_t *n = n00b_private_list_pop(ctx->results);
 
-    while (*n->start != '\e') {
-        --n->start;
+    // Control sequence partials may start after the ESC; a partial
+    // codepoint starts at its lead byte.
+    if ((uint8_t)*n->start < 0xc0) {
+        while (*n->start != '\e') {
+            --n->start;
+        }
     }
 
     // If there's room in the current buffer, we'll slide over the
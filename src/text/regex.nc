@@ -38,31 +38,165 @@ n00b_regex_init(void)
     n00b_pcre2_match   = pcre2_match_context_create(n00b_pcre2_global);
 }
 
-static void
-process_ovector(n00b_string_t *s, pcre2_match_data *md, n00b_list_t *l)
+// Match data is sized for the pattern w/ the most capture groups
+// we've seen on this thread, and reused across calls, instead of
+// being allocated per-match. Nothing we do while we hold it can
+// re-enter the matcher.
+static pcre2_match_data *
+get_match_data(n00b_regex_t *re)
+{
+    n00b_tsi_t       *tsi = n00b_get_tsi_ptr();
+    pcre2_match_data *md  = tsi->regex_match_data;
+
+    if (!md || pcre2_get_ovector_count(md) < re->ovector_pairs) {
+        md = pcre2_match_data_create(n00b_max(re->ovector_pairs,
+                                              N00B_REGEX_MIN_PAIRS),
+                                     n00b_pcre2_global);
+        tsi->regex_match_data = md;
+    }
+
+    return md;
+}
+
+static n00b_match_t *
+process_ovector(n00b_regex_t     *re,
+                n00b_string_t    *s,
+                pcre2_match_data *md,
+                n00b_list_t      *l)
 {
-    n00b_match_t *m     = n00b_gc_alloc_mapped(n00b_match_t, N00B_GC_SCAN_ALL);
-    uint32_t      n     = pcre2_get_ovector_count(md);
+    int32_t       ncap  = re->ovector_pairs - 1;
     PCRE2_SIZE   *oinfo = pcre2_get_ovector_pointer(md);
-    uint32_t      pos   = 2;
+    n00b_match_t *m     = n00b_gc_flex_alloc(n00b_match_t,
+                                         int64_t,
+                                         ncap * 2,
+                                         N00B_GC_SCAN_ALL);
 
-    m->start = oinfo[0];
-    m->end   = oinfo[1];
+    m->input_string = s;
+    m->start        = oinfo[0];
+    m->end          = oinfo[1];
+    m->num_captures = ncap;
+
+    for (int32_t i = 0; i < ncap * 2; i++) {
+        PCRE2_SIZE v = oinfo[i + 2];
+
+        m->spans[i] = (v == PCRE2_UNSET) ? -1 : (int64_t)v;
+    }
 
     n00b_list_append(l, m);
 
-    if (n == 1) {
-        return;
+    return m;
+}
+
+n00b_string_t *
+n00b_match_capture(n00b_match_t *m, int ix)
+{
+    int64_t start;
+    int64_t end;
+
+    if (!n00b_match_capture_span(m, ix, &start, &end)) {
+        return NULL;
+    }
+
+    return n00b_utf8(m->input_string->data + start, end - start);
+}
+
+n00b_list_t *
+n00b_match_captures(n00b_match_t *m)
+{
+    if (!m->num_captures || m->captures) {
+        return m->captures;
     }
 
-    m->captures = n00b_list(n00b_type_string());
+    n00b_list_t *result = n00b_list(n00b_type_string());
 
-    for (uint32_t i = 1; i < n; i++) {
-        int64_t        start   = oinfo[pos++];
-        int64_t        len     = oinfo[pos++] - start;
-        n00b_string_t *capture = n00b_utf8(s->data + start, len);
+    for (int i = 0; i < m->num_captures; i++) {
+        n00b_string_t *capture = n00b_match_capture(m, i);
 
-        n00b_list_append(m->captures, capture);
+        if (!capture) {
+            capture = n00b_cached_empty_string();
+        }
+
+        n00b_list_append(result, capture);
+    }
+
+    m->captures = result;
+
+    return result;
+}
+
+static inline int
+run_match(n00b_regex_t     *re,
+          n00b_string_t    *s,
+          int               off,
+          uint32_t          opts,
+          pcre2_match_data *md)
+{
+    // The JIT doesn't support PCRE2_ENDANCHORED at match time;
+    // pcre2_match() would notice and fall back to the interpreter.
+    // The pattern is JIT compiled for both complete and (soft)
+    // partial matching, so that's fine either way.
+    if (re->jit && !(opts & PCRE2_ENDANCHORED)) {
+        return pcre2_jit_match(re->regex,
+                               (PCRE2_SPTR8)s->data,
+                               s->u8_bytes,
+                               off,
+                               opts,
+                               md,
+                               n00b_pcre2_match);
+    }
+
+    return pcre2_match(re->regex,
+                       (PCRE2_SPTR8)s->data,
+                       s->u8_bytes,
+                       off,
+                       opts,
+                       md,
+                       n00b_pcre2_match);
+}
+
+// For matching against a buffer that only ever grows between calls
+// (the contents seen previously never change). '*resume' should start
+// at 0; when there's no match yet, it's moved up to the earliest
+// offset at which a match could still start once more input
+// arrives, so the next call doesn't rescan input that can't matter.
+// Lookbehinds still see everything before '*resume', since we pass
+// the whole buffer.
+//
+// It gets set to -1 when no match is possible at all until the
+// buffer is reset (an anchored pattern that failed outright).
+n00b_match_t *
+n00b_regex_search_incremental(n00b_regex_t  *re,
+                              n00b_string_t *s,
+                              int64_t       *resume)
+{
+    int64_t off = *resume;
+
+    if (off < 0 || !s) {
+        return NULL;
+    }
+
+    if (off > s->u8_bytes) {
+        off = s->u8_bytes;
+    }
+
+    pcre2_match_data *md  = get_match_data(re);
+    int               err = run_match(re, s, off, PCRE2_PARTIAL_SOFT, md);
+
+    if (err >= 1) {
+        return process_ovector(re, s, md, n00b_list(n00b_type_ref()));
+    }
+
+    switch (err) {
+    case PCRE2_ERROR_PARTIAL:
+        *resume = pcre2_get_ovector_pointer(md)[0];
+        return NULL;
+    case PCRE2_ERROR_NOMATCH:
+        *resume = re->anchored ? -1 : s->u8_bytes;
+        return NULL;
+    default:;
+        PCRE2_UCHAR8 buf[N00B_PCRE2_ERR_LEN];
+        pcre2_get_error_message(err, buf, N00B_PCRE2_ERR_LEN);
+        N00B_RAISE(n00b_cstring(buf));
     }
 }
 
@@ -75,6 +209,7 @@ n00b_regex_raw_match(n00b_regex_t  *re,
                      bool           all)
 {
     pcre2_match_data *md;
+    n00b_match_t     *m;
     int               err;
     uint32_t          opts    = 0;
     n00b_list_t      *matches = n00b_list(n00b_type_ref());
@@ -87,17 +222,18 @@ n00b_regex_raw_match(n00b_regex_t  *re,
         opts |= PCRE2_NOTEOL;
     }
 
-    // pcre2 checks to ensure the offset isn't off the end.
-    md = pcre2_match_data_create_from_pattern(re->regex, n00b_pcre2_global);
+    // pcre2_match() checks to ensure the offset isn't off the end,
+    // but the JIT fast path doesn't.
+    if (off < 0 || off > s->u8_bytes) {
+        PCRE2_UCHAR8 buf[N00B_PCRE2_ERR_LEN];
+        pcre2_get_error_message(PCRE2_ERROR_BADOFFSET, buf, N00B_PCRE2_ERR_LEN);
+        N00B_RAISE(n00b_cstring(buf));
+    }
+
+    md = get_match_data(re);
 
     while (true) {
-        err = pcre2_match(re->regex,
-                          (PCRE2_SPTR8)s->data,
-                          s->u8_bytes,
-                          off,
-                          opts | opt2,
-                          md,
-                          n00b_pcre2_match);
+        err = run_match(re, s, off, opts | opt2, md);
 
         if (err < 1) {
             if (err == PCRE2_ERROR_NOMATCH) {
@@ -109,34 +245,143 @@ n00b_regex_raw_match(n00b_regex_t  *re,
             N00B_RAISE(n00b_cstring(buf));
         }
 
-        process_ovector(s, md, matches);
+        m = process_ovector(re, s, md, matches);
 
         if (!all) {
-            if (!n00b_list_len(matches)) {
-                return NULL;
-            }
             return matches;
         }
 
-        n00b_match_t *m = n00b_list_get(matches,
-                                        n00b_list_len(matches) - 1,
-                                        NULL);
-        m->input_string = s;
-
         if (m->end == m->start) {
             // Handle empty string matches.
-            off = m->end + 1;
-        }
-        else {
-            if (m->end <= off) {
+            if (m->end >= s->u8_bytes) {
                 return matches;
             }
+            off = m->end + 1;
+            continue;
+        }
+
+        if (m->end <= off) {
+            return matches;
         }
 
         off = m->end;
     }
 }
 
+// Compiled patterns are shared by every regex w/ the same pattern and
+// flags, up to N00B_REGEX_CACHE_MAX distinct ones. Cached code comes
+// from malloc(), not the GC heap: the JIT's machine code has the
+// addresses of parts of the pcre2_code baked into it, so the code
+// can't be allowed to move. Cached entries are never freed, since any
+// number of regex objects may be using them.
+//
+// Once the cache is full, new patterns get compiled into the GC heap
+// instead, w/o JIT, so the collector can move them, and reclaim them
+// along w/ the regex that uses them.
+typedef struct {
+    pcre2_code *regex;
+    uint32_t    ovector_pairs;
+    bool        jit;
+} regex_code_t;
+
+static n00b_dict_t           *regex_cache = NULL;
+static _Atomic int64_t        regex_cache_size;
+static pcre2_compile_context *pinned_compile;
+static pcre2_general_context *gc_general;
+static pcre2_compile_context *gc_compile;
+
+static once void
+init_regex_cache(void)
+{
+    n00b_gc_register_root(&regex_cache, 1);
+    n00b_gc_register_root(&gc_general, 1);
+    n00b_gc_register_root(&gc_compile, 1);
+
+    regex_cache    = n00b_dict(n00b_type_string(), n00b_type_ref());
+    pinned_compile = pcre2_compile_context_create(NULL);
+    gc_general     = pcre2_general_context_create(pcre2_malloc_wrap,
+                                              pcre2_free_wrap,
+                                              NULL);
+    gc_compile     = pcre2_compile_context_create(gc_general);
+}
+
+static regex_code_t *
+compile_pattern(n00b_string_t *pattern, int flags, bool cached)
+{
+    int           err;
+    PCRE2_SIZE    eoffset;
+    uint32_t      ncap   = 0;
+    regex_code_t *result = n00b_gc_alloc_mapped(regex_code_t,
+                                                N00B_GC_SCAN_ALL);
+
+    result->regex = pcre2_compile((PCRE2_SPTR8)pattern->data,
+                                  pattern->u8_bytes,
+                                  flags,
+                                  &err,
+                                  &eoffset,
+                                  cached ? pinned_compile : gc_compile);
+
+    if (!result->regex) {
+        if (cached) {
+            atomic_fetch_add(&regex_cache_size, -1);
+        }
+
+        PCRE2_UCHAR8 buf[N00B_PCRE2_ERR_LEN];
+        pcre2_get_error_message(err, buf, N00B_PCRE2_ERR_LEN);
+        N00B_RAISE(n00b_cstring(buf));
+    }
+
+    pcre2_pattern_info(result->regex, PCRE2_INFO_CAPTURECOUNT, &ncap);
+    result->ovector_pairs = ncap + 1;
+
+    // If pcre2 was built w/o JIT support (or the platform doesn't
+    // have it), this fails and we just use the interpreter.
+    if (cached) {
+        result->jit = !pcre2_jit_compile(result->regex,
+                                         PCRE2_JIT_COMPLETE
+                                             | PCRE2_JIT_PARTIAL_SOFT);
+    }
+
+    return result;
+}
+
+static regex_code_t *
+get_compiled(n00b_string_t *pattern, int flags)
+{
+    char prefix[16];
+    bool found;
+
+    init_regex_cache();
+
+    snprintf(prefix, sizeof(prefix), "%x:", flags);
+
+    n00b_string_t *key    = n00b_string_concat(n00b_cstring(prefix),
+                                            n00b_utf8(pattern->data,
+                                                      pattern->u8_bytes));
+    regex_code_t  *result = hatrack_dict_get(regex_cache, key, &found);
+
+    if (found) {
+        return result;
+    }
+
+    if (atomic_fetch_add(&regex_cache_size, 1) >= N00B_REGEX_CACHE_MAX) {
+        atomic_fetch_add(&regex_cache_size, -1);
+        return compile_pattern(pattern, flags, false);
+    }
+
+    result = compile_pattern(pattern, flags, true);
+
+    if (!hatrack_dict_add(regex_cache, key, result)) {
+        // Another thread compiled the same thing first; ours was never
+        // shared, so it can go.
+        pcre2_code_free(result->regex);
+        atomic_fetch_add(&regex_cache_size, -1);
+        result = hatrack_dict_get(regex_cache, key, NULL);
+    }
+
+    return result;
+}
+
 void
 regex_object_init(n00b_regex_t *regex, va_list args)
 {
@@ -155,27 +400,19 @@ regex_object_init(n00b_regex_t *regex, va_list args)
 
     regex->repr = *pattern;
 
-    int        err;
-    PCRE2_SIZE eoffset;
-    int        flags = PCRE2_ALLOW_EMPTY_CLASS | PCRE2_ALT_BSUX
+    int flags = PCRE2_ALLOW_EMPTY_CLASS | PCRE2_ALT_BSUX
               | PCRE2_NEVER_BACKSLASH_C | PCRE2_UCP | PCRE2_NO_UTF_CHECK;
 
     flags |= (PCRE2_ANCHORED * (int)anchored);
     flags |= (PCRE2_CASELESS * (int)insensitive);
     flags |= (PCRE2_MULTILINE * (int)multiline);
 
-    regex->regex = pcre2_compile((PCRE2_SPTR8)pattern->data,
-                                 pattern->u8_bytes,
-                                 flags,
-                                 &err,
-                                 &eoffset,
-                                 n00b_pcre2_compile);
+    regex_code_t *code = get_compiled(pattern, flags);
 
-    if (!regex->regex) {
-        PCRE2_UCHAR8 buf[N00B_PCRE2_ERR_LEN];
-        pcre2_get_error_message(err, buf, N00B_PCRE2_ERR_LEN);
-        N00B_RAISE(n00b_cstring(buf));
-    }
+    regex->regex         = code->regex;
+    regex->ovector_pairs = code->ovector_pairs;
+    regex->jit           = code->jit;
+    regex->anchored      = anchored;
 }
 
 n00b_string_t *
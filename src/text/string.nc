@@ -101,7 +101,7 @@ n00b_string_set_codepoint_count(n00b_string_t *s)
     return count;
 }
 
-static inline bool
+bool
 n00b_cstring_validate_u8(char *s, int *num_cp, int *num_bytes, int max_bytes)
 {
     if (!max_bytes) {
@@ -930,7 +930,7 @@ count_codepoints(n00b_string_t *s)
     return s;
 }
 
-bool
+n00b_string_t *
 n00b_string_from_file(n00b_string_t *name, int *err)
 {
     if (!name || !name->codepoints) {
@@ -946,6 +946,13 @@ n00b_string_from_file(n00b_string_t *name, int *err)
         return NULL;
     }
 
+    n00b_string_t *result = n00b_map_file_contents(fd, false, NULL);
+
+    if (result) {
+        n00b_raw_fd_close(fd);
+        return result;
+    }
+
     off_t len = lseek(fd, 0, SEEK_END);
 
     if (len == -1) {
@@ -957,9 +964,9 @@ n00b_string_from_file(n00b_string_t *name, int *err)
         n00b_raise_errno();
     }
 
-    n00b_string_t *result     = n00b_new(n00b_type_string(), NULL, true, len);
-    char          *p          = result->data;
-    int64_t        total_read = 0;
+    result             = n00b_new(n00b_type_string(), NULL, true, len);
+    char   *p          = result->data;
+    int64_t total_read = 0;
 
     while (total_read < len) {
         ssize_t num_read = read(fd, p, len - total_read);
@@ -981,6 +988,9 @@ n00b_string_from_file(n00b_string_t *name, int *err)
         }
         n00b_assert(total_read > len);
     }
+
+    n00b_raw_fd_close(fd);
+
     return count_codepoints(result);
 }
 
@@ -0,0 +1,238 @@
+#include "n00b.h"
+
+static inline uint32_t
+read32(uint8_t *p)
+{
+    uint32_t result;
+
+    memcpy(&result, p, sizeof(uint32_t));
+
+    return result;
+}
+
+static inline uint32_t
+lz_hash(uint32_t v)
+{
+    return (v * 2654435761U) >> (32 - N00B_LZ_HASH_BITS);
+}
+
+static inline uint8_t *
+emit_length(uint8_t *op, int64_t len)
+{
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+
+    *op++ = (uint8_t)len;
+
+    return op;
+}
+
+static inline uint8_t *
+emit_literals(uint8_t *op, uint8_t *lits, int64_t n, int match_nibble)
+{
+    *op++ = (n >= 15 ? 15 : n) << 4 | match_nibble;
+
+    if (n >= 15) {
+        op = emit_length(op, n - 15);
+    }
+
+    memcpy(op, lits, n);
+
+    return op + n;
+}
+
+int64_t
+n00b_lz_compress_raw(char *src, int64_t len, char *dst, int64_t cap)
+{
+    if (cap < n00b_lz_bound(len)) {
+        return -1;
+    }
+
+    int32_t  table[1 << N00B_LZ_HASH_BITS];
+    uint8_t *base   = (uint8_t *)src;
+    uint8_t *ip     = base;
+    uint8_t *anchor = base;
+    uint8_t *end    = base + len;
+    uint8_t *op     = (uint8_t *)dst;
+
+    for (int i = 0; i < (1 << N00B_LZ_HASH_BITS); i++) {
+        table[i] = -1;
+    }
+
+    if (len > N00B_LZ_MFLIMIT) {
+        uint8_t *match_limit = end - N00B_LZ_MFLIMIT;
+        uint8_t *ext_limit   = end - N00B_LZ_LAST_LITERALS;
+
+        while (ip < match_limit) {
+            uint32_t seq  = read32(ip);
+            uint32_t h    = lz_hash(seq);
+            int32_t  cand = table[h];
+
+            table[h] = ip - base;
+
+            if (cand < 0 || ip - (base + cand) > N00B_LZ_MAX_OFFSET
+                || read32(base + cand) != seq) {
+                ip++;
+                continue;
+            }
+
+            uint8_t *ref = base + cand;
+
+            while (ip > anchor && ref > base && ip[-1] == ref[-1]) {
+                ip--;
+                ref--;
+            }
+
+            uint8_t *mp = ip + N00B_LZ_MIN_MATCH;
+            uint8_t *rp = ref + N00B_LZ_MIN_MATCH;
+
+            while (mp < ext_limit && *mp == *rp) {
+                mp++;
+                rp++;
+            }
+
+            int64_t  mlen   = (mp - ip) - N00B_LZ_MIN_MATCH;
+            uint16_t offset = ip - ref;
+            int      nibble = mlen >= 15 ? 15 : mlen;
+
+            op    = emit_literals(op, anchor, ip - anchor, nibble);
+            *op++ = offset & 0xff;
+            *op++ = offset >> 8;
+
+            if (mlen >= 15) {
+                op = emit_length(op, mlen - 15);
+            }
+
+            ip = anchor = mp;
+        }
+    }
+
+    op = emit_literals(op, anchor, end - anchor, 0);
+
+    return op - (uint8_t *)dst;
+}
+
+static inline bool
+read_length(uint8_t **ipp, uint8_t *iend, int64_t *len)
+{
+    uint8_t *ip = *ipp;
+    uint8_t  b;
+
+    do {
+        if (ip >= iend) {
+            return false;
+        }
+        b = *ip++;
+        *len += b;
+    } while (b == 255);
+
+    *ipp = ip;
+
+    return true;
+}
+
+int64_t
+n00b_lz_decompress_raw(char *src, int64_t len, char *dst, int64_t cap)
+{
+    uint8_t *ip     = (uint8_t *)src;
+    uint8_t *iend   = ip + len;
+    uint8_t *op     = (uint8_t *)dst;
+    uint8_t *ostart = op;
+    uint8_t *oend   = op + cap;
+
+    while (ip < iend) {
+        uint8_t token = *ip++;
+        int64_t lits  = token >> 4;
+
+        if (lits == 15 && !read_length(&ip, iend, &lits)) {
+            return -1;
+        }
+
+        if (lits > iend - ip || lits > oend - op) {
+            return -1;
+        }
+
+        memcpy(op, ip, lits);
+        op += lits;
+        ip += lits;
+
+        // The last sequence is literals only.
+        if (ip == iend) {
+            break;
+        }
+
+        if (iend - ip < 2) {
+            return -1;
+        }
+
+        int64_t offset = ip[0] | (ip[1] << 8);
+        int64_t mlen   = token & 0x0f;
+
+        ip += 2;
+
+        if (!offset || offset > op - ostart) {
+            return -1;
+        }
+
+        if (mlen == 15 && !read_length(&ip, iend, &mlen)) {
+            return -1;
+        }
+
+        mlen += N00B_LZ_MIN_MATCH;
+
+        if (mlen > oend - op) {
+            return -1;
+        }
+
+        uint8_t *ref = op - offset;
+
+        // Matches may overlap their own output (that's how runs get
+        // encoded), in which case we have to go byte by byte.
+        if (offset >= mlen) {
+            memcpy(op, ref, mlen);
+            op += mlen;
+        }
+        else {
+            while (mlen--) {
+                *op++ = *ref++;
+            }
+        }
+    }
+
+    return op - ostart;
+}
+
+n00b_buf_t *
+n00b_lz_compress(n00b_buf_t *input)
+{
+    int64_t     len    = n00b_buffer_len(input);
+    int64_t     bound  = n00b_lz_bound(len);
+    n00b_buf_t *result = n00b_new(n00b_type_buffer(), length : bound);
+
+    result->byte_len = n00b_lz_compress_raw(input->data,
+                                            len,
+                                            result->data,
+                                            bound);
+
+    return result;
+}
+
+// 'len' is the size of the original data, which the format doesn't
+// record; it's up to the caller to keep track of it.
+n00b_buf_t *
+n00b_lz_decompress(n00b_buf_t *input, int64_t len)
+{
+    n00b_buf_t *result = n00b_new(n00b_type_buffer(), length : len);
+    int64_t     n      = n00b_lz_decompress_raw(input->data,
+                                           n00b_buffer_len(input),
+                                           result->data,
+                                           len);
+
+    if (n != len) {
+        N00B_CRAISE("Corrupt compressed data.");
+    }
+
+    return result;
+}
@@ -129,7 +129,7 @@ alloc_is_blank(n00b_alloc_hdr *h)
 {
     if (h->guard || h->type || h->n00b_marshal_end || h->n00b_ptr_scan
         || h->n00b_obj || h->n00b_finalize || h->n00b_traced
-        || h->cached_hash) {
+        || h->forward) {
         return false;
     }
 
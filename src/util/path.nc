@@ -340,22 +340,6 @@ n00b_get_file_kind(n00b_string_t *p)
     }
 }
 
-typedef struct {
-    n00b_string_t *sc_proc;
-    n00b_string_t *sc_dev;
-    n00b_string_t *sc_cwd;
-    n00b_string_t *sc_up;
-    n00b_list_t   *result;
-    n00b_string_t *resolved;
-    bool           recurse;
-    bool           yield_links;
-    bool           yield_dirs;
-    bool           follow_links;
-    bool           ignore_special;
-    bool           done_with_safety_checks;
-    bool           have_recursed;
-} n00b_walk_ctx;
-
 static n00b_string_t *
 add_slash_if_needed(n00b_string_t *s)
 {
@@ -371,157 +355,587 @@ add_slash_if_needed(n00b_string_t *s)
     return result;
 }
 
+// The directory walker.
+//
+// Directories get read in parallel: whoever reads a directory queues
+// its subdirectories, and a small set of workers (the calling thread
+// plus N00B_WALK_MAX_WORKERS - 1 helpers, at most) pull from the
+// queue until it's drained and nobody is still reading.
+//
+// To keep the per-entry cost down, we work relative to directory
+// descriptors (openat() / fstatat()), and we trust d_type from
+// readdir() whenever the file system fills it in, so that regular
+// files and directories never get stat'd at all; only symlinks and
+// DT_UNKNOWN entries do. Paths for entries only get built when we're
+// actually going to hand them out.
+//
+// Subdirectories get opened while we still have their parent open,
+// so the queue holds descriptors. So that a very wide tree can't run
+// us out of descriptors, past N00B_WALK_MAX_QUEUED_FDS we queue the
+// path instead, and open it when it comes off the queue.
+//
+// Results go to a callback as they're found. Calls to the callback
+// are serialized, but come from whichever worker found the entry, and
+// the order is whatever order the workers happen to get to things.
+
+#define N00B_WALK_MAX_WORKERS    8
+#define N00B_WALK_MAX_QUEUED_FDS 256
+#define N00B_WALK_IDLE_NS        (N00B_NS_PER_MS)
+
+typedef struct {
+    n00b_string_t *path; // Always ends in a slash.
+    int64_t        fd;   // -1 if not opened yet.
+} walk_dir_t;
+
+typedef struct {
+    n00b_walk_cb     cb;
+    void            *arg;
+    n00b_list_t     *queue;
+    n00b_mutex_t     queue_lock;
+    n00b_mutex_t     cb_lock;
+    // Directories that are queued or being read. When this hits 0,
+    // we're done.
+    _Atomic int64_t  pending;
+    _Atomic int32_t  queued_fds;
+    _Atomic int32_t  idle;
+    n00b_futex_t     wakeup;
+    n00b_futex_t     running;
+    // When following links, the (dev, ino) of each directory read.
+    n00b_dict_t     *seen;
+    _Atomic bool     stop;
+    bool             recurse;
+    bool             yield_links;
+    bool             yield_dirs;
+    bool             follow_links;
+    bool             ignore_special;
+} walk_ctx_t;
+
+static n00b_file_kind
+kind_from_mode(mode_t mode)
+{
+    switch (mode & S_IFMT) {
+    case S_IFREG:
+        return N00B_FK_IS_REG_FILE;
+    case S_IFDIR:
+        return N00B_FK_IS_DIR;
+    case S_IFLNK:
+        return N00B_FK_IS_FLINK;
+    case S_IFSOCK:
+        return N00B_FK_IS_SOCK;
+    case S_IFCHR:
+        return N00B_FK_IS_CHR_DEVICE;
+    case S_IFBLK:
+        return N00B_FK_IS_BLOCK_DEVICE;
+    case S_IFIFO:
+        return N00B_FK_IS_FIFO;
+    default:
+        return N00B_FK_OTHER;
+    }
+}
+
+static n00b_file_kind
+kind_from_d_type(unsigned char d_type)
+{
+    switch (d_type) {
+    case DT_REG:
+        return N00B_FK_IS_REG_FILE;
+    case DT_DIR:
+        return N00B_FK_IS_DIR;
+    case DT_LNK:
+        return N00B_FK_IS_FLINK;
+    case DT_SOCK:
+        return N00B_FK_IS_SOCK;
+    case DT_CHR:
+        return N00B_FK_IS_CHR_DEVICE;
+    case DT_BLK:
+        return N00B_FK_IS_BLOCK_DEVICE;
+    case DT_FIFO:
+        return N00B_FK_IS_FIFO;
+    default:
+        return N00B_FK_NOT_FOUND;
+    }
+}
+
 static void
-internal_path_walk(n00b_walk_ctx *ctx)
+walk_yield(walk_ctx_t *ctx, n00b_string_t *path, n00b_file_kind kind)
 {
-    DIR           *dirobj;
-    struct dirent *entry;
-    n00b_string_t *saved;
-    struct stat    file_info;
+    if (atomic_read(&ctx->stop)) {
+        return;
+    }
 
-    if (!ctx->done_with_safety_checks) {
-        if (n00b_string_starts_with(ctx->resolved, ctx->sc_proc)) {
-            return;
-        }
-        if (n00b_string_starts_with(ctx->resolved, ctx->sc_dev)) {
-            return;
-        }
-        if (n00b_string_codepoint_len(ctx->resolved) != 1) {
-            ctx->done_with_safety_checks = true;
+    n00b_lock_acquire(&ctx->cb_lock);
+
+    if (!atomic_read(&ctx->stop) && !(*ctx->cb)(path, kind, ctx->arg)) {
+        atomic_store(&ctx->stop, true);
+    }
+
+    n00b_lock_release(&ctx->cb_lock);
+}
+
+static void
+walk_enqueue(walk_ctx_t *ctx, n00b_string_t *path, int parent, char *name)
+{
+    walk_dir_t *item = n00b_gc_alloc_mapped(walk_dir_t, N00B_GC_SCAN_ALL);
+
+    item->path = path;
+    item->fd   = -1;
+
+    if (parent != -1
+        && atomic_fetch_add(&ctx->queued_fds, 1) < N00B_WALK_MAX_QUEUED_FDS) {
+        item->fd = openat(parent, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+        if (item->fd == -1) {
+            atomic_fetch_add(&ctx->queued_fds, -1);
         }
     }
 
-    if (lstat(ctx->resolved->data, &file_info) != 0) {
+    atomic_fetch_add(&ctx->pending, 1);
+
+    n00b_lock_acquire(&ctx->queue_lock);
+    n00b_private_list_append(ctx->queue, item);
+    n00b_lock_release(&ctx->queue_lock);
+
+    atomic_fetch_add(&ctx->wakeup, 1);
+
+    if (atomic_read(&ctx->idle)) {
+        n00b_futex_wake(&ctx->wakeup, false);
+    }
+}
+
+static inline n00b_string_t *
+walk_entry_path(n00b_string_t *dir, char *name, int64_t name_len)
+{
+    char    buf[PATH_MAX + 1];
+    int64_t dlen = dir->u8_bytes;
+
+    if (dlen + name_len > PATH_MAX) {
+        return NULL;
+    }
+
+    memcpy(buf, dir->data, dlen);
+    memcpy(buf + dlen, name, name_len);
+
+    return n00b_utf8(buf, dlen + name_len);
+}
+
+// Where a symlink points, as an absolute path.
+static n00b_string_t *
+walk_link_target(n00b_string_t *dir, int dfd, char *name)
+{
+    char buf[PATH_MAX + 1];
+    int  n = readlinkat(dfd, name, buf, PATH_MAX);
+
+    if (n == -1) {
+        return NULL;
+    }
+
+    buf[n] = 0;
+
+    if (buf[0] == '/') {
+        return n00b_resolve_path(n00b_utf8(buf, n));
+    }
+
+    return n00b_resolve_path(n00b_string_concat(dir, n00b_utf8(buf, n)));
+}
+
+static void
+walk_link(walk_ctx_t    *ctx,
+          walk_dir_t    *dir,
+          int            dfd,
+          char          *name,
+          n00b_string_t *path)
+{
+    struct stat    info;
+    n00b_string_t *target;
+
+    if (fstatat(dfd, name, &info, 0) != 0) {
         return;
     }
 
-    switch (file_info.st_mode & S_IFMT) {
+    switch (info.st_mode & S_IFMT) {
     case S_IFREG:
-        n00b_list_append(ctx->result, ctx->resolved);
+        if (!ctx->yield_links) {
+            return;
+        }
+        if (ctx->follow_links) {
+            target = walk_link_target(dir->path, dfd, name);
+            if (target) {
+                walk_yield(ctx, target, N00B_FK_IS_FLINK);
+            }
+            return;
+        }
+        walk_yield(ctx, path, N00B_FK_IS_FLINK);
         return;
-
     case S_IFDIR:
-        if (ctx->yield_dirs) {
-            n00b_list_append(ctx->result, ctx->resolved);
+        if (ctx->yield_dirs && ctx->yield_links) {
+            walk_yield(ctx, path, N00B_FK_IS_DLINK);
+        }
+
+        if (!ctx->follow_links || !ctx->recurse) {
             return;
         }
 
-actual_directory:
-        if (!ctx->recurse) {
-            if (ctx->have_recursed) {
-                return;
-            }
-            ctx->have_recursed = true;
+        target = walk_link_target(dir->path, dfd, name);
+
+        if (!target) {
+            return;
+        }
+
+        if (ctx->yield_dirs && !ctx->yield_links) {
+            walk_yield(ctx, target, N00B_FK_IS_DIR);
+        }
+
+        walk_enqueue(ctx, add_slash_if_needed(target), dfd, name);
+        return;
+    default:
+        if (!ctx->ignore_special) {
+            walk_yield(ctx, path, kind_from_mode(info.st_mode));
         }
+        return;
+    }
+}
+
+// Following links can lead back to a directory we've already read
+// (or are reading), so when we do that, each directory only gets
+// read the first time we get to it.
+static bool
+walk_first_visit(walk_ctx_t *ctx, int dfd)
+{
+    struct stat info;
+    char        key[64];
+
+    if (fstat(dfd, &info) != 0) {
+        return true;
+    }
+
+    snprintf(key,
+             sizeof(key),
+             "%llx:%llx",
+             (unsigned long long)info.st_dev,
+             (unsigned long long)info.st_ino);
 
-        ctx->resolved = add_slash_if_needed(ctx->resolved);
+    return hatrack_dict_add(ctx->seen, n00b_cstring(key), (void *)true);
+}
 
-        dirobj = opendir(ctx->resolved->data);
+static void
+walk_read_dir(walk_ctx_t *ctx, walk_dir_t *dir)
+{
+    int dfd = dir->fd;
 
-        if (dirobj == NULL) {
+    if (dfd == -1) {
+        dfd = open(dir->path->data, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dfd == -1) {
             return;
         }
+    }
+    else {
+        atomic_fetch_add(&ctx->queued_fds, -1);
+    }
 
-        saved = ctx->resolved;
+    if (ctx->seen && !walk_first_visit(ctx, dfd)) {
+        close(dfd);
+        return;
+    }
 
-        while (true) {
-            entry = readdir(dirobj);
+    DIR *dirobj = fdopendir(dfd);
 
-            if (entry == NULL) {
-                ctx->resolved = saved;
-                return;
-            }
+    if (!dirobj) {
+        close(dfd);
+        return;
+    }
+
+    // Walking from the root, we don't descend into the pseudo-file
+    // systems.
+    bool           at_root = dir->path->u8_bytes == 1;
+    struct dirent *entry;
+
+    while ((entry = readdir(dirobj)) != NULL) {
+        char *name = entry->d_name;
 
-            if (!strcmp(entry->d_name, "..")) {
+        if (atomic_read(&ctx->stop)) {
+            break;
+        }
+
+        if (name[0] == '.'
+            && (!name[1] || (name[1] == '.' && !name[2]))) {
+            continue;
+        }
+
+        if (at_root && (!strcmp(name, "proc") || !strcmp(name, "dev"))) {
+            continue;
+        }
+
+        n00b_file_kind kind = kind_from_d_type(entry->d_type);
+        struct stat    info;
+
+        if (kind == N00B_FK_NOT_FOUND) {
+            if (fstatat(dfd, name, &info, AT_SYMLINK_NOFOLLOW) != 0) {
                 continue;
             }
+            kind = kind_from_mode(info.st_mode);
+        }
 
-            if (!strcmp(entry->d_name, ".")) {
+        // Skip building the path for anything we won't report or
+        // visit.
+        switch (kind) {
+        case N00B_FK_IS_DIR:
+            if (!ctx->yield_dirs && !ctx->recurse) {
+                continue;
+            }
+            break;
+        case N00B_FK_IS_FLINK:
+            if (!ctx->yield_links && !(ctx->follow_links && ctx->recurse)) {
+                continue;
+            }
+            break;
+        case N00B_FK_IS_REG_FILE:
+            break;
+        default:
+            if (ctx->ignore_special) {
                 continue;
             }
+            break;
+        }
 
-            ctx->resolved = n00b_string_concat(saved,
-                                               n00b_cstring(entry->d_name));
+        n00b_string_t *path = walk_entry_path(dir->path, name, strlen(name));
 
-            internal_path_walk(ctx);
+        if (!path) {
+            continue;
         }
-        ctx->resolved = saved;
-        return;
 
-    case S_IFLNK:
-        if (stat(ctx->resolved->data, &file_info) != 0) {
-            return;
+        switch (kind) {
+        case N00B_FK_IS_DIR:
+            if (ctx->yield_dirs) {
+                walk_yield(ctx, path, kind);
+            }
+            if (ctx->recurse) {
+                walk_enqueue(ctx, n00b_cformat("«#»/", path), dfd, name);
+            }
+            continue;
+        case N00B_FK_IS_FLINK:
+            walk_link(ctx, dir, dfd, name, path);
+            continue;
+        default:
+            walk_yield(ctx, path, kind);
+            continue;
         }
+    }
 
-        switch (file_info.st_mode & S_IFMT) {
-        case S_IFREG:
-            if (ctx->follow_links && ctx->yield_links) {
-                char buf[PATH_MAX + 1] = {
-                    0,
-                };
+    closedir(dirobj);
+}
 
-                int n = readlink(ctx->resolved->data, buf, PATH_MAX);
+static walk_dir_t *
+walk_dequeue(walk_ctx_t *ctx)
+{
+    walk_dir_t *result;
 
-                if (n == -1) {
-                    N00B_CRAISE("readlink() failed.");
-                }
+    n00b_lock_acquire(&ctx->queue_lock);
+    result = n00b_private_list_pop(ctx->queue);
+    n00b_lock_release(&ctx->queue_lock);
 
-                ctx->resolved->data[n] = 0;
+    return result;
+}
 
-                n00b_list_append(ctx->result,
-                                 n00b_resolve_path(n00b_cstring(buf)));
-            }
-            else {
-                if (ctx->yield_links) {
-                    n00b_list_append(ctx->result, ctx->resolved);
-                }
-            }
-            return;
-        case S_IFDIR:
+static void *
+walk_worker(walk_ctx_t *ctx)
+{
+    while (atomic_read(&ctx->pending)) {
+        uint32_t    seen = atomic_read(&ctx->wakeup);
+        walk_dir_t *dir  = walk_dequeue(ctx);
 
-            if (ctx->yield_dirs && ctx->yield_links) {
-                n00b_list_append(ctx->result, ctx->resolved);
-            }
+        if (dir) {
+            walk_read_dir(ctx, dir);
 
-            if (!ctx->follow_links || !ctx->recurse) {
-                return;
+            if (atomic_fetch_add(&ctx->pending, -1) == 1) {
+                atomic_fetch_add(&ctx->wakeup, 1);
+                n00b_futex_wake(&ctx->wakeup, true);
             }
+            continue;
+        }
 
-            saved                  = ctx->resolved;
-            char buf[PATH_MAX + 1] = {
-                0,
-            };
-            int n = readlink(ctx->resolved->data, buf, PATH_MAX);
+        // Somebody's still reading a directory, and may queue more.
+        atomic_fetch_add(&ctx->idle, 1);
+        n00b_futex_wait(&ctx->wakeup, seen, N00B_WALK_IDLE_NS);
+        atomic_fetch_add(&ctx->idle, -1);
+    }
 
-            if (n == -1) {
-                N00B_CRAISE("readlink() failed.");
-            }
+    if (atomic_fetch_add(&ctx->running, -1) == 1) {
+        n00b_futex_wake(&ctx->running, true);
+    }
+
+    return NULL;
+}
 
-            ctx->resolved->data[n] = 0;
+static int
+walk_num_workers(int64_t requested)
+{
+    if (requested > 0) {
+        return n00b_min(requested, N00B_WALK_MAX_WORKERS);
+    }
 
-            ctx->resolved = n00b_resolve_path(n00b_cstring(buf));
-            if (ctx->yield_dirs && !ctx->yield_links) {
-                n00b_list_append(ctx->result, ctx->resolved);
-            }
+    return n00b_max(1,
+                    n00b_min(sysconf(_SC_NPROCESSORS_ONLN),
+                             N00B_WALK_MAX_WORKERS));
+}
+
+// Walks 'dir', handing each result to 'cb' along w/ its kind and
+// 'arg'. If the callback returns false, the walk stops (other workers
+// may still be mid-directory, but the callback won't get called
+// again). Returns once the walk is complete.
+//
+// By default, the walk happens entirely on the calling thread. Pass
+// 'workers' > 1 to read directories on that many threads (0 means one
+// per core); the callback still only runs on one thread at a time,
+// but results come in no particular order.
+//
+// With 'follow_links', a link back up the tree doesn't loop; each
+// directory gets read once, however many ways there are to reach it.
+//
+// If 'dir' is a file rather than a directory, it's the only result.
+void
+_n00b_path_walk_each(n00b_string_t *dir, n00b_walk_cb cb, void *arg, ...)
+{
+    keywords
+    {
+        bool    recurse        = true;
+        bool    yield_links    = false;
+        bool    yield_dirs     = false;
+        bool    ignore_special = true;
+        bool    follow_links   = false;
+        int64_t workers        = 1;
+    }
 
-            goto actual_directory;
+    n00b_string_t *resolved = n00b_resolve_path(dir);
+    struct stat    info;
 
-        default:
-            if (!ctx->ignore_special) {
-                n00b_list_append(ctx->result, ctx->resolved);
+    if (n00b_string_starts_with(resolved, n00b_cstring("/proc/"))
+        || n00b_string_starts_with(resolved, n00b_cstring("/dev/"))) {
+        return;
+    }
+
+    if (lstat(resolved->data, &info) != 0) {
+        return;
+    }
+
+    walk_ctx_t *ctx = n00b_gc_alloc_mapped(walk_ctx_t, N00B_GC_SCAN_ALL);
+
+    ctx->cb             = cb;
+    ctx->arg            = arg;
+    ctx->queue          = n00b_list(n00b_type_ref());
+    ctx->recurse        = recurse;
+    ctx->yield_links    = yield_links;
+    ctx->yield_dirs     = yield_dirs;
+    ctx->follow_links   = follow_links;
+    ctx->ignore_special = ignore_special;
+
+    if (follow_links && recurse) {
+        ctx->seen = n00b_dict(n00b_type_string(), n00b_type_ref());
+    }
+
+    n00b_named_lock_init(&ctx->queue_lock, N00B_NLT_MUTEX, "walk queue");
+    n00b_named_lock_init(&ctx->cb_lock, N00B_NLT_MUTEX, "walk results");
+
+    switch (info.st_mode & S_IFMT) {
+    case S_IFDIR:
+        if (yield_dirs) {
+            walk_yield(ctx, resolved, N00B_FK_IS_DIR);
+        }
+        break;
+    case S_IFLNK:
+        if (stat(resolved->data, &info) != 0) {
+            return;
+        }
+        if (S_ISREG(info.st_mode)) {
+            if (yield_links) {
+                walk_yield(ctx, resolved, N00B_FK_IS_FLINK);
             }
             return;
         }
-    case S_IFSOCK:
-    case S_IFCHR:
-    case S_IFBLK:
-    case S_IFIFO:
+        if (!S_ISDIR(info.st_mode)) {
+            if (!ignore_special) {
+                walk_yield(ctx, resolved, kind_from_mode(info.st_mode));
+            }
+            return;
+        }
+        if (yield_dirs && yield_links) {
+            walk_yield(ctx, resolved, N00B_FK_IS_DLINK);
+        }
+        if (!follow_links) {
+            return;
+        }
+        break;
+    case S_IFREG:
+        walk_yield(ctx, resolved, N00B_FK_IS_REG_FILE);
+        return;
     default:
-        if (!ctx->ignore_special) {
-            n00b_list_append(ctx->result, ctx->resolved);
+        if (!ignore_special) {
+            walk_yield(ctx, resolved, kind_from_mode(info.st_mode));
         }
         return;
     }
+
+    // The top directory always gets read, even when not recursing.
+    walk_enqueue(ctx, add_slash_if_needed(resolved), -1, NULL);
+
+    int n = walk_num_workers(workers);
+
+    atomic_store(&ctx->running, n);
+
+    for (int i = 1; i < n; i++) {
+        n00b_thread_spawn((void *)walk_worker, ctx);
+    }
+
+    walk_worker(ctx);
+
+    uint32_t left;
+
+    while ((left = atomic_read(&ctx->running)) != 0) {
+        n00b_futex_wait(&ctx->running, left, N00B_WALK_IDLE_NS);
+    }
+}
+
+static bool
+walk_collect(n00b_string_t *path, n00b_file_kind kind, n00b_list_t *result)
+{
+    n00b_private_list_append(result, path);
+
+    return true;
+}
+
+// Like n00b_path_walk_each(), but collects the results into a list,
+// sorted, so the result is the same however many workers there are.
+// Since order doesn't matter here, this defaults to one worker per
+// core.
+n00b_list_t *
+_n00b_path_walk(n00b_string_t *dir, ...)
+{
+    keywords
+    {
+        bool    recurse        = true;
+        bool    yield_links    = false;
+        bool    yield_dirs     = false;
+        bool    ignore_special = true;
+        bool    follow_links   = false;
+        int64_t workers        = 0;
+    }
+
+    n00b_list_t *result = n00b_list(n00b_type_string());
+
+    // clang-format off
+    n00b_path_walk_each(dir,
+                        (n00b_walk_cb)walk_collect,
+                        result,
+                        recurse:        recurse,
+                        yield_links:    yield_links,
+                        yield_dirs:     yield_dirs,
+                        ignore_special: ignore_special,
+                        follow_links:   follow_links,
+                        workers:        workers);
+    // clang-format on
+
+    n00b_private_list_sort(result, n00b_lexical_sort);
+
+    return result;
 }
 
 #ifdef __linux__
@@ -548,39 +962,6 @@ n00b_app_path(void)
 #error "Unsupported platform"
 #endif
 
-n00b_list_t *
-_n00b_path_walk(n00b_string_t *dir, ...)
-{
-    keywords
-    {
-        bool recurse        = true;
-        bool yield_links    = false;
-        bool yield_dirs     = false;
-        bool ignore_special = true;
-        bool follow_links   = false;
-    }
-
-    n00b_walk_ctx ctx = {
-        .sc_proc                 = n00b_cstring("/proc/"),
-        .sc_dev                  = n00b_cstring("/dev/"),
-        .sc_cwd                  = n00b_cached_period(),
-        .sc_up                   = n00b_cstring(".."),
-        .recurse                 = recurse,
-        .yield_links             = yield_links,
-        .yield_dirs              = yield_dirs,
-        .follow_links            = follow_links,
-        .ignore_special          = ignore_special,
-        .done_with_safety_checks = false,
-        .have_recursed           = false,
-        .result                  = n00b_list(n00b_type_string()),
-        .resolved                = n00b_resolve_path(dir),
-    };
-
-    internal_path_walk(&ctx);
-
-    return ctx.result;
-}
-
 n00b_string_t *
 n00b_path_trim_trailing_slashes(n00b_string_t *s)
 {
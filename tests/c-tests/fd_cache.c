@@ -0,0 +1,178 @@
+#define N00B_USE_INTERNAL_API
+#include "n00b.h"
+
+// The per-loop fd table: fds spread across chunks (and past the end
+// of the table, where the dictionary takes over), the open-stream
+// check on add, releasing a slot on close, and that a stream that
+// lost its slot can't clear out whoever replaced it.
+
+#define RACERS   8
+#define RACE_FDS 256
+
+static n00b_event_loop_t *loop;
+static _Atomic int        racers_done;
+
+static n00b_fd_stream_t *
+fake_stream(int fd)
+{
+    n00b_fd_stream_t *s = n00b_gc_alloc_mapped(n00b_fd_stream_t,
+                                               N00B_GC_SCAN_ALL);
+
+    s->fd     = fd;
+    s->evloop = loop;
+
+    return s;
+}
+
+// What the close paths do.
+static void
+fake_close(n00b_fd_stream_t *s)
+{
+    n00b_fd_cache_remove(s);
+    s->fd = N00B_FD_CLOSED;
+}
+
+static void
+chunk_test(void)
+{
+    int               fds[] = {3, 1023, 1024, 5000, N00B_FD_TABLE_MAX + 7};
+    int               n     = sizeof(fds) / sizeof(int);
+    n00b_fd_stream_t *s[sizeof(fds) / sizeof(int)];
+    bool              ok = true;
+
+    for (int i = 0; i < n; i++) {
+        if (n00b_fd_cache_lookup(fds[i], loop)) {
+            ok = false;
+        }
+
+        s[i] = fake_stream(fds[i]);
+
+        if (n00b_fd_cache_add(s[i]) != s[i]) {
+            ok = false;
+        }
+    }
+
+    for (int i = 0; i < n; i++) {
+        if (n00b_fd_cache_lookup(fds[i], loop) != s[i]) {
+            ok = false;
+        }
+
+        // A second stream for an fd that's still open gets the first.
+        if (n00b_fd_cache_add(fake_stream(fds[i])) != s[i]) {
+            ok = false;
+        }
+    }
+
+    // Neighbors of what we added, and a chunk nobody has touched.
+    if (n00b_fd_cache_lookup(4, loop) || n00b_fd_cache_lookup(9000, loop)) {
+        ok = false;
+    }
+
+    for (int i = 0; i < n; i++) {
+        fake_close(s[i]);
+
+        if (n00b_fd_cache_lookup(fds[i], loop)) {
+            ok = false;
+        }
+    }
+
+    printf("fd table chunks: %s\n", ok ? "ok" : "FAIL");
+}
+
+static void
+stale_remove_test(void)
+{
+    int  fds[] = {42, N00B_FD_TABLE_MAX + 42};
+    bool ok    = true;
+
+    for (int i = 0; i < 2; i++) {
+        n00b_fd_stream_t *a = fake_stream(fds[i]);
+        n00b_fd_stream_t *b = fake_stream(fds[i]);
+
+        n00b_fd_cache_add(a);
+        n00b_fd_cache_remove(a);
+
+        if (n00b_fd_cache_add(b) != b) {
+            ok = false;
+        }
+
+        // 'a' gets closed late; its slot has already been reused.
+        fake_close(a);
+
+        if (n00b_fd_cache_lookup(fds[i], loop) != b) {
+            ok = false;
+        }
+
+        fake_close(b);
+
+        if (n00b_fd_cache_lookup(fds[i], loop)) {
+            ok = false;
+        }
+    }
+
+    printf("fd table stale remove: %s\n", ok ? "ok" : "FAIL");
+}
+
+static n00b_fd_stream_t *winners[RACERS][RACE_FDS];
+
+static void *
+racer(void *arg)
+{
+    int64_t id = (int64_t)arg;
+
+    // Every racer adds its own stream for the same fds, so they all
+    // contend on each slot, and on installing the chunks.
+    for (int i = 0; i < RACE_FDS; i++) {
+        winners[id][i] = n00b_fd_cache_add(fake_stream(2000 + i * 7));
+    }
+
+    atomic_fetch_add(&racers_done, 1);
+
+    return NULL;
+}
+
+static void
+race_test(void)
+{
+    bool ok = true;
+
+    for (int64_t i = 0; i < RACERS; i++) {
+        n00b_thread_spawn(racer, (void *)i);
+    }
+
+    while (atomic_read(&racers_done) != RACERS) {
+        n00b_nanosleep(0, 1000000);
+    }
+
+    for (int i = 0; i < RACE_FDS; i++) {
+        n00b_fd_stream_t *s = n00b_fd_cache_lookup(2000 + i * 7, loop);
+
+        for (int j = 0; j < RACERS; j++) {
+            if (winners[j][i] != s) {
+                ok = false;
+            }
+        }
+
+        if (s) {
+            fake_close(s);
+        }
+    }
+
+    printf("fd table race: %s\n", ok ? "ok" : "FAIL");
+}
+
+int
+main()
+{
+    n00b_terminal_app_setup();
+    n00b_gc_register_root(&loop, 1);
+    n00b_gc_register_root(winners, RACERS * RACE_FDS);
+
+    // A loop of our own, that never runs, so none of this touches
+    // the system dispatcher's real fds.
+    loop = n00b_new_event_context(N00B_EV_POLL);
+
+    chunk_test();
+    stale_remove_test();
+    race_test();
+}
@@ -0,0 +1,82 @@
+#define N00B_USE_INTERNAL_API
+#include "n00b.h"
+
+// Builds an image from marshal output that carries a backpatch for a
+// word colliding with the virtual heap base, the same way the
+// marshaler emits one, and checks the word survives loading.
+
+#define SENTINEL   0x5a5a5a5a5a5a5a58ULL
+#define IMAGE_PATH "/tmp/n00b_image_collision.img"
+
+int
+main()
+{
+    n00b_terminal_app_setup();
+
+    n00b_list_t *l = n00b_list(n00b_type_ref());
+
+    n00b_list_append(l, n00b_cstring("hello"));
+    n00b_list_append(l, (void *)SENTINEL);
+
+    n00b_buf_t *m     = n00b_automarshal(l);
+    int64_t     len   = n00b_buffer_len(m);
+    uint64_t    base  = ((uint64_t *)m->data)[1];
+    uint64_t    value = base | 0x28;
+
+    // Room for one (offset, value) pair after the end record.
+    n00b_buf_t *patched = n00b_new(n00b_type_buffer(),
+                                   n00b_header_kargs("length", len + 16));
+    uint64_t   *words   = (uint64_t *)patched->data;
+    int64_t     found   = -1;
+
+    memcpy(patched->data, m->data, len);
+    patched->byte_len = len + 16;
+
+    for (int64_t i = 2; i < len / 8; i++) {
+        if (words[i] == SENTINEL) {
+            found = i;
+            break;
+        }
+    }
+
+    if (found == -1) {
+        printf("image collision: FAIL (no sentinel)\n");
+        return 1;
+    }
+
+    n00b_alloc_hdr *end = (n00b_alloc_hdr *)(patched->data + len
+                                             - sizeof(n00b_alloc_hdr));
+
+    words[found]       = 0;
+    end->alloc_len     = 16;
+    words[len / 8]     = (found - 2) * 8;
+    words[len / 8 + 1] = value;
+
+    n00b_buf_t *img = n00b_image_from_marshal(patched);
+    int         fd  = open(IMAGE_PATH, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+
+    if (fd == -1
+        || write(fd, img->data, img->byte_len) != img->byte_len) {
+        printf("image collision: FAIL (could not write image)\n");
+        return 1;
+    }
+
+    close(fd);
+
+    n00b_list_t *copy = n00b_image_load(n00b_cstring(IMAGE_PATH));
+
+    unlink(IMAGE_PATH);
+
+    if (!copy) {
+        printf("image collision: FAIL (could not load image)\n");
+        return 1;
+    }
+
+    n00b_string_t *s = n00b_list_get(copy, 0, NULL);
+    uint64_t       w = (uint64_t)n00b_list_get(copy, 1, NULL);
+
+    printf("image string: %s\n", s->data);
+    printf("image collision: %s\n", w == value ? "ok" : "FAIL");
+
+    return 0;
+}
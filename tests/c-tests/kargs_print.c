@@ -0,0 +1,62 @@
+#define N00B_USE_INTERNAL_API
+#include "n00b.h"
+
+// Keyword arguments to a varargs function (n00b_print()), both the
+// way ncpp passes them (on the caller's stack), and hand-built w/
+// n00b_header_kargs().
+
+#define SEP(c)                                                  \
+    n00b_stack_kargs(((n00b_one_karg_t[]){                      \
+                         {"sep", n00b_karg_hash("sep"),         \
+                          (void *)(int64_t)(c)}}),              \
+                     1)
+
+static void
+detect_test(void)
+{
+    bool ok = true;
+
+    if (!n00b_is_kargs(SEP('_'))) {
+        ok = false;
+    }
+
+    if (!n00b_is_kargs(n00b_header_kargs("sep", (int64_t)'_'))) {
+        ok = false;
+    }
+
+    if (n00b_is_kargs(NULL) || n00b_is_kargs((void *)17)
+        || n00b_is_kargs(n00b_cstring("sep"))) {
+        ok = false;
+    }
+
+    // A stack address that isn't a keyword literal.
+    int64_t words[8] = {0};
+
+    if (n00b_is_kargs(&words[6])) {
+        ok = false;
+    }
+
+    n00b_print(n00b_cstring(ok ? "kargs detect: ok" : "kargs detect: FAIL"));
+}
+
+int
+main()
+{
+    n00b_terminal_app_setup();
+
+    detect_test();
+
+    n00b_print(n00b_cstring("print"),
+               n00b_cstring("stack"),
+               n00b_cstring("kargs"),
+               SEP('_'));
+    n00b_print(n00b_cstring("print"),
+               n00b_cstring("header"),
+               n00b_cstring("kargs"),
+               n00b_header_kargs("sep", (int64_t)'+'));
+    n00b_print(n00b_stdout(),
+               n00b_cstring("print"),
+               n00b_cstring("to"),
+               n00b_cstring("stream"),
+               SEP('.'));
+}
@@ -0,0 +1,259 @@
+#include "n00b.h"
+
+// The kernels for lists of ints and f64s, and the memcpy() paths for
+// plus, += and slices on lists of value items.
+
+static n00b_list_t *
+ints(n00b_type_t *t, int64_t *items, int n)
+{
+    n00b_list_t *l = n00b_list(t);
+
+    for (int i = 0; i < n; i++) {
+        n00b_list_append(l, (void *)items[i]);
+    }
+
+    return l;
+}
+
+static bool
+holds(n00b_list_t *l, int64_t *items, int n)
+{
+    if (n00b_list_len(l) != n) {
+        return false;
+    }
+
+    for (int i = 0; i < n; i++) {
+        if ((int64_t)n00b_list_get(l, i, NULL) != items[i]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static int
+cmp_signed(const void *a, const void *b)
+{
+    int64_t x = *(int64_t *)a;
+    int64_t y = *(int64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+static int
+cmp_unsigned(const void *a, const void *b)
+{
+    uint64_t x = *(uint64_t *)a;
+    uint64_t y = *(uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+static uint64_t rng = 0x9e3779b97f4a7c15ULL;
+
+static uint64_t
+next_rand(void)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+
+    return rng;
+}
+
+// Sorts 'n' items, w/ a mix of small, huge, and (as signed) negative
+// values, and checks against qsort(). Under 64 items goes through the
+// insertion sort; 64 and up goes through the radix sort.
+static bool
+sort_case(n00b_type_t *t, bool is_signed, int n)
+{
+    int64_t *items = n00b_gc_array_value_alloc(int64_t, n);
+
+    for (int i = 0; i < n; i++) {
+        switch (i % 4) {
+        case 0:
+            items[i] = (int64_t)next_rand();
+            break;
+        case 1:
+            items[i] = (int64_t)(next_rand() % 1000) - 500;
+            break;
+        case 2:
+            items[i] = (int64_t)(next_rand() % 300);
+            break;
+        default:
+            items[i] = (i / 4) & 1 ? INT64_MIN : INT64_MAX;
+            break;
+        }
+    }
+
+    n00b_list_t *l = ints(t, items, n);
+
+    qsort(items, n, sizeof(int64_t), is_signed ? cmp_signed : cmp_unsigned);
+    n00b_list_sort_ints(l);
+
+    return holds(l, items, n);
+}
+
+static void
+sort_test(void)
+{
+    int  sizes[] = {0, 1, 2, 63, 64, 65, 1000};
+    bool ok      = true;
+
+    for (unsigned int i = 0; i < sizeof(sizes) / sizeof(int); i++) {
+        if (!sort_case(n00b_type_int(), true, sizes[i])) {
+            printf("sort signed %d: FAIL\n", sizes[i]);
+            ok = false;
+        }
+        if (!sort_case(n00b_type_u64(), false, sizes[i])) {
+            printf("sort unsigned %d: FAIL\n", sizes[i]);
+            ok = false;
+        }
+    }
+
+    // Negatives only, where every key has the high bytes set.
+    int64_t negs[100];
+
+    for (int i = 0; i < 100; i++) {
+        negs[i] = -1 - ((i * 37) % 100);
+    }
+
+    n00b_list_t *l = ints(n00b_type_int(), negs, 100);
+
+    qsort(negs, 100, sizeof(int64_t), cmp_signed);
+    n00b_list_sort_ints(l);
+    ok = holds(l, negs, 100) && ok;
+
+    printf("list sort ints: %s\n", ok ? "ok" : "FAIL");
+}
+
+static void
+int_kernel_test(void)
+{
+    bool         err;
+    bool         ok    = true;
+    n00b_list_t *empty = n00b_list(n00b_type_int());
+
+    ok = ok && n00b_list_sum_ints(empty) == 0;
+    n00b_list_min_int(empty, &err);
+    ok = ok && err;
+    n00b_list_max_int(empty, &err);
+    ok = ok && err;
+
+    int64_t      items[] = {5, -3, 12, 0, -40, 7, 9};
+    n00b_list_t *l       = ints(n00b_type_int(), items, 7);
+
+    ok = ok && n00b_list_sum_ints(l) == -10;
+    ok = ok && n00b_list_min_int(l, &err) == -40 && !err;
+    ok = ok && n00b_list_max_int(l, &err) == 12 && !err;
+
+    // Unsigned compares above the sign bit as bigger, not negative.
+    int64_t      big[] = {3, (int64_t)0xfffffffffffffff0ULL, 1};
+    n00b_list_t *u     = ints(n00b_type_u64(), big, 3);
+
+    ok = ok && n00b_list_min_int(u, &err) == 1;
+    ok = ok && n00b_list_max_int(u, &err) == big[1];
+
+    // Overflow wraps, rather than being undefined.
+    int64_t      wrap[] = {INT64_MAX, 1, 0, 0, INT64_MAX, 2};
+    n00b_list_t *w      = ints(n00b_type_int(), wrap, 6);
+
+    ok = ok && n00b_list_sum_ints(w) == 1;
+
+    printf("list int kernels: %s\n", ok ? "ok" : "FAIL");
+}
+
+static n00b_list_t *
+floats(double *items, int n)
+{
+    n00b_list_t *l = n00b_list(n00b_type_f64());
+
+    for (int i = 0; i < n; i++) {
+        void *bits;
+
+        memcpy(&bits, &items[i], sizeof(double));
+        n00b_list_append(l, bits);
+    }
+
+    return l;
+}
+
+static void
+float_kernel_test(void)
+{
+    bool         err;
+    bool         ok    = true;
+    n00b_list_t *empty = n00b_list(n00b_type_f64());
+
+    ok = ok && n00b_list_sum_floats(empty) == 0;
+    n00b_list_min_float(empty, &err);
+    ok = ok && err;
+    n00b_list_max_float(empty, &err);
+    ok = ok && err;
+
+    double       items[] = {1.5, -2.25, 8.0, 0.25, 3.0};
+    n00b_list_t *l       = floats(items, 5);
+
+    ok = ok && n00b_list_sum_floats(l) == 10.5;
+    ok = ok && n00b_list_min_float(l, &err) == -2.25 && !err;
+    ok = ok && n00b_list_max_float(l, &err) == 8.0 && !err;
+
+    printf("list float kernels: %s\n", ok ? "ok" : "FAIL");
+}
+
+static void
+bulk_test(void)
+{
+    int64_t      a[]  = {1, 2, 3, 4, 5};
+    int64_t      b[]  = {-6, -7};
+    n00b_list_t *la   = ints(n00b_type_int(), a, 5);
+    n00b_list_t *lb   = ints(n00b_type_int(), b, 2);
+    bool         ok   = true;
+    int64_t      ab[] = {1, 2, 3, 4, 5, -6, -7};
+
+    ok = ok && holds(n00b_list_plus(la, lb), ab, 7);
+    ok = ok && holds(la, a, 5) && holds(lb, b, 2);
+
+    n00b_list_t *grown = ints(n00b_type_int(), a, 5);
+
+    // Enough to force a resize of the slots.
+    for (int i = 0; i < 10; i++) {
+        n00b_list_plus_eq(grown, lb);
+    }
+
+    ok = ok && n00b_list_len(grown) == 25;
+    ok = ok && (int64_t)n00b_list_get(grown, 24, NULL) == -7;
+    ok = ok && n00b_list_sum_ints(grown) == 15 - 130;
+
+    int64_t mid[]  = {2, 3, 4};
+    int64_t tail[] = {4, 5};
+
+    ok = ok && holds(n00b_list_get_slice(la, 1, 4), mid, 3);
+    ok = ok && holds(n00b_list_get_slice(la, -2, 100), tail, 2);
+    ok = ok && n00b_list_len(n00b_list_get_slice(la, 3, 2)) == 0;
+
+    // Replace the middle w/ something shorter, then longer.
+    n00b_list_t *s       = ints(n00b_type_int(), a, 5);
+    int64_t      short_r[] = {1, -6, -7, 5};
+
+    n00b_list_set_slice(s, 1, 4, lb);
+    ok = ok && holds(s, short_r, 4);
+
+    int64_t long_r[] = {1, 1, 2, 3, 4, 5, 5};
+
+    n00b_list_set_slice(s, 1, 3, la);
+    ok = ok && holds(s, long_r, 7);
+
+    printf("list bulk copies: %s\n", ok ? "ok" : "FAIL");
+}
+
+int
+main()
+{
+    n00b_terminal_app_setup();
+
+    sort_test();
+    int_kernel_test();
+    float_kernel_test();
+    bulk_test();
+}
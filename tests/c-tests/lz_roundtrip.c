@@ -0,0 +1,211 @@
+#include "n00b.h"
+
+static n00b_buf_t *
+new_buf(int64_t len)
+{
+    n00b_buf_t *result = n00b_new(n00b_type_buffer(),
+                                  n00b_header_kargs("length", len));
+
+    result->byte_len = len;
+
+    return result;
+}
+
+static bool
+round_trip(n00b_buf_t *b, int64_t *compressed_len)
+{
+    int64_t     len = n00b_buffer_len(b);
+    n00b_buf_t *c   = n00b_lz_compress(b);
+
+    if (c->byte_len < 0 || c->byte_len > n00b_lz_bound(len)) {
+        return false;
+    }
+
+    if (compressed_len) {
+        *compressed_len = c->byte_len;
+    }
+
+    n00b_buf_t *d = n00b_lz_decompress(c, len);
+
+    return n00b_buffer_len(d) == len && !memcmp(d->data, b->data, len);
+}
+
+static void
+report(char *name, bool ok)
+{
+    printf("lz %s: %s\n", name, ok ? "ok" : "FAIL");
+}
+
+// Sizes around the codec's and the stream filter's edges.
+static int64_t sizes[] = {
+    1,
+    N00B_LZ_LAST_LITERALS,
+    N00B_LZ_MFLIMIT,
+    N00B_LZ_MFLIMIT + 1,
+    255,
+    256,
+    N00B_LZ_MAX_OFFSET,
+    N00B_LZ_MAX_OFFSET + 1,
+    N00B_LZ_DEFAULT_BLOCK - 1,
+    N00B_LZ_DEFAULT_BLOCK,
+    N00B_LZ_DEFAULT_BLOCK + 1,
+    N00B_LZ_MAX_BLOCK,
+};
+
+#define NUM_SIZES (sizeof(sizes) / sizeof(int64_t))
+
+static void
+fill_random(n00b_buf_t *b)
+{
+    uint64_t *p = (uint64_t *)b->data;
+    int64_t   n = n00b_buffer_len(b) / 8;
+
+    for (int64_t i = 0; i < n; i++) {
+        p[i] = n00b_rand64();
+    }
+    for (int64_t i = n * 8; i < n00b_buffer_len(b); i++) {
+        b->data[i] = (char)n00b_rand64();
+    }
+}
+
+static bool
+all_sizes(n00b_buf_t *src)
+{
+    for (unsigned int i = 0; i < NUM_SIZES; i++) {
+        n00b_buf_t *b = new_buf(sizes[i]);
+
+        memcpy(b->data, src->data, sizes[i]);
+
+        if (!round_trip(b, NULL)) {
+            printf("(failed at %lld bytes)\n", (long long)sizes[i]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void
+collect(n00b_list_t *pieces, void *value)
+{
+    n00b_list_append(pieces, value);
+}
+
+static n00b_buf_t *
+join(n00b_list_t *pieces)
+{
+    int     n   = n00b_list_len(pieces);
+    int64_t len = 0;
+
+    for (int i = 0; i < n; i++) {
+        len += n00b_buffer_len(n00b_list_get(pieces, i, NULL));
+    }
+
+    n00b_buf_t *result = new_buf(len);
+    char       *p      = result->data;
+
+    for (int i = 0; i < n; i++) {
+        n00b_buf_t *piece = n00b_list_get(pieces, i, NULL);
+
+        memcpy(p, piece->data, piece->byte_len);
+        p += piece->byte_len;
+    }
+
+    return result;
+}
+
+// Compresses through the write filter in uneven writes, then feeds
+// the frames, split at odd places, through the decompressor.
+static bool
+filter_round_trip(n00b_buf_t *src)
+{
+    int64_t        len    = n00b_buffer_len(src);
+    n00b_list_t   *frames = n00b_list(n00b_type_buffer());
+    n00b_list_t   *out    = n00b_list(n00b_type_buffer());
+    n00b_stream_t *cs;
+    n00b_stream_t *ds;
+
+    cs = n00b_new_callback_stream(collect,
+                                  frames,
+                                  n00b_filter_compress(false, 0, 60000));
+    ds = n00b_new_callback_stream(collect,
+                                  out,
+                                  n00b_filter_decompress(true));
+
+    for (int64_t i = 0, n = 1; i < len; i += n, n = n * 3 + 1) {
+        n00b_write(cs, n00b_slice_get(src, i, n00b_min(i + n, len)));
+    }
+
+    n00b_flush(cs);
+
+    n00b_buf_t *all  = join(frames);
+    int64_t     flen = n00b_buffer_len(all);
+
+    for (int64_t i = 0; i < flen; i += 7777) {
+        n00b_write(ds, n00b_slice_get(all, i, n00b_min(i + 7777, flen)));
+    }
+
+    n00b_buf_t *result = join(out);
+
+    return n00b_buffer_len(result) == len
+        && !memcmp(result->data, src->data, len);
+}
+
+// A partial block should go out once it's old enough, even if nothing
+// else gets written.
+static bool
+idle_flush(void)
+{
+    n00b_list_t   *frames = n00b_list(n00b_type_buffer());
+    n00b_stream_t *cs     = n00b_new_callback_stream(
+        collect,
+        frames,
+        n00b_filter_compress(false, 0, 20));
+
+    n00b_write(cs, n00b_cstring("quiet"));
+
+    for (int i = 0; i < 200 && !n00b_list_len(frames); i++) {
+        usleep(10000);
+    }
+
+    if (n00b_list_len(frames) != 1) {
+        return false;
+    }
+
+    n00b_list_t   *out = n00b_list(n00b_type_buffer());
+    n00b_stream_t *ds  = n00b_new_callback_stream(collect,
+                                                 out,
+                                                 n00b_filter_decompress(true));
+
+    n00b_write(ds, n00b_list_get(frames, 0, NULL));
+
+    n00b_buf_t *result = join(out);
+
+    return n00b_buffer_len(result) == 5 && !memcmp(result->data, "quiet", 5);
+}
+
+int
+main()
+{
+    n00b_terminal_app_setup();
+
+    int64_t     max = N00B_LZ_MAX_BLOCK;
+    n00b_buf_t *src = new_buf(max);
+    int64_t     clen;
+
+    report("empty", round_trip(new_buf(0), NULL));
+
+    fill_random(src);
+    report("incompressible", all_sizes(src));
+
+    memset(src->data, 'a', max);
+    report("long matches", all_sizes(src) && round_trip(src, &clen)
+                               && clen < max / 100);
+
+    for (int64_t i = 0; i < max; i++) {
+        src->data[i] = "n00b says hi, "[i % 14] ^ ((i / 70000) & 1);
+    }
+    report("block boundaries", all_sizes(src));
+    report("stream filters", filter_round_trip(src));
+    report("idle flush", idle_flush());
+}
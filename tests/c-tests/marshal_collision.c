@@ -0,0 +1,95 @@
+#include "n00b.h"
+
+// Words that happen to look like addresses in the marshaler's virtual
+// heap get zeroed on the way out, and backpatched on the way in. This
+// checks that both marshal paths round-trip them.
+
+static void
+collect(n00b_list_t *pieces, void *value)
+{
+    n00b_list_append(pieces, value);
+}
+
+static n00b_buf_t *
+join(n00b_list_t *pieces)
+{
+    int     n   = n00b_list_len(pieces);
+    int64_t len = 0;
+
+    for (int i = 0; i < n; i++) {
+        len += n00b_buffer_len(n00b_list_get(pieces, i, NULL));
+    }
+
+    n00b_buf_t *result = n00b_new(n00b_type_buffer(),
+                                  n00b_header_kargs("length", len));
+    char       *p      = result->data;
+
+    result->byte_len = len;
+
+    for (int i = 0; i < n; i++) {
+        n00b_buf_t *piece = n00b_list_get(pieces, i, NULL);
+
+        memcpy(p, piece->data, piece->byte_len);
+        p += piece->byte_len;
+    }
+
+    return result;
+}
+
+static uint64_t low_bits[] = {0x0, 0x28, 0x1000, 0xfff8};
+
+#define NUM_WORDS (sizeof(low_bits) / sizeof(uint64_t))
+
+static void
+collision_test(char *name, n00b_filter_spec_t *f)
+{
+    n00b_list_t   *pieces = n00b_list(n00b_type_buffer());
+    n00b_stream_t *s      = n00b_new_callback_stream(collect, pieces, f);
+
+    // The first write just gets us the virtual heap base, which comes
+    // right after the magic value at the start of the stream.
+    n00b_write(s, n00b_cstring("base"));
+
+    n00b_buf_t  *first = n00b_list_get(pieces, 0, NULL);
+    uint64_t     base  = ((uint64_t *)first->data)[1];
+    n00b_list_t *l     = n00b_list(n00b_type_ref());
+
+    for (unsigned int i = 0; i < NUM_WORDS; i++) {
+        n00b_list_append(l, (void *)(base | low_bits[i]));
+    }
+
+    n00b_write(s, l);
+
+    n00b_list_t   *objs = n00b_list(n00b_type_ref());
+    n00b_stream_t *u    = n00b_new_callback_stream(collect,
+                                                objs,
+                                                n00b_filter_unmarshal(true));
+
+    n00b_write(u, join(pieces));
+
+    if (n00b_list_len(objs) != 2) {
+        printf("%s: FAIL (got %lld objects)\n",
+               name,
+               (long long)n00b_list_len(objs));
+        return;
+    }
+
+    n00b_list_t *copy = n00b_list_get(objs, 1, NULL);
+    bool         ok   = n00b_list_len(copy) == NUM_WORDS;
+
+    for (unsigned int i = 0; ok && i < NUM_WORDS; i++) {
+        uint64_t w = (uint64_t)n00b_list_get(copy, i, NULL);
+        ok         = (w == (base | low_bits[i]));
+    }
+
+    printf("%s: %s\n", name, ok ? "ok" : "FAIL");
+}
+
+int
+main()
+{
+    n00b_terminal_app_setup();
+
+    collision_test("serial", n00b_filter_marshal(false));
+    collision_test("parallel", n00b_filter_marshal_parallel(false, 4));
+}
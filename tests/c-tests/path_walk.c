@@ -0,0 +1,106 @@
+#include "n00b.h"
+
+// Walks a small tree w/ symlinks that loop back up it. The collected
+// results should be sorted, the same however many workers there are,
+// and following the links shouldn't loop.
+
+static char *files[] = {"a/x", "a/y", "b/z", "c", "d/e/f/g"};
+
+#define NUM_FILES (sizeof(files) / sizeof(char *))
+
+static void
+make_file(char *root, char *rel)
+{
+    char path[PATH_MAX];
+    char dirs[PATH_MAX];
+
+    snprintf(path, PATH_MAX, "%s/%s", root, rel);
+    strcpy(dirs, path);
+
+    for (char *p = dirs + strlen(root) + 1; *p; p++) {
+        if (*p == '/') {
+            *p = 0;
+            mkdir(dirs, 0755);
+            *p = '/';
+        }
+    }
+
+    close(open(path, O_CREAT | O_WRONLY, 0644));
+}
+
+static bool
+check(char *name, n00b_list_t *results, n00b_string_t *root)
+{
+    int n = n00b_list_len(results);
+
+    if (n != (int)NUM_FILES) {
+        printf("%s: FAIL (got %d results)\n", name, n);
+        return false;
+    }
+
+    for (int i = 0; i < n; i++) {
+        n00b_string_t *s   = n00b_list_get(results, i, NULL);
+        char          *rel = s->data + root->u8_bytes + 1;
+
+        if (strncmp(s->data, root->data, root->u8_bytes)
+            || strcmp(rel, files[i])) {
+            printf("%s: FAIL (%s at %d)\n", name, s->data, i);
+            return false;
+        }
+    }
+
+    printf("%s: ok\n", name);
+    return true;
+}
+
+static bool
+stop_early(n00b_string_t *path, n00b_file_kind kind, int *count)
+{
+    return ++*count < 2;
+}
+
+int
+main()
+{
+    n00b_terminal_app_setup();
+
+    n00b_string_t *tmp  = n00b_new_temp_dir(n00b_cstring("walk"), NULL);
+    n00b_string_t *root = n00b_resolve_path(tmp);
+    char           link[PATH_MAX];
+
+    for (unsigned int i = 0; i < NUM_FILES; i++) {
+        make_file(root->data, files[i]);
+    }
+
+    snprintf(link, PATH_MAX, "%s/a/up", root->data);
+    symlink("..", link);
+    snprintf(link, PATH_MAX, "%s/b/self", root->data);
+    symlink(".", link);
+    snprintf(link, PATH_MAX, "%s/d/e/top", root->data);
+    symlink(root->data, link);
+
+    check("walk sorted", n00b_path_walk(root), root);
+    check("walk one worker",
+          n00b_path_walk(root, n00b_header_kargs("workers", 1ULL)),
+          root);
+    check("walk link cycles",
+          n00b_path_walk(root, n00b_header_kargs("follow_links", 1ULL)),
+          root);
+    check("walk link cycles, one worker",
+          n00b_path_walk(root,
+                         n00b_header_kargs("follow_links",
+                                           1ULL,
+                                           "workers",
+                                           1ULL)),
+          root);
+
+    int count = 0;
+
+    n00b_path_walk_each(root, (n00b_walk_cb)stop_early, &count);
+    printf("walk stop: %s\n", count == 2 ? "ok" : "FAIL");
+
+    char cmd[PATH_MAX + 16];
+
+    snprintf(cmd, sizeof(cmd), "rm -rf '%s'", root->data);
+    system(cmd);
+}
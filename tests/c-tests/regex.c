@@ -56,9 +56,9 @@ regex_test(n00b_buf_t *b)
         n00b_match_t  *m = n00b_list_get(l, i, NULL);
         n00b_string_t *cap;
 
-        if (m->captures) {
-            assert(n00b_list_len(m->captures) == 1);
-            cap = n00b_list_pop(m->captures);
+        if (n00b_match_num_captures(m)) {
+            assert(n00b_match_num_captures(m) == 1);
+            cap = n00b_match_capture(m, 0);
         }
         else {
             cap = n00b_cstring("<<None>>");
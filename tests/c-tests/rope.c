@@ -0,0 +1,191 @@
+#include "n00b.h"
+#include <pthread.h>
+
+// Concatenation, fragment order, flattening, and writing a rope w/
+// more fragments than IOV_MAX, and more bytes than the pipe holds, to
+// a non-blocking pipe that's read slowly, so writev() comes up short.
+
+static bool
+same(n00b_buf_t *b, char *expected, int64_t len)
+{
+    return b->byte_len == len && !memcmp(b->data, expected, len);
+}
+
+static void
+concat_test(void)
+{
+    n00b_rope_t *hello = n00b_rope_from_string(n00b_cstring("hello, "));
+    n00b_rope_t *world = n00b_rope_from_string(n00b_cstring("world"));
+    n00b_rope_t *empty = n00b_rope_empty();
+    n00b_rope_t *both  = n00b_rope_concat(hello, world);
+    bool         ok    = true;
+
+    ok = ok && n00b_rope_len(both) == 12;
+    ok = ok && same(n00b_rope_to_buffer(both), "hello, world", 12);
+    ok = ok && n00b_rope_concat(empty, hello) == hello;
+    ok = ok && n00b_rope_concat(hello, empty) == hello;
+    ok = ok && n00b_rope_concat(NULL, world) == world;
+
+    n00b_buf_t  *b    = n00b_buffer_from_bytes("!", 1);
+    n00b_rope_t *leaf = n00b_rope_from_buffer(b);
+
+    ok = ok && leaf->source == b;
+    ok = ok && hello->source != NULL;
+
+    n00b_rope_t *more = n00b_rope_append_buffer(both, b);
+
+    ok = ok && same(n00b_rope_to_buffer(more), "hello, world!", 13);
+
+    printf("rope concat: %s\n", ok ? "ok" : "FAIL");
+}
+
+static char *digits = "0123456789";
+
+static n00b_rope_t *
+digit(int i)
+{
+    return n00b_rope_from_buffer(n00b_buffer_from_bytes(digits + i, 1));
+}
+
+static void
+iovec_test(void)
+{
+    // Left-leaning for the first half, right-leaning for the second,
+    // then joined.
+    n00b_rope_t *left  = NULL;
+    n00b_rope_t *right = NULL;
+
+    for (int i = 0; i < 5; i++) {
+        left = n00b_rope_concat(left, digit(i));
+    }
+
+    for (int i = 9; i >= 5; i--) {
+        right = n00b_rope_concat(digit(i), right);
+    }
+
+    n00b_rope_t  *r = n00b_rope_concat(left, right);
+    int           n;
+    struct iovec *iov = n00b_rope_iovec(r, &n);
+    bool          ok  = n == 10;
+
+    for (int i = 0; ok && i < n; i++) {
+        ok = iov[i].iov_len == 1 && *(char *)iov[i].iov_base == digits[i];
+    }
+
+    printf("rope iovec order: %s\n", ok ? "ok" : "FAIL");
+}
+
+static void
+flatten_test(void)
+{
+    n00b_rope_t *r = NULL;
+
+    for (int i = 0; i < 10; i++) {
+        r = n00b_rope_append_string(r, n00b_cstring("ab"));
+    }
+
+    n00b_buf_t *flat = n00b_rope_to_buffer(r);
+    bool        ok   = same(flat, "abababababababababab", 20);
+
+    // The flattened bytes get cached, and count as one fragment for
+    // ropes built on top.
+    ok = ok && n00b_rope_to_buffer(r) == flat;
+
+    n00b_rope_t  *r2 = n00b_rope_append_string(r, n00b_cstring("c"));
+    int           n;
+    struct iovec *iov = n00b_rope_iovec(r2, &n);
+
+    ok = ok && n == 2 && iov[0].iov_base == flat->data;
+    ok = ok && iov[0].iov_len == 20;
+    ok = ok && same(n00b_rope_to_buffer(r2), "ababababababababababc", 21);
+
+    printf("rope flatten: %s\n", ok ? "ok" : "FAIL");
+}
+
+#define FRAG_LEN  200
+#define NUM_FRAGS 1500
+#define TOTAL_LEN (FRAG_LEN * NUM_FRAGS)
+
+typedef struct {
+    int   fd;
+    char *out;
+} reader_t;
+
+static void *
+slow_reader(reader_t *r)
+{
+    int64_t got = 0;
+
+    while (got < TOTAL_LEN) {
+        // Small reads, w/ a pause, so the writer keeps filling the
+        // pipe and getting partial writes.
+        ssize_t n = read(r->fd, r->out + got, n00b_min(TOTAL_LEN - got, 777));
+
+        if (n <= 0) {
+            break;
+        }
+
+        got += n;
+        usleep(50);
+    }
+
+    return NULL;
+}
+
+static void
+write_fd_test(void)
+{
+    char        *expected = malloc(TOTAL_LEN);
+    n00b_rope_t *r        = NULL;
+
+    for (int i = 0; i < NUM_FRAGS; i++) {
+        n00b_buf_t *b = n00b_new(n00b_type_buffer(),
+                                 n00b_header_kargs("length",
+                                                   (int64_t)FRAG_LEN));
+
+        for (int j = 0; j < FRAG_LEN; j++) {
+            b->data[j] = (char)(i * 7 + j);
+        }
+
+        memcpy(expected + i * FRAG_LEN, b->data, FRAG_LEN);
+        r = n00b_rope_append_buffer(r, b);
+    }
+
+    int fds[2];
+
+    if (pipe(fds)) {
+        printf("rope write_fd: FAIL (pipe)\n");
+        return;
+    }
+
+    fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+
+    reader_t  rd = {.fd = fds[0], .out = calloc(1, TOTAL_LEN)};
+    pthread_t t;
+
+    pthread_create(&t, NULL, (void *(*)(void *))slow_reader, &rd);
+
+    int64_t written = n00b_rope_write_fd(r, fds[1]);
+
+    close(fds[1]);
+    pthread_join(t, NULL);
+    close(fds[0]);
+
+    bool ok = written == TOTAL_LEN && !memcmp(rd.out, expected, TOTAL_LEN);
+
+    printf("rope write_fd: %s\n", ok ? "ok" : "FAIL");
+
+    free(rd.out);
+    free(expected);
+}
+
+int
+main()
+{
+    n00b_terminal_app_setup();
+
+    concat_test();
+    iovec_test();
+    flatten_test();
+    write_fd_test();
+}
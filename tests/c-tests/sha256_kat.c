@@ -0,0 +1,209 @@
+#include "n00b.h"
+
+// NIST known answers for SHA-256, run against every backend this CPU
+// can use, on both the one-shot and the incremental interfaces. The
+// multi-buffer batch mixes lengths that straddle the padding cases,
+// and has more inputs than there are AVX2 lanes, so lanes refill.
+
+typedef struct {
+    char *name;
+    char *digest;
+} kat_t;
+
+static const char *msg448 =
+    "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+
+static kat_t kats[] = {
+    {"empty",
+     "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"},
+    {"abc",
+     "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"},
+    {"448 bits",
+     "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"},
+    {"million a",
+     "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"},
+};
+
+#define NUM_KATS  (sizeof(kats) / sizeof(kat_t))
+#define MILLION   1000000
+#define NUM_MULTI 13
+
+static char *backends[] = {"portable", "sha-ni", "avx2", "armv8"};
+
+#define NUM_BACKENDS (sizeof(backends) / sizeof(char *))
+
+static uint8_t *million_a;
+
+static void
+hex(const uint8_t *digest, char *out)
+{
+    for (int i = 0; i < N00B_SHA256_LEN; i++) {
+        sprintf(out + i * 2, "%02x", digest[i]);
+    }
+}
+
+static bool
+matches(const uint8_t *digest, const char *expected)
+{
+    char s[N00B_SHA256_LEN * 2 + 1];
+
+    hex(digest, s);
+
+    return !strcmp(s, expected);
+}
+
+static const uint8_t *
+kat_input(int i, size_t *len)
+{
+    switch (i) {
+    case 0:
+        *len = 0;
+        return (const uint8_t *)"";
+    case 1:
+        *len = 3;
+        return (const uint8_t *)"abc";
+    case 2:
+        *len = strlen(msg448);
+        return (const uint8_t *)msg448;
+    default:
+        *len = MILLION;
+        return million_a;
+    }
+}
+
+static bool
+check_kats(char *backend)
+{
+    uint8_t digest[N00B_SHA256_LEN];
+    bool    ok = true;
+
+    for (unsigned int i = 0; i < NUM_KATS; i++) {
+        size_t         len;
+        const uint8_t *p = kat_input(i, &len);
+
+        n00b_sha256_raw(p, len, digest);
+
+        if (!matches(digest, kats[i].digest)) {
+            printf("%s %s: FAIL (one-shot)\n", backend, kats[i].name);
+            ok = false;
+        }
+
+        // Feed it in odd-sized pieces, so the partial block buffering
+        // gets exercised too.
+        n00b_sha256_ctx_t ctx;
+        size_t            off = 0;
+        size_t            step = 1;
+
+        n00b_sha256_ctx_init(&ctx);
+
+        while (off < len) {
+            size_t n = len - off < step ? len - off : step;
+
+            n00b_sha256_ctx_update(&ctx, p + off, n);
+            off += n;
+            step = step * 3 + 7;
+        }
+
+        n00b_sha256_ctx_final(&ctx, digest);
+
+        if (!matches(digest, kats[i].digest)) {
+            printf("%s %s: FAIL (incremental)\n", backend, kats[i].name);
+            ok = false;
+        }
+    }
+
+    return ok;
+}
+
+static int64_t multi_lens[NUM_MULTI] = {
+    0, 3, 56, MILLION, 1, 55, 63, 64, 65, 119, 120, 200, 4097,
+};
+
+// Answers for the batch come from the portable code, one input at a
+// time; if that's wrong, its own known answers fail.
+static uint8_t multi_expected[NUM_MULTI][N00B_SHA256_LEN];
+
+static n00b_list_t *
+multi_inputs(void)
+{
+    n00b_list_t *l = n00b_list(n00b_type_buffer());
+
+    for (int i = 0; i < NUM_MULTI; i++) {
+        int64_t     len = multi_lens[i];
+        n00b_buf_t *b   = n00b_new(n00b_type_buffer(),
+                                 n00b_header_kargs("length", len));
+
+        if (i < (int)NUM_KATS) {
+            size_t kat_len;
+
+            memcpy(b->data, kat_input(i, &kat_len), len);
+        }
+        else {
+            for (int64_t j = 0; j < len; j++) {
+                b->data[j] = (char)(i * 31 + j);
+            }
+        }
+
+        n00b_list_append(l, b);
+    }
+
+    return l;
+}
+
+static bool
+check_multi(char *backend, n00b_list_t *inputs)
+{
+    n00b_list_t *digests = n00b_sha256_multi(inputs);
+    bool         ok      = n00b_list_len(digests) == NUM_MULTI;
+
+    for (int i = 0; ok && i < NUM_MULTI; i++) {
+        n00b_buf_t *d = n00b_list_get(digests, i, NULL);
+
+        if (memcmp(d->data, multi_expected[i], N00B_SHA256_LEN)) {
+            printf("%s multi[%d]: FAIL\n", backend, i);
+            ok = false;
+        }
+    }
+
+    return ok;
+}
+
+int
+main()
+{
+    n00b_terminal_app_setup();
+
+    million_a = n00b_gc_array_value_alloc(uint8_t, MILLION);
+    memset(million_a, 'a', MILLION);
+
+    printf("default backend: %s\n", n00b_sha256_backend_name());
+
+    n00b_list_t *inputs = multi_inputs();
+
+    n00b_sha256_set_backend("portable");
+
+    for (int i = 0; i < NUM_MULTI; i++) {
+        n00b_buf_t *b = n00b_list_get(inputs, i, NULL);
+
+        n00b_sha256_raw(b->data, b->byte_len, multi_expected[i]);
+    }
+
+    bool all_ok = true;
+
+    for (unsigned int i = 0; i < NUM_BACKENDS; i++) {
+        char *backend = backends[i];
+
+        if (!n00b_sha256_set_backend(backend)) {
+            continue;
+        }
+
+        bool ok = check_kats(backend);
+
+        ok     = check_multi(backend, inputs) && ok;
+        all_ok = all_ok && ok;
+
+        printf("%s: %s\n", backend, ok ? "ok" : "FAIL");
+    }
+
+    printf("sha256 known answers: %s\n", all_ok ? "ok" : "FAIL");
+}